@@ -0,0 +1,76 @@
+#!/bin/bash
+# 只用引擎自带的工具测量启动时间和常驻内存，不依赖项目代码，因此可以在任意版本上运行，
+# 用来对比软引用异步加载前后（或任意两个版本）的差异：
+#   启动时间: 日志中的 "(Engine Initialization) Total time" 和 "Took ... seconds to LoadMap"
+#   常驻内存: 地图加载后执行的 memreport -full（Process Physical Memory），
+#             以及 -LLM -LLMCSV 在运行结束时的各标签内存（Total、Meshes、Textures、Particles）
+# 结果写入 Saved/AssetFootprint/<标签>_<server|game>.txt；before 和 after 都存在时并排输出。
+#
+# 用法: Scripts/AssetFootprint.sh <UE4Editor 可执行文件> <标签> [server|game=server] [运行秒数=60]
+# 例如，分别在两个版本上编译后运行：
+#   git checkout <旧版本> && <编译> && Scripts/AssetFootprint.sh ~/UnrealEngine/Engine/Binaries/Linux/UE4Editor before
+#   git checkout <新版本> && <编译> && Scripts/AssetFootprint.sh ~/UnrealEngine/Engine/Binaries/Linux/UE4Editor after
+
+set -e
+
+EDITOR="$1"
+LABEL="$2"
+MODE="${3:-server}"
+RUN_SECONDS="${4:-60}"
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+PROJECT="$PROJECT_DIR/MultiplayerGame_Demo.uproject"
+MAP="/Game/ThirdPersonCPP/Maps/ThirdPersonExampleMap"
+OUT_DIR="$PROJECT_DIR/Saved/AssetFootprint"
+
+if [ ! -x "$EDITOR" ] || [ -z "$LABEL" ] || { [ "$MODE" != "server" ] && [ "$MODE" != "game" ]; }; then
+	echo "usage: $0 <path to UE4Editor> <label> [server|game] [seconds]" >&2
+	exit 1
+fi
+
+mkdir -p "$OUT_DIR"
+LOG="$OUT_DIR/${LABEL}_${MODE}.log"
+RESULT="$OUT_DIR/${LABEL}_${MODE}.txt"
+MEMREPORT_DIR="$PROJECT_DIR/Saved/Profiling/MemReports"
+LLM_DIR="$PROJECT_DIR/Saved/Profiling/LLM"
+rm -rf "$MEMREPORT_DIR" "$LLM_DIR"
+
+# memreport 在第一帧执行，此时地图已经加载完；LLM 的 CSV 持续写入，运行结束时的最后一行是稳定后的内存。
+timeout --signal=INT "$RUN_SECONDS" "$EDITOR" "$PROJECT" "$MAP" "-$MODE" -nullrhi -nosound -unattended -nopause \
+	-LLM -LLMCSV -ExecCmds="memreport -full" -abslog="$LOG" || true
+
+{
+	echo "Revision: $(git -C "$PROJECT_DIR" rev-parse --short HEAD)"
+	grep -o "(Engine Initialization) Total time: [0-9.]* seconds" "$LOG" | head -1 || true
+	grep -o "Took [0-9.]* seconds to LoadMap([^)]*)" "$LOG" | head -1 || true
+
+	MEMREPORT="$(find "$MEMREPORT_DIR" -name '*.memreport' 2>/dev/null | head -1)"
+	if [ -n "$MEMREPORT" ]; then
+		grep -m1 "Process Physical Memory" "$MEMREPORT" | sed 's/^[[:space:]]*/memreport /'
+	else
+		echo "memreport: not written"
+	fi
+
+	LLM_CSV="$(ls -t "$LLM_DIR"/*.csv 2>/dev/null | head -1)"
+	if [ -n "$LLM_CSV" ]; then
+		# 按表头取列，不同平台的标签集合不完全相同，缺失的列不输出。
+		awk -F, 'NR == 1 { for (i = 1; i <= NF; ++i) column[$i] = i; next } { last = $0 }
+			END {
+				split(last, value, ",")
+				n = split("Total,Meshes,Textures,Particles,UObject", tags, ",")
+				for (t = 1; t <= n; ++t) if (tags[t] in column) printf "LLM %s: %s MB\n", tags[t], value[column[tags[t]]]
+			}' "$LLM_CSV"
+	else
+		echo "LLM: no csv written"
+	fi
+} > "$RESULT"
+
+cat "$RESULT"
+
+BEFORE="$OUT_DIR/before_${MODE}.txt"
+AFTER="$OUT_DIR/after_${MODE}.txt"
+if [ -f "$BEFORE" ] && [ -f "$AFTER" ]; then
+	echo
+	echo "before | after ($MODE)"
+	paste -d'|' "$BEFORE" "$AFTER"
+fi
@@ -0,0 +1,46 @@
+#!/bin/bash
+# 无头负载测试：在本机启动一个专用服务器和 N 个 -nullrhi 客户端机器人，通过回环地址连接。
+# 服务器按阶段增加服务器端机器人，结束后把报告写入 Saved/LoadTest 并退出。
+#
+# 用法: Scripts/LoadTest.sh <UE4Editor 可执行文件> [客户端数量=4] [其余服务器参数...]
+# 例如: Scripts/LoadTest.sh ~/UnrealEngine/Engine/Binaries/Linux/UE4Editor 8 -LoadTestBots=64 -LoadTestBotStep=8 -LoadTestStepSeconds=30
+# 环境变量 LOADTEST_CLIENT_EXEC 不为空时，作为 -ExecCmds 传给每个客户端（例如 "mp.Move.Compact 0"）。
+
+set -e
+
+EDITOR="$1"
+shift || true
+NUM_CLIENTS="${1:-4}"
+shift || true
+
+PROJECT="$(cd "$(dirname "$0")/.." && pwd)/MultiplayerGame_Demo.uproject"
+MAP="/Game/ThirdPersonCPP/Maps/ThirdPersonExampleMap"
+PORT=7777
+
+if [ ! -x "$EDITOR" ]; then
+	echo "usage: $0 <path to UE4Editor> [num clients] [server args...]" >&2
+	exit 1
+fi
+
+"$EDITOR" "$PROJECT" "$MAP" -server -nullrhi -nosound -unattended -log -Port=$PORT -LoadTest "$@" &
+SERVER_PID=$!
+
+# 等待服务器开始监听
+sleep 15
+
+CLIENT_ARGS=()
+if [ -n "$LOADTEST_CLIENT_EXEC" ]; then
+	CLIENT_ARGS+=("-ExecCmds=$LOADTEST_CLIENT_EXEC")
+fi
+
+CLIENT_PIDS=()
+for ((i = 0; i < NUM_CLIENTS; i++)); do
+	"$EDITOR" "$PROJECT" 127.0.0.1:$PORT -game -nullrhi -nosound -unattended -LoadTestBot -LoadTestSeed=$i -log=LoadTestClient$i.log "${CLIENT_ARGS[@]}" &
+	CLIENT_PIDS+=($!)
+done
+
+wait $SERVER_PID
+kill "${CLIENT_PIDS[@]}" 2>/dev/null || true
+wait
+
+echo "Reports: $(dirname "$PROJECT")/Saved/LoadTest"
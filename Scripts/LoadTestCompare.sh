@@ -0,0 +1,45 @@
+#!/bin/bash
+# 用负载测试对比一个控制台变量取 0 和 1 时的带宽与服务器帧时间。
+# 两次运行使用相同的客户端数量、机器人、输入脚本和种子，结束后把两次最后一个阶段的结果
+# 写入 Saved/LoadTest/<变量名>_Compare.csv 并输出。
+#
+# 用法: Scripts/LoadTestCompare.sh <UE4Editor 可执行文件> <server|client> <控制台变量> [客户端数量=4] [其余服务器参数...]
+#   server: 变量在服务器上设置（例如 mp.Net.AdaptiveUpdateRate，比较服务器发出的字节）
+#   client: 变量在每个客户端上设置（例如 mp.Move.Compact，比较服务器收到的字节）
+# 例如: Scripts/LoadTestCompare.sh ~/UnrealEngine/Engine/Binaries/Linux/UE4Editor server mp.Net.AdaptiveUpdateRate 8 -LoadTestBots=32 -LoadTestStepSeconds=60
+
+set -e
+
+EDITOR="$1"
+SIDE="$2"
+CVAR="$3"
+NUM_CLIENTS="${4:-4}"
+shift 4 || shift $#
+
+SCRIPTS="$(cd "$(dirname "$0")" && pwd)"
+REPORT_DIR="$(dirname "$SCRIPTS")/Saved/LoadTest"
+
+if [ ! -x "$EDITOR" ] || [ -z "$CVAR" ] || { [ "$SIDE" != "server" ] && [ "$SIDE" != "client" ]; }; then
+	echo "usage: $0 <path to UE4Editor> <server|client> <console variable> [num clients] [server args...]" >&2
+	exit 1
+fi
+
+SUMMARY="$REPORT_DIR/${CVAR}_Compare.csv"
+mkdir -p "$REPORT_DIR"
+echo "$CVAR,Players,FrameMsP90,AvgOutBytesPerConnection,AvgInBytesPerConnection,Report" > "$SUMMARY"
+
+for VALUE in 0 1; do
+	REPORT="${CVAR}_${VALUE}"
+	if [ "$SIDE" = "server" ]; then
+		LOADTEST_CLIENT_EXEC="" "$SCRIPTS/LoadTest.sh" "$EDITOR" "$NUM_CLIENTS" -LoadTestReport="$REPORT" "-ExecCmds=$CVAR $VALUE" "$@"
+	else
+		LOADTEST_CLIENT_EXEC="$CVAR $VALUE" "$SCRIPTS/LoadTest.sh" "$EDITOR" "$NUM_CLIENTS" -LoadTestReport="$REPORT" "$@"
+	fi
+
+	CSV="$(ls -t "$REPORT_DIR/${REPORT}"_*.csv | head -1)"
+	# 最后一个阶段的负载最高：Players, FrameMsP90, AvgOutBytesPerConnection, AvgInBytesPerConnection
+	tail -1 "$CSV" | awk -F, -v value="$VALUE" -v report="$(basename "$CSV")" '{ printf "%s,%s,%s,%s,%s,%s\n", value, $4, $6, $10, $12, report }' >> "$SUMMARY"
+done
+
+echo "Comparison written to $SUMMARY"
+cat "$SUMMARY"
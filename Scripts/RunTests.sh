@@ -0,0 +1,39 @@
+#!/bin/bash
+# 无头运行项目的自动化测试（Source/MultiplayerGame_Demo/Private/Tests，测试名以 MultiplayerGame. 开头）。
+# 任何测试失败、或者没有运行任何测试时返回非零，报告写入 Saved/Automation/Reports。
+#
+# 用法: Scripts/RunTests.sh <UE4Editor 可执行文件> [测试过滤=MultiplayerGame]
+# 例如: Scripts/RunTests.sh ~/UnrealEngine/Engine/Binaries/Linux/UE4Editor MultiplayerGame.LagCompensation
+
+EDITOR="$1"
+FILTER="${2:-MultiplayerGame}"
+
+PROJECT="$(cd "$(dirname "$0")/.." && pwd)/MultiplayerGame_Demo.uproject"
+REPORT_DIR="$(dirname "$PROJECT")/Saved/Automation/Reports"
+
+if [ ! -x "$EDITOR" ]; then
+	echo "usage: $0 <path to UE4Editor> [test filter]" >&2
+	exit 1
+fi
+
+rm -rf "$REPORT_DIR"
+
+# 编辑器的退出码不反映测试结果，以报告为准。
+"$EDITOR" "$PROJECT" -ExecCmds="Automation RunTests $FILTER" -TestExit="Automation Test Queue Empty" \
+	-ReportExportPath="$REPORT_DIR" -nullrhi -nosound -unattended -nopause -log || true
+
+REPORT="$REPORT_DIR/index.json"
+if [ ! -f "$REPORT" ]; then
+	echo "No automation report at $REPORT" >&2
+	exit 1
+fi
+
+count() {
+	grep -o "\"$1\": *[0-9]*" "$REPORT" | head -1 | grep -o '[0-9]*$'
+}
+
+SUCCEEDED=$(( $(count succeeded) + $(count succeededWithWarnings) ))
+FAILED=$(count failed)
+echo "Automation tests: $SUCCEEDED succeeded, $FAILED failed (report: $REPORT_DIR)"
+
+[ "$FAILED" -eq 0 ] && [ "$SUCCEEDED" -gt 0 ]
@@ -9,6 +9,7 @@ public class MultiplayerGame_DemoTarget : TargetRules
 	{
 		Type = TargetType.Game;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
+		bWithPushModel = true;
 		ExtraModuleNames.Add("MultiplayerGame_Demo");
 	}
 }
@@ -9,5 +9,7 @@ public class MultiplayerGame_Demo : ModuleRules
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "HeadMountedDisplay" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "NetCore", "ReplicationGraph", "AIModule", "Json" });
 	}
 }
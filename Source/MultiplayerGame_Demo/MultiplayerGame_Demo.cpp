@@ -1,7 +1,20 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "MultiplayerGame_Demo.h"
+#include "GameplayEventChannel.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, MultiplayerGame_Demo, "MultiplayerGame_Demo" );
- 
\ No newline at end of file
+UE_TRACE_CHANNEL_DEFINE(MultiplayerGameChannel);
+
+class FMultiplayerGame_DemoModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void ShutdownModule() override
+	{
+		// 停止玩法事件的后台线程，写完剩余事件。
+		FGameplayEventChannel::Get().Shutdown();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FMultiplayerGame_DemoModule, MultiplayerGame_Demo, "MultiplayerGame_Demo" );
+ 
\ No newline at end of file
@@ -3,3 +3,21 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// 本模块的性能统计分组，使用 "stat MultiplayerGame" 查看。
+DECLARE_STATS_GROUP(TEXT("MultiplayerGame"), STATGROUP_MultiplayerGame, STATCAT_Advanced);
+
+// 本模块的 Unreal Insights 通道，使用 -trace=cpu,MultiplayerGame 录制。
+UE_TRACE_CHANNEL_EXTERN(MultiplayerGameChannel, MULTIPLAYERGAME_DEMO_API);
+
+// 热点函数的计时：同时计入 "stat MultiplayerGame" 的周期计数器，并在 MultiplayerGame 通道上产生 Insights 的CPU事件。
+#define MP_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, MultiplayerGameChannel)
+
+// 为1时在屏幕上显示生命值与击杀的调试消息。默认关闭，需要时在 Build.cs 中添加 PublicDefinitions.Add("MP_DEBUG_ONSCREEN_MESSAGES=1")。
+// 玩法事件始终通过 FGameplayEventChannel 记录，与是否显示无关。
+#ifndef MP_DEBUG_ONSCREEN_MESSAGES
+#define MP_DEBUG_ONSCREEN_MESSAGES 0
+#endif
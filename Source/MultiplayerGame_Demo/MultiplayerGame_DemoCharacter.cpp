@@ -9,15 +9,124 @@
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
 #include "Engine/Engine.h"
+#include "MultiplayerGame_Demo.h"
 #include "ThirdPersonMPProjectile.h"
+#include "ProjectilePoolSubsystem.h"
+#include "ProjectileSimulationSubsystem.h"
+#include "LagCompensationSubsystem.h"
+#include "GameplayCountersSubsystem.h"
+#include "RpcRateLimitSubsystem.h"
+#include "SplashDamageSubsystem.h"
+#include "MPCharacterMovementComponent.h"
+#include "NetUpdateRateSubsystem.h"
+#include "TickAggregationSubsystem.h"
+#include "LoadTestBotController.h"
+#include "GameplayEventChannel.h"
+#include "MultiplayerGame_DemoGameMode.h"
+#include "MultiplayerGame_DemoGameState.h"
+#include "Components/SphereComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/ScopeExit.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Serialization/ArchiveCountMem.h"
+
+
+
+// 推送模型的效果：服务器上标记为脏的次数（即真正需要比较和发送的次数），以及客户端收到的更新次数。
+// 属性比较的CPU耗时与带宽可配合引擎的 "stat net" 和 net.IsPushModelEnabled 做对比。
+DECLARE_DWORD_COUNTER_STAT(TEXT("Health Dirty Marks"), STAT_HealthDirtyMarks, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Health Updates Received"), STAT_HealthUpdatesReceived, STATGROUP_MultiplayerGame);
+
+// 服务器Tick中与开火、伤害相关的热点。
+DECLARE_CYCLE_STAT(TEXT("Character HandleFire"), STAT_CharacterHandleFire, STATGROUP_MultiplayerGame);
+DECLARE_CYCLE_STAT(TEXT("Projectile Spawn"), STAT_ProjectileSpawn, STATGROUP_MultiplayerGame);
+DECLARE_CYCLE_STAT(TEXT("Character TakeDamage"), STAT_CharacterTakeDamage, STATGROUP_MultiplayerGame);
+DECLARE_CYCLE_STAT(TEXT("Character SetCurrentHealth"), STAT_CharacterSetCurrentHealth, STATGROUP_MultiplayerGame);
+DECLARE_CYCLE_STAT(TEXT("Character OnHealthUpdate"), STAT_CharacterOnHealthUpdate, STATGROUP_MultiplayerGame);
+
+// 开火冷却在 UTickAggregationSubsystem 中的分组名。
+static const FName FireCooldownGroupName(TEXT("Character.FireCooldown"));
+
+DEFINE_LOG_CATEGORY_STATIC(LogPawnFootprint, Log, All);
+
+namespace PawnFootprint
+{
+	// 对象自身占用的内存（UObject本体加上其拥有的数组等），与 "obj list" 的统计方式相同。
+	static SIZE_T GetObjectBytes(UObject* Object)
+	{
+		FArchiveCountMem CountMem(Object);
+		return CountMem.GetMax();
+	}
+
+	// 输出一个Actor的组件数量、注册与Tick情况以及内存占用。
+	static void LogActor(AActor* Actor)
+	{
+		TInlineComponentArray<UActorComponent*> Components(Actor);
+
+		SIZE_T TotalBytes = GetObjectBytes(Actor);
+		int32 NumRegistered = 0;
+		int32 NumTicking = 0;
+		for (UActorComponent* Component : Components)
+		{
+			TotalBytes += GetObjectBytes(Component);
+			NumRegistered += Component->IsRegistered() ? 1 : 0;
+			NumTicking += Component->IsComponentTickEnabled() ? 1 : 0;
+		}
+
+		UE_LOG(LogPawnFootprint, Log, TEXT("%s (%s): %d components, %d registered, %d ticking, actor tick %s, %.1f KB"),
+			*Actor->GetName(), *Actor->GetClass()->GetName(), Components.Num(), NumRegistered, NumTicking,
+			Actor->IsActorTickEnabled() ? TEXT("on") : TEXT("off"), TotalBytes / 1024.0);
+		for (UActorComponent* Component : Components)
+		{
+			UE_LOG(LogPawnFootprint, Log, TEXT("  %-28s %-32s %s %s %.1f KB"),
+				*Component->GetName(), *Component->GetClass()->GetName(),
+				Component->IsRegistered() ? TEXT("registered") : TEXT("unregistered"),
+				Component->IsComponentTickEnabled() ? TEXT("ticking") : TEXT("idle   "),
+				GetObjectBytes(Component) / 1024.0);
+		}
+	}
 
+	template<typename ActorType>
+	static void LogFirstActor(UWorld* World)
+	{
+		TActorIterator<ActorType> It(World);
+		if (It)
+		{
+			LogActor(*It);
+		}
+		else
+		{
+			UE_LOG(LogPawnFootprint, Log, TEXT("No %s in the world."), *ActorType::StaticClass()->GetName());
+		}
+	}
+}
 
+static FAutoConsoleCommandWithWorld GPawnFootprintCommand(
+	TEXT("mp.Server.PawnFootprint"),
+	TEXT("Prints the component count, ticking components and memory of one character and one projectile. Run on both the game and the server build to compare the variants."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (!World)
+		{
+			return;
+		}
+
+		UE_LOG(LogPawnFootprint, Log, TEXT("Pawn footprint (%s build, %s):"),
+			UE_SERVER ? TEXT("server") : TEXT("game"), World->GetNetMode() == NM_DedicatedServer ? TEXT("dedicated server") : TEXT("client/listen server"));
+		PawnFootprint::LogFirstActor<AMultiplayerGame_DemoCharacter>(World);
+		PawnFootprint::LogFirstActor<AThirdPersonMPProjectile>(World);
+	}));
 
 //////////////////////////////////////////////////////////////////////////
 // AMultiplayerGame_DemoCharacter
 
-AMultiplayerGame_DemoCharacter::AMultiplayerGame_DemoCharacter()
+AMultiplayerGame_DemoCharacter::AMultiplayerGame_DemoCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UMPCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -37,6 +146,9 @@ AMultiplayerGame_DemoCharacter::AMultiplayerGame_DemoCharacter()
 	GetCharacterMovement()->JumpZVelocity = 600.f;
 	GetCharacterMovement()->AirControl = 0.2f;
 
+	// 摄像机只用于本地玩家的表现。专用服务器构建（MultiplayerGame_DemoServer 目标）中不创建，CameraBoom 与 FollowCamera 为空；
+	// 蓝图子类序列化的摄像机组件由 StripClientOnlyComponents 在运行时销毁。
+#if !UE_SERVER
 	// Create a camera boom (pulls in towards the player if there is a collision)
 	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
 	CameraBoom->SetupAttachment(RootComponent);
@@ -47,6 +159,10 @@ AMultiplayerGame_DemoCharacter::AMultiplayerGame_DemoCharacter()
 	FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
 	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
 	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
+#else
+	CameraBoom = nullptr;
+	FollowCamera = nullptr;
+#endif
 
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named MyCharacter (to avoid direct content references in C++)
@@ -57,13 +173,23 @@ AMultiplayerGame_DemoCharacter::AMultiplayerGame_DemoCharacter()
 
 	// The player's Current health
 	CurrentHealth = MaxHealth;
+	ReplicatedHealth = QuantizeHealth(CurrentHealth);
 
 	// 初始化投射物类
 	ProjectileClass = AThirdPersonMPProjectile::StaticClass();
 	// 初始化射速
 	FireRate = 0.25f;
 	bIsFiringWeapon = false;
+	FireCooldownRemaining = 0.0f;
+
+	LastFireInputSequence = 0;
+	bHasFireInputSequence = false;
 
+	bDead = false;
+
+	// 复制频率上限与下限。启用 mp.Net.AdaptiveUpdateRate 时由 UNetUpdateRateSubsystem 在两者之间按连接调整。
+	NetUpdateFrequency = 60.0f;
+	MinNetUpdateFrequency = 5.0f;
 
 }
 
@@ -85,8 +211,11 @@ void AMultiplayerGame_DemoCharacter::SetupPlayerInputComponent(class UInputCompo
 	// "turn" handles devices that provide an absolute delta, such as a mouse.
 	// "turnrate" is for devices that we choose to treat as a rate of change, such as an analog joystick
 	PlayerInputComponent->BindAxis("Turn", this, &APawn::AddControllerYawInput);
-	PlayerInputComponent->BindAxis("TurnRate", this, &AMultiplayerGame_DemoCharacter::TurnAtRate);
 	PlayerInputComponent->BindAxis("LookUp", this, &APawn::AddControllerPitchInput);
+
+	// 摇杆转向、触屏与VR只有客户端会用到，专用服务器构建中不绑定。
+#if !UE_SERVER
+	PlayerInputComponent->BindAxis("TurnRate", this, &AMultiplayerGame_DemoCharacter::TurnAtRate);
 	PlayerInputComponent->BindAxis("LookUpRate", this, &AMultiplayerGame_DemoCharacter::LookUpAtRate);
 
 	// handle touch devices
@@ -95,11 +224,76 @@ void AMultiplayerGame_DemoCharacter::SetupPlayerInputComponent(class UInputCompo
 
 	// VR headset functionality
 	PlayerInputComponent->BindAction("ResetVR", IE_Pressed, this, &AMultiplayerGame_DemoCharacter::OnResetVR);
+#endif
 
 	// 处理发射投射物
 	PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &AMultiplayerGame_DemoCharacter::StartFire);
 }
 
+void AMultiplayerGame_DemoCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// 服务器构建与以 -server 运行的游戏构建都在这里去掉摄像机组件。
+	if (IsRunningDedicatedServer())
+	{
+		StripClientOnlyComponents();
+	}
+}
+
+void AMultiplayerGame_DemoCharacter::StripClientOnlyComponents()
+{
+	// 按类型查找：蓝图子类的组件不一定由 CameraBoom / FollowCamera 引用。
+	TInlineComponentArray<USceneComponent*> Components(this);
+	for (USceneComponent* Component : Components)
+	{
+		if (Component->IsA<USpringArmComponent>() || Component->IsA<UCameraComponent>())
+		{
+			Component->DestroyComponent();
+		}
+	}
+	CameraBoom = nullptr;
+	FollowCamera = nullptr;
+}
+
+void AMultiplayerGame_DemoCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// 服务器记录胶囊体历史，用于延迟补偿；并登记到范围伤害的网格中。
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		{
+			LagCompensation->RegisterCharacter(this);
+		}
+		if (USplashDamageSubsystem* SplashDamage = GetWorld()->GetSubsystem<USplashDamageSubsystem>())
+		{
+			SplashDamage->RegisterCharacter(this);
+		}
+	}
+}
+
+void AMultiplayerGame_DemoCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterCharacter(this);
+	}
+
+	if (USplashDamageSubsystem* SplashDamage = GetWorld()->GetSubsystem<USplashDamageSubsystem>())
+	{
+		SplashDamage->UnregisterCharacter(this);
+	}
+
+	if (UTickAggregationSubsystem* TickAggregation = GetWorld()->GetSubsystem<UTickAggregationSubsystem>())
+	{
+		TickAggregation->RemoveObject(FireCooldownGroupName, this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AMultiplayerGame_DemoCharacter::OnResetVR()
 {
 	// If MultiplayerGame_Demo is added to a project via 'Add Feature' in the Unreal Editor the dependency on HeadMountedDisplay in MultiplayerGame_Demo.Build.cs is not automatically propagated
@@ -108,7 +302,9 @@ void AMultiplayerGame_DemoCharacter::OnResetVR()
 	//		Add "HeadMountedDisplay" to [YourProject].Build.cs PublicDependencyModuleNames in order to build successfully (appropriate if supporting VR).
 	// or:
 	//		Comment or delete the call to ResetOrientationAndPosition below (appropriate if not supporting VR)
+#if !UE_SERVER
 	UHeadMountedDisplayFunctionLibrary::ResetOrientationAndPosition();
+#endif
 }
 
 void AMultiplayerGame_DemoCharacter::TouchStarted(ETouchIndex::Type FingerIndex, FVector Location)
@@ -162,42 +358,350 @@ void AMultiplayerGame_DemoCharacter::MoveRight(float Value)
 	}
 }
 
+void AMultiplayerGame_DemoCharacter::ApplyBotInput(const FLoadTestBotInput& Input)
+{
+	if (bDead)
+	{
+		return;
+	}
+
+	// AI控制器没有 AddControllerYawInput 的输入处理，直接修改控制旋转；客户端机器人的控制旋转同样会随移动包发送。
+	if (Controller != nullptr && Input.YawDelta != 0.0f)
+	{
+		Controller->SetControlRotation(Controller->GetControlRotation() + FRotator(0.0f, Input.YawDelta, 0.0f));
+	}
+
+	MoveForward(Input.Forward);
+	MoveRight(Input.Right);
+
+	if (Input.bFire)
+	{
+		StartFire();
+	}
+}
+
 /*-------------------New content----------------------*/
 
 void AMultiplayerGame_DemoCharacter::OnRep_CurrentHealth()
 {
+	INC_DWORD_STAT(STAT_HealthUpdatesReceived);
+
+	CurrentHealth = DequantizeHealth(ReplicatedHealth);
 	OnHealthUpdate();
 }
 
+uint16 AMultiplayerGame_DemoCharacter::QuantizeHealth(float Health) const
+{
+	if (MaxHealth <= 0.0f)
+	{
+		return 0;
+	}
+
+	// 四舍五入到最近的刻度，但只要还有生命值就不会被量化成0（否则客户端会误判死亡）。
+	const int32 Quantized = FMath::RoundToInt(FMath::Clamp(Health / MaxHealth, 0.0f, 1.0f) * MAX_uint16);
+	return (uint16)(Health > 0.0f ? FMath::Max(Quantized, 1) : 0);
+}
+
+float AMultiplayerGame_DemoCharacter::DequantizeHealth(uint16 QuantizedHealth) const
+{
+	return QuantizedHealth == MAX_uint16 ? MaxHealth : MaxHealth * QuantizedHealth / (float)MAX_uint16;
+}
+
 // 启用开火
 void AMultiplayerGame_DemoCharacter::StartFire()
 {
-	if(!bIsFiringWeapon)
+	if(!bIsFiringWeapon && !bDead)
 	{
 		bIsFiringWeapon = true;
 		UWorld* World = GetWorld();
-		World->GetTimerManager().SetTimer(FiringTimer, this, &AMultiplayerGame_DemoCharacter::StopFire, FireRate, false);
-		HandleFire();
+
+		// 射速冷却由Tick聚合管理器批量处理，不再为每个角色单独设置定时器。
+		FireCooldownRemaining = FireRate;
+		if (UTickAggregationSubsystem* TickAggregation = World->GetSubsystem<UTickAggregationSubsystem>())
+		{
+			TickAggregation->RegisterGroup(FireCooldownGroupName, &AMultiplayerGame_DemoCharacter::TickFireCooldowns);
+			TickAggregation->AddObject(FireCooldownGroupName, this);
+		}
+
+		// 用同步后的服务器时间标记开火时刻，服务器据此回溯目标。
+		const AGameStateBase* GameState = World->GetGameState();
+		const float FireTimeStamp = GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+
+		// 开火预测：拥有者客户端在按下开火的这一帧就发射表现用的投射物，不再等待一个往返。
+		UMPCharacterMovementComponent* MovementComponent = Cast<UMPCharacterMovementComponent>(GetCharacterMovement());
+		UProjectileSimulationSubsystem* ProjectileSimulation = World->GetSubsystem<UProjectileSimulationSubsystem>();
+		const bool bAutonomousProxy = GetLocalRole() == ROLE_AutonomousProxy && MovementComponent;
+		const bool bPredict = bAutonomousProxy && ProjectileSimulation && UProjectileSimulationSubsystem::IsFirePredictionEnabled();
+
+		// 客户端把开火输入打包进不可靠的移动包；服务器本机或未启用打包移动RPC时仍使用 HandleFire。
+		int32 PredictionId = INDEX_NONE;
+		if (bAutonomousProxy && UMPCharacterMovementComponent::CanSendFireInputWithMoves())
+		{
+			PredictionId = MovementComponent->QueueFireInput(FireTimeStamp, bPredict);
+		}
+		else
+		{
+			PredictionId = bAutonomousProxy ? MovementComponent->AllocateFireSequence() : INDEX_NONE;
+			HandleFire(FireTimeStamp, bPredict ? PredictionId : INDEX_NONE);
+		}
+
+		if (bPredict)
+		{
+			FVector SpawnLocation;
+			FRotator SpawnRotation;
+			GetProjectileSpawnTransform(SpawnLocation, SpawnRotation);
+			ProjectileSimulation->FirePredictedProjectile(GetDefault<AThirdPersonMPProjectile>(), SpawnLocation, SpawnRotation.Vector(), this, PredictionId);
+		}
 	}
 }
 
+void AMultiplayerGame_DemoCharacter::GetProjectileSpawnTransform(FVector& OutLocation, FRotator& OutRotation) const
+{
+	OutRotation = GetControlRotation();  // 根据控制器的旋转而旋转
+	OutLocation = GetActorLocation() + (OutRotation.Vector() * 100.0f) + (GetActorUpVector() * 50.0f);
+}
+
 // 禁用开火
 void AMultiplayerGame_DemoCharacter::StopFire()
 {
 	bIsFiringWeapon = false;
+	FireCooldownRemaining = 0.0f;
+
+	if (UTickAggregationSubsystem* TickAggregation = GetWorld()->GetSubsystem<UTickAggregationSubsystem>())
+	{
+		TickAggregation->RemoveObject(FireCooldownGroupName, this);
+	}
+}
+
+void AMultiplayerGame_DemoCharacter::TickFireCooldowns(TArrayView<UObject* const> Characters, float DeltaTime)
+{
+	for (UObject* Object : Characters)
+	{
+		AMultiplayerGame_DemoCharacter* Character = CastChecked<AMultiplayerGame_DemoCharacter>(Object);
+		Character->FireCooldownRemaining -= DeltaTime;
+		if (Character->FireCooldownRemaining <= 0.0f)
+		{
+			Character->StopFire();
+		}
+	}
 }
 
 // 控制开火指令的实施
-void AMultiplayerGame_DemoCharacter::HandleFire_Implementation()  // 因为 HandleFire 是服务器RPC，其在CPP文件中的实现必须在函数名后面添加后缀 _Implementation。
+void AMultiplayerGame_DemoCharacter::HandleFire_Implementation(float ClientTimeStamp, int32 PredictionId)  // 因为 HandleFire 是服务器RPC，其在CPP文件中的实现必须在函数名后面添加后缀 _Implementation。
 {
-	FVector spawnLocation = GetActorLocation() + (GetControlRotation().Vector()* 100.0f) + (GetActorUpVector()* 50.0f);
-	FRotator SpawnRotator = GetControlRotation();  // 根据控制器的旋转而旋转
+	MP_SCOPE_CYCLE_COUNTER(STAT_CharacterHandleFire);
+
+	// 丢弃预测的一发时通知开火者，否则它的预测投射物会一直飞行并显示撞击，直到 mp.Fire.PredictionTimeout。
+	const auto RejectPrediction = [this, PredictionId]()
+	{
+		if (PredictionId != INDEX_NONE && !IsLocallyControlled())
+		{
+			ClientRejectPredictedFire((uint16)PredictionId);
+		}
+	};
+
+	// 死亡前发出、死亡后才到达的开火输入直接丢弃。
+	if (bDead)
+	{
+		RejectPrediction();
+		return;
+	}
+
+	// 超出 FireRate 的开火在生成任何东西之前丢弃。客户端的时间戳可以伪造，所以按服务器时间限流。
+	if (URpcRateLimitSubsystem* RateLimit = GetWorld()->GetSubsystem<URpcRateLimitSubsystem>())
+	{
+		if (!RateLimit->AllowCall(GetNetConnection(), ERpcRateLimit::Fire, FireRate))
+		{
+			RejectPrediction();
+			return;
+		}
+	}
+
+	if (UGameplayCountersSubsystem* Counters = GetWorld()->GetSubsystem<UGameplayCountersSubsystem>())
+	{
+		Counters->RecordShot();
+	}
+	if (AMultiplayerGame_DemoGameState* MatchGameState = GetWorld()->GetGameState<AMultiplayerGame_DemoGameState>())
+	{
+		MatchGameState->RecordShot(GetPlayerState());
+	}
+
+	FVector spawnLocation;
+	FRotator SpawnRotator;
+	GetProjectileSpawnTransform(spawnLocation, SpawnRotator);
+
+	FGameplayEventChannel::Get().Push(EGameplayEventType::Fired, this, nullptr, ClientTimeStamp, 0.0f, spawnLocation);
+
+	// 开火预测的确认：投射物等效于在 LaunchTime 时刻从 PredictedOrigin 发射。
+	const FVector PredictedOrigin = spawnLocation;
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	float LaunchTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+	ON_SCOPE_EXIT
+	{
+		// 监听服务器本机没有预测，不需要确认。
+		if (PredictionId != INDEX_NONE && !IsLocallyControlled())
+		{
+			ClientConfirmPredictedFire((uint16)PredictionId, PredictedOrigin, SpawnRotator.Vector(), LaunchTime);
+		}
+	};
+
+	// 延迟补偿：按客户端开火时刻回溯目标。
+	if (const ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		const float RewindSeconds = LagCompensation->GetRewindSeconds(ClientTimeStamp);
+		if (RewindSeconds > 0.0f && ResolveLagCompensatedShot(*LagCompensation, RewindSeconds, spawnLocation, SpawnRotator))
+		{
+			return;
+		}
+
+		// 发射位置被前移了追赶的距离，相当于提前 RewindSeconds 发射。
+		if (spawnLocation != PredictedOrigin)
+		{
+			LaunchTime -= RewindSeconds;
+		}
+	}
+
+	// 轻量级模拟：投射物只存在于服务器的SoA缓冲区中，客户端收到开火事件后自行模拟表现。
+	if (UProjectileSimulationSubsystem::IsEnabled())
+	{
+		if (UProjectileSimulationSubsystem* ProjectileSimulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>())
+		{
+			MP_SCOPE_CYCLE_COUNTER(STAT_ProjectileSpawn);
+			ProjectileSimulation->FireProjectile(GetDefault<AThirdPersonMPProjectile>(), spawnLocation, SpawnRotator, GetInstigator());
+			MulticastProjectileFired(spawnLocation, SpawnRotator.Vector());
+			return;
+		}
+	}
+
+	MP_SCOPE_CYCLE_COUNTER(STAT_ProjectileSpawn);
 
 	FActorSpawnParameters SpawnParameters;
 	SpawnParameters.Instigator = GetInstigator();
 	SpawnParameters.Owner = this;
 
-	AThirdPersonMPProjectile* SpawnedProjectile = GetWorld()->SpawnActor<AThirdPersonMPProjectile>(spawnLocation, SpawnRotator,SpawnParameters);
+	// 优先从对象池中取出投射物，避免每次射击都生成新的Actor。
+	AThirdPersonMPProjectile* SpawnedProjectile = nullptr;
+	if (UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+	{
+		SpawnedProjectile = ProjectilePool->AcquireProjectile(AThirdPersonMPProjectile::StaticClass(), spawnLocation, SpawnRotator, SpawnParameters.Owner, SpawnParameters.Instigator);
+	}
+	else
+	{
+		SpawnedProjectile = GetWorld()->SpawnActor<AThirdPersonMPProjectile>(spawnLocation, SpawnRotator,SpawnParameters);
+	}
+
+	// 拥有者客户端据此隐藏复制下来的投射物，由本地预测的那一发负责表现。
+	if (SpawnedProjectile)
+	{
+		SpawnedProjectile->SetPredictionId(PredictionId);
+	}
+}
+
+void AMultiplayerGame_DemoCharacter::ServerProcessFireInput(const FFireInputPacket& FireInput)
+{
+	for (const FFireInputEntry& Entry : FireInput.Entries)
+	{
+		// 冗余发送的重复输入和乱序到达的旧输入直接跳过（序号按16位回绕比较）。
+		if (bHasFireInputSequence && (int16)(Entry.Sequence - LastFireInputSequence) <= 0)
+		{
+			continue;
+		}
+
+		LastFireInputSequence = Entry.Sequence;
+		bHasFireInputSequence = true;
+
+		// 射速只由 HandleFire_Implementation 中的 URpcRateLimitSubsystem 按服务器收到的时间限制；客户端的时间戳只用于延迟补偿，
+		// 伪造的时间戳由 GetRewindSeconds 限制在 [0, mp.LagComp.MaxRewind] 内。
+		HandleFire_Implementation(Entry.TimeStamp, Entry.bPredicted ? Entry.Sequence : INDEX_NONE);
+	}
+}
+
+bool AMultiplayerGame_DemoCharacter::ResolveLagCompensatedShot(const ULagCompensationSubsystem& LagCompensation, float RewindSeconds, FVector& InOutSpawnLocation, const FRotator& SpawnRotation)
+{
+	const AThirdPersonMPProjectile* Archetype = GetDefault<AThirdPersonMPProjectile>();
+	const float ProjectileRadius = Archetype->SphereComponent->GetUnscaledSphereRadius();
+	const FVector Direction = SpawnRotation.Vector();
+	const FVector CatchUpEnd = InOutSpawnLocation + Direction * Archetype->ProjectileMovementComponent->InitialSpeed * RewindSeconds;
+
+	// 场景几何体不随时间变化，直接用当前状态检测；角色胶囊体属于Pawn通道，不在这次查询中。
+	FCollisionObjectQueryParams ObjectQueryParams;
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_WorldStatic);
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(LagCompensatedCatchUp), false, this);
+
+	FHitResult WorldHit;
+	const bool bWorldHit = GetWorld()->SweepSingleByObjectType(WorldHit, InOutSpawnLocation, CatchUpEnd, FQuat::Identity, ObjectQueryParams, FCollisionShape::MakeSphere(ProjectileRadius), QueryParams);
+	const FVector CatchUpPathEnd = bWorldHit ? WorldHit.Location : CatchUpEnd;
+
+	FLagCompensationHit RewoundHit;
+	if (LagCompensation.RewindSweep(RewindSeconds, InOutSpawnLocation, CatchUpPathEnd, ProjectileRadius, this, RewoundHit))
+	{
+		// 与 OnProjectileImpact 相同的伤害结算。
+		const FHitResult Hit(RewoundHit.Character, RewoundHit.Character->GetCapsuleComponent(), RewoundHit.Location, -Direction);
+		UGameplayStatics::ApplyPointDamage(RewoundHit.Character, Archetype->Damage, Direction, Hit, GetController(), this, Archetype->DamageType);
+		if (AMultiplayerGame_DemoGameState* MatchGameState = GetWorld()->GetGameState<AMultiplayerGame_DemoGameState>())
+		{
+			MatchGameState->RecordHit(this, RewoundHit.Character);
+		}
+		if (USplashDamageSubsystem* SplashDamage = GetWorld()->GetSubsystem<USplashDamageSubsystem>())
+		{
+			SplashDamage->QueueProjectileExplosion(Archetype, RewoundHit.Location, RewoundHit.Character, GetController(), this);
+		}
+
+		// 伤害已结算，客户端（以及监听服务器本机）只需要表现用的投射物。
+		MulticastProjectileFired(InOutSpawnLocation, Direction);
+		if (GetNetMode() == NM_ListenServer)
+		{
+			if (UProjectileSimulationSubsystem* ProjectileSimulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>())
+			{
+				ProjectileSimulation->FireCosmeticProjectile(Archetype, InOutSpawnLocation, Direction);
+			}
+		}
+		return true;
+	}
+
+	// 追赶途中撞到场景时仍从原位置发射，让投射物自然撞击；否则从追赶后的位置开始飞行。
+	if (!bWorldHit)
+	{
+		InOutSpawnLocation = CatchUpEnd;
+	}
+	return false;
+}
+
+void AMultiplayerGame_DemoCharacter::MulticastProjectileFired_Implementation(FVector_NetQuantize10 Origin, FVector_NetQuantizeNormal Direction)
+{
+	// 多播在服务器上也会执行，服务器已经在 HandleFire 中发射了真正的投射物。
+	if (HasAuthority())
+	{
+		return;
+	}
+
+	// 开火者客户端已经发射了预测的投射物，等待 ClientConfirmPredictedFire 修正即可。
+	if (GetLocalRole() == ROLE_AutonomousProxy && UProjectileSimulationSubsystem::IsFirePredictionEnabled())
+	{
+		return;
+	}
+
+	if (UProjectileSimulationSubsystem* ProjectileSimulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>())
+	{
+		ProjectileSimulation->FireCosmeticProjectile(GetDefault<AThirdPersonMPProjectile>(), Origin, Direction);
+	}
+}
+
+void AMultiplayerGame_DemoCharacter::ClientConfirmPredictedFire_Implementation(uint16 PredictionId, FVector_NetQuantize10 Origin, FVector_NetQuantizeNormal Direction, float ServerLaunchTime)
+{
+	if (UProjectileSimulationSubsystem* ProjectileSimulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>())
+	{
+		ProjectileSimulation->ConfirmPredictedProjectile(this, PredictionId, Origin, Direction, ServerLaunchTime);
+	}
+}
+
+void AMultiplayerGame_DemoCharacter::ClientRejectPredictedFire_Implementation(uint16 PredictionId)
+{
+	if (UProjectileSimulationSubsystem* ProjectileSimulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>())
+	{
+		ProjectileSimulation->RejectPredictedProjectile(this, PredictionId);
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -209,45 +713,164 @@ void AMultiplayerGame_DemoCharacter::GetLifetimeReplicatedProps(TArray<FLifetime
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);  // 必须调用 GetLifetimeReplicatedProps 的 Super 版本，否则从Actor父类继承的属性不会复制，即便该父类指定要复制。
 
 	// replicate the current health.
-	DOREPLIFETIME(AMultiplayerGame_DemoCharacter, CurrentHealth);
+	// 推送模型：网络驱动不再每次都比较该属性，只有在 SetCurrentHealth 标记为脏之后才会复制。
+	FDoRepLifetimeParams PushModelParams;
+	PushModelParams.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(AMultiplayerGame_DemoCharacter, ReplicatedHealth, PushModelParams);
 }
 
 // OnHealthUpdate 不复制，需要在所有设备上手动调用。
 void AMultiplayerGame_DemoCharacter::OnHealthUpdate()
 {
-	//客户端特定的功能
-	if (IsLocallyControlled())
-	{
-		FString healthMessage = FString::Printf(TEXT("您现在的生命值剩余为 %f。"), CurrentHealth);
-		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Black, healthMessage);  // 添加屏幕调试消息
-	}
+	MP_SCOPE_CYCLE_COUNTER(STAT_CharacterOnHealthUpdate);
 
-	// 服务器特定的功能
-	if(GetLocalRole() == ROLE_Authority)
+#if MP_DEBUG_ONSCREEN_MESSAGES && !UE_BUILD_SHIPPING
+	// 屏幕调试消息只在开启 MP_DEBUG_ONSCREEN_MESSAGES 的调试构建中显示，专用服务器上没有人能看到，直接跳过。
+	if (GEngine && !IsRunningDedicatedServer())
 	{
-		FString healthMessage = FString::Printf(TEXT("%s 现在的生命值剩余为 %f。"), *GetFName().ToString(),CurrentHealth);
-		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, healthMessage);
+		//客户端特定的功能
+		if (IsLocallyControlled())
+		{
+			FString healthMessage = FString::Printf(TEXT("您现在的生命值剩余为 %f。"), CurrentHealth);
+			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Black, healthMessage);  // 添加屏幕调试消息
+		}
+
+		// 服务器特定的功能
+		if(GetLocalRole() == ROLE_Authority)
+		{
+			FString healthMessage = FString::Printf(TEXT("%s 现在的生命值剩余为 %f。"), *GetFName().ToString(),CurrentHealth);
+			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, healthMessage);
+		}
 	}
+#endif
 
 	
 	//在所有机器上都执行的函数。 
 	/*  
 		因任何因伤害或死亡而产生的特殊功能都应放在这里。 
 	*/
-	// 角色死亡提示及销毁角色Actor
+	// 角色死亡提示及回收角色Actor
 	if (CurrentHealth == 0)
 	{
-		FString deathMessage = FString::Printf(TEXT("%s 被杀死了"), *GetFName().ToString());
-		GEngine->AddOnScreenDebugMessage(-1, 5.f,FColor::Red,deathMessage);
-		Destroy();
+		if (!bDead)
+		{
+#if MP_DEBUG_ONSCREEN_MESSAGES && !UE_BUILD_SHIPPING
+			if (GEngine && !IsRunningDedicatedServer())
+			{
+				FString deathMessage = FString::Printf(TEXT("%s 被杀死了"), *GetFName().ToString());
+				GEngine->AddOnScreenDebugMessage(-1, 5.f,FColor::Red,deathMessage);
+			}
+#endif
+			ApplyDeathState();
+
+			// 服务器把角色交给GameMode等待重生，而不是销毁后重新生成；未开启重生池时仍然销毁。
+			// 客户端只应用死亡表现，角色的去留由服务器决定。
+			if (GetLocalRole() == ROLE_Authority)
+			{
+				AMultiplayerGame_DemoGameMode* GameMode = GetWorld()->GetAuthGameMode<AMultiplayerGame_DemoGameMode>();
+				if (!GameMode || !GameMode->QueueRespawn(this))
+				{
+					Destroy();
+				}
+			}
+		}
+	}
+	else if (bDead)
+	{
+		ApplyRespawnState();
 	}
 }
 
+void AMultiplayerGame_DemoCharacter::ApplyDeathState()
+{
+	bDead = true;
+	StopFire();
+
+	UCharacterMovementComponent* MovementComponent = GetCharacterMovement();
+	MovementComponent->StopMovementImmediately();
+	MovementComponent->DisableMovement();
+
+	SetActorEnableCollision(false);
+	SetActorHiddenInGame(true);
+}
+
+void AMultiplayerGame_DemoCharacter::ApplyRespawnState()
+{
+	bDead = false;
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	GetCharacterMovement()->SetDefaultMovementMode();
+}
+
+void AMultiplayerGame_DemoCharacter::RespawnAt(const FVector& Location, const FRotator& Rotation)
+{
+	if (GetLocalRole() != ROLE_Authority)
+	{
+		return;
+	}
+
+	// 出生点附近有东西时让引擎把角色挪到最近的空位，挪不开也照样放下。
+	if (!TeleportTo(Location, Rotation))
+	{
+		TeleportTo(Location, Rotation, false, true);
+	}
+	if (Controller)
+	{
+		Controller->SetControlRotation(Rotation);
+	}
+	GetCharacterMovement()->ResetPredictionData_Server();
+
+	// 生命值回满会在 OnHealthUpdate 中应用复活状态，客户端通过生命值的复制做同样的事。
+	SetCurrentHealth(MaxHealth);
+
+	ClientRespawned(GetActorLocation(), Rotation);
+}
+
+void AMultiplayerGame_DemoCharacter::ClientRespawned_Implementation(FVector_NetQuantize10 Location, FRotator Rotation)
+{
+	// 监听服务器本机玩家的角色已经在 RespawnAt 中处理过。
+	if (GetLocalRole() != ROLE_AutonomousProxy)
+	{
+		return;
+	}
+
+	TeleportTo(Location, Rotation, false, true);
+	if (Controller)
+	{
+		Controller->SetControlRotation(Rotation);
+	}
+	GetCharacterMovement()->ResetPredictionData_Client();
+}
+
 void AMultiplayerGame_DemoCharacter::SetCurrentHealth(float healrhValue)
 {
+	MP_SCOPE_CYCLE_COUNTER(STAT_CharacterSetCurrentHealth);
+
 	if(GetLocalRole() == ROLE_Authority)
 	{
+		const float OldHealth = CurrentHealth;
 		CurrentHealth = FMath::Clamp(healrhValue, 0.f, MaxHealth);  // Clamp(x, min, max) 在min, max区间取值，x的值在区间时返回 x；x<min 时返回min；x>max 时返回max
+
+		// 只有量化值真的变化时才标记为脏，网络驱动才会在下次更新中比较并发送它。
+		const uint16 NewReplicatedHealth = QuantizeHealth(CurrentHealth);
+		if (NewReplicatedHealth != ReplicatedHealth)
+		{
+			ReplicatedHealth = NewReplicatedHealth;
+			MARK_PROPERTY_DIRTY_FROM_NAME(AMultiplayerGame_DemoCharacter, ReplicatedHealth, this);
+			INC_DWORD_STAT(STAT_HealthDirtyMarks);
+
+			// 受到伤害的角色短时间内以最高频率复制。
+			if (UNetUpdateRateSubsystem* NetUpdateRate = GetWorld()->GetSubsystem<UNetUpdateRateSubsystem>())
+			{
+				NetUpdateRate->NotifyActorChanged(this);
+			}
+		}
+
+		if (CurrentHealth != OldHealth)
+		{
+			FGameplayEventChannel::Get().Push(EGameplayEventType::HealthChanged, this, nullptr, CurrentHealth, CurrentHealth - OldHealth);
+		}
 		OnHealthUpdate();
 	}
 }
@@ -256,8 +879,35 @@ float AMultiplayerGame_DemoCharacter::TakeDamage(float DamageTaken, FDamageEvent
 	AController* EventInstigator, AActor* DamageCauser)
 {
 	//return Super::TakeDamage(DamageTaken, DamageEvent, EventInstigator, DamageCauser);
+	MP_SCOPE_CYCLE_COUNTER(STAT_CharacterTakeDamage);
+
+	if (UGameplayCountersSubsystem* Counters = GetWorld()->GetSubsystem<UGameplayCountersSubsystem>())
+	{
+		Counters->RecordDamageEvent();
+	}
+
+	// 致死时角色可能在 SetCurrentHealth 中被销毁并失去 PlayerState，先取出来。
+	const APawn* Attacker = EventInstigator ? EventInstigator->GetPawn() : (DamageCauser ? DamageCauser->GetInstigator() : nullptr);
+	const APlayerState* AttackerState = EventInstigator ? EventInstigator->PlayerState : (Attacker ? Attacker->GetPlayerState() : nullptr);
+	const APlayerState* VictimState = GetPlayerState();
+
+	const float OldHealth = CurrentHealth;
 	float damageApplied = CurrentHealth - DamageTaken;
 	SetCurrentHealth(damageApplied);
+
+	const bool bKilled = OldHealth > 0.0f && CurrentHealth == 0.0f;
+	if (CurrentHealth < OldHealth)
+	{
+		FGameplayEventChannel::Get().Push(EGameplayEventType::Damaged, this, Attacker, OldHealth - CurrentHealth, DamageTaken, GetActorLocation());
+	}
+	if (bKilled)
+	{
+		FGameplayEventChannel::Get().Push(EGameplayEventType::Killed, this, Attacker, DamageTaken, 0.0f, GetActorLocation());
+	}
+	if (AMultiplayerGame_DemoGameState* MatchGameState = GetWorld()->GetGameState<AMultiplayerGame_DemoGameState>())
+	{
+		MatchGameState->RecordDamage(AttackerState, VictimState, OldHealth - CurrentHealth, bKilled);
+	}
 	return damageApplied;
 }
 
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "Engine/NetSerialization.h"
 #include "MultiplayerGame_DemoCharacter.generated.h"
 
 UCLASS(config=Game)
@@ -18,8 +19,9 @@ class AMultiplayerGame_DemoCharacter : public ACharacter
 	/** Follow camera */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class UCameraComponent* FollowCamera;
+
 public:
-	AMultiplayerGame_DemoCharacter();
+	AMultiplayerGame_DemoCharacter(const FObjectInitializer& ObjectInitializer);
 
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
@@ -64,13 +66,21 @@ protected:
 	float MaxHealth;
 
 	/** The player's current health,If it goes down to zero, it's dead. */
-	UPROPERTY(ReplicatedUsing=OnRep_CurrentHealth) // OnRep_ 是命名规范前缀，没有也可以，但最好带上，便于识别。
+	UPROPERTY(VisibleInstanceOnly, Category="Health")  // 不直接复制，由 ReplicatedHealth 量化后同步到客户端。
 	float CurrentHealth;
 
+	/** 量化后的当前生命值（CurrentHealth / MaxHealth 映射到 0~65535）。使用推送模型复制，仅在 SetCurrentHealth 中标记为脏。*/
+	UPROPERTY(ReplicatedUsing=OnRep_CurrentHealth) // OnRep_ 是命名规范前缀，没有也可以，但最好带上，便于识别。
+	uint16 ReplicatedHealth;
+
 	/** RepNotify,Used to synchronize changes made to the current health value. */
 	UFUNCTION()
 	void OnRep_CurrentHealth();  // 在各客户端中同步玩家当前血量的代理函数
 
+	/** 生命值与量化值之间的转换。0 与 MaxHealth 都能精确还原，死亡判定不受量化影响。*/
+	uint16 QuantizeHealth(float Health) const;
+	float DequantizeHealth(uint16 QuantizedHealth) const;
+
 	// 投射物类变量
 	UPROPERTY(EditDefaultsOnly, Category="Gameplay|Projectile")
 	TSubclassOf<class AThirdPersonMPProjectile> ProjectileClass;
@@ -90,30 +100,101 @@ protected:
 	UFUNCTION(BlueprintCallable, Category="Gameplay")
 	void StopFire();
 
-	// 用于生成投射物的服务器函数。
+	// 用于生成投射物的服务器函数。ClientTimeStamp 为客户端开火时估算的服务器时间，用于延迟补偿。
+	// PredictionId 为客户端本地预测这一发时使用的开火序号，未预测时为 INDEX_NONE。
 	UFUNCTION(Server, Reliable)  // Reliable说明符 启用RPC 
-	void HandleFire();
+	void HandleFire(float ClientTimeStamp, int32 PredictionId);
+
+	/** 按当前控制朝向计算投射物的发射位置与朝向。服务器发射和客户端预测使用同一个计算。*/
+	void GetProjectileSpawnTransform(FVector& OutLocation, FRotator& OutRotation) const;
+
+	// 开火预测：服务器确认预测的一发，告知权威的发射位置、方向与发射时刻（服务器时间），客户端据此把预测投射物修正到权威弹道上。
+	// 不可靠：确认丢失时预测投射物按原弹道飞行，等到 mp.Fire.PredictionTimeout 后移除。
+	UFUNCTION(Client, Unreliable)
+	void ClientConfirmPredictedFire(uint16 PredictionId, FVector_NetQuantize10 Origin, FVector_NetQuantizeNormal Direction, float ServerLaunchTime);
+
+	// 开火预测：服务器丢弃了预测的一发（角色已死亡或超出射速），客户端立即移除对应的预测投射物。
+	// 不可靠：拒绝丢失时与确认丢失相同，等到 mp.Fire.PredictionTimeout 后移除。
+	UFUNCTION(Client, Unreliable)
+	void ClientRejectPredictedFire(uint16 PredictionId);
+
+	// 服务器：已处理的最新开火序号，用于去重。
+	uint16 LastFireInputSequence;
+	bool bHasFireInputSequence;
+
+	/**
+	 * 延迟补偿：投射物在客户端开火后已经飞行了 RewindSeconds 秒，先把这段"追赶"路径与回溯后的角色做检测。
+	 * 命中则直接结算伤害并返回 true；否则把 InOutSpawnLocation 前移到追赶后的位置并返回 false。
+	 */
+	bool ResolveLagCompensatedShot(const class ULagCompensationSubsystem& LagCompensation, float RewindSeconds, FVector& InOutSpawnLocation, const FRotator& SpawnRotation);
+
+	// 本次射击剩余的冷却时间。冷却期间角色位于 UTickAggregationSubsystem 的开火冷却分组中，由 TickFireCooldowns 统一递减。
+	float FireCooldownRemaining;
+
+	/** 开火冷却的批量更新：对所有冷却中的角色递减剩余时间，到期后调用 StopFire。*/
+	static void TickFireCooldowns(TArrayView<UObject* const> Characters, float DeltaTime);
+
+	// 本机上是否处于死亡状态。服务器在生命值归零时进入，客户端根据复制的生命值进入和退出。
+	bool bDead;
 
-	// 定时器句柄，用于提供生成间隔时间内的射速延迟。
-	FTimerHandle FiringTimer;
+	/** 在本机上应用死亡状态：停止开火和移动，隐藏角色并关闭碰撞。Actor本身保留，等待重生时复用。*/
+	void ApplyDeathState();
+
+	/** 在本机上应用复活状态：恢复显示、碰撞与默认移动模式。*/
+	void ApplyRespawnState();
+
+	// 通知拥有者客户端复活位置。自主代理不接收复制的移动，需要在这里传送并清空移动预测数据。
+	UFUNCTION(Client, Reliable)
+	void ClientRespawned(FVector_NetQuantize10 Location, FRotator Rotation);
+
+	// 轻量级投射物模拟下的开火事件。只携带量化后的发射位置和方向，客户端据此在本地模拟表现用的投射物。
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastProjectileFired(FVector_NetQuantize10 Origin, FVector_NetQuantizeNormal Direction);
 
 protected:
 	// APawn interface
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	// End of APawn interface
 
+	// AActor interface
+	virtual void PostInitializeComponents() override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// End of AActor interface
+
 public:
-	/** Returns CameraBoom subobject **/
+	/** Returns CameraBoom subobject. 专用服务器上为空。**/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
-	/** Returns FollowCamera subobject **/
+	/** Returns FollowCamera subobject. 专用服务器上为空。**/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
 
+	/**
+	 * 销毁只用于本地表现的摄像机组件（弹簧臂与摄像机），并清空 CameraBoom / FollowCamera。专用服务器上在 PostInitializeComponents 中调用。
+	 * 构造函数中的 #if !UE_SERVER 只对C++默认子对象生效；蓝图子类的烘焙数据由非服务器的编辑器生成，仍带有这两个组件。
+	 */
+	void StripClientOnlyComponents();
+
 
 	/*-------------------New content----------------------*/
 	//////////////////////////////////////////////////////////////////////////
 	// replicated attribute
 	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
+	/** 服务器：处理随移动包到达的开火输入。按序号去重，射速由 HandleFire_Implementation 按服务器时间限制。*/
+	void ServerProcessFireInput(const struct FFireInputPacket& FireInput);
+
+	/** 负载测试机器人的输入，与玩家按键绑定走同一条路径（MoveForward / MoveRight / StartFire）。*/
+	void ApplyBotInput(const struct FLoadTestBotInput& Input);
+
+	/** 角色是否已死亡、正在等待重生。*/
+	FORCEINLINE bool IsDead() const { return bDead; }
+
+	/** 两次射击之间的最短间隔（秒）。*/
+	FORCEINLINE float GetFireRate() const { return FireRate; }
+
+	/** 服务器：在指定位置复活角色，生命值恢复为 MaxHealth，并重置移动状态。由 AMultiplayerGame_DemoGameMode 在重生延迟结束后调用。*/
+	void RespawnAt(const FVector& Location, const FRotator& Rotation);
+
 	/** 响应要更新的生命值。修改后，立即在服务器上调用，并在客户端上调用以响应RepNotify*/
 	void OnHealthUpdate();
 
@@ -125,7 +206,11 @@ public:
 	UFUNCTION(BlueprintPure, Category="Health")
 	FORCEINLINE float GetCurrentHealth() const { return CurrentHealth;}
 
-	/** 当前生命值的存值函数。将此值的范围限定在0到MaxHealth之间，并调用OnHealthUpdate。仅在服务器上调用。*/
+	/**
+	 * 当前生命值的存值函数。将此值的范围限定在0到MaxHealth之间，并调用OnHealthUpdate。仅在服务器上调用。
+	 * 生命值只在伤害、治疗与重生时改变，没有随时间推进的逻辑，因此不需要Tick，也不加入 UTickAggregationSubsystem 的分组；
+	 * 死亡后的重生等待是 GameMode 中每次死亡一个的一次性定时器。
+	 */
 	UFUNCTION(BlueprintCallable, Category="Health")
 	void SetCurrentHealth(float healrhValue);
 
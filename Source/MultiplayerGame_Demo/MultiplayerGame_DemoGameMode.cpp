@@ -2,14 +2,344 @@
 
 #include "MultiplayerGame_DemoGameMode.h"
 #include "MultiplayerGame_DemoCharacter.h"
-#include "UObject/ConstructorHelpers.h"
+#include "MultiplayerGame_DemoGameState.h"
+#include "ThirdPersonMPProjectile.h"
+#include "ProjectilePoolSubsystem.h"
+#include "ProjectileSimulationSubsystem.h"
+#include "SplashDamageSubsystem.h"
+#include "GameplayEventChannel.h"
+#include "RpcRateLimitSubsystem.h"
+#include "MultiplayerGame_Demo.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/AssetManager.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/PlayerStart.h"
+#include "HAL/IConsoleManager.h"
+#include "TimerManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogRespawn, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Character Respawn"), STAT_CharacterRespawn, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Respawns"), STAT_CharacterRespawns, STATGROUP_MultiplayerGame);
+DECLARE_CYCLE_STAT(TEXT("Match Reset"), STAT_MatchReset, STATGROUP_MultiplayerGame);
+
+static TAutoConsoleVariable<int32> CVarRespawnPooled(
+	TEXT("mp.Respawn.Pooled"),
+	1,
+	TEXT("1: dead characters are hidden and reused on respawn. 0: dead characters are destroyed."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld GRespawnStatsCommand(
+	TEXT("mp.Respawn.Stats"),
+	TEXT("Prints respawn count, death-to-respawn latency and server respawn cost for the current world."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const AMultiplayerGame_DemoGameMode* GameMode = World ? World->GetAuthGameMode<AMultiplayerGame_DemoGameMode>() : nullptr)
+		{
+			GameMode->LogRespawnStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld GMatchResetCommand(
+	TEXT("mp.Match.Reset"),
+	TEXT("Resets the match in place on the server: clears projectiles, returns every character to a spawn point with full health and clears scores."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (AMultiplayerGame_DemoGameMode* GameMode = World ? World->GetAuthGameMode<AMultiplayerGame_DemoGameMode>() : nullptr)
+		{
+			GameMode->ResetMatch();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld GMatchResetStatsCommand(
+	TEXT("mp.Match.ResetStats"),
+	TEXT("Prints the number of in-place match resets and their server cost."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const AMultiplayerGame_DemoGameMode* GameMode = World ? World->GetAuthGameMode<AMultiplayerGame_DemoGameMode>() : nullptr)
+		{
+			GameMode->LogMatchResetStats();
+		}
+	}));
 
 AMultiplayerGame_DemoGameMode::AMultiplayerGame_DemoGameMode()
 {
 	// set default pawn class to our Blueprinted character
-	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter"));
-	if (PlayerPawnBPClass.Class != NULL)
+	// 蓝图类不在类默认对象构造时加载，见 InitGame。
+	DefaultPawnClassAsset = TSoftClassPtr<APawn>(FSoftObjectPath(TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter.ThirdPersonCharacter_C")));
+
+	// 对局状态中带有复制的战斗统计表。
+	GameStateClass = AMultiplayerGame_DemoGameState::StaticClass();
+
+	ProjectilePoolPrewarmCount = 64;
+
+	RespawnDelay = 3.0f;
+	NextRespawnPointIndex = 0;
+}
+
+void AMultiplayerGame_DemoGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	// 地图加载期间就开始异步加载玩家角色蓝图，第一个玩家登录前通常已经完成。
+	if (!DefaultPawnClassAsset.IsNull())
+	{
+		DefaultPawnClassHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(DefaultPawnClassAsset.ToSoftObjectPath(),
+			FStreamableDelegate::CreateUObject(this, &AMultiplayerGame_DemoGameMode::OnDefaultPawnClassLoaded));
+	}
+}
+
+void AMultiplayerGame_DemoGameMode::OnDefaultPawnClassLoaded()
+{
+	if (UClass* PawnClass = DefaultPawnClassAsset.Get())
+	{
+		DefaultPawnClass = PawnClass;
+	}
+}
+
+UClass* AMultiplayerGame_DemoGameMode::GetDefaultPawnClassForController_Implementation(AController* InController)
+{
+	if (!DefaultPawnClassAsset.IsNull())
+	{
+		// 异步加载还没完成就有玩家需要出生时，只能同步等待这一个资产。
+		if (!DefaultPawnClassAsset.Get())
+		{
+			DefaultPawnClassAsset.LoadSynchronous();
+		}
+		OnDefaultPawnClassLoaded();
+	}
+
+	return Super::GetDefaultPawnClassForController_Implementation(InController);
+}
+
+void AMultiplayerGame_DemoGameMode::StartPlay()
+{
+	// GameMode只存在于服务器上，在这里预热投射物对象池。
+	if (UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+	{
+		ProjectilePool->Prewarm(AThirdPersonMPProjectile::StaticClass(), ProjectilePoolPrewarmCount);
+	}
+
+	Super::StartPlay();
+}
+
+void AMultiplayerGame_DemoGameMode::Logout(AController* Exiting)
+{
+	// 释放该连接在限流表中的槽位。
+	const APlayerController* PlayerController = Cast<APlayerController>(Exiting);
+	URpcRateLimitSubsystem* RateLimit = GetWorld()->GetSubsystem<URpcRateLimitSubsystem>();
+	if (PlayerController && RateLimit)
+	{
+		RateLimit->RemoveConnection(PlayerController->GetNetConnection());
+	}
+
+	Super::Logout(Exiting);
+}
+
+bool AMultiplayerGame_DemoGameMode::QueueRespawn(AMultiplayerGame_DemoCharacter* Character)
+{
+	if (!Character || CVarRespawnPooled.GetValueOnGameThread() == 0)
+	{
+		return false;
+	}
+
+	const float DeathTime = GetWorld()->GetTimeSeconds();
+	FTimerHandle RespawnTimer;
+	GetWorldTimerManager().SetTimer(RespawnTimer,
+		FTimerDelegate::CreateUObject(this, &AMultiplayerGame_DemoGameMode::RespawnCharacter, MakeWeakObjectPtr(Character), DeathTime),
+		FMath::Max(RespawnDelay, KINDA_SMALL_NUMBER), false);
+	return true;
+}
+
+void AMultiplayerGame_DemoGameMode::RespawnCharacter(TWeakObjectPtr<AMultiplayerGame_DemoCharacter> WeakCharacter, float DeathTime)
+{
+	AMultiplayerGame_DemoCharacter* Character = WeakCharacter.Get();
+	if (!Character || Character->IsActorBeingDestroyed() || !Character->IsDead())
+	{
+		return;
+	}
+
+	// 等待期间控制者已经离开，没有人再需要这个角色。
+	if (!Character->GetController())
 	{
-		DefaultPawnClass = PlayerPawnBPClass.Class;
+		Character->Destroy();
+		return;
 	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CharacterRespawn);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	const FVector Location = MoveToRespawnPoint(Character);
+
+	const double CostMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	const float LatencySeconds = GetWorld()->GetTimeSeconds() - DeathTime;
+
+	RespawnStats.NumRespawns++;
+	RespawnStats.TotalLatencySeconds += LatencySeconds;
+	RespawnStats.MaxLatencySeconds = FMath::Max(RespawnStats.MaxLatencySeconds, LatencySeconds);
+	RespawnStats.TotalCostMs += CostMs;
+	RespawnStats.MaxCostMs = FMath::Max(RespawnStats.MaxCostMs, CostMs);
+	INC_DWORD_STAT(STAT_CharacterRespawns);
+
+	FGameplayEventChannel::Get().Push(EGameplayEventType::Respawned, Character, nullptr, LatencySeconds, 0.0f, Location);
+}
+
+FVector AMultiplayerGame_DemoGameMode::MoveToRespawnPoint(AMultiplayerGame_DemoCharacter* Character)
+{
+	const AActor* RespawnPoint = SelectRespawnPoint(Character);
+	const FVector Location = RespawnPoint ? RespawnPoint->GetActorLocation() : Character->GetActorLocation();
+	const FRotator Rotation(0.0f, RespawnPoint ? RespawnPoint->GetActorRotation().Yaw : Character->GetActorRotation().Yaw, 0.0f);
+	Character->RespawnAt(Location, Rotation);
+	return Location;
+}
+
+AActor* AMultiplayerGame_DemoGameMode::SelectRespawnPoint(const AMultiplayerGame_DemoCharacter* Character)
+{
+	UWorld* World = GetWorld();
+	if (RespawnPoints.Num() == 0)
+	{
+		for (TActorIterator<APlayerStart> It(World); It; ++It)
+		{
+			RespawnPoints.Add(*It);
+		}
+	}
+
+	const int32 NumPoints = RespawnPoints.Num();
+	if (NumPoints == 0)
+	{
+		return FindPlayerStart(Character->GetController());
+	}
+
+	// 只检测Pawn类型的对象：死亡的角色已关闭碰撞，不会占用出生点。
+	float CapsuleRadius, CapsuleHalfHeight;
+	Character->GetCapsuleComponent()->GetScaledCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
+	const FCollisionShape CapsuleShape = FCollisionShape::MakeCapsule(CapsuleRadius, CapsuleHalfHeight);
+	const FCollisionObjectQueryParams ObjectQueryParams(ECC_Pawn);
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(RespawnPointOccupied), false, Character);
+
+	for (int32 Attempt = 0; Attempt < NumPoints; ++Attempt)
+	{
+		const int32 Index = (NextRespawnPointIndex + Attempt) % NumPoints;
+		AActor* Point = RespawnPoints[Index].Get();
+		if (Point && !World->OverlapAnyTestByObjectType(Point->GetActorLocation(), FQuat::Identity, ObjectQueryParams, CapsuleShape, QueryParams))
+		{
+			NextRespawnPointIndex = (Index + 1) % NumPoints;
+			return Point;
+		}
+		RespawnStats.NumBlockedPoints++;
+	}
+
+	AActor* Point = RespawnPoints[NextRespawnPointIndex].Get();
+	NextRespawnPointIndex = (NextRespawnPointIndex + 1) % NumPoints;
+	return Point;
+}
+
+void AMultiplayerGame_DemoGameMode::LogRespawnStats() const
+{
+	const int32 NumRespawns = FMath::Max(RespawnStats.NumRespawns, 1);
+	UE_LOG(LogRespawn, Log, TEXT("Respawns=%d Delay=%.2fs Latency avg=%.3fs max=%.3fs Cost avg=%.3fms max=%.3fms BlockedPoints=%d SpawnPoints=%d"),
+		RespawnStats.NumRespawns, RespawnDelay,
+		RespawnStats.TotalLatencySeconds / NumRespawns, RespawnStats.MaxLatencySeconds,
+		RespawnStats.TotalCostMs / NumRespawns, RespawnStats.MaxCostMs,
+		RespawnStats.NumBlockedPoints, RespawnPoints.Num());
+}
+
+void AMultiplayerGame_DemoGameMode::ResetMatch()
+{
+	SCOPE_CYCLE_COUNTER(STAT_MatchReset);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	UWorld* World = GetWorld();
+
+	// 所有角色马上就会复活，等待中的重生不再需要。GameMode上的计时器只有重生。
+	GetWorldTimerManager().ClearAllTimersForObject(this);
+
+	// 清除飞行中的投射物：池中的回收，不在池中的直接销毁（先隐藏，销毁时就不会播放爆炸），轻量级模拟的清空。
+	int32 NumProjectiles = 0;
+	if (UProjectilePoolSubsystem* ProjectilePool = World->GetSubsystem<UProjectilePoolSubsystem>())
+	{
+		NumProjectiles += ProjectilePool->ReleaseAllProjectiles();
+	}
+	for (TActorIterator<AThirdPersonMPProjectile> It(World); It; ++It)
+	{
+		if (!It->IsPooled() && !It->IsActorBeingDestroyed())
+		{
+			It->SetActorHiddenInGame(true);
+			It->Destroy();
+			++NumProjectiles;
+		}
+	}
+	if (UProjectileSimulationSubsystem* ProjectileSimulation = World->GetSubsystem<UProjectileSimulationSubsystem>())
+	{
+		NumProjectiles += ProjectileSimulation->ClearProjectiles();
+	}
+	if (USplashDamageSubsystem* SplashDamage = World->GetSubsystem<USplashDamageSubsystem>())
+	{
+		SplashDamage->ClearPendingExplosions();
+	}
+
+	// 复用现有的角色：活着的与等待重生的都满血回到出生点，没有角色的玩家重新生成一个。连接与控制器保持不变。
+	NextRespawnPointIndex = 0;
+	int32 NumCharacters = 0;
+	for (FConstControllerIterator It = World->GetControllerIterator(); It; ++It)
+	{
+		AController* Controller = It->Get();
+		if (!Controller)
+		{
+			continue;
+		}
+
+		if (AMultiplayerGame_DemoCharacter* Character = Cast<AMultiplayerGame_DemoCharacter>(Controller->GetPawn()))
+		{
+			MoveToRespawnPoint(Character);
+			++NumCharacters;
+		}
+		else
+		{
+			APlayerController* PlayerController = Cast<APlayerController>(Controller);
+			if (PlayerController && !Controller->GetPawn() && PlayerCanRestart(PlayerController))
+			{
+				RestartPlayer(PlayerController);
+				++NumCharacters;
+			}
+		}
+
+		if (APlayerState* PlayerState = Controller->GetPlayerState<APlayerState>())
+		{
+			PlayerState->SetScore(0.0f);
+		}
+	}
+	if (AMultiplayerGame_DemoGameState* MatchGameState = GetGameState<AMultiplayerGame_DemoGameState>())
+	{
+		MatchGameState->ResetMatchStats();
+	}
+
+	// 控制者已经离开、还在等待重生的角色不会再被使用。
+	for (TActorIterator<AMultiplayerGame_DemoCharacter> It(World); It; ++It)
+	{
+		if (It->IsDead() && !It->GetController() && !It->IsActorBeingDestroyed())
+		{
+			It->Destroy();
+		}
+	}
+
+	const double CostMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	MatchResetStats.NumResets++;
+	MatchResetStats.LastCostMs = CostMs;
+	MatchResetStats.TotalCostMs += CostMs;
+	MatchResetStats.MaxCostMs = FMath::Max(MatchResetStats.MaxCostMs, CostMs);
+	MatchResetStats.LastNumCharacters = NumCharacters;
+	MatchResetStats.LastNumProjectiles = NumProjectiles;
+
+	UE_LOG(LogRespawn, Log, TEXT("Match reset: %d characters, %d projectiles cleared, %.3f ms"), NumCharacters, NumProjectiles, CostMs);
+}
+
+void AMultiplayerGame_DemoGameMode::LogMatchResetStats() const
+{
+	const int32 NumResets = FMath::Max(MatchResetStats.NumResets, 1);
+	UE_LOG(LogRespawn, Log, TEXT("Match resets=%d Cost last=%.3fms avg=%.3fms max=%.3fms LastCharacters=%d LastProjectiles=%d"),
+		MatchResetStats.NumResets, MatchResetStats.LastCostMs, MatchResetStats.TotalCostMs / NumResets, MatchResetStats.MaxCostMs,
+		MatchResetStats.LastNumCharacters, MatchResetStats.LastNumProjectiles);
 }
@@ -4,8 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "Engine/StreamableManager.h"
 #include "MultiplayerGame_DemoGameMode.generated.h"
 
+class AMultiplayerGame_DemoCharacter;
+
 UCLASS(minimalapi)
 class AMultiplayerGame_DemoGameMode : public AGameModeBase
 {
@@ -13,6 +16,91 @@ class AMultiplayerGame_DemoGameMode : public AGameModeBase
 
 public:
 	AMultiplayerGame_DemoGameMode();
+
+	// AGameModeBase interface
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void StartPlay() override;
+	virtual void Logout(AController* Exiting) override;
+	virtual UClass* GetDefaultPawnClassForController_Implementation(AController* InController) override;
+	// End of AGameModeBase interface
+
+	/**
+	 * 角色死亡时由服务器调用。mp.Respawn.Pooled 开启时保留角色Actor（已隐藏并关闭碰撞），RespawnDelay 秒后在下一个出生点复用它。
+	 * 返回 false 表示未开启重生池，调用者应自行销毁角色。
+	 */
+	bool QueueRespawn(AMultiplayerGame_DemoCharacter* Character);
+
+	/** 输出重生次数、延迟与耗时统计。*/
+	void LogRespawnStats() const;
+
+	/**
+	 * 原地重置对局，不重新加载地图、不断开客户端连接：清除飞行中的投射物，所有角色满血回到出生点，分数清零。
+	 * 已加载的资源、对象池与关卡中的其他Actor保持不变。由 mp.Match.Reset 调用。
+	 */
+	void ResetMatch();
+
+	/** 输出对局重置的次数与服务器耗时（mp.Match.ResetStats）。*/
+	void LogMatchResetStats() const;
+
+protected:
+	/** 玩家角色蓝图。软引用，在地图加载时（InitGame）异步加载，加载完成后设置为 DefaultPawnClass。*/
+	UPROPERTY(config, EditDefaultsOnly, Category="Classes")
+	TSoftClassPtr<APawn> DefaultPawnClassAsset;
+
+	/** DefaultPawnClassAsset 加载完成。*/
+	void OnDefaultPawnClassLoaded();
+
+	// 保持玩家角色蓝图常驻
+	TSharedPtr<FStreamableHandle> DefaultPawnClassHandle;
+
+	/** 对局开始时投射物对象池预先生成的投射物数量。可在各地图的GameMode中单独配置。*/
+	UPROPERTY(config, EditDefaultsOnly, Category="Gameplay|Projectile")
+	int32 ProjectilePoolPrewarmCount;
+
+	/** 角色死亡到重生之间的时间，单位为秒。*/
+	UPROPERTY(config, EditDefaultsOnly, Category="Gameplay|Respawn")
+	float RespawnDelay;
+
+	/** 重生延迟结束：选择出生点，重置并复活角色。DeathTime 用于统计重生延迟。*/
+	void RespawnCharacter(TWeakObjectPtr<AMultiplayerGame_DemoCharacter> WeakCharacter, float DeathTime);
+
+	/** 把角色满血放到下一个出生点，返回放置的位置。重生与对局重置共用。*/
+	FVector MoveToRespawnPoint(AMultiplayerGame_DemoCharacter* Character);
+
+	/** 从 NextRespawnPointIndex 开始轮转，选择第一个没有其他角色占用的出生点；全部被占用时仍使用索引所指的出生点。*/
+	AActor* SelectRespawnPoint(const AMultiplayerGame_DemoCharacter* Character);
+
+	// 地图中的出生点，第一次重生时收集
+	TArray<TWeakObjectPtr<AActor>> RespawnPoints;
+
+	// 下一次重生优先检查的出生点索引
+	int32 NextRespawnPointIndex;
+
+	struct FRespawnStats
+	{
+		int32 NumRespawns = 0;
+		// 死亡到复活的世界时间
+		float TotalLatencySeconds = 0.0f;
+		float MaxLatencySeconds = 0.0f;
+		// 复活本身在服务器上的耗时
+		double TotalCostMs = 0.0;
+		double MaxCostMs = 0.0;
+		// 因被占用而跳过的出生点次数
+		int32 NumBlockedPoints = 0;
+	};
+	FRespawnStats RespawnStats;
+
+	struct FMatchResetStats
+	{
+		int32 NumResets = 0;
+		double LastCostMs = 0.0;
+		double TotalCostMs = 0.0;
+		double MaxCostMs = 0.0;
+		// 最近一次重置中复位的角色与清除的投射物
+		int32 LastNumCharacters = 0;
+		int32 LastNumProjectiles = 0;
+	};
+	FMatchResetStats MatchResetStats;
 };
 
 
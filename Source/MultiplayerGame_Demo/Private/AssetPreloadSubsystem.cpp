@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AssetPreloadSubsystem.h"
+#include "Engine/AssetManager.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/CommandLine.h"
+#include "Particles/ParticleSystem.h"
+#include "UObject/UObjectIterator.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogAssetPreload, Log, All);
+
+static FAutoConsoleCommandWithWorld GAssetReportCommand(
+	TEXT("mp.Assets.Report"),
+	TEXT("Prints process startup time, asset preload time, resident memory and the number of loaded render assets."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UAssetPreloadSubsystem* AssetPreload = World ? World->GetSubsystem<UAssetPreloadSubsystem>() : nullptr)
+		{
+			AssetPreload->LogReport();
+		}
+	}));
+
+static double ToMegabytes(uint64 Bytes)
+{
+	return Bytes / (1024.0 * 1024.0);
+}
+
+bool UAssetPreloadSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UAssetPreloadSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	TArray<FSoftObjectPath> AssetsToLoad = SharedAssets;
+	if (IsRunningDedicatedServer())
+	{
+		NumSkipped = RenderAssets.Num();
+	}
+	else
+	{
+		AssetsToLoad.Append(RenderAssets);
+	}
+	AssetsToLoad.RemoveAll([](const FSoftObjectPath& Path) { return Path.IsNull(); });
+
+	NumRequested = AssetsToLoad.Num();
+	PreloadStartTime = FPlatformTime::Seconds();
+	PreloadStartUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+
+	if (AssetsToLoad.Num() == 0)
+	{
+		OnPreloadComplete();
+		return;
+	}
+
+	PreloadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(AssetsToLoad,
+		FStreamableDelegate::CreateUObject(this, &UAssetPreloadSubsystem::OnPreloadComplete), FStreamableManager::AsyncLoadHighPriority);
+}
+
+void UAssetPreloadSubsystem::Deinitialize()
+{
+	if (PreloadHandle.IsValid())
+	{
+		PreloadHandle->CancelHandle();
+		PreloadHandle.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+void UAssetPreloadSubsystem::OnPreloadComplete()
+{
+	bPreloadComplete = true;
+	PreloadSeconds = FPlatformTime::Seconds() - PreloadStartTime;
+	PreloadEndUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+
+	UE_LOG(LogAssetPreload, Display, TEXT("Preloaded %d assets in %.1f ms (%d render-only assets skipped), resident memory %.1f MB -> %.1f MB"),
+		NumRequested, PreloadSeconds * 1000.0, NumSkipped, ToMegabytes(PreloadStartUsedPhysical), ToMegabytes(PreloadEndUsedPhysical));
+
+	// -AssetReport：预加载完成时输出一次报告。跨版本对比请用 Scripts/AssetFootprint.sh，它只依赖引擎工具。
+	if (FParse::Param(FCommandLine::Get(), TEXT("AssetReport")))
+	{
+		LogReport();
+	}
+}
+
+void UAssetPreloadSubsystem::LogReport() const
+{
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+
+	int32 NumStaticMeshes = 0;
+	int32 NumSkeletalMeshes = 0;
+	int32 NumParticleSystems = 0;
+	int32 NumTextures = 0;
+	for (TObjectIterator<UObject> It; It; ++It)
+	{
+		const UObject* Object = *It;
+		NumStaticMeshes += Object->IsA<UStaticMesh>() ? 1 : 0;
+		NumSkeletalMeshes += Object->IsA<USkeletalMesh>() ? 1 : 0;
+		NumParticleSystems += Object->IsA<UParticleSystem>() ? 1 : 0;
+		NumTextures += Object->IsA<UTexture>() ? 1 : 0;
+	}
+
+	UE_LOG(LogAssetPreload, Display, TEXT("Asset report (%s):"), IsRunningDedicatedServer() ? TEXT("dedicated server") : TEXT("client/listen server"));
+	UE_LOG(LogAssetPreload, Display, TEXT("  Process startup to now: %.2f s"), FPlatformTime::Seconds() - GStartTime);
+	UE_LOG(LogAssetPreload, Display, TEXT("  Preload: %s, %d assets, %d render-only skipped, %.1f ms"),
+		bPreloadComplete ? TEXT("complete") : TEXT("in progress"), NumRequested, NumSkipped, PreloadSeconds * 1000.0);
+	UE_LOG(LogAssetPreload, Display, TEXT("  Resident memory: %.1f MB now, %.1f MB peak, %.1f MB -> %.1f MB across preload"),
+		ToMegabytes(MemoryStats.UsedPhysical), ToMegabytes(MemoryStats.PeakUsedPhysical), ToMegabytes(PreloadStartUsedPhysical), ToMegabytes(PreloadEndUsedPhysical));
+	UE_LOG(LogAssetPreload, Display, TEXT("  Loaded render assets: %d static meshes, %d skeletal meshes, %d particle systems, %d textures"),
+		NumStaticMeshes, NumSkeletalMeshes, NumParticleSystems, NumTextures);
+}
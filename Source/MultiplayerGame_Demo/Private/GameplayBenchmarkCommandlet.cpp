@@ -0,0 +1,582 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayBenchmarkCommandlet.h"
+#include "MPCharacterMovementComponent.h"
+#include "MultiplayerGame_DemoCharacter.h"
+#include "ThirdPersonMPProjectile.h"
+#include "Tests/GameplayTestWorld.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/DamageType.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/CoreNet.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogGameplayBenchmark, Log, All);
+
+namespace GameplayBenchmark
+{
+	// 固定的帧间隔，使各次运行推进相同的游戏时间。
+	static const float DeltaSeconds = 1.0f / 30.0f;
+
+	/** 按服务器收到一次开火输入的方式开火，与随移动包到达的开火走同一条路径。Sequence 需逐次递增。*/
+	static void Fire(AMultiplayerGame_DemoCharacter* Character, uint16 Sequence, float TimeStamp)
+	{
+		FFireInputPacket FireInput;
+		FFireInputEntry& Entry = FireInput.Entries.AddDefaulted_GetRef();
+		Entry.Sequence = Sequence;
+		Entry.TimeStamp = TimeStamp;
+		Character->ServerProcessFireInput(FireInput);
+	}
+
+	static double GetPercentile(TArray<double>& Values, float Percentile)
+	{
+		if (Values.Num() == 0)
+		{
+			return 0.0;
+		}
+		Values.Sort();
+		return Values[FMath::Min(Values.Num() - 1, (int32)(Values.Num() * Percentile))];
+	}
+}
+
+UGameplayBenchmarkCommandlet::UGameplayBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = true;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UGameplayBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 NumIterations = 10000;
+	FParse::Value(*Params, TEXT("Iterations="), NumIterations);
+	NumIterations = FMath::Max(1, NumIterations);
+
+	int32 NumFrames = 300;
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	NumFrames = FMath::Max(1, NumFrames);
+
+	TArray<int32> Scales = { 10, 100, 1000 };
+	FString ScalesString;
+	if (FParse::Value(*Params, TEXT("Scales="), ScalesString))
+	{
+		TArray<FString> ScaleStrings;
+		ScalesString.ParseIntoArray(ScaleStrings, TEXT(","));
+		Scales.Reset();
+		for (const FString& Scale : ScaleStrings)
+		{
+			Scales.Add(FMath::Max(1, FCString::Atoi(*Scale)));
+		}
+	}
+
+	FString OutputFilename = FPaths::ProjectSavedDir() / TEXT("Benchmarks/GameplayBenchmark.json");
+	FParse::Value(*Params, TEXT("Output="), OutputFilename);
+
+	FString BaselineFilename = FPaths::ProjectDir() / TEXT("Benchmarks/GameplayBaseline.json");
+	FParse::Value(*Params, TEXT("Baseline="), BaselineFilename);
+
+	float ThresholdPercent = 10.0f;
+	FParse::Value(*Params, TEXT("Threshold="), ThresholdPercent);
+
+	Results.Reset();
+
+	// 每项测试使用单独的世界，互不影响（对象池、网格等都从空开始）。
+	{
+		UWorld* World = GameplayTestWorld::Create(TEXT("GameplayBenchmark"));
+		RunDamageBenchmark(World, NumIterations);
+		GameplayTestWorld::Destroy(World);
+	}
+	{
+		UWorld* World = GameplayTestWorld::Create(TEXT("GameplayBenchmark"));
+		RunFireBenchmark(World, FMath::Max(1, NumIterations / 100));
+		GameplayTestWorld::Destroy(World);
+	}
+	{
+		UWorld* World = GameplayTestWorld::Create(TEXT("GameplayBenchmark"));
+		RunReplicationBenchmark(World, NumIterations);
+		GameplayTestWorld::Destroy(World);
+	}
+	{
+		UWorld* World = GameplayTestWorld::Create(TEXT("GameplayBenchmark"));
+		RunMoveFormatBenchmark(World, NumIterations);
+		GameplayTestWorld::Destroy(World);
+	}
+	for (int32 NumCharacters : Scales)
+	{
+		UWorld* World = GameplayTestWorld::Create(TEXT("GameplayBenchmark"));
+		RunScenario(World, NumCharacters, NumFrames);
+		GameplayTestWorld::Destroy(World);
+	}
+
+	if (!WriteResults(OutputFilename))
+	{
+		UE_LOG(LogGameplayBenchmark, Error, TEXT("Could not write %s"), *OutputFilename);
+		return 1;
+	}
+	UE_LOG(LogGameplayBenchmark, Display, TEXT("Wrote %d results to %s"), Results.Num(), *OutputFilename);
+
+	if (FParse::Param(*Params, TEXT("UpdateBaseline")))
+	{
+		// 保留基线中手工设置的阈值，只替换测量值。
+		TSharedPtr<FJsonObject> Baseline;
+		FString BaselineJson;
+		const TSharedPtr<FJsonObject>* Thresholds = nullptr;
+		if (FFileHelper::LoadFileToString(BaselineJson, *BaselineFilename) && FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineJson), Baseline) && Baseline.IsValid())
+		{
+			Baseline->TryGetObjectField(TEXT("thresholds"), Thresholds);
+		}
+		if (!WriteResults(BaselineFilename, Thresholds ? *Thresholds : nullptr))
+		{
+			UE_LOG(LogGameplayBenchmark, Error, TEXT("Could not write %s"), *BaselineFilename);
+			return 1;
+		}
+		UE_LOG(LogGameplayBenchmark, Display, TEXT("Updated baseline %s"), *BaselineFilename);
+		return 0;
+	}
+
+	// 没有基线就无法发现退化，默认视为失败；只有明确允许时才跳过比较。
+	if (!FPaths::FileExists(BaselineFilename))
+	{
+		if (FParse::Param(*Params, TEXT("AllowNoBaseline")))
+		{
+			UE_LOG(LogGameplayBenchmark, Warning, TEXT("No baseline at %s, nothing to compare (-AllowNoBaseline)."), *BaselineFilename);
+			return 0;
+		}
+		UE_LOG(LogGameplayBenchmark, Error, TEXT("No baseline at %s. Run with -UpdateBaseline to create one, or -AllowNoBaseline to skip the comparison."), *BaselineFilename);
+		return 1;
+	}
+
+	const int32 NumRegressions = CompareWithBaseline(BaselineFilename, ThresholdPercent);
+	if (NumRegressions > 0)
+	{
+		UE_LOG(LogGameplayBenchmark, Error, TEXT("%d results regressed past their threshold"), NumRegressions);
+		return 1;
+	}
+
+	UE_LOG(LogGameplayBenchmark, Display, TEXT("All results within threshold of the baseline"));
+	return 0;
+}
+
+double UGameplayBenchmarkCommandlet::TickWorld(UWorld* World)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	World->Tick(LEVELTICK_All, GameplayBenchmark::DeltaSeconds);
+	++GFrameCounter;
+	return (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+AMultiplayerGame_DemoCharacter* UGameplayBenchmarkCommandlet::SpawnCharacter(UWorld* World, const FVector& Location)
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AMultiplayerGame_DemoCharacter* Character = World->SpawnActor<AMultiplayerGame_DemoCharacter>(AMultiplayerGame_DemoCharacter::StaticClass(), Location, FRotator::ZeroRotator, SpawnParameters);
+
+	// 世界中没有地面，飞行模式让角色停在原地，但移动组件照常Tick。
+	if (Character)
+	{
+		Character->GetCharacterMovement()->SetMovementMode(MOVE_Flying);
+	}
+	return Character;
+}
+
+void UGameplayBenchmarkCommandlet::AddResult(const FString& Name, double Value)
+{
+	Results.Emplace(Name, Value);
+	UE_LOG(LogGameplayBenchmark, Display, TEXT("  %-36s %12.3f"), *Name, Value);
+}
+
+void UGameplayBenchmarkCommandlet::RunDamageBenchmark(UWorld* World, int32 NumIterations)
+{
+	AMultiplayerGame_DemoCharacter* Target = SpawnCharacter(World, FVector::ZeroVector);
+	if (!Target)
+	{
+		return;
+	}
+
+	const FDamageEvent DamageEvent(UDamageType::StaticClass());
+	const float MaxHealth = Target->GetMaxHealth();
+
+	// 每次1点伤害，按不致死的次数分批计时，批次之间回满血，避免死亡流程混入测量。
+	double TotalSeconds = 0.0;
+	for (int32 NumDone = 0; NumDone < NumIterations;)
+	{
+		Target->SetCurrentHealth(MaxHealth);
+		const int32 BatchSize = FMath::Min(NumIterations - NumDone, FMath::Max(1, FMath::FloorToInt(MaxHealth) - 2));
+
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < BatchSize; ++Iteration)
+		{
+			Target->TakeDamage(1.0f, DamageEvent, nullptr, nullptr);
+		}
+		TotalSeconds += FPlatformTime::Seconds() - StartTime;
+		NumDone += BatchSize;
+	}
+	AddResult(TEXT("Damage.TakeDamageNs"), TotalSeconds * 1e9 / NumIterations);
+
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		Target->SetCurrentHealth((Iteration & 1) ? MaxHealth : MaxHealth * 0.5f);
+	}
+	AddResult(TEXT("Damage.SetCurrentHealthNs"), (FPlatformTime::Seconds() - StartTime) * 1e9 / NumIterations);
+}
+
+void UGameplayBenchmarkCommandlet::RunFireBenchmark(UWorld* World, int32 NumIterations)
+{
+	// 射手朝 +X 开火，目标在正前方6米。
+	AMultiplayerGame_DemoCharacter* Shooter = SpawnCharacter(World, FVector::ZeroVector);
+	AMultiplayerGame_DemoCharacter* Target = SpawnCharacter(World, FVector(600.0f, 0.0f, 0.0f));
+	if (!Shooter || !Target)
+	{
+		return;
+	}
+	TickWorld(World);
+
+	const int32 MaxFramesPerShot = 60;
+	double FireSeconds = 0.0;
+	double SpawnToImpactSeconds = 0.0;
+	int32 NumImpacts = 0;
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		if (Target->GetCurrentHealth() <= Target->GetMaxHealth() * 0.5f)
+		{
+			Target->SetCurrentHealth(Target->GetMaxHealth());
+		}
+		const float HealthBefore = Target->GetCurrentHealth();
+
+		const double StartTime = FPlatformTime::Seconds();
+		GameplayBenchmark::Fire(Shooter, (uint16)(Iteration + 1), World->GetTimeSeconds());
+		FireSeconds += FPlatformTime::Seconds() - StartTime;
+
+		for (int32 Frame = 0; Frame < MaxFramesPerShot && Target->GetCurrentHealth() >= HealthBefore; ++Frame)
+		{
+			TickWorld(World);
+		}
+
+		if (Target->GetCurrentHealth() < HealthBefore)
+		{
+			SpawnToImpactSeconds += FPlatformTime::Seconds() - StartTime;
+			++NumImpacts;
+		}
+	}
+
+	AddResult(TEXT("Fire.HandleFireUs"), FireSeconds * 1e6 / NumIterations);
+	if (NumImpacts < NumIterations)
+	{
+		UE_LOG(LogGameplayBenchmark, Warning, TEXT("Only %d of %d shots hit the target"), NumImpacts, NumIterations);
+	}
+	AddResult(TEXT("Fire.SpawnToImpactMs"), NumImpacts > 0 ? SpawnToImpactSeconds * 1000.0 / NumImpacts : 0.0);
+}
+
+void UGameplayBenchmarkCommandlet::RunReplicationBenchmark(UWorld* World, int32 NumIterations)
+{
+	AMultiplayerGame_DemoCharacter* Character = SpawnCharacter(World, FVector::ZeroVector);
+	if (!Character)
+	{
+		return;
+	}
+
+	UClass* Class = Character->GetClass();
+	if (!Class->HasAnyClassFlags(CLASS_ReplicationDataIsSetUp))
+	{
+		Class->SetUpRuntimeReplicationData();
+	}
+
+	TArray<FLifetimeProperty> LifetimeProps;
+	Character->GetLifetimeReplicatedProps(LifetimeProps);
+
+	// 对象引用需要连接的 PackageMap，这里只序列化不依赖连接的属性（数值、枚举、带 NetSerialize 的结构体等）。
+	TArray<const FRepRecord*> Records;
+	int32 NumSkipped = 0;
+	for (const FLifetimeProperty& LifetimeProp : LifetimeProps)
+	{
+		const FRepRecord& Record = Class->ClassReps[LifetimeProp.RepIndex];
+		const FProperty* Property = Record.Property;
+		const FStructProperty* StructProperty = CastField<FStructProperty>(Property);
+
+		TArray<const FStructProperty*> EncounteredStructProps;
+		const bool bSupported = !CastField<FObjectPropertyBase>(Property) && !CastField<FInterfaceProperty>(Property) && !CastField<FArrayProperty>(Property)
+			&& (!StructProperty || (StructProperty->Struct->StructFlags & STRUCT_NetSerializeNative))
+			&& !Property->ContainsObjectReference(EncounteredStructProps);
+		if (bSupported)
+		{
+			Records.Add(&Record);
+		}
+		else
+		{
+			++NumSkipped;
+		}
+	}
+
+	FNetBitWriter Writer(nullptr, 0);
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		Writer.Reset();
+		for (const FRepRecord* Record : Records)
+		{
+			Record->Property->NetSerializeItem(Writer, nullptr, Record->Property->ContainerPtrToValuePtr<void>(Character, Record->Index));
+		}
+	}
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogGameplayBenchmark, Display, TEXT("Replication: %d lifetime properties, %d serialized, %d skipped (object references)"), LifetimeProps.Num(), Records.Num(), NumSkipped);
+	AddResult(TEXT("Replication.SerializeNsPerCharacter"), Seconds * 1e9 / NumIterations);
+	AddResult(TEXT("Replication.BitsPerCharacter"), Writer.GetNumBits());
+}
+
+void UGameplayBenchmarkCommandlet::RunMoveFormatBenchmark(UWorld* World, int32 NumIterations)
+{
+	AMultiplayerGame_DemoCharacter* Character = SpawnCharacter(World, FVector::ZeroVector);
+	UMPCharacterMovementComponent* Movement = Character ? Cast<UMPCharacterMovementComponent>(Character->GetCharacterMovement()) : nullptr;
+	IConsoleVariable* CompactVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("mp.Move.Compact"));
+	if (!Movement || !CompactVariable)
+	{
+		return;
+	}
+
+	// 客户端以60帧发送行走的移动：约四分之一没有输入，其余朝随机方向全速或半速加速，偶尔跳跃，镜头持续转动。
+	struct FScriptedMove
+	{
+		float TimeStamp;
+		FVector Acceleration;
+		FVector Location;
+		FRotator ControlRotation;
+		uint8 Flags;
+	};
+	TArray<FScriptedMove> Moves;
+	Moves.Reserve(NumIterations);
+	FRandomStream Random(24680);
+	const float MaxAcceleration = Movement->GetMaxAcceleration();
+	FVector Location(0.0f, 0.0f, 90.15f);
+	FRotator ControlRotation = FRotator::ZeroRotator;
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		FScriptedMove& Move = Moves.AddDefaulted_GetRef();
+		Move.TimeStamp = Iteration / 60.0f;
+		const float Input = Random.FRand() < 0.25f ? 0.0f : (Random.FRand() < 0.5f ? 0.5f : 1.0f);
+		const float Direction = Random.FRandRange(0.0f, 2.0f * PI);
+		Move.Acceleration = FVector(FMath::Cos(Direction), FMath::Sin(Direction), 0.0f) * Input * MaxAcceleration;
+		Location += Move.Acceleration.GetSafeNormal() * Random.FRandRange(0.0f, 10.0f);
+		Move.Location = Location;
+		ControlRotation.Yaw = FRotator::ClampAxis(ControlRotation.Yaw + Random.FRandRange(-3.0f, 3.0f));
+		ControlRotation.Pitch = FRotator::ClampAxis(FMath::Clamp(FRotator::NormalizeAxis(ControlRotation.Pitch) + Random.FRandRange(-1.0f, 1.0f), -60.0f, 60.0f));
+		Move.ControlRotation = ControlRotation;
+		Move.Flags = Random.FRand() < 0.02f ? FSavedMove_Character::FLAG_JumpPressed : 0;
+	}
+
+	const int32 PreviousCompact = CompactVariable->GetInt();
+	double BitsPerMove[2] = {};
+	for (int32 Compact = 0; Compact <= 1; ++Compact)
+	{
+		CompactVariable->Set(Compact, ECVF_SetByCode);
+		const TCHAR* FormatName = Compact ? TEXT("Compact") : TEXT("Default");
+
+		// 客户端保存移动时按当前格式的精度取整加速度，服务器应解码出完全相同的输入。
+		TArray<FMPCharacterNetworkMoveData> ClientMoves;
+		ClientMoves.SetNum(Moves.Num());
+		for (int32 Index = 0; Index < Moves.Num(); ++Index)
+		{
+			const FScriptedMove& Move = Moves[Index];
+			FMPCharacterNetworkMoveData& MoveData = ClientMoves[Index];
+			MoveData.TimeStamp = Move.TimeStamp;
+			MoveData.Acceleration = Movement->RoundAcceleration(Move.Acceleration);
+			MoveData.Location = Move.Location;
+			MoveData.ControlRotation = Move.ControlRotation;
+			MoveData.CompressedMoveFlags = Move.Flags;
+			MoveData.MovementMode = MOVE_Walking;
+		}
+
+		FNetBitWriter Writer(nullptr, 0);
+		int64 TotalBits = 0;
+		double SerializeSeconds = 0.0;
+		float MaxLocationError = 0.0f;
+		int32 NumInputMismatches = 0;
+		for (FMPCharacterNetworkMoveData& MoveData : ClientMoves)
+		{
+			Writer.Reset();
+			const double StartTime = FPlatformTime::Seconds();
+			MoveData.Serialize(*Movement, Writer, nullptr, ENetworkMoveType::NewMove);
+			SerializeSeconds += FPlatformTime::Seconds() - StartTime;
+			TotalBits += Writer.GetNumBits();
+
+			FNetBitReader Reader(nullptr, Writer.GetData(), Writer.GetNumBits());
+			FMPCharacterNetworkMoveData Decoded;
+			Decoded.Serialize(*Movement, Reader, nullptr, ENetworkMoveType::NewMove);
+
+			MaxLocationError = FMath::Max(MaxLocationError, FVector::Dist(Decoded.Location, MoveData.Location));
+			if (!Decoded.Acceleration.Equals(MoveData.Acceleration, KINDA_SMALL_NUMBER) || Decoded.CompressedMoveFlags != MoveData.CompressedMoveFlags
+				|| Decoded.bCompact != (Compact != 0))
+			{
+				++NumInputMismatches;
+			}
+		}
+
+		// 服务器模拟的输入与客户端不同会直接导致纠正。
+		if (NumInputMismatches > 0)
+		{
+			UE_LOG(LogGameplayBenchmark, Error, TEXT("Move format %s: %d of %d moves decoded with different input than the client simulated"), FormatName, NumInputMismatches, ClientMoves.Num());
+		}
+
+		BitsPerMove[Compact] = (double)TotalBits / ClientMoves.Num();
+		AddResult(FString::Printf(TEXT("Move.%s.BitsPerMove"), FormatName), BitsPerMove[Compact]);
+		AddResult(FString::Printf(TEXT("Move.%s.SerializeNs"), FormatName), SerializeSeconds * 1e9 / ClientMoves.Num());
+		AddResult(FString::Printf(TEXT("Move.%s.MaxLocationErrorCm"), FormatName), MaxLocationError);
+	}
+	CompactVariable->Set(PreviousCompact, ECVF_SetByCode);
+
+	UE_LOG(LogGameplayBenchmark, Display, TEXT("Move format: %.1f bits per move default, %.1f compact (%.0f%% smaller)"),
+		BitsPerMove[0], BitsPerMove[1], BitsPerMove[0] > 0.0 ? (1.0 - BitsPerMove[1] / BitsPerMove[0]) * 100.0 : 0.0);
+	if (BitsPerMove[1] >= BitsPerMove[0])
+	{
+		UE_LOG(LogGameplayBenchmark, Error, TEXT("Move format: compact moves are not smaller than default moves"));
+	}
+}
+
+void UGameplayBenchmarkCommandlet::RunScenario(UWorld* World, int32 NumCharacters, int32 NumFrames)
+{
+	// 10列的网格，每个角色朝 +X 向下一列开火；行距与列距保证投射物只会命中正前方的角色。
+	const int32 NumColumns = FMath::Min(NumCharacters, 10);
+	TArray<TWeakObjectPtr<AMultiplayerGame_DemoCharacter>> Characters;
+	Characters.Reserve(NumCharacters);
+	for (int32 Index = 0; Index < NumCharacters; ++Index)
+	{
+		const FVector Location((Index % NumColumns) * 500.0f, (Index / NumColumns) * 300.0f, 0.0f);
+		Characters.Add(SpawnCharacter(World, Location));
+	}
+
+	const float FireRate = GetDefault<AMultiplayerGame_DemoCharacter>()->GetFireRate();
+	const int32 FramesPerShot = FMath::Max(1, FMath::RoundToInt(FireRate / GameplayBenchmark::DeltaSeconds));
+
+	// 先跑一小段，让对象池与网格进入稳定状态。
+	const int32 NumWarmupFrames = FramesPerShot * 4;
+	TArray<double> FrameMs;
+	FrameMs.Reserve(NumFrames);
+	for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; ++Frame)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < Characters.Num(); ++Index)
+		{
+			AMultiplayerGame_DemoCharacter* Character = Characters[Index].Get();
+			if (!Character || Character->IsDead())
+			{
+				continue;
+			}
+			// 受到伤害的角色回满血，避免场景中的角色逐渐死光。
+			if (Character->GetCurrentHealth() <= Character->GetMaxHealth() * 0.5f)
+			{
+				Character->SetCurrentHealth(Character->GetMaxHealth());
+			}
+			// 错开开火的帧，使每帧的负载均匀。
+			if ((Frame + Index) % FramesPerShot == 0)
+			{
+				GameplayBenchmark::Fire(Character, (uint16)(Frame + 1), World->GetTimeSeconds());
+			}
+		}
+		TickWorld(World);
+
+		if (Frame >= NumWarmupFrames)
+		{
+			FrameMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		}
+	}
+
+	double TotalMs = 0.0;
+	for (double Ms : FrameMs)
+	{
+		TotalMs += Ms;
+	}
+
+	int32 NumProjectiles = 0;
+	for (TActorIterator<AThirdPersonMPProjectile> It(World); It; ++It)
+	{
+		NumProjectiles += It->IsHidden() ? 0 : 1;
+	}
+	UE_LOG(LogGameplayBenchmark, Display, TEXT("Scenario %d characters: %d frames, %d projectile actors in flight at the end"), NumCharacters, FrameMs.Num(), NumProjectiles);
+
+	AddResult(FString::Printf(TEXT("Scenario.%d.FrameMsAvg"), NumCharacters), TotalMs / FMath::Max(1, FrameMs.Num()));
+	AddResult(FString::Printf(TEXT("Scenario.%d.FrameMsP90"), NumCharacters), GameplayBenchmark::GetPercentile(FrameMs, 0.9f));
+}
+
+bool UGameplayBenchmarkCommandlet::WriteResults(const FString& Filename, const TSharedPtr<FJsonObject>& Thresholds) const
+{
+	FString Json;
+	TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&Json);
+	JsonWriter->WriteObjectStart();
+	JsonWriter->WriteValue(TEXT("platform"), FString(FPlatformProperties::PlatformName()));
+	JsonWriter->WriteValue(TEXT("configuration"), FString(LexToString(FApp::GetBuildConfiguration())));
+	JsonWriter->WriteValue(TEXT("time"), FDateTime::UtcNow().ToIso8601());
+	JsonWriter->WriteObjectStart(TEXT("metrics"));
+	for (const TPair<FString, double>& Result : Results)
+	{
+		JsonWriter->WriteValue(Result.Key, Result.Value);
+	}
+	JsonWriter->WriteObjectEnd();
+	if (Thresholds.IsValid())
+	{
+		FJsonSerializer::Serialize(MakeShared<FJsonValueObject>(Thresholds), TEXT("thresholds"), JsonWriter, false);
+	}
+	JsonWriter->WriteObjectEnd();
+	JsonWriter->Close();
+
+	return FFileHelper::SaveStringToFile(Json, *Filename);
+}
+
+int32 UGameplayBenchmarkCommandlet::CompareWithBaseline(const FString& BaselineFilename, float DefaultThresholdPercent) const
+{
+	FString Json;
+	TSharedPtr<FJsonObject> Baseline;
+	const TSharedPtr<FJsonObject>* Metrics = nullptr;
+	if (!FFileHelper::LoadFileToString(Json, *BaselineFilename) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Baseline)
+		|| !Baseline.IsValid() || !Baseline->TryGetObjectField(TEXT("metrics"), Metrics))
+	{
+		UE_LOG(LogGameplayBenchmark, Error, TEXT("Could not read baseline %s"), *BaselineFilename);
+		return 1;
+	}
+
+	const TSharedPtr<FJsonObject>* Thresholds = nullptr;
+	Baseline->TryGetObjectField(TEXT("thresholds"), Thresholds);
+
+	UE_LOG(LogGameplayBenchmark, Display, TEXT("Comparing with %s (default threshold %.1f%%):"), *BaselineFilename, DefaultThresholdPercent);
+	int32 NumRegressions = 0;
+	for (const TPair<FString, double>& Result : Results)
+	{
+		double BaselineValue = 0.0;
+		if (!(*Metrics)->TryGetNumberField(Result.Key, BaselineValue) || BaselineValue <= 0.0)
+		{
+			UE_LOG(LogGameplayBenchmark, Warning, TEXT("  %-36s %12.3f (no baseline)"), *Result.Key, Result.Value);
+			continue;
+		}
+
+		double ThresholdPercent = DefaultThresholdPercent;
+		if (Thresholds)
+		{
+			(*Thresholds)->TryGetNumberField(Result.Key, ThresholdPercent);
+		}
+
+		const double ChangePercent = (Result.Value / BaselineValue - 1.0) * 100.0;
+		if (ChangePercent > ThresholdPercent)
+		{
+			++NumRegressions;
+			UE_LOG(LogGameplayBenchmark, Error, TEXT("  %-36s %12.3f baseline %12.3f %+7.1f%% (threshold %.1f%%)"), *Result.Key, Result.Value, BaselineValue, ChangePercent, ThresholdPercent);
+		}
+		else
+		{
+			UE_LOG(LogGameplayBenchmark, Display, TEXT("  %-36s %12.3f baseline %12.3f %+7.1f%%"), *Result.Key, Result.Value, BaselineValue, ChangePercent);
+		}
+	}
+	return NumRegressions;
+}
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayCountersSubsystem.h"
+#include "MultiplayerGame_Demo.h"
+#include "ProjectileSimulationSubsystem.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogGameplayCounters, Log, All);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active Projectiles"), STAT_ActiveProjectiles, STATGROUP_MultiplayerGame);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Shots / sec"), STAT_ShotsPerSecond, STATGROUP_MultiplayerGame);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Damage Events / sec"), STAT_DamageEventsPerSecond, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net Out Bytes / sec"), STAT_NetOutBytesPerSecond, STATGROUP_MultiplayerGame);
+
+CSV_DEFINE_CATEGORY(MultiplayerGame, true);
+
+static FAutoConsoleCommandWithWorld GGameplayCountersCommand(
+	TEXT("mp.Stats.Counters"),
+	TEXT("Prints active projectiles, shots/sec, damage events/sec and outgoing bytes/sec for the current world."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UGameplayCountersSubsystem* Counters = World ? World->GetSubsystem<UGameplayCountersSubsystem>() : nullptr)
+		{
+			Counters->LogCounters();
+		}
+	}));
+
+bool UGameplayCountersSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+ETickableTickType UGameplayCountersSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId UGameplayCountersSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGameplayCountersSubsystem, STATGROUP_Tickables);
+}
+
+void UGameplayCountersSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+
+	const UProjectileSimulationSubsystem* ProjectileSimulation = World->GetSubsystem<UProjectileSimulationSubsystem>();
+	NumActiveProjectiles = NumActiveProjectileActors + (ProjectileSimulation ? ProjectileSimulation->GetNumProjectiles() : 0);
+
+	const UNetDriver* NetDriver = World->GetNetDriver();
+	NetOutBytesPerSecond = NetDriver ? (int32)NetDriver->OutBytesPerSecond : 0;
+
+	// 速率按1秒窗口更新，避免逐帧跳动。
+	ShotsInWindow += ShotsThisFrame;
+	DamageEventsInWindow += DamageEventsThisFrame;
+	WindowSeconds += DeltaTime;
+	if (WindowSeconds >= 1.0f)
+	{
+		ShotsPerSecond = ShotsInWindow / WindowSeconds;
+		DamageEventsPerSecond = DamageEventsInWindow / WindowSeconds;
+		ShotsInWindow = 0;
+		DamageEventsInWindow = 0;
+		WindowSeconds = 0.0f;
+	}
+
+	SET_DWORD_STAT(STAT_ActiveProjectiles, NumActiveProjectiles);
+	SET_FLOAT_STAT(STAT_ShotsPerSecond, ShotsPerSecond);
+	SET_FLOAT_STAT(STAT_DamageEventsPerSecond, DamageEventsPerSecond);
+	SET_DWORD_STAT(STAT_NetOutBytesPerSecond, NetOutBytesPerSecond);
+
+	// CSV 中同时记录本帧的计数，便于按构建对比总量；每个类复制的字节数由复制图的 CSVTracker 写入。
+	CSV_CUSTOM_STAT(MultiplayerGame, ActiveProjectiles, NumActiveProjectiles, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(MultiplayerGame, ShotsFired, ShotsThisFrame, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(MultiplayerGame, DamageEvents, DamageEventsThisFrame, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(MultiplayerGame, ShotsPerSecond, ShotsPerSecond, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(MultiplayerGame, DamageEventsPerSecond, DamageEventsPerSecond, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(MultiplayerGame, NetOutBytesPerSecond, NetOutBytesPerSecond, ECsvCustomStatOp::Set);
+
+	ShotsThisFrame = 0;
+	DamageEventsThisFrame = 0;
+}
+
+void UGameplayCountersSubsystem::LogCounters() const
+{
+	UE_LOG(LogGameplayCounters, Log, TEXT("Gameplay counters: ActiveProjectiles=%d (actors %d) Shots/s=%.1f DamageEvents/s=%.1f NetOutBytes/s=%d"),
+		NumActiveProjectiles, NumActiveProjectileActors, ShotsPerSecond, DamageEventsPerSecond, NetOutBytesPerSecond);
+}
@@ -0,0 +1,322 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayEventChannel.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "Serialization/Archive.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogGameplayEvents, Log, All);
+
+static TAutoConsoleVariable<int32> CVarGameplayEventLog(
+	TEXT("mp.Events.Log"),
+	0,
+	TEXT("Writes gameplay events (health changes, kills, fire) from a background thread to Saved/Logs.\n")
+	TEXT("0: off, 1: binary (.mpev), 2: CSV. Read when the channel starts."),
+	ECVF_Default);
+
+static FAutoConsoleCommand GGameplayEventStatsCommand(
+	TEXT("mp.Events.Stats"),
+	TEXT("Prints gameplay event channel counters (pushed, dropped, consumed)."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FGameplayEventChannel::Get().LogStats();
+	}));
+
+/**
+ * 把事件写入文件的消费者。二进制格式：文件头（"MPEV"、版本、记录大小）后紧跟记录。
+ * 每条记录按字段顺序写出（不含结构体的对齐填充）：WorldTime、SubjectId、InstigatorId、Value、Delta、Location.X/Y/Z、Type。
+ */
+class FGameplayEventFileSink : public IGameplayEventSink
+{
+public:
+	FGameplayEventFileSink(const FString& InFilename, bool bInCsv)
+		: Filename(InFilename)
+		, bCsv(bInCsv)
+	{
+		Writer.Reset(IFileManager::Get().CreateFileWriter(*Filename));
+		if (!Writer)
+		{
+			return;
+		}
+
+		if (bCsv)
+		{
+			WriteUtf8(TEXT("WorldTime,Type,SubjectId,InstigatorId,Value,Delta,X,Y,Z\n"));
+		}
+		else
+		{
+			uint32 Magic = 0x5645504D; // "MPEV"
+			uint32 Version = 2;
+			uint32 RecordSize = BinaryRecordSize;
+			*Writer << Magic << Version << RecordSize;
+		}
+	}
+
+	virtual void Consume(TArrayView<const FGameplayEventRecord> Records) override
+	{
+		if (!Writer)
+		{
+			return;
+		}
+
+		if (!bCsv)
+		{
+			// 逐个字段写入复用的缓冲，再一次写入文件；直接写结构体会把未初始化的填充字节写进文件。
+			BinaryBuffer.Reset();
+			FMemoryWriter BufferWriter(BinaryBuffer);
+			for (const FGameplayEventRecord& Record : Records)
+			{
+				float WorldTime = Record.WorldTime;
+				uint32 SubjectId = Record.SubjectId;
+				uint32 InstigatorId = Record.InstigatorId;
+				float Value = Record.Value;
+				float Delta = Record.Delta;
+				FVector Location = Record.Location;
+				uint8 Type = (uint8)Record.Type;
+				BufferWriter << WorldTime << SubjectId << InstigatorId << Value << Delta << Location.X << Location.Y << Location.Z << Type;
+			}
+			Writer->Serialize(BinaryBuffer.GetData(), BinaryBuffer.Num());
+			return;
+		}
+
+		// 在后台线程格式化，复用同一个字符串缓冲。
+		CsvBuffer.Reset();
+		for (const FGameplayEventRecord& Record : Records)
+		{
+			CsvBuffer += FString::Printf(TEXT("%.3f,%d,%u,%u,%.3f,%.3f,%.1f,%.1f,%.1f\n"),
+				Record.WorldTime, (int32)Record.Type, Record.SubjectId, Record.InstigatorId, Record.Value, Record.Delta,
+				Record.Location.X, Record.Location.Y, Record.Location.Z);
+		}
+		WriteUtf8(*CsvBuffer);
+	}
+
+	virtual void Flush() override
+	{
+		if (Writer)
+		{
+			Writer->Close();
+			Writer.Reset();
+			UE_LOG(LogGameplayEvents, Log, TEXT("Gameplay event log closed: %s"), *Filename);
+		}
+	}
+
+private:
+	void WriteUtf8(const TCHAR* Text)
+	{
+		FTCHARToUTF8 Utf8(Text);
+		Writer->Serialize(const_cast<ANSICHAR*>(Utf8.Get()), Utf8.Length());
+	}
+
+	// 二进制格式中一条记录的字节数
+	static constexpr uint32 BinaryRecordSize = 8 * sizeof(uint32) + sizeof(uint8);
+
+	FString Filename;
+	bool bCsv;
+	TUniquePtr<FArchive> Writer;
+	FString CsvBuffer;
+	TArray<uint8> BinaryBuffer;
+};
+
+FGameplayEventChannel& FGameplayEventChannel::Get()
+{
+	static FGameplayEventChannel Channel;
+	return Channel;
+}
+
+bool FGameplayEventChannel::IsEnabled() const
+{
+	// 启动后以实际的消费者为准：最后一个消费者移除后不再复制事件；启动前由 mp.Events.Log 决定是否需要日志文件。
+	if (bRunning)
+	{
+		return NumExternalSinks > 0 || bHasFileSink;
+	}
+	return NumExternalSinks > 0 || CVarGameplayEventLog.GetValueOnGameThread() != 0;
+}
+
+void FGameplayEventChannel::Push(EGameplayEventType Type, const UObject* Subject, const UObject* Instigator, float Value, float Delta, const FVector& Location)
+{
+	checkSlow(IsInGameThread());
+
+	if (!IsEnabled())
+	{
+		return;
+	}
+	if (!bRunning)
+	{
+		Start();
+	}
+
+	FGameplayEventRecord Record;
+	// 撞到场景时没有 Subject，用 Instigator 取世界时间。
+	const UObject* WorldContext = Subject ? Subject : Instigator;
+	const UWorld* World = WorldContext ? WorldContext->GetWorld() : nullptr;
+	Record.WorldTime = World ? World->GetTimeSeconds() : 0.0f;
+	Record.SubjectId = Subject ? Subject->GetUniqueID() : 0;
+	Record.InstigatorId = Instigator ? Instigator->GetUniqueID() : 0;
+	Record.Value = Value;
+	Record.Delta = Delta;
+	Record.Location = Location;
+	Record.Type = Type;
+
+	++NumPushed;
+	if (!Ring.TryPush(Record))
+	{
+		++NumDropped;
+	}
+}
+
+void FGameplayEventChannel::AddSink(TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe> Sink)
+{
+	check(IsInGameThread());
+
+	{
+		FScopeLock Lock(&SinksCriticalSection);
+		Sinks.Add(Sink);
+	}
+	++NumExternalSinks;
+
+	if (!bRunning)
+	{
+		Start();
+	}
+}
+
+void FGameplayEventChannel::RemoveSink(TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe> Sink)
+{
+	check(IsInGameThread());
+
+	// 后台线程持有同一把锁消费事件，拿到锁即说明它已不在使用该消费者。
+	FScopeLock Lock(&SinksCriticalSection);
+	if (Sinks.Remove(Sink) > 0 && RetiringSinks.Remove(Sink) == 0)
+	{
+		--NumExternalSinks;
+	}
+}
+
+void FGameplayEventChannel::RetireSink(TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe> Sink)
+{
+	check(IsInGameThread());
+
+	FScopeLock Lock(&SinksCriticalSection);
+	if (Sinks.Contains(Sink) && !RetiringSinks.Contains(Sink))
+	{
+		RetiringSinks.Add(Sink);
+		--NumExternalSinks;
+	}
+}
+
+void FGameplayEventChannel::Start()
+{
+	check(IsInGameThread());
+
+	bRunning = true;
+	bStopping = false;
+
+	const int32 LogMode = CVarGameplayEventLog.GetValueOnGameThread();
+	if (LogMode != 0)
+	{
+		const bool bCsv = LogMode == 2;
+		const FString Filename = FPaths::ProjectLogDir() / FString::Printf(TEXT("GameplayEvents_%s.%s"), *FDateTime::Now().ToString(), bCsv ? TEXT("csv") : TEXT("mpev"));
+
+		FScopeLock Lock(&SinksCriticalSection);
+		Sinks.Add(MakeShared<FGameplayEventFileSink, ESPMode::ThreadSafe>(Filename, bCsv));
+		bHasFileSink = true;
+		UE_LOG(LogGameplayEvents, Log, TEXT("Gameplay event log: %s"), *Filename);
+	}
+
+	Thread = FRunnableThread::Create(this, TEXT("GameplayEventChannel"), 0, TPri_BelowNormal);
+}
+
+void FGameplayEventChannel::Shutdown()
+{
+	if (!bRunning)
+	{
+		return;
+	}
+
+	if (Thread)
+	{
+		// Kill 会调用 Stop 并等待 Run 返回。
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	FScopeLock Lock(&SinksCriticalSection);
+	for (const TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe>& Sink : Sinks)
+	{
+		Sink->Flush();
+	}
+	Sinks.Reset();
+	RetiringSinks.Reset();
+	NumExternalSinks = 0;
+	bHasFileSink = false;
+	bRunning = false;
+}
+
+uint32 FGameplayEventChannel::Run()
+{
+	while (!bStopping)
+	{
+		DrainAndRetireSinks();
+		FPlatformProcess::Sleep(0.05f);
+	}
+
+	// 写完停止前已经进入缓冲区的事件。
+	Drain();
+	return 0;
+}
+
+void FGameplayEventChannel::Stop()
+{
+	bStopping = true;
+}
+
+void FGameplayEventChannel::Drain()
+{
+	int32 NumRecords;
+	while ((NumRecords = Ring.PopBatch(DrainBuffer, DrainBatchSize)) > 0)
+	{
+		FScopeLock Lock(&SinksCriticalSection);
+		for (const TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe>& Sink : Sinks)
+		{
+			Sink->Consume(TArrayView<const FGameplayEventRecord>(DrainBuffer, NumRecords));
+		}
+		NumConsumed += NumRecords;
+	}
+}
+
+void FGameplayEventChannel::DrainAndRetireSinks()
+{
+	TArray<TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe>> SinksToRetire;
+	{
+		FScopeLock Lock(&SinksCriticalSection);
+		SinksToRetire = MoveTemp(RetiringSinks);
+	}
+
+	// RetireSink 之前推入的事件此时都已在缓冲区中，先交给这些消费者再停用它们。
+	Drain();
+
+	if (SinksToRetire.Num() > 0)
+	{
+		FScopeLock Lock(&SinksCriticalSection);
+		for (const TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe>& Sink : SinksToRetire)
+		{
+			Sink->Flush();
+			Sinks.Remove(Sink);
+		}
+	}
+}
+
+void FGameplayEventChannel::LogStats() const
+{
+	FScopeLock Lock(&SinksCriticalSection);
+	UE_LOG(LogGameplayEvents, Display, TEXT("Gameplay events: running %d, pushed %llu, dropped %llu, consumed %llu, sinks %d"),
+		bRunning ? 1 : 0, NumPushed, NumDropped, NumConsumed.load(), Sinks.Num());
+}
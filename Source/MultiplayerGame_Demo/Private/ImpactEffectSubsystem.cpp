@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ImpactEffectSubsystem.h"
+#include "MultiplayerGame_Demo.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Impact Effects"), STAT_ImpactEffects, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impacts Queued"), STAT_ImpactsQueued, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impacts Spawned"), STAT_ImpactsSpawned, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impacts Merged"), STAT_ImpactsMerged, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impacts Culled"), STAT_ImpactsCulled, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impacts Over Budget"), STAT_ImpactsOverBudget, STATGROUP_MultiplayerGame);
+
+static TAutoConsoleVariable<int32> CVarImpactMaxPerFrame(
+	TEXT("mp.Impact.MaxPerFrame"),
+	8,
+	TEXT("Maximum number of impact effects spawned per frame; the nearest impacts win."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarImpactCullDistance(
+	TEXT("mp.Impact.CullDistance"),
+	10000.0f,
+	TEXT("Impact effects farther than this from the local camera are not spawned."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarImpactLowDetailDistance(
+	TEXT("mp.Impact.LowDetailDistance"),
+	3000.0f,
+	TEXT("Impact effects farther than this from the local camera use the lowest particle LOD."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarImpactMergeDistance(
+	TEXT("mp.Impact.MergeDistance"),
+	150.0f,
+	TEXT("Impacts of the same effect within this distance in the same frame are merged into one spawn."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarImpactPoolSize(
+	TEXT("mp.Impact.PoolSize"),
+	32,
+	TEXT("Number of pooled particle components used for impact effects. Read when the pool is created."),
+	ECVF_Default);
+
+bool UImpactEffectSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// 专用服务器没有渲染，不需要任何特效。
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UImpactEffectSubsystem::Deinitialize()
+{
+	PendingImpacts.Reset();
+	ComponentPool.Reset();
+	PoolActor = nullptr;
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UImpactEffectSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UImpactEffectSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UImpactEffectSubsystem, STATGROUP_Tickables);
+}
+
+void UImpactEffectSubsystem::QueueImpact(UParticleSystem* Effect, const FVector& Location)
+{
+	if (Effect)
+	{
+		PendingImpacts.Add({ Effect, Location, 0.0f });
+		INC_DWORD_STAT(STAT_ImpactsQueued);
+	}
+}
+
+bool UImpactEffectSubsystem::GetViewLocation(FVector& OutViewLocation) const
+{
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (PlayerController && PlayerController->PlayerCameraManager)
+	{
+		OutViewLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+		return true;
+	}
+	return false;
+}
+
+void UImpactEffectSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ImpactEffects);
+
+	FVector ViewLocation = FVector::ZeroVector;
+	const bool bHasView = GetViewLocation(ViewLocation);
+	const float CullDistanceSquared = FMath::Square(CVarImpactCullDistance.GetValueOnGameThread());
+	const float LowDetailDistanceSquared = FMath::Square(CVarImpactLowDetailDistance.GetValueOnGameThread());
+	const float MergeDistance = FMath::Max(CVarImpactMergeDistance.GetValueOnGameThread(), 1.0f);
+
+	// 距离裁剪，同时按格子合并同一种特效。
+	MergeCells.Reset();
+	for (int32 Index = PendingImpacts.Num() - 1; Index >= 0; --Index)
+	{
+		FPendingImpact& Impact = PendingImpacts[Index];
+		Impact.DistanceSquared = bHasView ? FVector::DistSquared(Impact.Location, ViewLocation) : 0.0f;
+		if (Impact.DistanceSquared > CullDistanceSquared)
+		{
+			PendingImpacts.RemoveAtSwap(Index, 1, false);
+			INC_DWORD_STAT(STAT_ImpactsCulled);
+			continue;
+		}
+
+		const FIntVector Cell(FMath::FloorToInt(Impact.Location.X / MergeDistance), FMath::FloorToInt(Impact.Location.Y / MergeDistance), FMath::FloorToInt(Impact.Location.Z / MergeDistance));
+		bool bAlreadyInCell = false;
+		MergeCells.Add(MakeTuple(Cell, Impact.Effect), &bAlreadyInCell);
+		if (bAlreadyInCell)
+		{
+			PendingImpacts.RemoveAtSwap(Index, 1, false);
+			INC_DWORD_STAT(STAT_ImpactsMerged);
+		}
+	}
+
+	// 按预算生成，距离近的优先。
+	PendingImpacts.Sort([](const FPendingImpact& A, const FPendingImpact& B) { return A.DistanceSquared < B.DistanceSquared; });
+
+	const int32 NumToSpawn = FMath::Min(PendingImpacts.Num(), FMath::Max(CVarImpactMaxPerFrame.GetValueOnGameThread(), 0));
+	for (int32 Index = 0; Index < NumToSpawn; ++Index)
+	{
+		SpawnImpact(PendingImpacts[Index], PendingImpacts[Index].DistanceSquared > LowDetailDistanceSquared);
+	}
+	INC_DWORD_STAT_BY(STAT_ImpactsOverBudget, PendingImpacts.Num() - NumToSpawn);
+
+	PendingImpacts.Reset();
+}
+
+UParticleSystemComponent* UImpactEffectSubsystem::AcquireComponent()
+{
+	if (ComponentPool.Num() == 0)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		PoolActor = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+
+		const int32 PoolSize = FMath::Max(CVarImpactPoolSize.GetValueOnGameThread(), 1);
+		for (int32 Index = 0; Index < PoolSize; ++Index)
+		{
+			UParticleSystemComponent* Component = NewObject<UParticleSystemComponent>(PoolActor);
+			Component->bAutoActivate = false;
+			Component->bAutoDestroy = false;
+			Component->SetUsingAbsoluteLocation(true);
+			Component->SetUsingAbsoluteRotation(true);
+			Component->RegisterComponent();
+			ComponentPool.Add(Component);
+		}
+	}
+
+	// 从上次的位置开始找空闲组件；全部在播放时复用下一个（即最早开始播放的）组件。
+	for (int32 Attempt = 0; Attempt < ComponentPool.Num(); ++Attempt)
+	{
+		UParticleSystemComponent* Component = ComponentPool[NextPoolIndex];
+		NextPoolIndex = (NextPoolIndex + 1) % ComponentPool.Num();
+		if (!Component->IsActive())
+		{
+			return Component;
+		}
+	}
+
+	UParticleSystemComponent* Component = ComponentPool[NextPoolIndex];
+	NextPoolIndex = (NextPoolIndex + 1) % ComponentPool.Num();
+	return Component;
+}
+
+void UImpactEffectSubsystem::SpawnImpact(const FPendingImpact& Impact, bool bLowDetail)
+{
+	UParticleSystemComponent* Component = AcquireComponent();
+	if (Component->Template != Impact.Effect)
+	{
+		Component->SetTemplate(Impact.Effect);
+	}
+
+	Component->SetWorldLocationAndRotation(Impact.Location, FRotator::ZeroRotator);
+
+	// 远处使用最低的LOD（SetLODLevel 会限制在特效实际拥有的LOD范围内）。
+	Component->bOverrideLODMethod = true;
+	Component->LODMethod = PARTICLESYSTEMLODMETHOD_DirectSet;
+	Component->SetLODLevel(bLowDetail ? Impact.Effect->GetLODLevelCount() - 1 : 0);
+
+	Component->ActivateSystem(true);
+	INC_DWORD_STAT(STAT_ImpactsSpawned);
+}
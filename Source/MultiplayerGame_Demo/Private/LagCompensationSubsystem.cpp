@@ -0,0 +1,359 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationSubsystem.h"
+#include "MultiplayerGame_Demo.h"
+#include "MultiplayerGame_DemoCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLagCompensation, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_LagCompensationRecord, STATGROUP_MultiplayerGame);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Rewind Sweep"), STAT_LagCompensationRewindSweep, STATGROUP_MultiplayerGame);
+
+static TAutoConsoleVariable<int32> CVarLagCompensationEnabled(
+	TEXT("mp.LagComp.Enabled"),
+	1,
+	TEXT("1: rewind characters to the client's fire time for the hit test. 0: test against current positions only."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarLagCompensationMaxRewind(
+	TEXT("mp.LagComp.MaxRewind"),
+	0.25f,
+	TEXT("Maximum number of seconds the server will rewind characters for a hit test."),
+	ECVF_Default);
+
+//////////////////////////////////////////////////////////////////////////
+// FLagCompensationHistory
+
+FLagCompensationHistory::FLagCompensationHistory()
+	: NumFrames(0)
+	, SlotCapacity(0)
+	, NewestFrame(INDEX_NONE)
+	, NumRecorded(0)
+{
+}
+
+void FLagCompensationHistory::Init(int32 InNumFrames, int32 InSlotCapacity)
+{
+	NumFrames = FMath::Max(InNumFrames, 2);
+	SlotCapacity = FMath::Max(InSlotCapacity, 1);
+	NewestFrame = INDEX_NONE;
+	NumRecorded = 0;
+
+	FrameTimes.Init(0.0f, NumFrames);
+	Samples.SetNumZeroed(NumFrames * SlotCapacity);
+	SlotsInUse.Init(false, SlotCapacity);
+}
+
+int32 FLagCompensationHistory::AllocateSlot()
+{
+	int32 Slot = SlotsInUse.Find(false);
+	if (Slot == INDEX_NONE)
+	{
+		Slot = SlotCapacity;
+		GrowSlots(SlotCapacity * 2);
+	}
+
+	SlotsInUse[Slot] = true;
+	return Slot;
+}
+
+void FLagCompensationHistory::FreeSlot(int32 Slot)
+{
+	if (!SlotsInUse.IsValidIndex(Slot))
+	{
+		return;
+	}
+
+	SlotsInUse[Slot] = false;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		Samples[Frame * SlotCapacity + Slot] = FLagCompensationSample();
+	}
+}
+
+FLagCompensationSample* FLagCompensationHistory::BeginFrame(float Time)
+{
+	NewestFrame = (NewestFrame + 1) % NumFrames;
+	NumRecorded = FMath::Min(NumRecorded + 1, NumFrames);
+	FrameTimes[NewestFrame] = Time;
+
+	FLagCompensationSample* Row = &Samples[NewestFrame * SlotCapacity];
+	FMemory::Memzero(Row, sizeof(FLagCompensationSample) * SlotCapacity);
+	return Row;
+}
+
+float FLagCompensationHistory::GetNewestTime() const
+{
+	return NumRecorded > 0 ? FrameTimes[NewestFrame] : 0.0f;
+}
+
+float FLagCompensationHistory::GetOldestTime() const
+{
+	return NumRecorded > 0 ? FrameTimes[GetPhysicalFrame(0)] : 0.0f;
+}
+
+int32 FLagCompensationHistory::GetPhysicalFrame(int32 LogicalFrame) const
+{
+	return (NewestFrame - (NumRecorded - 1) + LogicalFrame + NumFrames) % NumFrames;
+}
+
+bool FLagCompensationHistory::FindFrames(float Time, int32& OutFrameA, int32& OutFrameB, float& OutAlpha) const
+{
+	if (NumRecorded == 0)
+	{
+		return false;
+	}
+
+	// 回溯时间通常只有几帧，从最新一帧往回找即可。
+	for (int32 Logical = NumRecorded - 1; Logical > 0; --Logical)
+	{
+		const int32 Older = GetPhysicalFrame(Logical - 1);
+		if (FrameTimes[Older] <= Time)
+		{
+			OutFrameA = Older;
+			OutFrameB = GetPhysicalFrame(Logical);
+			const float FrameDelta = FrameTimes[OutFrameB] - FrameTimes[OutFrameA];
+			OutAlpha = FrameDelta > KINDA_SMALL_NUMBER ? FMath::Clamp((Time - FrameTimes[OutFrameA]) / FrameDelta, 0.0f, 1.0f) : 1.0f;
+			return true;
+		}
+	}
+
+	// 比最旧的一帧还早，使用最旧的一帧。
+	OutFrameA = OutFrameB = GetPhysicalFrame(0);
+	OutAlpha = 0.0f;
+	return true;
+}
+
+bool FLagCompensationHistory::GetSampleAtTime(int32 Slot, float Time, FLagCompensationSample& OutSample) const
+{
+	int32 FrameA, FrameB;
+	float Alpha;
+	if (Slot < 0 || Slot >= SlotCapacity || !FindFrames(Time, FrameA, FrameB, Alpha))
+	{
+		return false;
+	}
+
+	const FLagCompensationSample& A = Samples[FrameA * SlotCapacity + Slot];
+	const FLagCompensationSample& B = Samples[FrameB * SlotCapacity + Slot];
+	if (!A.IsValid() || !B.IsValid())
+	{
+		// 角色在这两帧之间出现或消失，使用仍然有效的那一帧。
+		OutSample = A.IsValid() ? A : B;
+		return OutSample.IsValid();
+	}
+
+	OutSample.Location = FMath::Lerp(A.Location, B.Location, Alpha);
+	OutSample.Radius = FMath::Lerp(A.Radius, B.Radius, Alpha);
+	OutSample.HalfHeight = FMath::Lerp(A.HalfHeight, B.HalfHeight, Alpha);
+	return true;
+}
+
+int32 FLagCompensationHistory::SweepAtTime(float Time, const FVector& Start, const FVector& End, float SweepRadius, int32 IgnoredSlot, float& OutHitTime) const
+{
+	int32 FrameA, FrameB;
+	float Alpha;
+	if (!FindFrames(Time, FrameA, FrameB, Alpha))
+	{
+		return INDEX_NONE;
+	}
+
+	const FLagCompensationSample* RowA = &Samples[FrameA * SlotCapacity];
+	const FLagCompensationSample* RowB = &Samples[FrameB * SlotCapacity];
+
+	int32 HitSlot = INDEX_NONE;
+	OutHitTime = 1.0f;
+	for (int32 Slot = 0; Slot < SlotCapacity; ++Slot)
+	{
+		if (Slot == IgnoredSlot || !RowA[Slot].IsValid() || !RowB[Slot].IsValid())
+		{
+			continue;
+		}
+
+		FLagCompensationSample Capsule;
+		Capsule.Location = FMath::Lerp(RowA[Slot].Location, RowB[Slot].Location, Alpha);
+		Capsule.Radius = FMath::Lerp(RowA[Slot].Radius, RowB[Slot].Radius, Alpha);
+		Capsule.HalfHeight = FMath::Lerp(RowA[Slot].HalfHeight, RowB[Slot].HalfHeight, Alpha);
+
+		float HitTime;
+		if (SweepSphereCapsule(Start, End, SweepRadius, Capsule, HitTime) && HitTime < OutHitTime)
+		{
+			OutHitTime = HitTime;
+			HitSlot = Slot;
+		}
+	}
+
+	return HitSlot;
+}
+
+bool FLagCompensationHistory::SweepSphereCapsule(const FVector& Start, const FVector& End, float SweepRadius, const FLagCompensationSample& Capsule, float& OutHitTime)
+{
+	// 球体扫掠胶囊体 等价于 线段与半径为 (胶囊半径 + 球半径) 的胶囊体求交。
+	const float CombinedRadius = Capsule.Radius + SweepRadius;
+	const FVector AxisOffset(0.0f, 0.0f, FMath::Max(Capsule.HalfHeight - Capsule.Radius, 0.0f));
+	const FVector AxisA = Capsule.Location - AxisOffset;
+	const FVector AxisB = Capsule.Location + AxisOffset;
+
+	if (FMath::PointDistToSegment(Start, AxisA, AxisB) <= CombinedRadius)
+	{
+		OutHitTime = 0.0f;
+		return true;
+	}
+
+	FVector ClosestOnPath, ClosestOnAxis;
+	FMath::SegmentDistToSegmentSafe(Start, End, AxisA, AxisB, ClosestOnPath, ClosestOnAxis);
+	if (FVector::DistSquared(ClosestOnPath, ClosestOnAxis) > FMath::Square(CombinedRadius))
+	{
+		return false;
+	}
+
+	// 起点在外、最近点在内，二分查找首次接触的位置。
+	const FVector Path = End - Start;
+	const float PathLengthSquared = Path.SizeSquared();
+	float Outside = 0.0f;
+	float Inside = PathLengthSquared > KINDA_SMALL_NUMBER ? FVector::DotProduct(ClosestOnPath - Start, Path) / PathLengthSquared : 0.0f;
+	for (int32 Iteration = 0; Iteration < 12; ++Iteration)
+	{
+		const float Mid = 0.5f * (Outside + Inside);
+		if (FMath::PointDistToSegment(Start + Path * Mid, AxisA, AxisB) <= CombinedRadius)
+		{
+			Inside = Mid;
+		}
+		else
+		{
+			Outside = Mid;
+		}
+	}
+
+	OutHitTime = Inside;
+	return true;
+}
+
+void FLagCompensationHistory::GrowSlots(int32 NewSlotCapacity)
+{
+	TArray<FLagCompensationSample> NewSamples;
+	NewSamples.SetNumZeroed(NumFrames * NewSlotCapacity);
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		FMemory::Memcpy(&NewSamples[Frame * NewSlotCapacity], &Samples[Frame * SlotCapacity], sizeof(FLagCompensationSample) * SlotCapacity);
+	}
+
+	Samples = MoveTemp(NewSamples);
+	SlotsInUse.Add(false, NewSlotCapacity - SlotCapacity);
+	SlotCapacity = NewSlotCapacity;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ULagCompensationSubsystem
+
+ULagCompensationSubsystem::ULagCompensationSubsystem()
+{
+	History.Init(FLagCompensationHistory::DefaultNumFrames, 16);
+}
+
+bool ULagCompensationSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void ULagCompensationSubsystem::Deinitialize()
+{
+	SlotCharacters.Reset();
+	History.Init(FLagCompensationHistory::DefaultNumFrames, 16);
+
+	Super::Deinitialize();
+}
+
+ETickableTickType ULagCompensationSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool ULagCompensationSubsystem::IsTickable() const
+{
+	return SlotCharacters.Num() > 0;
+}
+
+TStatId ULagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+void ULagCompensationSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRecord);
+
+	// 可Tick对象在所有Actor移动完成之后更新，记录的是本帧最终的胶囊体位置。
+	FLagCompensationSample* Row = History.BeginFrame(GetWorld()->GetTimeSeconds());
+	for (int32 Slot = 0; Slot < SlotCharacters.Num(); ++Slot)
+	{
+		const AMultiplayerGame_DemoCharacter* Character = SlotCharacters[Slot].Get();
+		// 死亡等待重生的角色不写入，槽位保持为空，回溯检测不会命中。
+		if (Character && !Character->IsActorBeingDestroyed() && !Character->IsDead())
+		{
+			const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+			Row[Slot].Location = Capsule->GetComponentLocation();
+			Capsule->GetScaledCapsuleSize(Row[Slot].Radius, Row[Slot].HalfHeight);
+		}
+	}
+}
+
+void ULagCompensationSubsystem::RegisterCharacter(AMultiplayerGame_DemoCharacter* Character)
+{
+	if (!Character || SlotCharacters.Contains(Character))
+	{
+		return;
+	}
+
+	const int32 Slot = History.AllocateSlot();
+	if (SlotCharacters.Num() <= Slot)
+	{
+		SlotCharacters.SetNum(Slot + 1);
+	}
+	SlotCharacters[Slot] = Character;
+}
+
+void ULagCompensationSubsystem::UnregisterCharacter(AMultiplayerGame_DemoCharacter* Character)
+{
+	const int32 Slot = SlotCharacters.IndexOfByKey(Character);
+	if (Slot != INDEX_NONE)
+	{
+		SlotCharacters[Slot] = nullptr;
+		History.FreeSlot(Slot);
+	}
+}
+
+float ULagCompensationSubsystem::GetRewindSeconds(float ClientTimeStamp) const
+{
+	if (CVarLagCompensationEnabled.GetValueOnGameThread() == 0)
+	{
+		return 0.0f;
+	}
+
+	const float ServerTime = GetWorld()->GetTimeSeconds();
+	return FMath::Clamp(ServerTime - ClientTimeStamp, 0.0f, CVarLagCompensationMaxRewind.GetValueOnGameThread());
+}
+
+bool ULagCompensationSubsystem::RewindSweep(float RewindSeconds, const FVector& Start, const FVector& End, float SweepRadius, const AMultiplayerGame_DemoCharacter* Shooter, FLagCompensationHit& OutHit) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRewindSweep);
+
+	const int32 ShooterSlot = SlotCharacters.IndexOfByKey(Shooter);
+	float HitTime;
+	const int32 HitSlot = History.SweepAtTime(GetWorld()->GetTimeSeconds() - RewindSeconds, Start, End, SweepRadius, ShooterSlot, HitTime);
+
+	AMultiplayerGame_DemoCharacter* HitCharacter = SlotCharacters.IsValidIndex(HitSlot) ? SlotCharacters[HitSlot].Get() : nullptr;
+	if (!HitCharacter)
+	{
+		return false;
+	}
+
+	OutHit.Character = HitCharacter;
+	OutHit.Time = HitTime;
+	OutHit.Location = FMath::Lerp(Start, End, HitTime);
+	return true;
+}
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LoadTestBotController.h"
+#include "MultiplayerGame_DemoCharacter.h"
+
+//////////////////////////////////////////////////////////////////////////
+// FLoadTestBotBrain
+
+void FLoadTestBotBrain::Init(ELoadTestBotScript InScript, int32 Seed, float InFiresPerSecond)
+{
+	Script = InScript;
+	Random.Initialize(Seed);
+	FiresPerSecond = FMath::Max(InFiresPerSecond, 0.0f);
+	Time = 0.0f;
+	TimeUntilNextDecision = 0.0f;
+	Current = FLoadTestBotInput();
+}
+
+FLoadTestBotInput FLoadTestBotBrain::Update(float DeltaTime)
+{
+	Time += DeltaTime;
+
+	switch (Script)
+	{
+	case ELoadTestBotScript::Circle:
+		Current.Forward = 1.0f;
+		Current.Right = 0.0f;
+		Current.YawDelta = 45.0f * DeltaTime;
+		break;
+
+	case ELoadTestBotScript::Strafe:
+		Current.Forward = 1.0f;
+		Current.Right = FMath::Sin(Time * PI * 0.5f) >= 0.0f ? 1.0f : -1.0f;
+		Current.YawDelta = 0.0f;
+		break;
+
+	default:
+		// 每隔 0.5~3 秒重新选择方向、转向速度；约五分之一的时间原地停顿。
+		TimeUntilNextDecision -= DeltaTime;
+		if (TimeUntilNextDecision <= 0.0f)
+		{
+			TimeUntilNextDecision = Random.FRandRange(0.5f, 3.0f);
+			const bool bPause = Random.FRand() < 0.2f;
+			Current.Forward = bPause ? 0.0f : Random.FRandRange(-0.5f, 1.0f);
+			Current.Right = bPause ? 0.0f : Random.FRandRange(-1.0f, 1.0f);
+			Current.YawDelta = Random.FRandRange(-90.0f, 90.0f);
+		}
+		break;
+	}
+
+	FLoadTestBotInput Input = Current;
+	if (Script == ELoadTestBotScript::Random)
+	{
+		Input.YawDelta = Current.YawDelta * DeltaTime;
+	}
+	Input.bFire = Random.FRand() < FiresPerSecond * DeltaTime;
+	return Input;
+}
+
+ELoadTestBotScript FLoadTestBotBrain::ParseScript(const FString& ScriptName)
+{
+	if (ScriptName.Equals(TEXT("circle"), ESearchCase::IgnoreCase))
+	{
+		return ELoadTestBotScript::Circle;
+	}
+	if (ScriptName.Equals(TEXT("strafe"), ESearchCase::IgnoreCase))
+	{
+		return ELoadTestBotScript::Strafe;
+	}
+	return ELoadTestBotScript::Random;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ALoadTestBotController
+
+ALoadTestBotController::ALoadTestBotController()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	// 与真实玩家一样拥有 PlayerState，计入对局人数并参与复制。
+	bWantsPlayerState = true;
+}
+
+void ALoadTestBotController::InitBrain(ELoadTestBotScript Script, int32 Seed, float FiresPerSecond)
+{
+	Brain.Init(Script, Seed, FiresPerSecond);
+}
+
+void ALoadTestBotController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (AMultiplayerGame_DemoCharacter* BotCharacter = Cast<AMultiplayerGame_DemoCharacter>(GetPawn()))
+	{
+		BotCharacter->ApplyBotInput(Brain.Update(DeltaTime));
+	}
+}
@@ -0,0 +1,367 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LoadTestSubsystem.h"
+#include "LoadTestBotController.h"
+#include "MultiplayerGame_DemoCharacter.h"
+#include "ProjectileSimulationSubsystem.h"
+#include "ThirdPersonMPProjectile.h"
+#include "Algo/BinarySearch.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLoadTest, Log, All);
+
+bool ULoadTestSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld()
+		&& (FParse::Param(FCommandLine::Get(), TEXT("LoadTest")) || FParse::Param(FCommandLine::Get(), TEXT("LoadTestBot")))
+		&& Super::ShouldCreateSubsystem(Outer);
+}
+
+void ULoadTestSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	bServerLoadTest = FParse::Param(CommandLine, TEXT("LoadTest"));
+	bClientBot = FParse::Param(CommandLine, TEXT("LoadTestBot"));
+
+	FParse::Value(CommandLine, TEXT("LoadTestBots="), TotalBots);
+	BotStep = TotalBots;
+	FParse::Value(CommandLine, TEXT("LoadTestBotStep="), BotStep);
+	FParse::Value(CommandLine, TEXT("LoadTestStepSeconds="), StepSeconds);
+	FParse::Value(CommandLine, TEXT("LoadTestWarmupSeconds="), WarmupSeconds);
+	FParse::Value(CommandLine, TEXT("LoadTestSeed="), Seed);
+	FParse::Value(CommandLine, TEXT("LoadTestFiresPerSecond="), FiresPerSecond);
+
+	FString ScriptName;
+	FParse::Value(CommandLine, TEXT("LoadTestScript="), ScriptName);
+	Script = FLoadTestBotBrain::ParseScript(ScriptName);
+
+	ReportName = TEXT("LoadTest");
+	FParse::Value(CommandLine, TEXT("LoadTestReport="), ReportName);
+	bExitWhenDone = !FParse::Param(CommandLine, TEXT("LoadTestNoExit"));
+
+	TotalBots = FMath::Max(TotalBots, 0);
+	BotStep = FMath::Max(BotStep, 1);
+	StepSeconds = FMath::Max(StepSeconds, 1.0f);
+	WarmupSeconds = FMath::Clamp(WarmupSeconds, 0.0f, StepSeconds * 0.5f);
+
+	// 每个客户端进程的种子不同，否则所有机器人走同样的路线。
+	ClientBrain.Init(Script, Seed + FPlatformProcess::GetCurrentProcessId(), FiresPerSecond);
+}
+
+ETickableTickType ULoadTestSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool ULoadTestSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return World && World->HasBegunPlay() && !bFinished;
+}
+
+TStatId ULoadTestSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULoadTestSubsystem, STATGROUP_Tickables);
+}
+
+void ULoadTestSubsystem::Tick(float DeltaTime)
+{
+	if (GetWorld()->GetAuthGameMode())
+	{
+		if (bServerLoadTest)
+		{
+			TickServer(DeltaTime);
+		}
+	}
+	else if (bClientBot)
+	{
+		TickClientBot(DeltaTime);
+	}
+}
+
+void ULoadTestSubsystem::TickClientBot(float DeltaTime)
+{
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (AMultiplayerGame_DemoCharacter* BotCharacter = PlayerController ? Cast<AMultiplayerGame_DemoCharacter>(PlayerController->GetPawn()) : nullptr)
+	{
+		BotCharacter->ApplyBotInput(ClientBrain.Update(DeltaTime));
+	}
+}
+
+void ULoadTestSubsystem::TickServer(float DeltaTime)
+{
+	if (!bStarted)
+	{
+		bStarted = true;
+
+		// 专用服务器按 NetServerMaxTickRate 限帧，这是需要保持的Tick间隔。
+		const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+		const float TargetTickRate = NetDriver ? NetDriver->NetServerMaxTickRate : 30.0f;
+		TargetFrameMs = 1000.0f / FMath::Max(TargetTickRate, 1.0f);
+
+		UE_LOG(LogLoadTest, Display, TEXT("Load test: %d bots in steps of %d, %.0fs per step, target frame %.2f ms"), TotalBots, BotStep, StepSeconds, TargetFrameMs);
+		BeginStep(FMath::Min(BotStep, TotalBots));
+		return;
+	}
+
+	StepTime += DeltaTime;
+	if (StepTime >= WarmupSeconds)
+	{
+		// 使用真实时间而不是经过时间膨胀的 DeltaTime。
+		FrameMsSamples.Add(FApp::GetDeltaTime() * 1000.0f);
+
+		TimeUntilSlowSample -= DeltaTime;
+		if (TimeUntilSlowSample <= 0.0f)
+		{
+			TimeUntilSlowSample = 1.0f;
+			SampleSlowCounters();
+		}
+	}
+
+	if (StepTime < StepSeconds)
+	{
+		return;
+	}
+
+	FinishStep();
+	if (Bots.Num() < TotalBots)
+	{
+		BeginStep(FMath::Min(Bots.Num() + BotStep, TotalBots));
+		return;
+	}
+
+	bFinished = true;
+	WriteReport();
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void ULoadTestSubsystem::BeginStep(int32 NumBots)
+{
+	UWorld* World = GetWorld();
+	while (Bots.Num() < NumBots)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		ALoadTestBotController* Bot = World->SpawnActor<ALoadTestBotController>(SpawnParams);
+		Bot->InitBrain(Script, Seed + Bots.Num(), FiresPerSecond);
+		Bots.Add(Bot);
+		SpawnBotPawn(Bot);
+	}
+
+	StepTime = 0.0f;
+	TimeUntilSlowSample = 0.0f;
+	FrameMsSamples.Reset();
+	ConnectionSums.Reset();
+	NumSlowSamples = 0;
+	CurrentStep = FLoadTestStepResult();
+	CurrentStep.NumBots = Bots.Num();
+
+	UE_LOG(LogLoadTest, Display, TEXT("Load test step %d: %d bots, %d connections"), Steps.Num() + 1, Bots.Num(), World->GetNetDriver() ? World->GetNetDriver()->ClientConnections.Num() : 0);
+}
+
+void ULoadTestSubsystem::SpawnBotPawn(ALoadTestBotController* Bot)
+{
+	UWorld* World = GetWorld();
+	AGameModeBase* GameMode = World->GetAuthGameMode();
+	const AActor* PlayerStart = GameMode->FindPlayerStart(Bot);
+	UClass* PawnClass = GameMode->GetDefaultPawnClassForController(Bot);
+	if (!PlayerStart || !PawnClass)
+	{
+		return;
+	}
+
+	// 所有机器人共用少量出生点，在出生点周围随机散开，避免生成时互相挤开。
+	FRandomStream SpawnRandom(Seed + Bots.Find(Bot) * 7919);
+	const FVector2D Offset = FVector2D(SpawnRandom.FRandRange(-1.0f, 1.0f), SpawnRandom.FRandRange(-1.0f, 1.0f)) * 1500.0f;
+	const FVector Location = PlayerStart->GetActorLocation() + FVector(Offset, 0.0f);
+	const FRotator Rotation(0.0f, SpawnRandom.FRandRange(-180.0f, 180.0f), 0.0f);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	if (APawn* Pawn = World->SpawnActor<APawn>(PawnClass, Location, Rotation, SpawnParams))
+	{
+		Bot->Possess(Pawn);
+		Bot->SetControlRotation(Rotation);
+	}
+}
+
+void ULoadTestSubsystem::SampleSlowCounters()
+{
+	UWorld* World = GetWorld();
+
+	if (const UNetDriver* NetDriver = World->GetNetDriver())
+	{
+		for (const UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			FLoadTestConnectionResult& Sum = ConnectionSums.FindOrAdd(Connection->LowLevelGetRemoteAddress(true));
+			Sum.OutBytesPerSecond += Connection->OutBytesPerSecond;
+			Sum.InBytesPerSecond += Connection->InBytesPerSecond;
+			Sum.NumSamples++;
+		}
+	}
+
+	int32 NumProjectiles = 0;
+	for (TActorIterator<AThirdPersonMPProjectile> It(World); It; ++It)
+	{
+		NumProjectiles += It->IsHidden() ? 0 : 1;
+	}
+	if (const UProjectileSimulationSubsystem* ProjectileSimulation = World->GetSubsystem<UProjectileSimulationSubsystem>())
+	{
+		NumProjectiles += ProjectileSimulation->GetNumProjectiles();
+	}
+	CurrentStep.PeakProjectiles = FMath::Max(CurrentStep.PeakProjectiles, NumProjectiles);
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	CurrentStep.PeakUsedPhysicalMB = FMath::Max(CurrentStep.PeakUsedPhysicalMB, MemoryStats.UsedPhysical / (1024.0 * 1024.0));
+
+	// 死亡的机器人重新生成，保持负载不变。
+	for (ALoadTestBotController* Bot : Bots)
+	{
+		if (Bot && !Bot->GetPawn())
+		{
+			SpawnBotPawn(Bot);
+		}
+	}
+
+	NumSlowSamples++;
+}
+
+void ULoadTestSubsystem::FinishStep()
+{
+	CurrentStep.Seconds = StepSeconds - WarmupSeconds;
+	CurrentStep.NumConnections = ConnectionSums.Num();
+
+	if (FrameMsSamples.Num() > 0)
+	{
+		FrameMsSamples.Sort();
+		const auto Percentile = [this](float Fraction)
+		{
+			const int32 Index = FMath::Clamp(FMath::CeilToInt(Fraction * FrameMsSamples.Num()) - 1, 0, FrameMsSamples.Num() - 1);
+			return FrameMsSamples[Index];
+		};
+		CurrentStep.FrameMsP50 = Percentile(0.5f);
+		CurrentStep.FrameMsP90 = Percentile(0.9f);
+		CurrentStep.FrameMsP99 = Percentile(0.99f);
+		CurrentStep.FrameMsMax = FrameMsSamples.Last();
+
+		const float BudgetMs = TargetFrameMs * 1.1f;
+		const int32 FirstOverBudget = Algo::UpperBound(FrameMsSamples, BudgetMs);
+		CurrentStep.OverBudgetFraction = float(FrameMsSamples.Num() - FirstOverBudget) / FrameMsSamples.Num();
+	}
+
+	for (const TPair<FString, FLoadTestConnectionResult>& Pair : ConnectionSums)
+	{
+		FLoadTestConnectionResult& Connection = CurrentStep.Connections.Add_GetRef(Pair.Value);
+		Connection.Name = Pair.Key;
+		Connection.OutBytesPerSecond /= FMath::Max(Pair.Value.NumSamples, 1);
+		Connection.InBytesPerSecond /= FMath::Max(Pair.Value.NumSamples, 1);
+	}
+
+	UE_LOG(LogLoadTest, Display, TEXT("Load test step %d: bots %d, connections %d, frame ms p50 %.2f p90 %.2f p99 %.2f max %.2f, over budget %.1f%%, peak projectiles %d, memory %.0f MB"),
+		Steps.Num() + 1, CurrentStep.NumBots, CurrentStep.NumConnections, CurrentStep.FrameMsP50, CurrentStep.FrameMsP90, CurrentStep.FrameMsP99, CurrentStep.FrameMsMax,
+		CurrentStep.OverBudgetFraction * 100.0f, CurrentStep.PeakProjectiles, CurrentStep.PeakUsedPhysicalMB);
+
+	Steps.Add(MoveTemp(CurrentStep));
+	CurrentStep = FLoadTestStepResult();
+}
+
+void ULoadTestSubsystem::WriteReport() const
+{
+	// 第一个 p90 帧时间超出目标Tick间隔的阶段：服务器从这里开始无法保持Tick频率。
+	int32 FirstStepOverBudget = INDEX_NONE;
+	for (int32 Index = 0; Index < Steps.Num(); ++Index)
+	{
+		if (Steps[Index].FrameMsP90 > TargetFrameMs * 1.1f)
+		{
+			FirstStepOverBudget = Index;
+			break;
+		}
+	}
+
+	const FString BasePath = FPaths::ProjectSavedDir() / TEXT("LoadTest") / FString::Printf(TEXT("%s_%s"), *ReportName, *FDateTime::Now().ToString());
+
+	FString Csv = TEXT("Step,Bots,Connections,Players,FrameMsP50,FrameMsP90,FrameMsP99,FrameMsMax,OverBudgetFraction,AvgOutBytesPerConnection,MaxOutBytesPerConnection,AvgInBytesPerConnection,PeakProjectiles,PeakUsedPhysicalMB\n");
+	FString Json;
+	TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&Json);
+	JsonWriter->WriteObjectStart();
+	JsonWriter->WriteValue(TEXT("map"), GetWorld()->GetMapName());
+	JsonWriter->WriteValue(TEXT("targetFrameMs"), TargetFrameMs);
+	JsonWriter->WriteValue(TEXT("script"), StaticEnum<ELoadTestBotScript>()->GetNameStringByValue((int64)Script));
+	JsonWriter->WriteValue(TEXT("firesPerSecond"), FiresPerSecond);
+	JsonWriter->WriteValue(TEXT("firstStepOverBudget"), FirstStepOverBudget);
+	JsonWriter->WriteValue(TEXT("maxPlayersHoldingTickRate"), FirstStepOverBudget == INDEX_NONE
+		? (Steps.Num() > 0 ? Steps.Last().NumBots + Steps.Last().NumConnections : 0)
+		: (FirstStepOverBudget > 0 ? Steps[FirstStepOverBudget - 1].NumBots + Steps[FirstStepOverBudget - 1].NumConnections : 0));
+	JsonWriter->WriteArrayStart(TEXT("steps"));
+
+	for (int32 Index = 0; Index < Steps.Num(); ++Index)
+	{
+		const FLoadTestStepResult& Step = Steps[Index];
+
+		double TotalOut = 0.0;
+		double MaxOut = 0.0;
+		double TotalIn = 0.0;
+		for (const FLoadTestConnectionResult& Connection : Step.Connections)
+		{
+			TotalOut += Connection.OutBytesPerSecond;
+			MaxOut = FMath::Max(MaxOut, Connection.OutBytesPerSecond);
+			TotalIn += Connection.InBytesPerSecond;
+		}
+		const int32 NumConnections = FMath::Max(Step.Connections.Num(), 1);
+
+		Csv += FString::Printf(TEXT("%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.4f,%.1f,%.1f,%.1f,%d,%.1f\n"),
+			Index + 1, Step.NumBots, Step.NumConnections, Step.NumBots + Step.NumConnections,
+			Step.FrameMsP50, Step.FrameMsP90, Step.FrameMsP99, Step.FrameMsMax, Step.OverBudgetFraction,
+			TotalOut / NumConnections, MaxOut, TotalIn / NumConnections, Step.PeakProjectiles, Step.PeakUsedPhysicalMB);
+
+		JsonWriter->WriteObjectStart();
+		JsonWriter->WriteValue(TEXT("bots"), Step.NumBots);
+		JsonWriter->WriteValue(TEXT("connections"), Step.NumConnections);
+		JsonWriter->WriteValue(TEXT("seconds"), Step.Seconds);
+		JsonWriter->WriteValue(TEXT("frameMsP50"), Step.FrameMsP50);
+		JsonWriter->WriteValue(TEXT("frameMsP90"), Step.FrameMsP90);
+		JsonWriter->WriteValue(TEXT("frameMsP99"), Step.FrameMsP99);
+		JsonWriter->WriteValue(TEXT("frameMsMax"), Step.FrameMsMax);
+		JsonWriter->WriteValue(TEXT("overBudgetFraction"), Step.OverBudgetFraction);
+		JsonWriter->WriteValue(TEXT("peakProjectiles"), Step.PeakProjectiles);
+		JsonWriter->WriteValue(TEXT("peakUsedPhysicalMB"), Step.PeakUsedPhysicalMB);
+		JsonWriter->WriteArrayStart(TEXT("connectionBytes"));
+		for (const FLoadTestConnectionResult& Connection : Step.Connections)
+		{
+			JsonWriter->WriteObjectStart();
+			JsonWriter->WriteValue(TEXT("address"), Connection.Name);
+			JsonWriter->WriteValue(TEXT("outBytesPerSecond"), Connection.OutBytesPerSecond);
+			JsonWriter->WriteValue(TEXT("inBytesPerSecond"), Connection.InBytesPerSecond);
+			JsonWriter->WriteObjectEnd();
+		}
+		JsonWriter->WriteArrayEnd();
+		JsonWriter->WriteObjectEnd();
+	}
+
+	JsonWriter->WriteArrayEnd();
+	JsonWriter->WriteObjectEnd();
+	JsonWriter->Close();
+
+	FFileHelper::SaveStringToFile(Csv, *(BasePath + TEXT(".csv")));
+	FFileHelper::SaveStringToFile(Json, *(BasePath + TEXT(".json")));
+	UE_LOG(LogLoadTest, Display, TEXT("Load test report written to %s.csv/.json"), *BasePath);
+}
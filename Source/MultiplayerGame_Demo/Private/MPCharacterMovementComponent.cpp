@@ -0,0 +1,758 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MPCharacterMovementComponent.h"
+#include "MultiplayerGame_Demo.h"
+#include "MultiplayerGame_DemoCharacter.h"
+#include "TickAggregationSubsystem.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMPMovement, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Server Move Packet"), STAT_ServerMovePacket, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Move Packets Received"), STAT_MovePacketsReceived, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Move Bits Received"), STAT_MoveBitsReceived, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Move Corrections"), STAT_MoveCorrections, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Move Packets Dropped"), STAT_MovePacketsDropped, STATGROUP_MultiplayerGame);
+
+static TAutoConsoleVariable<int32> CVarFireInputRedundancy(
+	TEXT("mp.Fire.InputRedundancy"),
+	3,
+	TEXT("Number of consecutive movement packets that repeat each fire input, so it survives packet loss without reliable resends."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarMoveCompact(
+	TEXT("mp.Move.Compact"),
+	1,
+	TEXT("Client: 1 sends moves in the compact quantized format, 0 uses the engine's default move serialization. The server decodes either."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarMoveMaxSendRate(
+	TEXT("mp.Move.MaxSendRate"),
+	30.0f,
+	TEXT("Maximum movement packets per second on a connection, enforced with a token bucket. Client: while the budget is spent, new moves are held ")
+	TEXT("and combined into the held move even if their acceleration differs. Fire input, jumps and movement mode changes are still sent at once and borrow ")
+	TEXT("from later budget. Server: packets beyond mp.Move.ReceiveBurst above this rate are dropped. ")
+	TEXT("Values below 10 are raised to 10, because the engine sends a held move after 0.2 s or once it covers MaxMoveDeltaTime. 0 disables the cap."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarMoveSendBurst(
+	TEXT("mp.Move.SendBurst"),
+	2.0f,
+	TEXT("Client: movement packets that may be sent back to back above mp.Move.MaxSendRate, and the most later budget an immediate send may borrow."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarMoveReceiveBurst(
+	TEXT("mp.Move.ReceiveBurst"),
+	10.0f,
+	TEXT("Server: movement packets a connection may deliver back to back above mp.Move.MaxSendRate before further packets are dropped. ")
+	TEXT("Covers the client's send burst, its borrowed budget and packets bunched by network jitter."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarMoveBatchServerMoves(
+	TEXT("mp.Move.BatchServerMoves"),
+	1,
+	TEXT("Server: 1 queues received movement packets and processes them for all characters in one batch later in the same frame, before client adjustments are sent. ")
+	TEXT("0 processes each packet as it arrives."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld GMoveStatsCommand(
+	TEXT("mp.Move.Stats"),
+	TEXT("Server: prints movement packet rate, dropped packets, bits per packet, bandwidth and correction rate per connection, split by move format (default / compact)."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UMPCharacterMovementComponent::LogMoveNetStats(World);
+	}));
+
+static FAutoConsoleCommandWithWorld GMoveResetStatsCommand(
+	TEXT("mp.Move.ResetStats"),
+	TEXT("Server: clears the movement packet statistics of every character."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UMPCharacterMovementComponent::ResetMoveNetStats(World);
+	}));
+
+namespace CompactMove
+{
+	// 加速度每轴的量化级数（有符号 8 位）
+	static const float AccelerationSteps = 127.0f;
+
+	static bool IsEnabled()
+	{
+		return CVarMoveCompact.GetValueOnGameThread() != 0;
+	}
+
+	static int8 QuantizeAxis(float Value, float MaxAcceleration)
+	{
+		if (MaxAcceleration <= 0.0f)
+		{
+			return 0;
+		}
+		return (int8)FMath::Clamp(FMath::RoundToInt(Value / MaxAcceleration * AccelerationSteps), -127, 127);
+	}
+
+	static float DequantizeAxis(int8 Value, float MaxAcceleration)
+	{
+		return Value * MaxAcceleration / AccelerationSteps;
+	}
+
+	static FVector RoundAcceleration(const FVector& Acceleration, float MaxAcceleration)
+	{
+		return FVector(
+			DequantizeAxis(QuantizeAxis(Acceleration.X, MaxAcceleration), MaxAcceleration),
+			DequantizeAxis(QuantizeAxis(Acceleration.Y, MaxAcceleration), MaxAcceleration),
+			DequantizeAxis(QuantizeAxis(Acceleration.Z, MaxAcceleration), MaxAcceleration));
+	}
+
+	static const TCHAR* GetFormatName(bool bCompact)
+	{
+		return bCompact ? TEXT("Compact") : TEXT("Default");
+	}
+}
+
+namespace MoveSendRate
+{
+	// 最低的发送频率上限：引擎在暂存 1/5 秒或合并的移动达到 MaxMoveDeltaTime 后总会发送，更低的上限无法保证。
+	static const float MinRate = 10.0f;
+
+	/** 每秒的移动包上限，0 表示不限制。*/
+	static float GetRate()
+	{
+		const float Rate = CVarMoveMaxSendRate.GetValueOnGameThread();
+		return Rate > 0.0f ? FMath::Max(Rate, MinRate) : 0.0f;
+	}
+
+	static float GetBurst()
+	{
+		return FMath::Max(1.0f, CVarMoveSendBurst.GetValueOnGameThread());
+	}
+
+	static float GetReceiveBurst()
+	{
+		return FMath::Max(1.0f, CVarMoveReceiveBurst.GetValueOnGameThread());
+	}
+}
+
+// 移动包批量处理在 UTickAggregationSubsystem 中的分组名。
+static const FName ServerMovesGroupName(TEXT("Movement.ServerMoves"));
+
+// 服务器：每个角色最多排队的移动包数。客户端卡顿后集中到达的包超过这个数时先处理已排队的，队列不再增长。
+static const int32 MaxQueuedServerMoves = 8;
+
+//////////////////////////////////////////////////////////////////////////
+// FSavedMove_MPCharacter
+
+/** 发送预算用完时放宽合并条件的保存移动。*/
+class FSavedMove_MPCharacter : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMovePtr, ACharacter* InCharacter, float MaxDelta) const override
+	{
+		if (Super::CanCombineWith(NewMovePtr, InCharacter, MaxDelta))
+		{
+			return true;
+		}
+
+		const UMPCharacterMovementComponent* Movement = InCharacter ? Cast<UMPCharacterMovementComponent>(InCharacter->GetCharacterMovement()) : nullptr;
+		if (!Movement || !Movement->IsMoveSendBudgetExhausted())
+		{
+			return false;
+		}
+
+		// 预算用完时，只因加速度或起始速度不同而无法合并的移动也合并：合并后的移动从暂存移动的起点按新的加速度重新模拟，
+		// 客户端与服务器执行的仍是同一个输入。标志、移动模式与移动基础不同的移动照常立即发送。
+		FSavedMove_MPCharacter Relaxed(*this);
+		Relaxed.Acceleration = NewMovePtr->Acceleration;
+		Relaxed.StartVelocity = NewMovePtr->StartVelocity;
+		return Relaxed.Super::CanCombineWith(NewMovePtr, InCharacter, MaxDelta);
+	}
+};
+
+class FNetworkPredictionData_Client_MPCharacter : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_MPCharacter(const UCharacterMovementComponent& ClientMovement)
+		: Super(ClientMovement)
+	{
+	}
+
+	virtual FSavedMovePtr AllocateNewMove() override
+	{
+		return FSavedMovePtr(new FSavedMove_MPCharacter());
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////
+// FFireInputPacket
+
+void FFireInputPacket::Serialize(FArchive& Ar)
+{
+	uint32 Count = Entries.Num();
+	Ar.SerializeInt(Count, MaxEntries + 1);
+
+	if (Ar.IsLoading())
+	{
+		Entries.SetNum(FMath::Min<int32>(Count, MaxEntries));
+	}
+
+	if (Entries.Num() == 0)
+	{
+		return;
+	}
+
+	FFireInputEntry& Newest = Entries.Last();
+	Ar << Newest.Sequence;
+	Ar << Newest.TimeStamp;
+
+	// 每次开火一位预测标志。
+	for (FFireInputEntry& Entry : Entries)
+	{
+		uint8 bPredicted = Entry.bPredicted ? 1 : 0;
+		Ar.SerializeBits(&bPredicted, 1);
+		Entry.bPredicted = bPredicted != 0;
+	}
+
+	// 从新到旧推出每次开火的序号：与后一次相差 1 时只占 1 位，否则附带间隔。
+	// 窗口中的序号不一定连续（较新的一次可能先发送够次数，HandleFire 也会占用序号），不能只按位置推算。
+	for (int32 Index = Entries.Num() - 2; Index >= 0; --Index)
+	{
+		FFireInputEntry& Entry = Entries[Index];
+		const FFireInputEntry& Next = Entries[Index + 1];
+		uint16 AgeMilliseconds = 0;
+		uint32 SequenceGap = 0;
+		if (Ar.IsSaving())
+		{
+			AgeMilliseconds = (uint16)FMath::Clamp(FMath::RoundToInt((Newest.TimeStamp - Entry.TimeStamp) * 1000.0f), 0, MAX_uint16);
+			SequenceGap = (uint16)(Next.Sequence - Entry.Sequence - 1);
+		}
+
+		Ar << AgeMilliseconds;
+
+		uint8 bHasSequenceGap = SequenceGap != 0 ? 1 : 0;
+		Ar.SerializeBits(&bHasSequenceGap, 1);
+		if (bHasSequenceGap)
+		{
+			Ar.SerializeIntPacked(SequenceGap);
+		}
+
+		if (Ar.IsLoading())
+		{
+			Entry.Sequence = Next.Sequence - 1 - (uint16)SequenceGap;
+			Entry.TimeStamp = Newest.TimeStamp - AgeMilliseconds * 0.001f;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FMPCharacterNetworkMoveData
+
+void FMPCharacterNetworkMoveData::ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType)
+{
+	Super::ClientFillNetworkMoveData(ClientMove, MoveType);
+
+	// 开火输入不属于某一个保存的移动，由容器在填充 NewMove 时写入。
+	FireInput.Entries.Reset();
+}
+
+bool FMPCharacterNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType)
+{
+	if (Ar.IsSaving())
+	{
+		bCompact = CompactMove::IsEnabled();
+	}
+
+	uint8 bCompactBit = bCompact ? 1 : 0;
+	Ar.SerializeBits(&bCompactBit, 1);
+	bCompact = bCompactBit != 0;
+
+	if (bCompact)
+	{
+		SerializeCompact(CharacterMovement, Ar, MoveType);
+	}
+	else
+	{
+		Super::Serialize(CharacterMovement, Ar, PackageMap, MoveType);
+	}
+
+	if (MoveType == ENetworkMoveType::NewMove)
+	{
+		FireInput.Serialize(Ar);
+	}
+	else if (Ar.IsLoading())
+	{
+		FireInput.Entries.Reset();
+	}
+
+	return !Ar.IsError();
+}
+
+void FMPCharacterNetworkMoveData::SerializeCompact(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, ENetworkMoveType MoveType)
+{
+	NetworkMoveType = MoveType;
+	const bool bIsSaving = Ar.IsSaving();
+
+	Ar << TimeStamp;
+
+	// 加速度：客户端已在 RoundAcceleration 中按同样的精度量化，这里的量化是无损的。
+	// 两端的最大加速度相同（都取自角色的移动设置）。
+	const float MaxAcceleration = CharacterMovement.GetMaxAcceleration();
+	int8 AccelX = 0;
+	int8 AccelY = 0;
+	int8 AccelZ = 0;
+	if (bIsSaving)
+	{
+		AccelX = CompactMove::QuantizeAxis(Acceleration.X, MaxAcceleration);
+		AccelY = CompactMove::QuantizeAxis(Acceleration.Y, MaxAcceleration);
+		AccelZ = CompactMove::QuantizeAxis(Acceleration.Z, MaxAcceleration);
+	}
+
+	// 没有输入时只占 1 位；行走时 Z 轴恒为零，也只占 1 位。
+	uint8 bHasAcceleration = (AccelX | AccelY | AccelZ) != 0 ? 1 : 0;
+	Ar.SerializeBits(&bHasAcceleration, 1);
+	if (bHasAcceleration)
+	{
+		Ar << AccelX;
+		Ar << AccelY;
+
+		uint8 bHasAccelZ = AccelZ != 0 ? 1 : 0;
+		Ar.SerializeBits(&bHasAccelZ, 1);
+		if (bHasAccelZ)
+		{
+			Ar << AccelZ;
+		}
+	}
+
+	if (!bIsSaving)
+	{
+		Acceleration = FVector(
+			CompactMove::DequantizeAxis(AccelX, MaxAcceleration),
+			CompactMove::DequantizeAxis(AccelY, MaxAcceleration),
+			CompactMove::DequantizeAxis(AccelZ, MaxAcceleration));
+	}
+
+	// 控制器朝向：偏航与俯仰的精度与默认格式相同（开火方向取自这里），角色不使用翻滚，为零时只占 1 位。
+	uint16 Yaw = FRotator::CompressAxisToShort(ControlRotation.Yaw);
+	uint16 Pitch = FRotator::CompressAxisToShort(ControlRotation.Pitch);
+	uint16 Roll = FRotator::CompressAxisToShort(ControlRotation.Roll);
+	Ar << Yaw;
+	Ar << Pitch;
+
+	uint8 bHasRoll = Roll != 0 ? 1 : 0;
+	Ar.SerializeBits(&bHasRoll, 1);
+	if (bHasRoll)
+	{
+		Ar << Roll;
+	}
+
+	if (!bIsSaving)
+	{
+		ControlRotation = FRotator(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), bHasRoll ? FRotator::DecompressAxisFromShort(Roll) : 0.0f);
+	}
+
+	// 移动标志：没有按键时 1 位；只有跳跃与下蹲时 3 位；带有自定义标志时发送完整的 8 位。
+	uint8 bHasFlags = CompressedMoveFlags != 0 ? 1 : 0;
+	Ar.SerializeBits(&bHasFlags, 1);
+	if (bHasFlags)
+	{
+		const uint8 BasicFlags = FSavedMove_Character::FLAG_JumpPressed | FSavedMove_Character::FLAG_WantsToCrouch;
+		uint8 bBasicFlagsOnly = (CompressedMoveFlags & ~BasicFlags) == 0 ? 1 : 0;
+		Ar.SerializeBits(&bBasicFlagsOnly, 1);
+		if (bBasicFlagsOnly)
+		{
+			Ar.SerializeBits(&CompressedMoveFlags, 2);
+		}
+		else
+		{
+			Ar << CompressedMoveFlags;
+		}
+	}
+	else if (!bIsSaving)
+	{
+		CompressedMoveFlags = 0;
+	}
+
+	// 位置、移动基础与结束时的移动模式只在服务器检查误差时使用，只随 NewMove 发送。
+	// 1 毫米的精度远小于纠正阈值（p.MaxPositionErrorSquared）。
+	if (MoveType == ENetworkMoveType::NewMove)
+	{
+		FVector_NetQuantize10 ClientLocation = Location;
+		bool bLocationSuccess = true;
+		ClientLocation.NetSerialize(Ar, nullptr, bLocationSuccess);
+		Location = ClientLocation;
+
+		SerializeOptionalValue<UPrimitiveComponent*>(bIsSaving, Ar, MovementBase, nullptr);
+		SerializeOptionalValue<FName>(bIsSaving, Ar, MovementBaseBoneName, NAME_None);
+		SerializeOptionalValue<uint8>(bIsSaving, Ar, MovementMode, MOVE_Walking);
+	}
+	else if (!bIsSaving)
+	{
+		Location = FVector::ZeroVector;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FMPMoveNetStats
+
+void FMPMoveNetStats::Accumulate(const FMPMoveNetStats& Other)
+{
+	Packets += Other.Packets;
+	Bits += Other.Bits;
+	Checks += Other.Checks;
+	Corrections += Other.Corrections;
+	Dropped += Other.Dropped;
+	Seconds += Other.Seconds;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FMPCharacterNetworkMoveDataContainer
+
+FMPCharacterNetworkMoveDataContainer::FMPCharacterNetworkMoveDataContainer()
+{
+	SetNetworkMoveDataReferences(MoveData[0], MoveData[1], MoveData[2]);
+}
+
+void FMPCharacterNetworkMoveDataContainer::ClientFillNetworkMoveData(const FSavedMove_Character* ClientNewMove, const FSavedMove_Character* ClientPendingMove, const FSavedMove_Character* ClientOldMove)
+{
+	Super::ClientFillNetworkMoveData(ClientNewMove, ClientPendingMove, ClientOldMove);
+
+	if (OwnerMovement)
+	{
+		OwnerMovement->BuildFireInputPacket(static_cast<FMPCharacterNetworkMoveData*>(GetNewMoveData())->FireInput);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UMPCharacterMovementComponent
+
+UMPCharacterMovementComponent::UMPCharacterMovementComponent()
+{
+	MoveDataContainer.OwnerMovement = this;
+	SetNetworkMoveDataContainer(MoveDataContainer);
+
+	NextFireSequence = 0;
+	MoveSendConnection = nullptr;
+	MoveReceiveConnection = nullptr;
+	LastMovePacketTime = -1.0f;
+	bLastMoveCompact = false;
+}
+
+FNetworkPredictionData_Client* UMPCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		UMPCharacterMovementComponent* MutableThis = const_cast<UMPCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_MPCharacter(*this);
+	}
+	return ClientPredictionData;
+}
+
+bool UMPCharacterMovementComponent::CanSendFireInputWithMoves()
+{
+	static const IConsoleVariable* CVarUsePackedMovementRPCs = IConsoleManager::Get().FindConsoleVariable(TEXT("p.NetUsePackedMovementRPCs"));
+	return CVarUsePackedMovementRPCs && CVarUsePackedMovementRPCs->GetInt() != 0;
+}
+
+uint16 UMPCharacterMovementComponent::QueueFireInput(float TimeStamp, bool bPredicted)
+{
+	// 窗口已满时丢弃最旧的一次；在射速限制下正常情况不会发生。
+	if (PendingFireInput.Num() >= FFireInputPacket::MaxEntries)
+	{
+		PendingFireInput.RemoveAt(0, 1, false);
+	}
+
+	FFireInputEntry& Entry = PendingFireInput.AddDefaulted_GetRef();
+	Entry.Sequence = AllocateFireSequence();
+	Entry.TimeStamp = TimeStamp;
+	Entry.bPredicted = bPredicted;
+	Entry.SendsRemaining = (uint8)FMath::Clamp(CVarFireInputRedundancy.GetValueOnGameThread(), 1, 255);
+	return Entry.Sequence;
+}
+
+void UMPCharacterMovementComponent::BuildFireInputPacket(FFireInputPacket& OutPacket) const
+{
+	OutPacket.Entries = PendingFireInput;
+}
+
+FVector UMPCharacterMovementComponent::RoundAcceleration(FVector InAccel) const
+{
+	// 客户端保存移动时就按紧凑格式的精度量化：本地模拟与服务器解码后的输入完全相同，
+	// 量化后相同的连续移动也能被 CanCombineWith 合并。
+	if (CompactMove::IsEnabled())
+	{
+		return CompactMove::RoundAcceleration(InAccel, GetMaxAcceleration());
+	}
+	return Super::RoundAcceleration(InAccel);
+}
+
+bool UMPCharacterMovementComponent::IsMoveSendBudgetExhausted() const
+{
+	return MoveSendRate::GetRate() > 0.0f && MoveSendBucket.Tokens < 1.0f;
+}
+
+void UMPCharacterMovementComponent::ReplicateMoveToServer(float DeltaTime, const FVector& NewAcceleration)
+{
+	// 先按经过的时间恢复令牌，这一帧的合并与发送判断都基于恢复后的预算。
+	const UNetConnection* Connection = CharacterOwner ? CharacterOwner->GetNetConnection() : nullptr;
+	const float Now = GetWorld()->GetTimeSeconds();
+	const float Burst = MoveSendRate::GetBurst();
+	if (Connection != MoveSendConnection)
+	{
+		MoveSendConnection = Connection;
+		MoveSendBucket.Tokens = Burst;
+		MoveSendBucket.LastRefillTime = Now;
+	}
+	MoveSendBucket.Refill(Now, MoveSendRate::GetRate(), Burst);
+
+	Super::ReplicateMoveToServer(DeltaTime, NewAcceleration);
+}
+
+bool UMPCharacterMovementComponent::CanDelaySendingMove(const FSavedMovePtr& NewMove)
+{
+	// 有开火输入时立即发送移动包，不等待合并。
+	return !HasPendingFireInput() && Super::CanDelaySendingMove(NewMove);
+}
+
+float UMPCharacterMovementComponent::GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const
+{
+	// 预算用完时，等到下一个令牌恢复再发送（引擎仍会限制在 1/120 到 1/5 秒之间）。
+	// 这个延迟从上一次发送算起，所以加上已经过去的时间。
+	const float DeltaTime = Super::GetClientNetSendDeltaTime(PC, ClientData, NewMove);
+	if (!IsMoveSendBudgetExhausted())
+	{
+		return DeltaTime;
+	}
+	const float TimeSinceLastSend = GetWorld()->GetTimeSeconds() - ClientData->ClientUpdateTime;
+	const float TimeUntilToken = (1.0f - MoveSendBucket.Tokens) / MoveSendRate::GetRate();
+	return FMath::Max(DeltaTime, TimeSinceLastSend + TimeUntilToken);
+}
+
+void UMPCharacterMovementComponent::CallServerMovePacked(const FSavedMove_Character* NewMove, const FSavedMove_Character* PendingMove, const FSavedMove_Character* OldMove)
+{
+	Super::CallServerMovePacked(NewMove, PendingMove, OldMove);
+
+	// 立即发送的输入在预算用完时透支，透支的部分从之后的预算中扣除。
+	MoveSendBucket.Tokens = FMath::Max(MoveSendBucket.Tokens - 1.0f, -MoveSendRate::GetBurst());
+
+	// 每发送一个包，窗口内的开火输入各消耗一次发送次数。
+	for (int32 Index = PendingFireInput.Num() - 1; Index >= 0; --Index)
+	{
+		if (--PendingFireInput[Index].SendsRemaining == 0)
+		{
+			PendingFireInput.RemoveAt(Index, 1, false);
+		}
+	}
+}
+
+bool UMPCharacterMovementComponent::ConsumeMoveReceiveToken()
+{
+	const float Rate = MoveSendRate::GetRate();
+	if (Rate <= 0.0f)
+	{
+		return true;
+	}
+
+	const UNetConnection* Connection = CharacterOwner ? CharacterOwner->GetNetConnection() : nullptr;
+	const float Now = GetWorld()->GetTimeSeconds();
+	const float Burst = MoveSendRate::GetReceiveBurst();
+	if (Connection != MoveReceiveConnection)
+	{
+		MoveReceiveConnection = Connection;
+		MoveReceiveBucket.Tokens = Burst;
+		MoveReceiveBucket.LastRefillTime = Now;
+	}
+	MoveReceiveBucket.Refill(Now, Rate, Burst);
+
+	if (MoveReceiveBucket.Tokens < 1.0f)
+	{
+		return false;
+	}
+	MoveReceiveBucket.Tokens -= 1.0f;
+	return true;
+}
+
+void UMPCharacterMovementComponent::ServerMovePacked_ServerReceive(const FCharacterServerMovePackedBits& PackedBits)
+{
+	// 超出频率上限的包直接丢弃，与丢包一样处理：下一个包的时间戳覆盖这段时间，冗余的开火输入随之后的包到达。
+	if (!ConsumeMoveReceiveToken())
+	{
+		++MoveNetStats[bLastMoveCompact ? 1 : 0].Dropped;
+		INC_DWORD_STAT(STAT_MovePacketsDropped);
+		return;
+	}
+
+	// 暂停时聚合器不Tick，直接处理。
+	UWorld* World = GetWorld();
+	UTickAggregationSubsystem* TickAggregation = CVarMoveBatchServerMoves.GetValueOnGameThread() != 0 && World && !World->IsPaused() ? World->GetSubsystem<UTickAggregationSubsystem>() : nullptr;
+	if (!TickAggregation)
+	{
+		ProcessServerMovePacked(PackedBits);
+		return;
+	}
+
+	if (QueuedServerMoves.Num() >= MaxQueuedServerMoves)
+	{
+		FlushQueuedServerMoves();
+	}
+	if (QueuedServerMoves.Num() == 0)
+	{
+		TickAggregation->RegisterGroup(ServerMovesGroupName, &UMPCharacterMovementComponent::TickQueuedServerMoves);
+		TickAggregation->AddObject(ServerMovesGroupName, this);
+	}
+	QueuedServerMoves.Add(PackedBits);
+}
+
+void UMPCharacterMovementComponent::FlushQueuedServerMoves()
+{
+	// RPC 只在网络驱动分发时到达，处理期间队列不会增长。
+	for (const FCharacterServerMovePackedBits& PackedBits : QueuedServerMoves)
+	{
+		ProcessServerMovePacked(PackedBits);
+	}
+	QueuedServerMoves.Reset();
+}
+
+void UMPCharacterMovementComponent::TickQueuedServerMoves(TArrayView<UObject* const> Components, float DeltaTime)
+{
+	for (UObject* Object : Components)
+	{
+		UMPCharacterMovementComponent* Movement = CastChecked<UMPCharacterMovementComponent>(Object);
+		Movement->FlushQueuedServerMoves();
+		if (UTickAggregationSubsystem* TickAggregation = Movement->GetWorld()->GetSubsystem<UTickAggregationSubsystem>())
+		{
+			TickAggregation->RemoveObject(ServerMovesGroupName, Movement);
+		}
+	}
+}
+
+void UMPCharacterMovementComponent::ProcessServerMovePacked(const FCharacterServerMovePackedBits& PackedBits)
+{
+	MP_SCOPE_CYCLE_COUNTER(STAT_ServerMovePacket);
+
+	Super::ServerMovePacked_ServerReceive(PackedBits);
+
+	// 格式取自刚解码的 NewMove，之后的位置检查也计入这种格式。
+	bLastMoveCompact = static_cast<const FMPCharacterNetworkMoveData*>(MoveDataContainer.GetNewMoveData())->bCompact;
+
+	const int32 NumBits = PackedBits.DataBits.Num();
+	FMPMoveNetStats& Stats = MoveNetStats[bLastMoveCompact ? 1 : 0];
+	++Stats.Packets;
+	Stats.Bits += NumBits;
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (LastMovePacketTime >= 0.0f)
+	{
+		// 超过一秒没有收包（例如客户端卡顿或暂停）的时间不计入。
+		Stats.Seconds += FMath::Min(Now - LastMovePacketTime, 1.0f);
+	}
+	LastMovePacketTime = Now;
+
+	INC_DWORD_STAT(STAT_MovePacketsReceived);
+	INC_DWORD_STAT_BY(STAT_MoveBitsReceived, NumBits);
+}
+
+void UMPCharacterMovementComponent::ServerMove_PerformMovement(const FCharacterNetworkMoveData& MoveData)
+{
+	Super::ServerMove_PerformMovement(MoveData);
+
+	// 先执行移动，开火时使用的是这次移动之后的位置与控制器朝向。
+	const FMPCharacterNetworkMoveData& MPMoveData = static_cast<const FMPCharacterNetworkMoveData&>(MoveData);
+	if (MPMoveData.FireInput.Num() > 0)
+	{
+		if (AMultiplayerGame_DemoCharacter* Character = Cast<AMultiplayerGame_DemoCharacter>(CharacterOwner))
+		{
+			Character->ServerProcessFireInput(MPMoveData.FireInput);
+		}
+	}
+}
+
+bool UMPCharacterMovementComponent::ServerCheckClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	const bool bNeedsCorrection = Super::ServerCheckClientError(ClientTimeStamp, DeltaTime, Accel, ClientWorldLocation, RelativeClientLocation, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+
+	FMPMoveNetStats& Stats = MoveNetStats[bLastMoveCompact ? 1 : 0];
+	++Stats.Checks;
+	if (bNeedsCorrection)
+	{
+		++Stats.Corrections;
+		INC_DWORD_STAT(STAT_MoveCorrections);
+	}
+	return bNeedsCorrection;
+}
+
+FMPMoveNetStats UMPCharacterMovementComponent::GetMoveNetStats(bool bCompact) const
+{
+	return MoveNetStats[bCompact ? 1 : 0];
+}
+
+void UMPCharacterMovementComponent::ResetMoveNetStats()
+{
+	MoveNetStats[0] = FMPMoveNetStats();
+	MoveNetStats[1] = FMPMoveNetStats();
+	LastMovePacketTime = -1.0f;
+}
+
+void UMPCharacterMovementComponent::LogMoveNetStats(UWorld* World)
+{
+	if (!World)
+	{
+		return;
+	}
+
+	FMPMoveNetStats Totals[2];
+	int32 NumConnections[2] = { 0, 0 };
+	for (TActorIterator<ACharacter> It(World); It; ++It)
+	{
+		if (const UMPCharacterMovementComponent* Movement = Cast<UMPCharacterMovementComponent>(It->GetCharacterMovement()))
+		{
+			for (int32 FormatIndex = 0; FormatIndex < 2; ++FormatIndex)
+			{
+				const FMPMoveNetStats Stats = Movement->GetMoveNetStats(FormatIndex != 0);
+				if (Stats.Packets > 0)
+				{
+					Totals[FormatIndex].Accumulate(Stats);
+					++NumConnections[FormatIndex];
+				}
+			}
+		}
+	}
+
+	// 速率按连接计算：Seconds 是所有连接收包时长之和。
+	double BytesPerSecond[2] = { 0.0, 0.0 };
+	for (int32 FormatIndex = 0; FormatIndex < 2; ++FormatIndex)
+	{
+		const FMPMoveNetStats& Stats = Totals[FormatIndex];
+		const double Seconds = FMath::Max<double>(Stats.Seconds, KINDA_SMALL_NUMBER);
+		BytesPerSecond[FormatIndex] = Stats.Bits / 8.0 / Seconds;
+		UE_LOG(LogMPMovement, Log, TEXT("Move format %s: Connections=%d Packets=%u (%.1f/s per connection) Dropped=%u Bits/packet=%.1f Bytes/s per connection=%.1f Corrections=%u/%u (%.2f%%)"),
+			CompactMove::GetFormatName(FormatIndex != 0), NumConnections[FormatIndex], Stats.Packets, Stats.Packets / Seconds, Stats.Dropped,
+			Stats.Packets > 0 ? (double)Stats.Bits / Stats.Packets : 0.0, BytesPerSecond[FormatIndex],
+			Stats.Corrections, Stats.Checks, Stats.Checks > 0 ? 100.0 * Stats.Corrections / Stats.Checks : 0.0);
+	}
+
+	if (Totals[0].Packets > 0 && Totals[1].Packets > 0)
+	{
+		UE_LOG(LogMPMovement, Log, TEXT("Move upstream per connection: Compact is %.1f%% of Default"), 100.0 * BytesPerSecond[1] / FMath::Max(BytesPerSecond[0], (double)KINDA_SMALL_NUMBER));
+	}
+}
+
+void UMPCharacterMovementComponent::ResetMoveNetStats(UWorld* World)
+{
+	if (!World)
+	{
+		return;
+	}
+
+	for (TActorIterator<ACharacter> It(World); It; ++It)
+	{
+		if (UMPCharacterMovementComponent* Movement = Cast<UMPCharacterMovementComponent>(It->GetCharacterMovement()))
+		{
+			Movement->ResetMoveNetStats();
+		}
+	}
+}
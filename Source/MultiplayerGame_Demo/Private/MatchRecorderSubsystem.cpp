@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MatchRecorderSubsystem.h"
+#include "GameplayEventChannel.h"
+#include "MatchRecording.h"
+#include "MultiplayerGame_Demo.h"
+#include "MultiplayerGame_DemoCharacter.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMatchRecorder, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Match Recorder Sample"), STAT_MatchRecorderSample, STATGROUP_MultiplayerGame);
+
+static TAutoConsoleVariable<int32> CVarRecorderEnable(
+	TEXT("mp.Recorder.Enable"),
+	0,
+	TEXT("Records server matches to Saved/Recordings. Read when a game world is created; -RecordMatch does the same."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRecorderTransformInterval(
+	TEXT("mp.Recorder.TransformInterval"),
+	0.1f,
+	TEXT("Seconds between character transform samples in match recordings."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarRecorderChunkKB(
+	TEXT("mp.Recorder.ChunkKB"),
+	64,
+	TEXT("Encoded size at which a match recording chunk is written. Read when recording starts."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRecorderChunkSeconds(
+	TEXT("mp.Recorder.ChunkSeconds"),
+	10.0f,
+	TEXT("Maximum world time covered by one match recording chunk. Read when recording starts."),
+	ECVF_Default);
+
+/** 把通道中的事件编码后写入录像文件，在事件通道的后台线程上运行。*/
+class FMatchRecorderSink : public IGameplayEventSink
+{
+public:
+	FMatchRecorderSink(FArchive* Writer, int32 ChunkBytes, float ChunkSeconds, const FString& InFilename)
+		: Recording(Writer, ChunkBytes, ChunkSeconds)
+		, Filename(InFilename)
+	{
+	}
+
+	virtual void Consume(TArrayView<const FGameplayEventRecord> Records) override
+	{
+		for (const FGameplayEventRecord& Record : Records)
+		{
+			Recording.Append(Record);
+		}
+	}
+
+	virtual void Flush() override
+	{
+		Recording.Finish();
+		UE_LOG(LogMatchRecorder, Log, TEXT("Match recording closed: %s (%.1f KB)"), *Filename, Recording.GetTotalBytes() / 1024.0);
+	}
+
+private:
+	FMatchRecordingWriter Recording;
+	FString Filename;
+};
+
+bool UMatchRecorderSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld()
+		&& (CVarRecorderEnable.GetValueOnGameThread() != 0 || FParse::Param(FCommandLine::Get(), TEXT("RecordMatch")))
+		&& Super::ShouldCreateSubsystem(Outer);
+}
+
+void UMatchRecorderSubsystem::Deinitialize()
+{
+	StopRecording();
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UMatchRecorderSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UMatchRecorderSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMatchRecorderSubsystem, STATGROUP_Tickables);
+}
+
+void UMatchRecorderSubsystem::Tick(float DeltaTime)
+{
+	// 网络模式要等世界开始运行后才确定，在第一次Tick时决定是否录制。
+	if (!Sink)
+	{
+		if (GetWorld()->GetNetMode() == NM_Client)
+		{
+			bClientWorld = true;
+			return;
+		}
+		StartRecording();
+	}
+
+	TimeUntilSample -= DeltaTime;
+	if (TimeUntilSample <= 0.0f)
+	{
+		SampleTransforms();
+		TimeUntilSample = FMath::Max(TimeUntilSample + CVarRecorderTransformInterval.GetValueOnGameThread(), 0.0f);
+	}
+}
+
+void UMatchRecorderSubsystem::StartRecording()
+{
+	Filename = FPaths::ProjectSavedDir() / TEXT("Recordings") / FString::Printf(TEXT("Match_%s_%s.mprec"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString());
+
+	// 只在开始录制时打开一次文件，之后的写入都在后台线程上。
+	FArchive* Writer = IFileManager::Get().CreateFileWriter(*Filename);
+	if (!Writer)
+	{
+		UE_LOG(LogMatchRecorder, Warning, TEXT("Could not create match recording %s"), *Filename);
+		bClientWorld = true;
+		return;
+	}
+
+	Sink = MakeShared<FMatchRecorderSink, ESPMode::ThreadSafe>(Writer, CVarRecorderChunkKB.GetValueOnGameThread() * 1024, CVarRecorderChunkSeconds.GetValueOnGameThread(), Filename);
+	FGameplayEventChannel::Get().AddSink(Sink.ToSharedRef());
+	IdentifiedCharacters.Reset();
+	TimeUntilSample = 0.0f;
+
+	UE_LOG(LogMatchRecorder, Log, TEXT("Match recording: %s"), *Filename);
+}
+
+void UMatchRecorderSubsystem::StopRecording()
+{
+	if (Sink)
+	{
+		FGameplayEventChannel::Get().RetireSink(Sink.ToSharedRef());
+		Sink.Reset();
+		Filename.Reset();
+	}
+}
+
+void UMatchRecorderSubsystem::SampleTransforms()
+{
+	SCOPE_CYCLE_COUNTER(STAT_MatchRecorderSample);
+
+	FGameplayEventChannel& Channel = FGameplayEventChannel::Get();
+	for (TActorIterator<AMultiplayerGame_DemoCharacter> It(GetWorld()); It; ++It)
+	{
+		AMultiplayerGame_DemoCharacter* Character = *It;
+		if (Character->IsDead() || Character->IsActorBeingDestroyed())
+		{
+			continue;
+		}
+
+		const uint32 CharacterId = Character->GetUniqueID();
+		const APlayerState* PlayerState = Character->GetPlayerState();
+		if (PlayerState && !IdentifiedCharacters.Contains(CharacterId))
+		{
+			IdentifiedCharacters.Add(CharacterId);
+			Channel.Push(EGameplayEventType::Identity, Character, nullptr, PlayerState->GetPlayerId());
+		}
+
+		Channel.Push(EGameplayEventType::Transform, Character, nullptr, Character->GetActorRotation().Yaw, 0.0f, Character->GetActorLocation());
+	}
+}
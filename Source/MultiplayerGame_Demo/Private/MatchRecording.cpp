@@ -0,0 +1,474 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MatchRecording.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Serialization/Archive.h"
+
+static int32 QuantizeHundredths(float Value)
+{
+	return (int32)FMath::Clamp<int64>((int64)FMath::RoundToDouble((double)Value * 100.0), MIN_int32, MAX_int32);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FMatchRecordingWriter
+
+FMatchRecordingWriter::FMatchRecordingWriter(FArchive* InWriter, int32 InChunkBytes, float InChunkSeconds)
+	: Writer(InWriter)
+	, ChunkBytes(FMath::Max(InChunkBytes, 1024))
+	, ChunkSeconds(FMath::Max(InChunkSeconds, 0.1f))
+{
+	// 一条记录最多约 40 字节，预留余量后写满一块不会再扩容。
+	Payload.Reserve(ChunkBytes + 64);
+
+	if (Writer)
+	{
+		FMatchRecordingFileHeader Header;
+		Writer->Serialize(&Header, sizeof(Header));
+		TotalBytes += sizeof(Header);
+	}
+}
+
+FMatchRecordingWriter::~FMatchRecordingWriter()
+{
+	Finish();
+}
+
+void FMatchRecordingWriter::Append(const FGameplayEventRecord& Record)
+{
+	if (!Writer)
+	{
+		return;
+	}
+
+	if (Chunk.NumRecords > 0 && (Payload.Num() >= ChunkBytes || Record.WorldTime - Chunk.StartTime >= ChunkSeconds || Record.WorldTime < Chunk.StartTime))
+	{
+		FlushChunk();
+	}
+
+	if (Chunk.NumRecords == 0)
+	{
+		Chunk.StartTime = Record.WorldTime;
+		LastRecordMs = 0;
+	}
+
+	const FIntVector Location(FMath::RoundToInt(Record.Location.X), FMath::RoundToInt(Record.Location.Y), FMath::RoundToInt(Record.Location.Z));
+	const int32 Value = QuantizeHundredths(Record.Value);
+	const int32 Delta = QuantizeHundredths(Record.Delta);
+
+	uint8 Flags = 0;
+	Flags |= Record.InstigatorId != 0 ? MatchRecording::HasInstigator : 0;
+	Flags |= Value != 0 ? MatchRecording::HasValue : 0;
+	Flags |= Delta != 0 ? MatchRecording::HasDelta : 0;
+	Flags |= Location != FIntVector::ZeroValue ? MatchRecording::HasLocation : 0;
+
+	Payload.Add((uint8)Record.Type);
+	Payload.Add(Flags);
+
+	// 世界时间单调递增，块内记录相对块起点的毫秒数只会增加。
+	const int32 RecordMs = FMath::Max(FMath::RoundToInt((Record.WorldTime - Chunk.StartTime) * 1000.0f), LastRecordMs);
+	WriteVarUInt(RecordMs - LastRecordMs);
+	LastRecordMs = RecordMs;
+
+	WriteVarUInt(Record.SubjectId);
+	if (Flags & MatchRecording::HasInstigator)
+	{
+		WriteVarUInt(Record.InstigatorId);
+	}
+	if (Flags & MatchRecording::HasValue)
+	{
+		WriteVarInt(Value);
+	}
+	if (Flags & MatchRecording::HasDelta)
+	{
+		WriteVarInt(Delta);
+	}
+	if (Flags & MatchRecording::HasLocation)
+	{
+		const FIntVector* LastLocation = LastLocations.Find(Record.SubjectId);
+		const FIntVector Base = LastLocation ? *LastLocation : FIntVector::ZeroValue;
+		WriteVarInt(Location.X - Base.X);
+		WriteVarInt(Location.Y - Base.Y);
+		WriteVarInt(Location.Z - Base.Z);
+		LastLocations.Add(Record.SubjectId, Location);
+	}
+
+	Chunk.NumRecords++;
+	Chunk.TypeMask |= MatchRecording::TypeBit(Record.Type);
+	Chunk.EndTime = Chunk.StartTime + RecordMs * 0.001f;
+}
+
+void FMatchRecordingWriter::FlushChunk()
+{
+	if (!Writer || Chunk.NumRecords == 0)
+	{
+		return;
+	}
+
+	FMatchRecordingIndexEntry& Entry = Index.AddDefaulted_GetRef();
+	Entry.Offset = TotalBytes;
+	Entry.TypeMask = Chunk.TypeMask;
+	Entry.NumRecords = Chunk.NumRecords;
+	Entry.StartTime = Chunk.StartTime;
+	Entry.EndTime = Chunk.EndTime;
+
+	Chunk.PayloadBytes = Payload.Num();
+	Writer->Serialize(&Chunk, sizeof(Chunk));
+	Writer->Serialize(Payload.GetData(), Payload.Num());
+	TotalBytes += sizeof(Chunk) + Payload.Num();
+
+	Chunk = FMatchRecordingChunkHeader();
+	Payload.Reset();
+	LastLocations.Reset();
+}
+
+void FMatchRecordingWriter::Finish()
+{
+	if (!Writer)
+	{
+		return;
+	}
+
+	FlushChunk();
+
+	FMatchRecordingTrailer Trailer;
+	Trailer.IndexOffset = TotalBytes;
+	Trailer.NumChunks = Index.Num();
+	Writer->Serialize(Index.GetData(), Index.Num() * sizeof(FMatchRecordingIndexEntry));
+	Writer->Serialize(&Trailer, sizeof(Trailer));
+	TotalBytes += Index.Num() * sizeof(FMatchRecordingIndexEntry) + sizeof(Trailer);
+
+	Writer->Close();
+	Writer.Reset();
+}
+
+void FMatchRecordingWriter::WriteVarUInt(uint32 Value)
+{
+	while (Value >= 0x80)
+	{
+		Payload.Add((uint8)(Value | 0x80));
+		Value >>= 7;
+	}
+	Payload.Add((uint8)Value);
+}
+
+void FMatchRecordingWriter::WriteVarInt(int32 Value)
+{
+	// zigzag：小的负数也只占一两个字节。
+	WriteVarUInt(((uint32)Value << 1) ^ (uint32)(Value >> 31));
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FMatchRecordingReader
+
+/** 块内记录的解码游标，所有读取都做越界检查。*/
+struct FMatchRecordingCursor
+{
+	const uint8* Data;
+	const uint8* End;
+	bool bError = false;
+
+	uint8 ReadByte()
+	{
+		if (Data >= End)
+		{
+			bError = true;
+			return 0;
+		}
+		return *Data++;
+	}
+
+	uint32 ReadVarUInt()
+	{
+		uint32 Value = 0;
+		for (int32 Shift = 0; Shift < 35; Shift += 7)
+		{
+			const uint8 Byte = ReadByte();
+			Value |= (uint32)(Byte & 0x7F) << Shift;
+			if (!(Byte & 0x80))
+			{
+				return Value;
+			}
+		}
+		bError = true;
+		return 0;
+	}
+
+	int32 ReadVarInt()
+	{
+		const uint32 Value = ReadVarUInt();
+		return (int32)(Value >> 1) ^ -(int32)(Value & 1);
+	}
+};
+
+FMatchRecordingReader::FMatchRecordingReader()
+{
+}
+
+FMatchRecordingReader::~FMatchRecordingReader()
+{
+	// 先释放映射区域，再关闭文件。
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+bool FMatchRecordingReader::Open(const FString& Filename)
+{
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+	if (!MappedFile)
+	{
+		return false;
+	}
+
+	MappedRegion.Reset(MappedFile->MapRegion());
+	if (!MappedRegion)
+	{
+		return false;
+	}
+
+	Data = MappedRegion->GetMappedPtr();
+	Size = MappedRegion->GetMappedSize();
+
+	FMatchRecordingFileHeader Header;
+	if (Size < (int64)sizeof(Header))
+	{
+		return false;
+	}
+	FMemory::Memcpy(&Header, Data, sizeof(Header));
+	if (Header.Magic != MatchRecording::FileMagic || Header.Version != MatchRecording::Version)
+	{
+		return false;
+	}
+
+	bHasTrailer = ReadIndexFromTrailer();
+	if (!bHasTrailer)
+	{
+		ScanChunks();
+	}
+	return true;
+}
+
+bool FMatchRecordingReader::ReadIndexFromTrailer()
+{
+	FMatchRecordingTrailer Trailer;
+	if (Size < (int64)(sizeof(FMatchRecordingFileHeader) + sizeof(Trailer)))
+	{
+		return false;
+	}
+	FMemory::Memcpy(&Trailer, Data + Size - sizeof(Trailer), sizeof(Trailer));
+
+	const int64 IndexBytes = (int64)Trailer.NumChunks * sizeof(FMatchRecordingIndexEntry);
+	if (Trailer.Magic != MatchRecording::TrailerMagic || (int64)Trailer.IndexOffset + IndexBytes + (int64)sizeof(Trailer) != Size)
+	{
+		return false;
+	}
+
+	Chunks.SetNumUninitialized(Trailer.NumChunks);
+	FMemory::Memcpy(Chunks.GetData(), Data + Trailer.IndexOffset, IndexBytes);
+	return true;
+}
+
+void FMatchRecordingReader::ScanChunks()
+{
+	// 只读块头，按 PayloadBytes 跳到下一块；最后一块不完整时丢弃。
+	int64 Offset = sizeof(FMatchRecordingFileHeader);
+	while (Offset + (int64)sizeof(FMatchRecordingChunkHeader) <= Size)
+	{
+		FMatchRecordingChunkHeader Header;
+		FMemory::Memcpy(&Header, Data + Offset, sizeof(Header));
+		if (Header.Magic != MatchRecording::ChunkMagic || Offset + (int64)sizeof(Header) + Header.PayloadBytes > Size)
+		{
+			break;
+		}
+
+		FMatchRecordingIndexEntry& Entry = Chunks.AddDefaulted_GetRef();
+		Entry.Offset = Offset;
+		Entry.TypeMask = Header.TypeMask;
+		Entry.NumRecords = Header.NumRecords;
+		Entry.StartTime = Header.StartTime;
+		Entry.EndTime = Header.EndTime;
+
+		Offset += sizeof(Header) + Header.PayloadBytes;
+	}
+}
+
+bool FMatchRecordingReader::DecodeChunk(int32 ChunkIndex, TFunctionRef<void(const FGameplayEventRecord&)> Visitor) const
+{
+	if (!Chunks.IsValidIndex(ChunkIndex))
+	{
+		return false;
+	}
+
+	FMatchRecordingChunkHeader Header;
+	const int64 Offset = Chunks[ChunkIndex].Offset;
+	if (Offset + (int64)sizeof(Header) > Size)
+	{
+		return false;
+	}
+	FMemory::Memcpy(&Header, Data + Offset, sizeof(Header));
+	if (Header.Magic != MatchRecording::ChunkMagic || Offset + (int64)sizeof(Header) + Header.PayloadBytes > Size)
+	{
+		return false;
+	}
+
+	FMatchRecordingCursor Cursor;
+	Cursor.Data = Data + Offset + sizeof(Header);
+	Cursor.End = Cursor.Data + Header.PayloadBytes;
+
+	TMap<uint32, FIntVector> LastLocations;
+	int32 RecordMs = 0;
+
+	for (uint32 RecordIndex = 0; RecordIndex < Header.NumRecords; ++RecordIndex)
+	{
+		FGameplayEventRecord Record;
+		Record.Type = (EGameplayEventType)Cursor.ReadByte();
+		const uint8 Flags = Cursor.ReadByte();
+
+		RecordMs += Cursor.ReadVarUInt();
+		Record.WorldTime = Header.StartTime + RecordMs * 0.001f;
+		Record.SubjectId = Cursor.ReadVarUInt();
+		Record.InstigatorId = (Flags & MatchRecording::HasInstigator) ? Cursor.ReadVarUInt() : 0;
+		Record.Value = (Flags & MatchRecording::HasValue) ? Cursor.ReadVarInt() * 0.01f : 0.0f;
+		Record.Delta = (Flags & MatchRecording::HasDelta) ? Cursor.ReadVarInt() * 0.01f : 0.0f;
+
+		if (Flags & MatchRecording::HasLocation)
+		{
+			const FIntVector* LastLocation = LastLocations.Find(Record.SubjectId);
+			FIntVector Location = LastLocation ? *LastLocation : FIntVector::ZeroValue;
+			Location.X += Cursor.ReadVarInt();
+			Location.Y += Cursor.ReadVarInt();
+			Location.Z += Cursor.ReadVarInt();
+			LastLocations.Add(Record.SubjectId, Location);
+			Record.Location = FVector(Location);
+		}
+
+		if (Cursor.bError)
+		{
+			return false;
+		}
+		Visitor(Record);
+	}
+
+	return true;
+}
+
+void FMatchRecordingReader::SumDamage(TMap<uint32, FMatchDamageSummary>& OutSummaries) const
+{
+	const uint32 RelevantTypes = MatchRecording::TypeBit(EGameplayEventType::Damaged) | MatchRecording::TypeBit(EGameplayEventType::Killed) | MatchRecording::TypeBit(EGameplayEventType::Fired);
+
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ++ChunkIndex)
+	{
+		if (!(Chunks[ChunkIndex].TypeMask & RelevantTypes))
+		{
+			continue;
+		}
+
+		DecodeChunk(ChunkIndex, [&OutSummaries](const FGameplayEventRecord& Record)
+		{
+			switch (Record.Type)
+			{
+			case EGameplayEventType::Damaged:
+				OutSummaries.FindOrAdd(Record.SubjectId).DamageTaken += Record.Value;
+				if (Record.InstigatorId != 0)
+				{
+					OutSummaries.FindOrAdd(Record.InstigatorId).DamageDealt += Record.Value;
+				}
+				break;
+			case EGameplayEventType::Killed:
+				OutSummaries.FindOrAdd(Record.SubjectId).Deaths++;
+				if (Record.InstigatorId != 0)
+				{
+					OutSummaries.FindOrAdd(Record.InstigatorId).Kills++;
+				}
+				break;
+			case EGameplayEventType::Fired:
+				OutSummaries.FindOrAdd(Record.SubjectId).ShotsFired++;
+				break;
+			default:
+				break;
+			}
+		});
+	}
+}
+
+void FMatchRecordingReader::GetIdentities(TMap<uint32, int32>& OutPlayerIds) const
+{
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ++ChunkIndex)
+	{
+		if (Chunks[ChunkIndex].TypeMask & MatchRecording::TypeBit(EGameplayEventType::Identity))
+		{
+			DecodeChunk(ChunkIndex, [&OutPlayerIds](const FGameplayEventRecord& Record)
+			{
+				if (Record.Type == EGameplayEventType::Identity)
+				{
+					OutPlayerIds.Add(Record.SubjectId, FMath::RoundToInt(Record.Value));
+				}
+			});
+		}
+	}
+}
+
+bool FMatchRecordingReader::FindLocationAtTime(uint32 SubjectId, float Time, FVector& OutLocation) const
+{
+	const uint32 TransformBit = MatchRecording::TypeBit(EGameplayEventType::Transform);
+
+	// 最后一个起始时间不晚于 Time 的块。
+	int32 StartChunk = INDEX_NONE;
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num() && Chunks[ChunkIndex].StartTime <= Time; ++ChunkIndex)
+	{
+		StartChunk = ChunkIndex;
+	}
+
+	bool bHasBefore = false, bHasAfter = false;
+	float BeforeTime = 0.0f, AfterTime = 0.0f;
+	FVector BeforeLocation = FVector::ZeroVector, AfterLocation = FVector::ZeroVector;
+
+	const auto VisitSample = [&](const FGameplayEventRecord& Record)
+	{
+		if (Record.Type != EGameplayEventType::Transform || Record.SubjectId != SubjectId)
+		{
+			return;
+		}
+		if (Record.WorldTime <= Time)
+		{
+			bHasBefore = true;
+			BeforeTime = Record.WorldTime;
+			BeforeLocation = Record.Location;
+		}
+		else if (!bHasAfter)
+		{
+			bHasAfter = true;
+			AfterTime = Record.WorldTime;
+			AfterLocation = Record.Location;
+		}
+	};
+
+	// 向前找 Time 之前的最后一个采样。
+	for (int32 ChunkIndex = StartChunk; ChunkIndex >= 0 && !bHasBefore; --ChunkIndex)
+	{
+		if (Chunks[ChunkIndex].TypeMask & TransformBit)
+		{
+			DecodeChunk(ChunkIndex, VisitSample);
+		}
+	}
+
+	// 向后找 Time 之后的第一个采样。
+	for (int32 ChunkIndex = StartChunk + 1; ChunkIndex < Chunks.Num() && !bHasAfter && bHasBefore; ++ChunkIndex)
+	{
+		if (Chunks[ChunkIndex].TypeMask & TransformBit)
+		{
+			DecodeChunk(ChunkIndex, VisitSample);
+		}
+	}
+
+	if (!bHasBefore)
+	{
+		return false;
+	}
+
+	OutLocation = bHasAfter && AfterTime > BeforeTime
+		? FMath::Lerp(BeforeLocation, AfterLocation, (Time - BeforeTime) / (AfterTime - BeforeTime))
+		: BeforeLocation;
+	return true;
+}
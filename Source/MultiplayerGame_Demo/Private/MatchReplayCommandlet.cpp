@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MatchReplayCommandlet.h"
+#include "MatchRecording.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMatchReplay, Log, All);
+
+UMatchReplayCommandlet::UMatchReplayCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UMatchReplayCommandlet::Main(const FString& Params)
+{
+	FString Filename;
+	if (!FParse::Value(*Params, TEXT("File="), Filename))
+	{
+		UE_LOG(LogMatchReplay, Error, TEXT("Usage: -run=MatchReplay -File=<recording> [-Query=Summary|Damage|Location] [-Subject=<id> | -Player=<PlayerId>] [-Time=<seconds>]"));
+		return 1;
+	}
+
+	FMatchRecordingReader Reader;
+	if (!Reader.Open(Filename))
+	{
+		UE_LOG(LogMatchReplay, Error, TEXT("Could not open match recording %s"), *Filename);
+		return 1;
+	}
+
+	FString Query = TEXT("Summary");
+	FParse::Value(*Params, TEXT("Query="), Query);
+
+	const TArray<FMatchRecordingIndexEntry>& Chunks = Reader.GetChunks();
+	TMap<uint32, int32> PlayerIds;
+	Reader.GetIdentities(PlayerIds);
+
+	if (Query == TEXT("Summary"))
+	{
+		uint64 NumRecords = 0;
+		for (const FMatchRecordingIndexEntry& Chunk : Chunks)
+		{
+			NumRecords += Chunk.NumRecords;
+		}
+		UE_LOG(LogMatchReplay, Display, TEXT("%s: %d chunks, %llu records, %.1fs - %.1fs, %d players%s"),
+			*Filename, Chunks.Num(), NumRecords,
+			Chunks.Num() > 0 ? Chunks[0].StartTime : 0.0f, Chunks.Num() > 0 ? Chunks.Last().EndTime : 0.0f,
+			PlayerIds.Num(), Reader.HasTrailer() ? TEXT("") : TEXT(" (no index, recording was not closed)"));
+		return 0;
+	}
+
+	if (Query == TEXT("Damage"))
+	{
+		TMap<uint32, FMatchDamageSummary> Summaries;
+		Reader.SumDamage(Summaries);
+		Summaries.ValueSort([](const FMatchDamageSummary& A, const FMatchDamageSummary& B) { return A.DamageDealt > B.DamageDealt; });
+
+		UE_LOG(LogMatchReplay, Display, TEXT("Subject,PlayerId,DamageDealt,DamageTaken,Kills,Deaths,ShotsFired"));
+		for (const TPair<uint32, FMatchDamageSummary>& Pair : Summaries)
+		{
+			const int32* PlayerId = PlayerIds.Find(Pair.Key);
+			UE_LOG(LogMatchReplay, Display, TEXT("%u,%d,%.1f,%.1f,%d,%d,%d"), Pair.Key, PlayerId ? *PlayerId : -1,
+				Pair.Value.DamageDealt, Pair.Value.DamageTaken, Pair.Value.Kills, Pair.Value.Deaths, Pair.Value.ShotsFired);
+		}
+		return 0;
+	}
+
+	if (Query == TEXT("Location"))
+	{
+		uint32 SubjectId = 0;
+		int32 PlayerId = 0;
+		if (FParse::Value(*Params, TEXT("Player="), PlayerId))
+		{
+			if (const uint32* Found = PlayerIds.FindKey(PlayerId))
+			{
+				SubjectId = *Found;
+			}
+		}
+		else
+		{
+			FParse::Value(*Params, TEXT("Subject="), SubjectId);
+		}
+
+		float Time = 0.0f;
+		FParse::Value(*Params, TEXT("Time="), Time);
+
+		FVector Location;
+		if (SubjectId == 0 || !Reader.FindLocationAtTime(SubjectId, Time, Location))
+		{
+			UE_LOG(LogMatchReplay, Error, TEXT("No transform for subject %u at %.2fs"), SubjectId, Time);
+			return 1;
+		}
+
+		UE_LOG(LogMatchReplay, Display, TEXT("Subject %u at %.2fs: %s"), SubjectId, Time, *Location.ToString());
+		return 0;
+	}
+
+	UE_LOG(LogMatchReplay, Error, TEXT("Unknown query %s"), *Query);
+	return 1;
+}
@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerGame_DemoGameState.h"
+#include "MultiplayerGame_Demo.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMatchStats, Log, All);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Match Stats Rows Dirtied"), STAT_MatchStatsRowsDirtied, STATGROUP_MultiplayerGame);
+
+static FAutoConsoleCommandWithWorld GMatchStatsCommand(
+	TEXT("mp.Match.Stats"),
+	TEXT("Prints kills, deaths, damage dealt / taken, shots and hits for every player in the current match."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const AMultiplayerGame_DemoGameState* GameState = World ? World->GetGameState<AMultiplayerGame_DemoGameState>() : nullptr)
+		{
+			GameState->LogMatchStats();
+		}
+	}));
+
+AMultiplayerGame_DemoGameState::AMultiplayerGame_DemoGameState()
+{
+	MatchStatsCapacity = 128;
+}
+
+void AMultiplayerGame_DemoGameState::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// 一次性预留，对局期间添加行与更新统计都不再分配内存。
+	if (HasAuthority())
+	{
+		MatchStats.Rows.Reserve(MatchStatsCapacity);
+		RowIndices.Reserve(MatchStatsCapacity);
+	}
+}
+
+void AMultiplayerGame_DemoGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// 推送模型：只有统计发生变化的帧才需要检查这张表，检查时快速数组也只发送脏行。
+	FDoRepLifetimeParams PushModelParams;
+	PushModelParams.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(AMultiplayerGame_DemoGameState, MatchStats, PushModelParams);
+}
+
+void AMultiplayerGame_DemoGameState::AddPlayerState(APlayerState* PlayerState)
+{
+	Super::AddPlayerState(PlayerState);
+
+	// 玩家加入时就添加行，计分板上能看到还没有任何战绩的玩家。
+	if (HasAuthority() && PlayerState && !PlayerState->IsInactive())
+	{
+		FindOrAddRow(PlayerState);
+	}
+}
+
+int32 AMultiplayerGame_DemoGameState::FindOrAddRow(const APlayerState* PlayerState)
+{
+	const int32 PlayerId = PlayerState->GetPlayerId();
+	if (const int32* RowIndex = RowIndices.Find(PlayerId))
+	{
+		return *RowIndex;
+	}
+
+	if (MatchStats.Rows.Num() == MatchStats.Rows.Max())
+	{
+		UE_LOG(LogMatchStats, Warning, TEXT("Match stats table grew past its capacity of %d rows; raise MatchStatsCapacity"), MatchStats.Rows.Max());
+	}
+
+	const int32 RowIndex = MatchStats.Rows.AddDefaulted();
+	MatchStats.Rows[RowIndex].PlayerId = PlayerId;
+	RowIndices.Add(PlayerId, RowIndex);
+	MarkRowDirty(RowIndex);
+	return RowIndex;
+}
+
+void AMultiplayerGame_DemoGameState::MarkRowDirty(int32 RowIndex)
+{
+	MatchStats.MarkItemDirty(MatchStats.Rows[RowIndex]);
+	MARK_PROPERTY_DIRTY_FROM_NAME(AMultiplayerGame_DemoGameState, MatchStats, this);
+	INC_DWORD_STAT(STAT_MatchStatsRowsDirtied);
+}
+
+void AMultiplayerGame_DemoGameState::RecordShot(const APlayerState* Shooter)
+{
+	if (!Shooter || !HasAuthority())
+	{
+		return;
+	}
+
+	const int32 RowIndex = FindOrAddRow(Shooter);
+	MatchStats.Rows[RowIndex].ShotsFired++;
+	MarkRowDirty(RowIndex);
+}
+
+void AMultiplayerGame_DemoGameState::RecordHit(const APawn* Shooter, const AActor* HitActor)
+{
+	const APawn* Victim = Cast<APawn>(HitActor);
+	const APlayerState* ShooterState = Shooter ? Shooter->GetPlayerState() : nullptr;
+	if (!ShooterState || !Victim || Victim == Shooter || !HasAuthority())
+	{
+		return;
+	}
+
+	const int32 RowIndex = FindOrAddRow(ShooterState);
+	MatchStats.Rows[RowIndex].Hits++;
+	MarkRowDirty(RowIndex);
+}
+
+void AMultiplayerGame_DemoGameState::RecordDamage(const APlayerState* Attacker, const APlayerState* Victim, float Damage, bool bKilled)
+{
+	if (!HasAuthority() || (Damage <= 0.0f && !bKilled))
+	{
+		return;
+	}
+
+	if (Victim)
+	{
+		const int32 RowIndex = FindOrAddRow(Victim);
+		FMatchStatsRow& Row = MatchStats.Rows[RowIndex];
+		Row.DamageTaken += Damage;
+		Row.Deaths += bKilled ? 1 : 0;
+		MarkRowDirty(RowIndex);
+	}
+
+	// 自伤只计入承受的伤害与死亡。
+	if (Attacker && Attacker != Victim)
+	{
+		const int32 RowIndex = FindOrAddRow(Attacker);
+		FMatchStatsRow& Row = MatchStats.Rows[RowIndex];
+		Row.DamageDealt += Damage;
+		Row.Kills += bKilled ? 1 : 0;
+		MarkRowDirty(RowIndex);
+	}
+}
+
+void AMultiplayerGame_DemoGameState::ResetMatchStats()
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	TSet<int32> ConnectedPlayerIds;
+	ConnectedPlayerIds.Reserve(PlayerArray.Num());
+	for (const APlayerState* PlayerState : PlayerArray)
+	{
+		if (PlayerState && !PlayerState->IsInactive())
+		{
+			ConnectedPlayerIds.Add(PlayerState->GetPlayerId());
+		}
+	}
+
+	// 已离开的玩家的行在这里移除（保留容量），其余的清零。
+	for (int32 RowIndex = MatchStats.Rows.Num() - 1; RowIndex >= 0; --RowIndex)
+	{
+		if (!ConnectedPlayerIds.Contains(MatchStats.Rows[RowIndex].PlayerId))
+		{
+			MatchStats.Rows.RemoveAtSwap(RowIndex, 1, false);
+		}
+	}
+
+	MatchStats.MarkArrayDirty();
+
+	// 只清零数值，保留快速数组的复制标识，客户端按行更新而不是重建整张表。
+	RowIndices.Reset();
+	for (int32 RowIndex = 0; RowIndex < MatchStats.Rows.Num(); ++RowIndex)
+	{
+		FMatchStatsRow& Row = MatchStats.Rows[RowIndex];
+		Row.Kills = 0;
+		Row.Deaths = 0;
+		Row.ShotsFired = 0;
+		Row.Hits = 0;
+		Row.DamageDealt = 0.0f;
+		Row.DamageTaken = 0.0f;
+		RowIndices.Add(Row.PlayerId, RowIndex);
+		MarkRowDirty(RowIndex);
+	}
+	MARK_PROPERTY_DIRTY_FROM_NAME(AMultiplayerGame_DemoGameState, MatchStats, this);
+}
+
+const FMatchStatsRow* AMultiplayerGame_DemoGameState::FindMatchStats(int32 PlayerId) const
+{
+	if (const int32* RowIndex = RowIndices.Find(PlayerId))
+	{
+		return &MatchStats.Rows[*RowIndex];
+	}
+
+	// 客户端没有下标表，行数很少，直接遍历。
+	return MatchStats.Rows.FindByPredicate([PlayerId](const FMatchStatsRow& Row) { return Row.PlayerId == PlayerId; });
+}
+
+void AMultiplayerGame_DemoGameState::LogMatchStats() const
+{
+	UE_LOG(LogMatchStats, Log, TEXT("Match stats: %d rows (capacity %d)"), MatchStats.Rows.Num(), MatchStats.Rows.Max());
+	UE_LOG(LogMatchStats, Log, TEXT("PlayerId,Kills,Deaths,DamageDealt,DamageTaken,ShotsFired,Hits"));
+	for (const FMatchStatsRow& Row : MatchStats.Rows)
+	{
+		UE_LOG(LogMatchStats, Log, TEXT("%d,%d,%d,%.1f,%.1f,%d,%d"),
+			Row.PlayerId, Row.Kills, Row.Deaths, Row.DamageDealt, Row.DamageTaken, Row.ShotsFired, Row.Hits);
+	}
+}
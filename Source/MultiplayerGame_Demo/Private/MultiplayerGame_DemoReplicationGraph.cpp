@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerGame_DemoReplicationGraph.h"
+#include "MultiplayerGame_DemoCharacter.h"
+#include "ThirdPersonMPProjectile.h"
+#include "GameFramework/PlayerState.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "UObject/UObjectIterator.h"
+
+UMultiplayerGame_DemoReplicationGraph::UMultiplayerGame_DemoReplicationGraph()
+{
+	GridCellSize = 10000.0f;
+	CharacterCullDistance = 15000.0f;
+	ProjectileCullDistance = 8000.0f;
+}
+
+void UMultiplayerGame_DemoReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+#if CSV_PROFILER
+	// 按类统计每帧复制的字节数与耗时，写入CSV的 ReplicationGraph 分类（包括子类），其余的类合计为 Other。
+	CSVTracker.SetImplicitClassTracking(AMultiplayerGame_DemoCharacter::StaticClass(), TEXT("Character"));
+	CSVTracker.SetImplicitClassTracking(AThirdPersonMPProjectile::StaticClass(), TEXT("Projectile"));
+	CSVTracker.SetImplicitClassTracking(APlayerState::StaticClass(), TEXT("PlayerState"));
+#endif
+
+	// 基类已经为每个复制的类（包括蓝图子类）登记了设置，这里覆盖角色和投射物及其子类。
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+		if (!ActorCDO || !ActorCDO->GetIsReplicated() || Class->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists))
+		{
+			continue;
+		}
+
+		if (Class->IsChildOf(AMultiplayerGame_DemoCharacter::StaticClass()))
+		{
+			// 角色：按类默认对象的更新频率复制，超过裁剪距离的连接直接跳过。
+			FClassReplicationInfo CharacterInfo;
+			CharacterInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorCDO->NetUpdateFrequency);
+			CharacterInfo.SetCullDistanceSquared(FMath::Square(CharacterCullDistance));
+			GlobalActorReplicationInfoMap.SetClassInfo(Class, CharacterInfo);
+		}
+		else if (Class->IsChildOf(AThirdPersonMPProjectile::StaticClass()))
+		{
+			// 投射物：裁剪距离更短；离开相关范围后尽快关闭通道，不让短命的Actor长期占用通道。
+			FClassReplicationInfo ProjectileInfo;
+			ProjectileInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorCDO->NetUpdateFrequency);
+			ProjectileInfo.SetCullDistanceSquared(FMath::Square(ProjectileCullDistance));
+			ProjectileInfo.ActorChannelFrameTimeout = 1;
+			GlobalActorReplicationInfoMap.SetClassInfo(Class, ProjectileInfo);
+		}
+	}
+}
+
+void UMultiplayerGame_DemoReplicationGraph::InitGlobalGraphNodes()
+{
+	Super::InitGlobalGraphNodes();
+
+	GridNode->CellSize = GridCellSize;
+}
+
+void UMultiplayerGame_DemoReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	// 角色始终在移动，作为动态Actor放入网格，每帧重新计算所在格子。
+	if (ActorInfo.Actor->IsA<AMultiplayerGame_DemoCharacter>())
+	{
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		return;
+	}
+
+	// 投射物（以及其他可休眠的Actor）由基类按休眠状态放入网格：对象池中休眠的投射物按静态处理，
+	// 几乎没有开销；飞行中的投射物按动态处理。GameState 等 bAlwaysRelevant 的Actor由基类放入常驻节点。
+	Super::RouteAddNetworkActorToNodes(ActorInfo, GlobalInfo);
+}
+
+void UMultiplayerGame_DemoReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	if (ActorInfo.Actor->IsA<AMultiplayerGame_DemoCharacter>())
+	{
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		return;
+	}
+
+	Super::RouteRemoveNetworkActorToNodes(ActorInfo);
+}
+
+void UMultiplayerGame_DemoReplicationGraph::SetConnectionUpdateFrequency(UNetConnection* Connection, AActor* Actor, float Frequency)
+{
+	if (UNetReplicationGraphConnection* ConnectionManager = FindOrAddConnectionManager(Connection))
+	{
+		FConnectionReplicationActorInfo& ActorInfo = ConnectionManager->ActorInfoMap.FindOrAdd(Actor);
+		ActorInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(Frequency);
+	}
+}
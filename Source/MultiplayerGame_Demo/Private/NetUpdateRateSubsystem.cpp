@@ -0,0 +1,375 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NetUpdateRateSubsystem.h"
+#include "MultiplayerGame_Demo.h"
+#include "MultiplayerGame_DemoCharacter.h"
+#include "MultiplayerGame_DemoReplicationGraph.h"
+#include "ThirdPersonMPProjectile.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogNetUpdateRate, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Net Update Rate"), STAT_NetUpdateRate, STATGROUP_MultiplayerGame);
+
+static TAutoConsoleVariable<int32> CVarAdaptiveUpdateRate(
+	TEXT("mp.Net.AdaptiveUpdateRate"),
+	1,
+	TEXT("1: adapt character/projectile net update rates per connection by distance, view and recent changes. 0: use class defaults."),
+	ECVF_Default);
+
+UNetUpdateRateSubsystem::UNetUpdateRateSubsystem()
+{
+	UpdateInterval = 0.25f;
+	NearDistance = 1500.0f;
+	FarDistance = 10000.0f;
+	ViewHalfAngleDegrees = 60.0f;
+	RecentChangeSeconds = 2.0f;
+	IdleSecondsBeforeDormant = 5.0f;
+	TimeUntilUpdate = 0.0f;
+
+	FNetUpdateRateClassBudget CharacterBudget;
+	CharacterBudget.ActorClass = AMultiplayerGame_DemoCharacter::StaticClass();
+	CharacterBudget.MinRate = 5.0f;
+	CharacterBudget.MaxRate = 60.0f;
+	CharacterBudget.EstimatedBytesPerUpdate = 48.0f;
+	ClassBudgets.Add(CharacterBudget);
+
+	FNetUpdateRateClassBudget ProjectileBudget;
+	ProjectileBudget.ActorClass = AThirdPersonMPProjectile::StaticClass();
+	ProjectileBudget.MinRate = 2.0f;
+	ProjectileBudget.MaxRate = 20.0f;
+	ProjectileBudget.EstimatedBytesPerUpdate = 24.0f;
+	ClassBudgets.Add(ProjectileBudget);
+}
+
+bool UNetUpdateRateSubsystem::IsEnabled()
+{
+	return CVarAdaptiveUpdateRate.GetValueOnGameThread() != 0;
+}
+
+bool UNetUpdateRateSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UNetUpdateRateSubsystem::Deinitialize()
+{
+	ActorStates.Reset();
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UNetUpdateRateSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UNetUpdateRateSubsystem::IsTickable() const
+{
+	const UWorld* World = GetWorld();
+	return World && World->GetNetDriver() && World->GetNetMode() != NM_Client;
+}
+
+TStatId UNetUpdateRateSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UNetUpdateRateSubsystem, STATGROUP_Tickables);
+}
+
+void UNetUpdateRateSubsystem::NotifyActorChanged(AActor* Actor)
+{
+	if (!Actor)
+	{
+		return;
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	FActorRateState& State = ActorStates.FindOrAdd(Actor);
+	State.LastChangeTime = Now;
+	State.LastActiveTime = Now;
+
+	// 由本子系统置为休眠的Actor立即唤醒，变化才能及时发送出去。
+	if (State.bMadeDormant)
+	{
+		State.bMadeDormant = false;
+		Actor->SetNetDormancy(DORM_Awake);
+	}
+}
+
+void UNetUpdateRateSubsystem::Tick(float DeltaTime)
+{
+	TimeUntilUpdate -= DeltaTime;
+	if (TimeUntilUpdate <= 0.0f)
+	{
+		TimeUntilUpdate = UpdateInterval;
+		UpdateRates();
+	}
+
+	if (BandwidthReportSeconds > 0.0f)
+	{
+		TickBandwidthReport(DeltaTime);
+	}
+}
+
+float UNetUpdateRateSubsystem::ComputeRate(const FNetUpdateRateClassBudget& Budget, const AActor* Actor, const FVector& ViewLocation, const FVector& ViewDirection, bool bRecentlyChanged, bool bIdle) const
+{
+	if (bRecentlyChanged)
+	{
+		return Budget.MaxRate;
+	}
+
+	const FVector ToActor = Actor->GetActorLocation() - ViewLocation;
+	const float Distance = ToActor.Size();
+
+	// 近处为1，远处为0。
+	float Alpha = 1.0f - FMath::Clamp((Distance - NearDistance) / FMath::Max(FarDistance - NearDistance, 1.0f), 0.0f, 1.0f);
+
+	const bool bInView = Distance <= NearDistance || FVector::DotProduct(ToActor / Distance, ViewDirection) >= FMath::Cos(FMath::DegreesToRadians(ViewHalfAngleDegrees));
+	if (!bInView)
+	{
+		Alpha *= 0.5f;
+	}
+
+	if (bIdle)
+	{
+		Alpha *= 0.25f;
+	}
+
+	return FMath::Lerp(Budget.MinRate, Budget.MaxRate, Alpha);
+}
+
+void UNetUpdateRateSubsystem::UpdateRates()
+{
+	SCOPE_CYCLE_COUNTER(STAT_NetUpdateRate);
+
+	UWorld* World = GetWorld();
+	UNetDriver* NetDriver = World->GetNetDriver();
+	UMultiplayerGame_DemoReplicationGraph* ReplicationGraph = NetDriver->GetReplicationDriver<UMultiplayerGame_DemoReplicationGraph>();
+	const bool bActive = IsEnabled() && !bBandwidthReportBaseline;
+	const float Now = World->GetTimeSeconds();
+
+	// 关闭期间什么都不做：关闭后的第一次更新已经恢复了默认频率并唤醒了休眠的Actor。
+	if (!bActive && !bAdaptiveRatesApplied)
+	{
+		return;
+	}
+
+	// 收集每个远程连接的视点。
+	ViewPoints.Reset();
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		UNetConnection* Connection = PlayerController ? PlayerController->GetNetConnection() : nullptr;
+		if (Connection && !PlayerController->IsLocalController())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewPoints.Add({ Connection, ViewLocation, ViewRotation.Vector() });
+		}
+	}
+
+	for (const FNetUpdateRateClassBudget& Budget : ClassBudgets)
+	{
+		UClass* ActorClass = Budget.ActorClass.Get();
+		if (!ActorClass)
+		{
+			continue;
+		}
+
+		ClassActors.Reset();
+		ActorRecentlyChanged.Reset();
+		ActorIdle.Reset();
+		for (TActorIterator<AActor> It(World, ActorClass); It; ++It)
+		{
+			AActor* Actor = *It;
+
+			// 隐藏的Actor（例如对象池中的投射物）自己管理休眠，这里跳过。
+			if (!Actor->GetIsReplicated() || Actor->IsHidden() || Actor->IsActorBeingDestroyed())
+			{
+				continue;
+			}
+
+			// 重新开启后的第一次更新：关闭期间没有记录活动时间，从现在重新计时，避免Actor立即进入休眠。
+			FActorRateState& State = ActorStates.FindOrAdd(Actor);
+			if (!bAdaptiveRatesApplied || !Actor->GetVelocity().IsNearlyZero(1.0f))
+			{
+				State.LastActiveTime = Now;
+			}
+
+			const bool bIdle = Now - State.LastActiveTime > IdleSecondsBeforeDormant;
+			UpdateDormancy(Actor, State, bActive && bIdle);
+
+			ClassActors.Add(Actor);
+			ActorRecentlyChanged.Add(Now - State.LastChangeTime < RecentChangeSeconds);
+			ActorIdle.Add(bIdle);
+		}
+
+		if (!bActive)
+		{
+			RestoreDefaultRates(ReplicationGraph);
+			continue;
+		}
+
+		// 按连接计算频率，超出预算时等比例降低。没有复制图时只能设置Actor自身的频率，取所有连接中的最大值。
+		ActorMaxRates.Init(Budget.MinRate, ClassActors.Num());
+		for (const FViewPoint& ViewPoint : ViewPoints)
+		{
+			ConnectionRates.Reset();
+			float TotalBytesPerSecond = 0.0f;
+			for (int32 Index = 0; Index < ClassActors.Num(); ++Index)
+			{
+				const float Rate = ComputeRate(Budget, ClassActors[Index], ViewPoint.Location, ViewPoint.Direction, ActorRecentlyChanged[Index], ActorIdle[Index]);
+				ConnectionRates.Add(Rate);
+				TotalBytesPerSecond += Rate * Budget.EstimatedBytesPerUpdate;
+			}
+
+			const float BudgetScale = (Budget.BytesPerSecondBudget > 0.0f && TotalBytesPerSecond > Budget.BytesPerSecondBudget)
+				? Budget.BytesPerSecondBudget / TotalBytesPerSecond : 1.0f;
+
+			for (int32 Index = 0; Index < ClassActors.Num(); ++Index)
+			{
+				const float Rate = FMath::Max(ConnectionRates[Index] * BudgetScale, Budget.MinRate);
+				if (ReplicationGraph)
+				{
+					ReplicationGraph->SetConnectionUpdateFrequency(ViewPoint.Connection, ClassActors[Index], Rate);
+				}
+				ActorMaxRates[Index] = FMath::Max(ActorMaxRates[Index], Rate);
+			}
+		}
+
+		for (int32 Index = 0; Index < ClassActors.Num(); ++Index)
+		{
+			ClassActors[Index]->NetUpdateFrequency = ActorMaxRates[Index];
+			ClassActors[Index]->MinNetUpdateFrequency = Budget.MinRate;
+		}
+	}
+
+	bAdaptiveRatesApplied = bActive;
+
+	// 清理已销毁Actor的记录。
+	for (auto It = ActorStates.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UNetUpdateRateSubsystem::UpdateDormancy(AActor* Actor, FActorRateState& State, bool bShouldBeDormant)
+{
+	// 只让无人控制的Pawn休眠：玩家控制的角色还要接收移动校正RPC，保持唤醒。
+	const APawn* Pawn = Cast<APawn>(Actor);
+	if (!Pawn || Pawn->GetController())
+	{
+		bShouldBeDormant = false;
+	}
+
+	if (bShouldBeDormant && !State.bMadeDormant && Actor->NetDormancy == DORM_Awake)
+	{
+		State.bMadeDormant = true;
+		Actor->SetNetDormancy(DORM_DormantAll);
+	}
+	else if (!bShouldBeDormant && State.bMadeDormant)
+	{
+		State.bMadeDormant = false;
+		Actor->SetNetDormancy(DORM_Awake);
+	}
+}
+
+void UNetUpdateRateSubsystem::RestoreDefaultRates(UMultiplayerGame_DemoReplicationGraph* ReplicationGraph)
+{
+	for (AActor* Actor : ClassActors)
+	{
+		const AActor* ActorCDO = Actor->GetClass()->GetDefaultObject<AActor>();
+		Actor->NetUpdateFrequency = ActorCDO->NetUpdateFrequency;
+		Actor->MinNetUpdateFrequency = ActorCDO->MinNetUpdateFrequency;
+
+		if (ReplicationGraph)
+		{
+			for (const FViewPoint& ViewPoint : ViewPoints)
+			{
+				ReplicationGraph->SetConnectionUpdateFrequency(ViewPoint.Connection, Actor, ActorCDO->NetUpdateFrequency);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// 带宽基准：mp.Net.BandwidthReport [每阶段秒数=10]
+// 先关闭自适应频率采样一段时间，再开启采样同样的时间，输出每个连接的平均发送字节/秒。
+// 可与多个 -nullrhi 客户端或机器人一起在无头服务器上运行。
+
+void UNetUpdateRateSubsystem::StartBandwidthReport(float SecondsPerPhase)
+{
+	BandwidthReportSeconds = FMath::Max(SecondsPerPhase, 1.0f);
+	bBandwidthReportBaseline = true;
+	BandwidthReportTimeLeft = BandwidthReportSeconds;
+	TimeUntilUpdate = 0.0f;
+	BaselineSamples.Reset();
+	AdaptiveSamples.Reset();
+
+	UE_LOG(LogNetUpdateRate, Display, TEXT("Bandwidth report: sampling %.0fs with class default rates, then %.0fs with adaptive rates"), BandwidthReportSeconds, BandwidthReportSeconds);
+}
+
+void UNetUpdateRateSubsystem::TickBandwidthReport(float DeltaTime)
+{
+	TMap<UNetConnection*, FBandwidthSample>& Samples = bBandwidthReportBaseline ? BaselineSamples : AdaptiveSamples;
+	for (UNetConnection* Connection : GetWorld()->GetNetDriver()->ClientConnections)
+	{
+		FBandwidthSample& Sample = Samples.FindOrAdd(Connection);
+		Sample.BytesPerSecondSum += Connection->OutBytesPerSecond;
+		Sample.NumSamples++;
+	}
+
+	BandwidthReportTimeLeft -= DeltaTime;
+	if (BandwidthReportTimeLeft > 0.0f)
+	{
+		return;
+	}
+
+	if (bBandwidthReportBaseline)
+	{
+		bBandwidthReportBaseline = false;
+		BandwidthReportTimeLeft = BandwidthReportSeconds;
+		TimeUntilUpdate = 0.0f;
+		return;
+	}
+
+	BandwidthReportSeconds = 0.0f;
+
+	double BaselineTotal = 0.0;
+	double AdaptiveTotal = 0.0;
+	UE_LOG(LogNetUpdateRate, Display, TEXT("Bandwidth report (bytes/sec per connection):"));
+	for (const TPair<UNetConnection*, FBandwidthSample>& Pair : AdaptiveSamples)
+	{
+		const FBandwidthSample* Baseline = BaselineSamples.Find(Pair.Key);
+		const double BaselineRate = Baseline ? Baseline->GetAverage() : 0.0;
+		const double AdaptiveRate = Pair.Value.GetAverage();
+		BaselineTotal += BaselineRate;
+		AdaptiveTotal += AdaptiveRate;
+		UE_LOG(LogNetUpdateRate, Display, TEXT("  %s: before %.0f, after %.0f"), *GetNameSafe(Pair.Key), BaselineRate, AdaptiveRate);
+	}
+
+	const int32 NumConnections = FMath::Max(AdaptiveSamples.Num(), 1);
+	UE_LOG(LogNetUpdateRate, Display, TEXT("  Average over %d connections: before %.0f, after %.0f"), AdaptiveSamples.Num(), BaselineTotal / NumConnections, AdaptiveTotal / NumConnections);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GBandwidthReportCommand(
+	TEXT("mp.Net.BandwidthReport"),
+	TEXT("Samples bytes/sec per connection with class default net update rates, then with adaptive rates, and logs both. Usage: mp.Net.BandwidthReport [SecondsPerPhase=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UNetUpdateRateSubsystem* NetUpdateRate = World ? World->GetSubsystem<UNetUpdateRateSubsystem>() : nullptr;
+		if (NetUpdateRate && World->GetNetDriver() && World->GetNetMode() != NM_Client)
+		{
+			NetUpdateRate->StartBandwidthReport(Args.Num() > 0 ? FCString::Atof(*Args[0]) : 10.0f);
+		}
+	}));
@@ -0,0 +1,260 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectilePoolSubsystem.h"
+#include "ThirdPersonMPProjectile.h"
+#include "TickAggregationSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogProjectilePool, Log, All);
+
+static TAutoConsoleVariable<float> CVarPooledProjectileMaxFlightTime(
+	TEXT("mp.ProjectilePool.MaxFlightTime"),
+	10.0f,
+	TEXT("Seconds a pooled projectile may fly without hitting anything before it is returned to the pool. 0 disables the limit."),
+	ECVF_Default);
+
+// 飞行时间检查不需要逐帧精确，按固定间隔批量处理。
+static const FName FlightTimeGroupName(TEXT("ProjectilePool.FlightTime"));
+static const float FlightTimeCheckInterval = 0.25f;
+
+// 打印当前世界的投射物对象池计数器。
+static FAutoConsoleCommandWithWorld GProjectilePoolStatsCommand(
+	TEXT("mp.ProjectilePool.Stats"),
+	TEXT("Prints projectile pool hit/miss and high-water-mark counters for the current world."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UProjectilePoolSubsystem* ProjectilePool = World ? World->GetSubsystem<UProjectilePoolSubsystem>() : nullptr)
+		{
+			ProjectilePool->LogStats();
+		}
+	}));
+
+bool UProjectilePoolSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UProjectilePoolSubsystem::Deinitialize()
+{
+	// 关卡卸载时投射物随世界一起销毁，这里只清理引用。
+	Buckets.Reset();
+	Stats = FProjectilePoolStats();
+
+	Super::Deinitialize();
+}
+
+void UProjectilePoolSubsystem::Prewarm(TSubclassOf<AThirdPersonMPProjectile> ProjectileClass, int32 Count)
+{
+	UWorld* World = GetWorld();
+	if (!ProjectileClass || !World || World->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(ProjectileClass);
+	Bucket.AllProjectiles.Reserve(Count);
+	Bucket.FreeProjectiles.Reserve(Count);
+
+	while (Bucket.AllProjectiles.Num() < Count)
+	{
+		if (!SpawnPooledProjectile(ProjectileClass, Bucket))
+		{
+			break;
+		}
+	}
+
+	UE_LOG(LogProjectilePool, Log, TEXT("Prewarmed %d x %s"), Bucket.AllProjectiles.Num(), *ProjectileClass->GetName());
+}
+
+AThirdPersonMPProjectile* UProjectilePoolSubsystem::AcquireProjectile(TSubclassOf<AThirdPersonMPProjectile> ProjectileClass, const FVector& Location, const FRotator& Rotation, AActor* Owner, APawn* Instigator)
+{
+	if (!ProjectileClass)
+	{
+		return nullptr;
+	}
+
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(ProjectileClass);
+
+	// 跳过已被外部销毁（例如关卡流送卸载）的投射物。
+	AThirdPersonMPProjectile* Projectile = nullptr;
+	while (!Projectile && Bucket.FreeProjectiles.Num() > 0)
+	{
+		Projectile = Bucket.FreeProjectiles.Pop(false);
+		if (!IsValid(Projectile))
+		{
+			Bucket.AllProjectiles.RemoveSwap(Projectile);
+			Stats.TotalCount--;
+			Projectile = nullptr;
+		}
+	}
+
+	if (Projectile)
+	{
+		Stats.Hits++;
+	}
+	else
+	{
+		Stats.Misses++;
+		Projectile = SpawnPooledProjectile(ProjectileClass, Bucket);
+		if (!Projectile)
+		{
+			return nullptr;
+		}
+		// 新生成的投射物直接使用，不经过空闲列表。
+		Bucket.FreeProjectiles.Pop(false);
+	}
+
+	Projectile->SetOwner(Owner);
+	Projectile->SetInstigator(Instigator);
+	Projectile->ActivateFromPool(Location, Rotation);
+
+	// 没有撞到任何东西的投射物不会触发回收，由飞行时间分组在超时后回收，避免池无限增长。
+	if (UTickAggregationSubsystem* TickAggregation = GetWorld()->GetSubsystem<UTickAggregationSubsystem>())
+	{
+		TickAggregation->RegisterGroup(FlightTimeGroupName, &UProjectilePoolSubsystem::TickFlightTimes, FlightTimeCheckInterval);
+		TickAggregation->AddObject(FlightTimeGroupName, Projectile);
+	}
+
+	Stats.ActiveCount++;
+	Stats.HighWaterMark = FMath::Max(Stats.HighWaterMark, Stats.ActiveCount);
+
+	return Projectile;
+}
+
+void UProjectilePoolSubsystem::ReleaseProjectile(AThirdPersonMPProjectile* Projectile, bool bPlayEffect)
+{
+	if (!IsValid(Projectile) || !Projectile->IsPoolActive())
+	{
+		return;
+	}
+
+	StopFlightTimer(Projectile);
+	Projectile->DeactivateToPool(bPlayEffect);
+	Projectile->SetInstigator(nullptr);
+
+	FProjectilePoolBucket& Bucket = Buckets.FindOrAdd(Projectile->GetClass());
+	Bucket.FreeProjectiles.Push(Projectile);
+
+	Stats.ActiveCount--;
+}
+
+int32 UProjectilePoolSubsystem::ReleaseAllProjectiles()
+{
+	int32 NumReleased = 0;
+	for (TPair<UClass*, FProjectilePoolBucket>& Pair : Buckets)
+	{
+		FProjectilePoolBucket& Bucket = Pair.Value;
+		for (AThirdPersonMPProjectile* Projectile : Bucket.AllProjectiles)
+		{
+			if (!IsValid(Projectile) || !Projectile->IsPoolActive())
+			{
+				continue;
+			}
+
+			StopFlightTimer(Projectile);
+			Projectile->DeactivateToPool(false);
+			Projectile->SetInstigator(nullptr);
+			Bucket.FreeProjectiles.Push(Projectile);
+			++NumReleased;
+		}
+	}
+
+	Stats.ActiveCount -= NumReleased;
+	return NumReleased;
+}
+
+void UProjectilePoolSubsystem::RemoveProjectile(AThirdPersonMPProjectile* Projectile)
+{
+	FProjectilePoolBucket* Bucket = Projectile ? Buckets.Find(Projectile->GetClass()) : nullptr;
+	if (!Bucket || Bucket->AllProjectiles.RemoveSwap(Projectile) == 0)
+	{
+		return;
+	}
+
+	Bucket->FreeProjectiles.RemoveSwap(Projectile);
+	Stats.TotalCount--;
+
+	if (Projectile->IsPoolActive())
+	{
+		StopFlightTimer(Projectile);
+		Stats.ActiveCount--;
+	}
+}
+
+void UProjectilePoolSubsystem::TickFlightTimes(TArrayView<UObject* const> Projectiles, float DeltaTime)
+{
+	const float MaxFlightTime = CVarPooledProjectileMaxFlightTime.GetValueOnGameThread();
+	if (MaxFlightTime <= 0.0f)
+	{
+		return;
+	}
+
+	for (UObject* Object : Projectiles)
+	{
+		AThirdPersonMPProjectile* Projectile = CastChecked<AThirdPersonMPProjectile>(Object);
+		UWorld* World = Projectile->GetWorld();
+		if (World->GetTimeSeconds() - Projectile->GetPoolLaunchTime() < MaxFlightTime)
+		{
+			continue;
+		}
+
+		// 回收时会把投射物移出分组，批量函数执行期间可以安全调用。
+		if (UProjectilePoolSubsystem* ProjectilePool = World->GetSubsystem<UProjectilePoolSubsystem>())
+		{
+			ProjectilePool->ReleaseProjectile(Projectile, false);
+		}
+	}
+}
+
+void UProjectilePoolSubsystem::StopFlightTimer(AThirdPersonMPProjectile* Projectile)
+{
+	if (UTickAggregationSubsystem* TickAggregation = GetWorld()->GetSubsystem<UTickAggregationSubsystem>())
+	{
+		TickAggregation->RemoveObject(FlightTimeGroupName, Projectile);
+	}
+}
+
+void UProjectilePoolSubsystem::ResetStats()
+{
+	Stats.Hits = 0;
+	Stats.Misses = 0;
+	Stats.HighWaterMark = Stats.ActiveCount;
+}
+
+void UProjectilePoolSubsystem::LogStats() const
+{
+	UE_LOG(LogProjectilePool, Log, TEXT("Projectile pool: Hits=%d Misses=%d HighWaterMark=%d Active=%d Total=%d"),
+		Stats.Hits, Stats.Misses, Stats.HighWaterMark, Stats.ActiveCount, Stats.TotalCount);
+
+	for (const TPair<UClass*, FProjectilePoolBucket>& Pair : Buckets)
+	{
+		UE_LOG(LogProjectilePool, Log, TEXT("  %s: %d total, %d free"),
+			*GetNameSafe(Pair.Key), Pair.Value.AllProjectiles.Num(), Pair.Value.FreeProjectiles.Num());
+	}
+}
+
+AThirdPersonMPProjectile* UProjectilePoolSubsystem::SpawnPooledProjectile(UClass* ProjectileClass, FProjectilePoolBucket& Bucket)
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AThirdPersonMPProjectile* Projectile = GetWorld()->SpawnActor<AThirdPersonMPProjectile>(ProjectileClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParameters);
+	if (!Projectile)
+	{
+		return nullptr;
+	}
+
+	// 生成后立即进入回收状态，在第一次复制之前就处于休眠，客户端不会为空闲投射物打开通道。
+	Projectile->MarkAsPooled();
+	Projectile->DeactivateToPool(false);
+
+	Bucket.AllProjectiles.Add(Projectile);
+	Bucket.FreeProjectiles.Add(Projectile);
+	Stats.TotalCount++;
+
+	return Projectile;
+}
@@ -0,0 +1,546 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileSimulationSubsystem.h"
+#include "ThirdPersonMPProjectile.h"
+#include "ImpactEffectSubsystem.h"
+#include "GameplayEventChannel.h"
+#include "MultiplayerGame_DemoGameState.h"
+#include "SplashDamageSubsystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SphereComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "MultiplayerGame_Demo.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StaticMesh.h"
+#include "Particles/ParticleSystem.h"
+#include "HAL/IConsoleManager.h"
+#include "GameFramework/GameStateBase.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogFirePrediction, Log, All);
+
+static TAutoConsoleVariable<int32> CVarLightweightProjectiles(
+	TEXT("mp.Projectile.Lightweight"),
+	0,
+	TEXT("1: simulate projectiles in the server-side struct-of-arrays buffer and send clients compact fire events.\n")
+	TEXT("0: spawn one replicated AThirdPersonMPProjectile per shot."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarLightweightProjectileLifetime(
+	TEXT("mp.Projectile.LightweightMaxLifetime"),
+	10.0f,
+	TEXT("Seconds a lightweight projectile may fly without hitting anything before it is removed."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarFirePredict(
+	TEXT("mp.Fire.Predict"),
+	1,
+	TEXT("1: the firing client shows a predicted projectile on the frame it fires and merges it with the server's projectile when confirmed.\n")
+	TEXT("0: the firing client waits for the server's projectile."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFirePredictionCorrectionTime(
+	TEXT("mp.Fire.PredictionCorrectionTime"),
+	0.1f,
+	TEXT("Time constant, in seconds, over which a predicted projectile's visual position blends onto the server's trajectory."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFirePredictionTimeout(
+	TEXT("mp.Fire.PredictionTimeout"),
+	1.0f,
+	TEXT("Seconds a predicted projectile waits for the server's confirmation before it is treated as rejected and removed."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld GFirePredictionStatsCommand(
+	TEXT("mp.Fire.PredictionStats"),
+	TEXT("Prints predicted / confirmed / rejected / expired shot counts and correction distances for the current world."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const UProjectileSimulationSubsystem* ProjectileSimulation = World ? World->GetSubsystem<UProjectileSimulationSubsystem>() : nullptr)
+		{
+			ProjectileSimulation->LogPredictionStats();
+		}
+	}));
+
+//////////////////////////////////////////////////////////////////////////
+// FProjectileSimBuffer
+
+int32 FProjectileSimBuffer::Add(const FVector& Position, const FVector& Velocity, APawn* Instigator, float Damage, float Lifetime, const AThirdPersonMPProjectile* Archetype, uint64 PredictionKey)
+{
+	Positions.Add(Position);
+	Velocities.Add(Velocity);
+	Instigators.Add(Instigator);
+	Damages.Add(Damage);
+	Lifetimes.Add(Lifetime);
+	Ages.Add(0.0f);
+	PredictionKeys.Add(PredictionKey);
+	PredictionStates.Add(PredictionKey != 0 ? EProjectilePrediction::Pending : EProjectilePrediction::None);
+	VisualOffsets.Add(FVector::ZeroVector);
+	return Archetypes.Add(Archetype);
+}
+
+void FProjectileSimBuffer::RemoveAtSwap(int32 Index)
+{
+	Positions.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	Instigators.RemoveAtSwap(Index, 1, false);
+	Damages.RemoveAtSwap(Index, 1, false);
+	Lifetimes.RemoveAtSwap(Index, 1, false);
+	Archetypes.RemoveAtSwap(Index, 1, false);
+	Ages.RemoveAtSwap(Index, 1, false);
+	PredictionKeys.RemoveAtSwap(Index, 1, false);
+	PredictionStates.RemoveAtSwap(Index, 1, false);
+	VisualOffsets.RemoveAtSwap(Index, 1, false);
+}
+
+void FProjectileSimBuffer::Reset()
+{
+	Positions.Reset();
+	Velocities.Reset();
+	Instigators.Reset();
+	Damages.Reset();
+	Lifetimes.Reset();
+	Archetypes.Reset();
+	Ages.Reset();
+	PredictionKeys.Reset();
+	PredictionStates.Reset();
+	VisualOffsets.Reset();
+}
+
+int32 FProjectileSimBuffer::FindPendingPrediction(uint64 PredictionKey) const
+{
+	for (int32 Index = 0; Index < PredictionKeys.Num(); ++Index)
+	{
+		if (PredictionKeys[Index] == PredictionKey && PredictionStates[Index] == EProjectilePrediction::Pending)
+		{
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
+
+float FProjectileSimBuffer::Reconcile(int32 Index, const FVector& Origin, const FVector& LaunchVelocity, float Elapsed, float GravityZ)
+{
+	const FVector Gravity(0.0f, 0.0f, GravityZ);
+	const float FlightTime = FMath::Max(Elapsed, 0.0f);
+	const FVector NewPosition = Origin + LaunchVelocity * FlightTime + 0.5f * Gravity * FlightTime * FlightTime;
+
+	// 绘制位置保持不变，之后由 DecayVisualOffsets 逐渐拉到权威弹道上。
+	const FVector Correction = Positions[Index] - NewPosition;
+	VisualOffsets[Index] += Correction;
+	Positions[Index] = NewPosition;
+	Velocities[Index] = LaunchVelocity + Gravity * FlightTime;
+	PredictionStates[Index] = EProjectilePrediction::Confirmed;
+	return Correction.Size();
+}
+
+void FProjectileSimBuffer::DecayVisualOffsets(float DeltaTime, float CorrectionTime)
+{
+	const float Remaining = CorrectionTime > 0.0f ? FMath::Exp(-DeltaTime / CorrectionTime) : 0.0f;
+	for (FVector& Offset : VisualOffsets)
+	{
+		Offset = Offset.SizeSquared() > 0.01f ? Offset * Remaining : FVector::ZeroVector;
+	}
+}
+
+int32 FProjectileSimBuffer::RemoveExpiredPredictions(float Timeout)
+{
+	int32 NumRemoved = 0;
+	for (int32 Index = Num() - 1; Index >= 0; --Index)
+	{
+		if (PredictionStates[Index] == EProjectilePrediction::Pending && Ages[Index] > Timeout)
+		{
+			RemoveAtSwap(Index);
+			++NumRemoved;
+		}
+	}
+	return NumRemoved;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UProjectileSimulationSubsystem
+
+bool UProjectileSimulationSubsystem::IsEnabled()
+{
+	return CVarLightweightProjectiles.GetValueOnGameThread() != 0;
+}
+
+bool UProjectileSimulationSubsystem::IsFirePredictionEnabled()
+{
+	return CVarFirePredict.GetValueOnGameThread() != 0;
+}
+
+bool UProjectileSimulationSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UProjectileSimulationSubsystem::Deinitialize()
+{
+	Projectiles.Reset();
+	BatchedActors.Reset();
+	VisualComponent = nullptr;
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UProjectileSimulationSubsystem::GetTickableTickType() const
+{
+	// 子系统的类默认对象也会注册为可Tick对象，这里将其排除。
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UProjectileSimulationSubsystem::IsTickable() const
+{
+	return Projectiles.Num() > 0 || BatchedActors.Num() > 0 || (VisualComponent && VisualComponent->GetInstanceCount() > 0);
+}
+
+TStatId UProjectileSimulationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileSimulationSubsystem, STATGROUP_Tickables);
+}
+
+void UProjectileSimulationSubsystem::FireProjectile(const AThirdPersonMPProjectile* Archetype, const FVector& Location, const FRotator& Rotation, APawn* Instigator)
+{
+	check(Archetype);
+
+	const FVector Velocity = Rotation.Vector() * Archetype->ProjectileMovementComponent->InitialSpeed;
+	Projectiles.Add(Location, Velocity, Instigator, Archetype->Damage, CVarLightweightProjectileLifetime.GetValueOnGameThread(), Archetype);
+}
+
+void UProjectileSimulationSubsystem::FireCosmeticProjectile(const AThirdPersonMPProjectile* Archetype, const FVector& Location, const FVector& Direction)
+{
+	check(Archetype);
+
+	const FVector Velocity = Direction.GetSafeNormal() * Archetype->ProjectileMovementComponent->InitialSpeed;
+	Projectiles.Add(Location, Velocity, nullptr, 0.0f, CVarLightweightProjectileLifetime.GetValueOnGameThread(), Archetype);
+}
+
+void UProjectileSimulationSubsystem::FirePredictedProjectile(const AThirdPersonMPProjectile* Archetype, const FVector& Location, const FVector& Direction, const AActor* Shooter, int32 PredictionId)
+{
+	check(Archetype && Shooter);
+
+	const FVector Velocity = Direction.GetSafeNormal() * Archetype->ProjectileMovementComponent->InitialSpeed;
+	Projectiles.Add(Location, Velocity, nullptr, 0.0f, CVarLightweightProjectileLifetime.GetValueOnGameThread(), Archetype, FProjectileSimBuffer::MakePredictionKey(Shooter, PredictionId));
+	PredictionStats.NumPredicted++;
+
+	// 本帧就要画出来，不等下一次Tick。
+	UpdateVisuals();
+}
+
+bool UProjectileSimulationSubsystem::ConfirmPredictedProjectile(const AActor* Shooter, int32 PredictionId, const FVector& Origin, const FVector& Direction, float ServerLaunchTime)
+{
+	const int32 Index = Projectiles.FindPendingPrediction(FProjectileSimBuffer::MakePredictionKey(Shooter, PredictionId));
+	if (Index == INDEX_NONE)
+	{
+		PredictionStats.NumUnmatchedConfirms++;
+		return false;
+	}
+
+	const UWorld* World = GetWorld();
+	const AGameStateBase* GameState = World->GetGameState();
+	const float ServerTime = GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+
+	const AThirdPersonMPProjectile* Archetype = Projectiles.Archetypes[Index];
+	const float GravityZ = World->GetGravityZ() * Archetype->ProjectileMovementComponent->ProjectileGravityScale;
+	const float ConfirmSeconds = Projectiles.Ages[Index];
+	const float Correction = Projectiles.Reconcile(Index, Origin, Direction.GetSafeNormal() * Archetype->ProjectileMovementComponent->InitialSpeed, ServerTime - ServerLaunchTime, GravityZ);
+
+	PredictionStats.NumConfirmed++;
+	PredictionStats.TotalCorrection += Correction;
+	PredictionStats.MaxCorrection = FMath::Max(PredictionStats.MaxCorrection, Correction);
+	PredictionStats.TotalConfirmSeconds += ConfirmSeconds;
+	PredictionStats.MaxConfirmSeconds = FMath::Max(PredictionStats.MaxConfirmSeconds, ConfirmSeconds);
+	return true;
+}
+
+bool UProjectileSimulationSubsystem::RejectPredictedProjectile(const AActor* Shooter, int32 PredictionId)
+{
+	const int32 Index = Projectiles.FindPendingPrediction(FProjectileSimBuffer::MakePredictionKey(Shooter, PredictionId));
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	Projectiles.RemoveAtSwap(Index);
+	PredictionStats.NumRejected++;
+	return true;
+}
+
+bool UProjectileSimulationSubsystem::EndPredictedProjectile(const AActor* Shooter, int32 PredictionId)
+{
+	const uint64 PredictionKey = FProjectileSimBuffer::MakePredictionKey(Shooter, PredictionId);
+	for (int32 Index = 0; Index < Projectiles.Num(); ++Index)
+	{
+		if (Projectiles.PredictionKeys[Index] == PredictionKey)
+		{
+			Projectiles.RemoveAtSwap(Index);
+			return true;
+		}
+	}
+	return false;
+}
+
+int32 UProjectileSimulationSubsystem::ClearProjectiles()
+{
+	const int32 NumCleared = Projectiles.Num();
+	Projectiles.Reset();
+	return NumCleared;
+}
+
+int32 UProjectileSimulationSubsystem::GetNumVisualInstances() const
+{
+	return VisualComponent ? VisualComponent->GetInstanceCount() : 0;
+}
+
+void UProjectileSimulationSubsystem::LogPredictionStats() const
+{
+	const int32 NumConfirmed = FMath::Max(PredictionStats.NumConfirmed, 1);
+	UE_LOG(LogFirePrediction, Log, TEXT("Fire prediction: Predicted=%d Confirmed=%d Rejected=%d Expired=%d UnmatchedConfirms=%d Correction avg=%.1fcm max=%.1fcm Confirm avg=%.0fms max=%.0fms"),
+		PredictionStats.NumPredicted, PredictionStats.NumConfirmed, PredictionStats.NumRejected, PredictionStats.NumExpired, PredictionStats.NumUnmatchedConfirms,
+		PredictionStats.TotalCorrection / NumConfirmed, PredictionStats.MaxCorrection,
+		PredictionStats.TotalConfirmSeconds * 1000.0f / NumConfirmed, PredictionStats.MaxConfirmSeconds * 1000.0f);
+}
+
+void UProjectileSimulationSubsystem::RegisterBatchedProjectile(AThirdPersonMPProjectile* Projectile)
+{
+	check(Projectile);
+
+	Projectile->ProjectileMovementComponent->SetComponentTickEnabled(false);
+	BatchedActors.AddUnique(Projectile);
+}
+
+void UProjectileSimulationSubsystem::UnregisterBatchedProjectile(AThirdPersonMPProjectile* Projectile)
+{
+	// 只在这里移除引用；正在进行的批处理使用快照，不受影响。
+	BatchedActors.RemoveSingleSwap(Projectile, false);
+}
+
+void UProjectileSimulationSubsystem::Tick(float DeltaTime)
+{
+	if (BatchedActors.Num() > 0)
+	{
+		SimulateBatchedActors(DeltaTime);
+	}
+
+	ImpactIndices.Reset();
+	ImpactHits.Reset();
+	SimulateProjectiles(DeltaTime, ImpactIndices, ImpactHits);
+
+	// 从后往前处理撞击，RemoveAtSwap 不会影响尚未处理的下标。
+	for (int32 ImpactIdx = ImpactIndices.Num() - 1; ImpactIdx >= 0; --ImpactIdx)
+	{
+		const int32 Index = ImpactIndices[ImpactIdx];
+		HandleImpact(Index, ImpactHits[ImpactIdx]);
+		Projectiles.RemoveAtSwap(Index);
+	}
+
+	// 超时的投射物直接移除，不播放特效。
+	for (int32 Index = Projectiles.Num() - 1; Index >= 0; --Index)
+	{
+		if (Projectiles.Lifetimes[Index] <= 0.0f)
+		{
+			Projectiles.RemoveAtSwap(Index);
+		}
+	}
+
+	// 开火预测：一直没有等到确认的视为被服务器拒绝，已合并的逐渐消除视觉偏移。
+	PredictionStats.NumExpired += Projectiles.RemoveExpiredPredictions(CVarFirePredictionTimeout.GetValueOnGameThread());
+	Projectiles.DecayVisualOffsets(DeltaTime, CVarFirePredictionCorrectionTime.GetValueOnGameThread());
+
+	UpdateVisuals();
+}
+
+void UProjectileSimulationSubsystem::SimulateProjectiles(float DeltaTime, TArray<int32>& OutImpactIndices, TArray<FHitResult>& OutImpactHits)
+{
+	if (Projectiles.Num() == 0)
+	{
+		return;
+	}
+
+	const float GravityZ = GetWorld()->GetGravityZ();
+
+	SweepBatch.Reset();
+	for (int32 Index = 0; Index < Projectiles.Num(); ++Index)
+	{
+		const AThirdPersonMPProjectile* Archetype = Projectiles.Archetypes[Index];
+		FVector& Velocity = Projectiles.Velocities[Index];
+
+		// 与 UProjectileMovementComponent 相同，重力按 ProjectileGravityScale 缩放（默认为0）。
+		Velocity.Z += GravityZ * Archetype->ProjectileMovementComponent->ProjectileGravityScale * DeltaTime;
+		Projectiles.Lifetimes[Index] -= DeltaTime;
+		Projectiles.Ages[Index] += DeltaTime;
+
+		const FVector& Position = Projectiles.Positions[Index];
+		SweepBatch.Add(Position, Position + Velocity * DeltaTime, Archetype->SphereComponent->GetUnscaledSphereRadius(),
+			Archetype->SphereComponent->GetCollisionProfileName(), nullptr);
+	}
+
+	SweepBatch.Execute(GetWorld(), FProjectileSweepBatch::IsParallelEnabled());
+
+	for (int32 Index = 0; Index < SweepBatch.Num(); ++Index)
+	{
+		if (SweepBatch.bBlockingHits[Index])
+		{
+			Projectiles.Positions[Index] = SweepBatch.Hits[Index].Location;
+			OutImpactIndices.Add(Index);
+			OutImpactHits.Add(SweepBatch.Hits[Index]);
+		}
+		else
+		{
+			Projectiles.Positions[Index] = SweepBatch.Ends[Index];
+		}
+	}
+}
+
+void UProjectileSimulationSubsystem::SimulateBatchedActors(float DeltaTime)
+{
+	// 撞击处理会回收或销毁投射物并修改 BatchedActors，所以先取快照。
+	BatchedActorSnapshot.Reset();
+	for (int32 Index = BatchedActors.Num() - 1; Index >= 0; --Index)
+	{
+		AThirdPersonMPProjectile* Projectile = BatchedActors[Index].Get();
+		if (IsValid(Projectile))
+		{
+			BatchedActorSnapshot.Add(Projectile);
+		}
+		else
+		{
+			BatchedActors.RemoveAtSwap(Index, 1, false);
+		}
+	}
+
+	SweepBatch.Reset();
+	for (AThirdPersonMPProjectile* Projectile : BatchedActorSnapshot)
+	{
+		UProjectileMovementComponent* MovementComponent = Projectile->ProjectileMovementComponent;
+		MovementComponent->Velocity.Z += MovementComponent->GetGravityZ() * DeltaTime;
+
+		const FVector Start = Projectile->GetActorLocation();
+		SweepBatch.Add(Start, Start + MovementComponent->Velocity * DeltaTime, Projectile->SphereComponent->GetScaledSphereRadius(),
+			Projectile->SphereComponent->GetCollisionProfileName(), Projectile);
+	}
+
+	SweepBatch.Execute(GetWorld(), FProjectileSweepBatch::IsParallelEnabled());
+
+	// 单线程、按固定顺序处理结果，撞击仍然走投射物原有的 OnProjectileImpact 逻辑。
+	for (int32 Index = 0; Index < BatchedActorSnapshot.Num(); ++Index)
+	{
+		AThirdPersonMPProjectile* Projectile = BatchedActorSnapshot[Index];
+		if (!IsValid(Projectile) || !Projectile->IsPoolActive())
+		{
+			continue;
+		}
+
+		const FVector& Velocity = Projectile->ProjectileMovementComponent->Velocity;
+		const FRotator Rotation = Projectile->ProjectileMovementComponent->bRotationFollowsVelocity ? Velocity.Rotation() : Projectile->GetActorRotation();
+
+		if (SweepBatch.bBlockingHits[Index])
+		{
+			const FHitResult& Hit = SweepBatch.Hits[Index];
+			Projectile->SetActorLocationAndRotation(Hit.Location, Rotation);
+			Projectile->OnProjectileImpact(Projectile->SphereComponent, Hit.GetActor(), Hit.GetComponent(), FVector::ZeroVector, Hit);
+		}
+		else
+		{
+			Projectile->SetActorLocationAndRotation(SweepBatch.Ends[Index], Rotation);
+		}
+	}
+}
+
+void UProjectileSimulationSubsystem::HandleImpact(int32 Index, const FHitResult& Hit)
+{
+	UWorld* World = GetWorld();
+	const AThirdPersonMPProjectile* Archetype = Projectiles.Archetypes[Index];
+
+	// 与 AThirdPersonMPProjectile::OnProjectileImpact 相同：对撞击到的Actor造成点伤害。
+	APawn* Instigator = Projectiles.Instigators[Index].Get();
+	if (World->GetNetMode() != NM_Client)
+	{
+		if (Hit.GetActor() && Instigator)
+		{
+			UGameplayStatics::ApplyPointDamage(Hit.GetActor(), Projectiles.Damages[Index], Projectiles.Velocities[Index].GetSafeNormal(), Hit, Instigator->Controller, Instigator, Archetype->DamageType);
+		}
+		FGameplayEventChannel::Get().Push(EGameplayEventType::Impact, Hit.GetActor(), Instigator, Projectiles.Damages[Index], 0.0f, Hit.ImpactPoint);
+
+		if (AMultiplayerGame_DemoGameState* MatchGameState = World->GetGameState<AMultiplayerGame_DemoGameState>())
+		{
+			MatchGameState->RecordHit(Instigator, Hit.GetActor());
+		}
+
+		if (USplashDamageSubsystem* SplashDamage = World->GetSubsystem<USplashDamageSubsystem>())
+		{
+			SplashDamage->QueueProjectileExplosion(Archetype, Hit.ImpactPoint, Hit.GetActor(), Instigator ? Instigator->Controller : nullptr, Instigator);
+		}
+	}
+
+	if (UImpactEffectSubsystem* ImpactEffects = World->GetSubsystem<UImpactEffectSubsystem>())
+	{
+		ImpactEffects->QueueImpact(Archetype->ExplosionEffect.Get(), Projectiles.Positions[Index]);
+	}
+}
+
+void UProjectileSimulationSubsystem::UpdateVisuals()
+{
+	UWorld* World = GetWorld();
+	if (World->GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	if (!VisualComponent)
+	{
+		if (Projectiles.Num() == 0)
+		{
+			return;
+		}
+
+		// 所有投射物共用同一个网格体，用第一发投射物的类默认对象来创建实例化网格体。
+		// 网格体是软引用，通常已由 UAssetPreloadSubsystem 预加载；否则先异步请求，加载完成后的下一帧再创建。
+		const TSoftObjectPtr<UStaticMesh>& ArchetypeMesh = Projectiles.Archetypes[0]->MeshAsset;
+		if (!ArchetypeMesh.Get())
+		{
+			if (!ArchetypeMesh.IsNull())
+			{
+				UAssetManager::GetStreamableManager().RequestAsyncLoad(ArchetypeMesh.ToSoftObjectPath());
+			}
+			return;
+		}
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		AActor* VisualActor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+		VisualComponent = NewObject<UInstancedStaticMeshComponent>(VisualActor, TEXT("LightweightProjectiles"));
+		VisualComponent->SetStaticMesh(ArchetypeMesh.Get());
+		VisualComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		VisualComponent->SetCastShadow(false);
+		VisualActor->SetRootComponent(VisualComponent);
+		VisualComponent->RegisterComponent();
+	}
+
+	InstanceTransforms.Reset(Projectiles.Num());
+	for (int32 Index = 0; Index < Projectiles.Num(); ++Index)
+	{
+		const FTransform MeshOffset = Projectiles.Archetypes[Index]->StaticMesh->GetRelativeTransform();
+		const FTransform ProjectileTransform(Projectiles.Velocities[Index].Rotation(), Projectiles.Positions[Index] + Projectiles.VisualOffsets[Index]);
+		InstanceTransforms.Add(MeshOffset * ProjectileTransform);
+	}
+
+	while (VisualComponent->GetInstanceCount() > InstanceTransforms.Num())
+	{
+		VisualComponent->RemoveInstance(VisualComponent->GetInstanceCount() - 1);
+	}
+	while (VisualComponent->GetInstanceCount() < InstanceTransforms.Num())
+	{
+		VisualComponent->AddInstance(FTransform::Identity);
+	}
+
+	if (InstanceTransforms.Num() > 0)
+	{
+		VisualComponent->BatchUpdateInstancesTransforms(0, InstanceTransforms, true, true, true);
+	}
+}
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileSweepBatch.h"
+#include "MultiplayerGame_Demo.h"
+#include "Engine/World.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Sweep Batch"), STAT_ProjectileSweepBatch, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Sweeps"), STAT_ProjectileSweeps, STATGROUP_MultiplayerGame);
+
+static TAutoConsoleVariable<int32> CVarBatchedProjectileSweeps(
+	TEXT("mp.Projectile.BatchedSweeps"),
+	0,
+	TEXT("1: gather the movement sweeps of all active projectiles and run them in parallel on worker threads.\n")
+	TEXT("0: every projectile sweeps on the game thread."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarBatchedProjectileSweepMinBatch(
+	TEXT("mp.Projectile.BatchedSweepsMinBatch"),
+	16,
+	TEXT("Smallest number of sweeps worth dispatching to worker threads; smaller batches run on the game thread."),
+	ECVF_Default);
+
+bool FProjectileSweepBatch::IsParallelEnabled()
+{
+	return CVarBatchedProjectileSweeps.GetValueOnGameThread() != 0;
+}
+
+int32 FProjectileSweepBatch::Add(const FVector& Start, const FVector& End, float Radius, FName CollisionProfile, const AActor* IgnoredActor)
+{
+	Starts.Add(Start);
+	Ends.Add(End);
+	Radii.Add(Radius);
+	CollisionProfiles.Add(CollisionProfile);
+	return IgnoredActors.Add(IgnoredActor);
+}
+
+void FProjectileSweepBatch::Reset()
+{
+	Starts.Reset();
+	Ends.Reset();
+	Radii.Reset();
+	CollisionProfiles.Reset();
+	IgnoredActors.Reset();
+	Hits.Reset();
+	bBlockingHits.Reset();
+}
+
+void FProjectileSweepBatch::Execute(const UWorld* World, bool bParallel)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileSweepBatch);
+	INC_DWORD_STAT_BY(STAT_ProjectileSweeps, Num());
+
+	Hits.SetNum(Num(), false);
+	bBlockingHits.SetNum(Num(), false);
+
+	// 每条请求只读取自己的输入、写入自己的结果，场景查询本身支持多线程并发读取。
+	const bool bForceSingleThread = !bParallel || Num() < CVarBatchedProjectileSweepMinBatch.GetValueOnGameThread();
+	ParallelFor(Num(), [this, World](int32 Index)
+	{
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ProjectileSweepBatch), false, IgnoredActors[Index]);
+		const FVector Move = Ends[Index] - Starts[Index];
+
+		// 与 UPrimitiveComponent::MoveComponent 一致：起点就已重叠、且正在离开的物体不算撞击
+		// （例如朝下开火时投射物生成在射手的胶囊体内），忽略它后重新扫掠，找到其后真正的撞击。
+		for (int32 Attempt = 0; Attempt <= MaxStartPenetratingRetries; ++Attempt)
+		{
+			bBlockingHits[Index] = World->SweepSingleByProfile(Hits[Index], Starts[Index], Ends[Index], FQuat::Identity,
+				CollisionProfiles[Index], FCollisionShape::MakeSphere(Radii[Index]), QueryParams);
+
+			const FHitResult& Hit = Hits[Index];
+			if (!bBlockingHits[Index] || !Hit.bStartPenetrating || (Move | Hit.ImpactNormal) <= 0.0f || !Hit.GetComponent())
+			{
+				break;
+			}
+
+			QueryParams.AddIgnoredComponent(Hit.GetComponent());
+			bBlockingHits[Index] = false;
+			Hits[Index] = FHitResult();
+		}
+	}, bForceSingleThread);
+}
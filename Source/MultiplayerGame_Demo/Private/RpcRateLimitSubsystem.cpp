@@ -0,0 +1,317 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RpcRateLimitSubsystem.h"
+#include "MultiplayerGame_Demo.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogRpcRateLimit, Log, All);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("RPC Calls Allowed"), STAT_RpcCallsAllowed, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("RPC Calls Dropped"), STAT_RpcCallsDropped, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("RPC Connections Throttled"), STAT_RpcConnectionsThrottled, STATGROUP_MultiplayerGame);
+
+static TAutoConsoleVariable<int32> CVarRpcLimitEnable(
+	TEXT("mp.RpcLimit.Enable"),
+	1,
+	TEXT("1: drop client RPCs that exceed their gameplay rate on the server. 0: accept every call."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRpcLimitTolerance(
+	TEXT("mp.RpcLimit.Tolerance"),
+	1.25f,
+	TEXT("Sustained rate allowed per connection, as a multiple of the gameplay rate (e.g. 1 / FireRate)."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRpcLimitBurst(
+	TEXT("mp.RpcLimit.Burst"),
+	3.0f,
+	TEXT("Calls a connection may send back to back before the sustained rate applies. Absorbs network jitter."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld GRpcLimitStatsCommand(
+	TEXT("mp.RpcLimit.Stats"),
+	TEXT("Prints allowed / dropped / throttled RPC counts and the connections with the most dropped calls."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const URpcRateLimitSubsystem* RateLimit = World ? World->GetSubsystem<URpcRateLimitSubsystem>() : nullptr)
+		{
+			RateLimit->LogStats();
+		}
+	}));
+
+namespace RpcRateLimit
+{
+	static const TCHAR* GetTypeName(ERpcRateLimit Type)
+	{
+		switch (Type)
+		{
+		case ERpcRateLimit::Fire: return TEXT("Fire");
+		default: return TEXT("Unknown");
+		}
+	}
+
+	static void ResetEntry(FRpcRateLimitEntry& Entry)
+	{
+		Entry = FRpcRateLimitEntry();
+		FMemory::Memzero(Entry.Drops);
+		FMemory::Memzero(Entry.Throttles);
+	}
+}
+
+FRpcRateLimitTable::FRpcRateLimitTable()
+{
+	Reset();
+}
+
+void FRpcRateLimitTable::Reset()
+{
+	for (FRpcRateLimitEntry& Entry : Entries)
+	{
+		RpcRateLimit::ResetEntry(Entry);
+	}
+	RpcRateLimit::ResetEntry(OverflowEntry);
+	NumConnections = 0;
+}
+
+uint32 FRpcRateLimitTable::HashConnection(const UNetConnection* Connection)
+{
+	// 对象地址的低位因对齐而恒定，先打散再取模。
+	return PointerHash(Connection);
+}
+
+int32 FRpcRateLimitTable::FindSlot(const UNetConnection* Connection) const
+{
+	const uint32 Start = HashConnection(Connection) % Capacity;
+	for (int32 Probe = 0; Probe < Capacity; ++Probe)
+	{
+		const int32 Slot = (Start + Probe) % Capacity;
+		const FRpcRateLimitEntry& Entry = Entries[Slot];
+		if (Entry.Connection == Connection)
+		{
+			return Slot;
+		}
+		if (Entry.Connection == nullptr && !Entry.bRemoved)
+		{
+			break;
+		}
+	}
+	return INDEX_NONE;
+}
+
+FRpcRateLimitEntry& FRpcRateLimitTable::FindOrAddEntry(const UNetConnection* Connection, float Now, float BurstSize)
+{
+	const uint32 Start = HashConnection(Connection) % Capacity;
+	int32 FreeSlot = INDEX_NONE;
+	for (int32 Probe = 0; Probe < Capacity; ++Probe)
+	{
+		const int32 Slot = (Start + Probe) % Capacity;
+		FRpcRateLimitEntry& Entry = Entries[Slot];
+		if (Entry.Connection == Connection)
+		{
+			return Entry;
+		}
+		if (Entry.Connection == nullptr)
+		{
+			if (FreeSlot == INDEX_NONE)
+			{
+				FreeSlot = Slot;
+			}
+			if (!Entry.bRemoved)
+			{
+				break;
+			}
+		}
+	}
+
+	if (FreeSlot == INDEX_NONE)
+	{
+		// 表已满：多出的连接共用溢出槽位。
+		if (OverflowEntry.Connection == nullptr)
+		{
+			OverflowEntry.Connection = Connection;
+			for (FRpcTokenBucket& Bucket : OverflowEntry.Buckets)
+			{
+				Bucket.Tokens = BurstSize;
+				Bucket.LastRefillTime = Now;
+			}
+		}
+		return OverflowEntry;
+	}
+
+	// 新连接从满桶开始。
+	FRpcRateLimitEntry& Entry = Entries[FreeSlot];
+	RpcRateLimit::ResetEntry(Entry);
+	Entry.Connection = Connection;
+	for (FRpcTokenBucket& Bucket : Entry.Buckets)
+	{
+		Bucket.Tokens = BurstSize;
+		Bucket.LastRefillTime = Now;
+	}
+	++NumConnections;
+	return Entry;
+}
+
+bool FRpcRateLimitTable::TryConsume(const UNetConnection* Connection, ERpcRateLimit Type, float Now, float TokensPerSecond, float BurstSize)
+{
+	FRpcRateLimitEntry& Entry = FindOrAddEntry(Connection, Now, BurstSize);
+	FRpcTokenBucket& Bucket = Entry.Buckets[(int32)Type];
+
+	Bucket.Refill(Now, TokensPerSecond, BurstSize);
+
+	if (Bucket.Tokens >= 1.0f)
+	{
+		Bucket.Tokens -= 1.0f;
+		Bucket.bThrottled = false;
+		return true;
+	}
+
+	++Entry.Drops[(int32)Type];
+	if (!Bucket.bThrottled)
+	{
+		Bucket.bThrottled = true;
+		++Entry.Throttles[(int32)Type];
+	}
+	return false;
+}
+
+void FRpcRateLimitTable::RemoveConnection(const UNetConnection* Connection)
+{
+	const int32 Slot = FindSlot(Connection);
+	if (Slot != INDEX_NONE)
+	{
+		RpcRateLimit::ResetEntry(Entries[Slot]);
+		Entries[Slot].bRemoved = true;
+		--NumConnections;
+	}
+	else if (OverflowEntry.Connection == Connection)
+	{
+		// 溢出槽位被多个连接共用，只换掉用于显示的键，计数保留。
+		OverflowEntry.Connection = nullptr;
+	}
+}
+
+const FRpcRateLimitEntry* FRpcRateLimitTable::Find(const UNetConnection* Connection) const
+{
+	const int32 Slot = FindSlot(Connection);
+	if (Slot != INDEX_NONE)
+	{
+		return &Entries[Slot];
+	}
+	return OverflowEntry.Connection == Connection ? &OverflowEntry : nullptr;
+}
+
+void FRpcRateLimitTable::ForEachEntry(TFunctionRef<void(const FRpcRateLimitEntry&)> Visitor) const
+{
+	for (const FRpcRateLimitEntry& Entry : Entries)
+	{
+		if (Entry.Connection)
+		{
+			Visitor(Entry);
+		}
+	}
+	if (OverflowEntry.Connection)
+	{
+		Visitor(OverflowEntry);
+	}
+}
+
+bool URpcRateLimitSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void URpcRateLimitSubsystem::Deinitialize()
+{
+	Table.Reset();
+
+	Super::Deinitialize();
+}
+
+bool URpcRateLimitSubsystem::AllowCall(const UNetConnection* Connection, ERpcRateLimit Type, float IntervalSeconds)
+{
+	if (Connection == nullptr || IntervalSeconds <= 0.0f || CVarRpcLimitEnable.GetValueOnGameThread() == 0)
+	{
+		return true;
+	}
+
+	const float TokensPerSecond = CVarRpcLimitTolerance.GetValueOnGameThread() / IntervalSeconds;
+	const float BurstSize = FMath::Max(1.0f, CVarRpcLimitBurst.GetValueOnGameThread());
+
+	const FRpcRateLimitEntry* Entry = Table.Find(Connection);
+	const bool bWasThrottled = Entry && Entry->Buckets[(int32)Type].bThrottled;
+
+	if (Table.TryConsume(Connection, Type, GetWorld()->GetTimeSeconds(), TokensPerSecond, BurstSize))
+	{
+		++NumAllowed[(int32)Type];
+		INC_DWORD_STAT(STAT_RpcCallsAllowed);
+		return true;
+	}
+
+	++NumDropped[(int32)Type];
+	INC_DWORD_STAT(STAT_RpcCallsDropped);
+	if (!bWasThrottled)
+	{
+		INC_DWORD_STAT(STAT_RpcConnectionsThrottled);
+		UE_LOG(LogRpcRateLimit, Verbose, TEXT("Throttling %s calls from %s"), RpcRateLimit::GetTypeName(Type), *GetNameSafe(Connection));
+	}
+	return false;
+}
+
+void URpcRateLimitSubsystem::RemoveConnection(const UNetConnection* Connection)
+{
+	if (Connection)
+	{
+		Table.RemoveConnection(Connection);
+	}
+}
+
+void URpcRateLimitSubsystem::LogStats() const
+{
+	for (int32 TypeIndex = 0; TypeIndex < (int32)ERpcRateLimit::Count; ++TypeIndex)
+	{
+		const uint64 Total = NumAllowed[TypeIndex] + NumDropped[TypeIndex];
+		UE_LOG(LogRpcRateLimit, Log, TEXT("RPC limit %s: Allowed=%llu Dropped=%llu (%.1f%%)"),
+			RpcRateLimit::GetTypeName((ERpcRateLimit)TypeIndex), NumAllowed[TypeIndex], NumDropped[TypeIndex],
+			Total > 0 ? 100.0 * NumDropped[TypeIndex] / Total : 0.0);
+	}
+
+	// 按丢弃次数列出前几个连接。只在命令中排序，限流路径上不做任何分配。
+	struct FOffender
+	{
+		const FRpcRateLimitEntry* Entry;
+		uint32 Drops;
+	};
+	TArray<FOffender, TInlineAllocator<8>> Offenders;
+	Table.ForEachEntry([&Offenders](const FRpcRateLimitEntry& Entry)
+	{
+		uint32 Drops = 0;
+		for (uint32 TypeDrops : Entry.Drops)
+		{
+			Drops += TypeDrops;
+		}
+		if (Drops > 0)
+		{
+			Offenders.Add({ &Entry, Drops });
+		}
+	});
+	Offenders.Sort([](const FOffender& A, const FOffender& B) { return A.Drops > B.Drops; });
+
+	UE_LOG(LogRpcRateLimit, Log, TEXT("RPC limit: %d connections tracked, %d with dropped calls"), Table.GetNumConnections(), Offenders.Num());
+	for (int32 Index = 0; Index < FMath::Min(Offenders.Num(), 8); ++Index)
+	{
+		const FRpcRateLimitEntry& Entry = *Offenders[Index].Entry;
+		for (int32 TypeIndex = 0; TypeIndex < (int32)ERpcRateLimit::Count; ++TypeIndex)
+		{
+			if (Entry.Drops[TypeIndex] > 0)
+			{
+				UE_LOG(LogRpcRateLimit, Log, TEXT("  %s %s: Dropped=%u Throttled=%u"),
+					*GetNameSafe(Entry.Connection), RpcRateLimit::GetTypeName((ERpcRateLimit)TypeIndex),
+					Entry.Drops[TypeIndex], Entry.Throttles[TypeIndex]);
+			}
+		}
+	}
+}
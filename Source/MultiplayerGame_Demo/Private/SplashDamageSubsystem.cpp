@@ -0,0 +1,466 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SplashDamageSubsystem.h"
+#include "MultiplayerGame_Demo.h"
+#include "MultiplayerGame_DemoCharacter.h"
+#include "ThirdPersonMPProjectile.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSplashDamage, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Splash Damage Grid Update"), STAT_SplashDamageGridUpdate, STATGROUP_MultiplayerGame);
+DECLARE_CYCLE_STAT(TEXT("Splash Damage Query"), STAT_SplashDamageQuery, STATGROUP_MultiplayerGame);
+DECLARE_CYCLE_STAT(TEXT("Splash Damage Apply"), STAT_SplashDamageApply, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Splash Explosions"), STAT_SplashExplosions, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Splash Targets"), STAT_SplashTargets, STATGROUP_MultiplayerGame);
+
+static TAutoConsoleVariable<int32> CVarSplashBatched(
+	TEXT("mp.Splash.Batched"),
+	1,
+	TEXT("1: resolve all explosions of a frame as one batch against the character grid.\n")
+	TEXT("0: one physics overlap query per explosion."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld GSplashStatsCommand(
+	TEXT("mp.Splash.Stats"),
+	TEXT("Prints splash damage counters for the current world."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (const USplashDamageSubsystem* SplashDamage = World ? World->GetSubsystem<USplashDamageSubsystem>() : nullptr)
+		{
+			SplashDamage->LogStats();
+		}
+	}));
+
+// 格子边长。略大于常用的爆炸半径，一次爆炸通常只需要检查 2x2 到 3x3 个格子。
+static const float SplashDamageCellSize = 500.0f;
+
+//////////////////////////////////////////////////////////////////////////
+// FSplashDamageGrid
+
+FSplashDamageGrid::FSplashDamageGrid()
+{
+	Init(SplashDamageCellSize);
+}
+
+void FSplashDamageGrid::Init(float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.0f);
+	InvCellSize = 1.0f / CellSize;
+	MaxSlotRadius = 0.0f;
+	NumCellMoves = 0;
+
+	SlotX.Reset();
+	SlotY.Reset();
+	SlotZ.Reset();
+	SlotRadii.Reset();
+	SlotHalfAxes.Reset();
+	SlotCells.Reset();
+	SlotIndicesInCell.Reset();
+	SlotsInCell.Empty();
+	SlotsInUse.Empty();
+	Cells.Reset();
+}
+
+int32 FSplashDamageGrid::AllocateSlot()
+{
+	int32 Slot = SlotsInUse.Find(false);
+	if (Slot == INDEX_NONE)
+	{
+		Slot = SlotCells.Num();
+		SlotX.Add(0.0f);
+		SlotY.Add(0.0f);
+		SlotZ.Add(0.0f);
+		SlotRadii.Add(0.0f);
+		SlotHalfAxes.Add(0.0f);
+		SlotCells.Add(0);
+		SlotIndicesInCell.Add(INDEX_NONE);
+		SlotsInCell.Add(false);
+		SlotsInUse.Add(false);
+	}
+
+	SlotsInUse[Slot] = true;
+	return Slot;
+}
+
+void FSplashDamageGrid::FreeSlot(int32 Slot)
+{
+	if (SlotsInUse.IsValidIndex(Slot))
+	{
+		RemoveFromCell(Slot);
+		SlotsInUse[Slot] = false;
+	}
+}
+
+uint64 FSplashDamageGrid::GetCellKey(float X, float Y) const
+{
+	return MakeCellKey(FMath::FloorToInt(X * InvCellSize), FMath::FloorToInt(Y * InvCellSize));
+}
+
+void FSplashDamageGrid::UpdateSlot(int32 Slot, const FVector& Location, float Radius, float HalfHeight)
+{
+	check(SlotsInUse.IsValidIndex(Slot) && SlotsInUse[Slot]);
+
+	SlotX[Slot] = Location.X;
+	SlotY[Slot] = Location.Y;
+	SlotZ[Slot] = Location.Z;
+	SlotRadii[Slot] = Radius;
+	SlotHalfAxes[Slot] = FMath::Max(HalfHeight - Radius, 0.0f);
+	MaxSlotRadius = FMath::Max(MaxSlotRadius, Radius);
+
+	// 大多数帧里角色仍在原来的格子中，只更新坐标。
+	const uint64 CellKey = GetCellKey(Location.X, Location.Y);
+	if (SlotsInCell[Slot] && SlotCells[Slot] == CellKey)
+	{
+		return;
+	}
+
+	RemoveFromCell(Slot);
+	TArray<int32>& Members = Cells.FindOrAdd(CellKey);
+	SlotIndicesInCell[Slot] = Members.Add(Slot);
+	SlotCells[Slot] = CellKey;
+	SlotsInCell[Slot] = true;
+	++NumCellMoves;
+}
+
+void FSplashDamageGrid::ClearSlot(int32 Slot)
+{
+	if (SlotsInUse.IsValidIndex(Slot))
+	{
+		RemoveFromCell(Slot);
+	}
+}
+
+void FSplashDamageGrid::RemoveFromCell(int32 Slot)
+{
+	if (!SlotsInCell[Slot])
+	{
+		return;
+	}
+
+	TArray<int32>& Members = Cells.FindChecked(SlotCells[Slot]);
+	const int32 IndexInCell = SlotIndicesInCell[Slot];
+	Members.RemoveAtSwap(IndexInCell, 1, false);
+	if (Members.IsValidIndex(IndexInCell))
+	{
+		SlotIndicesInCell[Members[IndexInCell]] = IndexInCell;
+	}
+	if (Members.Num() == 0)
+	{
+		Cells.Remove(SlotCells[Slot]);
+	}
+
+	SlotIndicesInCell[Slot] = INDEX_NONE;
+	SlotsInCell[Slot] = false;
+}
+
+void FSplashDamageGrid::QueryBatch(TArrayView<const FSplashDamageQuery> Queries, TArray<FSplashDamageOverlap>& OutOverlaps)
+{
+	for (int32 QueryIndex = 0; QueryIndex < Queries.Num(); ++QueryIndex)
+	{
+		const FSplashDamageQuery& Query = Queries[QueryIndex];
+
+		// 收集覆盖范围内所有格子中的槽位。每个槽位只属于一个格子，不会重复。
+		const float Reach = Query.Radius + MaxSlotRadius;
+		const int32 MinCellX = FMath::FloorToInt((Query.Origin.X - Reach) * InvCellSize);
+		const int32 MaxCellX = FMath::FloorToInt((Query.Origin.X + Reach) * InvCellSize);
+		const int32 MinCellY = FMath::FloorToInt((Query.Origin.Y - Reach) * InvCellSize);
+		const int32 MaxCellY = FMath::FloorToInt((Query.Origin.Y + Reach) * InvCellSize);
+
+		CandidateSlots.Reset();
+		for (int32 CellX = MinCellX; CellX <= MaxCellX; ++CellX)
+		{
+			for (int32 CellY = MinCellY; CellY <= MaxCellY; ++CellY)
+			{
+				if (const TArray<int32>* Members = Cells.Find(MakeCellKey(CellX, CellY)))
+				{
+					CandidateSlots.Append(*Members);
+				}
+			}
+		}
+
+		const int32 NumCandidates = CandidateSlots.Num();
+		if (NumCandidates == 0)
+		{
+			continue;
+		}
+
+		// 把候选的坐标拷贝成连续的数组，补齐到4的倍数。补齐的部分 Reach 为负，一定不会命中。
+		const int32 NumPadded = Align(NumCandidates, 4);
+		CandidateX.SetNumUninitialized(NumPadded, false);
+		CandidateY.SetNumUninitialized(NumPadded, false);
+		CandidateZ.SetNumUninitialized(NumPadded, false);
+		CandidateHalfAxes.SetNumUninitialized(NumPadded, false);
+		CandidateReach.SetNumUninitialized(NumPadded, false);
+		for (int32 Index = 0; Index < NumCandidates; ++Index)
+		{
+			const int32 Slot = CandidateSlots[Index];
+			CandidateX[Index] = SlotX[Slot];
+			CandidateY[Index] = SlotY[Slot];
+			CandidateZ[Index] = SlotZ[Slot];
+			CandidateHalfAxes[Index] = SlotHalfAxes[Slot];
+			CandidateReach[Index] = Slot != Query.IgnoredSlot ? FMath::Square(Query.Radius + SlotRadii[Slot]) : -1.0f;
+		}
+		for (int32 Index = NumCandidates; Index < NumPadded; ++Index)
+		{
+			CandidateX[Index] = CandidateY[Index] = CandidateZ[Index] = CandidateHalfAxes[Index] = 0.0f;
+			CandidateReach[Index] = -1.0f;
+		}
+
+		// 球心到胶囊体轴线（竖直线段）的距离：竖直方向先减去轴线半长。
+		const VectorRegister OriginX = VectorSetFloat1(Query.Origin.X);
+		const VectorRegister OriginY = VectorSetFloat1(Query.Origin.Y);
+		const VectorRegister OriginZ = VectorSetFloat1(Query.Origin.Z);
+		for (int32 Index = 0; Index < NumPadded; Index += 4)
+		{
+			const VectorRegister DeltaX = VectorSubtract(VectorLoad(&CandidateX[Index]), OriginX);
+			const VectorRegister DeltaY = VectorSubtract(VectorLoad(&CandidateY[Index]), OriginY);
+			const VectorRegister DeltaZ = VectorMax(VectorSubtract(VectorAbs(VectorSubtract(VectorLoad(&CandidateZ[Index]), OriginZ)), VectorLoad(&CandidateHalfAxes[Index])), VectorZero());
+			const VectorRegister DistSquared = VectorMultiplyAdd(DeltaZ, DeltaZ, VectorMultiplyAdd(DeltaY, DeltaY, VectorMultiply(DeltaX, DeltaX)));
+
+			uint32 HitMask = (uint32)VectorMaskBits(VectorCompareGE(VectorLoad(&CandidateReach[Index]), DistSquared));
+			while (HitMask)
+			{
+				const int32 Candidate = Index + (int32)FMath::CountTrailingZeros(HitMask);
+				HitMask &= HitMask - 1;
+
+				const int32 Slot = CandidateSlots[Candidate];
+				const float AxisDeltaZ = FMath::Max(FMath::Abs(CandidateZ[Candidate] - Query.Origin.Z) - CandidateHalfAxes[Candidate], 0.0f);
+				const float AxisDistance = FMath::Sqrt(FMath::Square(CandidateX[Candidate] - Query.Origin.X) + FMath::Square(CandidateY[Candidate] - Query.Origin.Y) + FMath::Square(AxisDeltaZ));
+				OutOverlaps.Add({ QueryIndex, Slot, FMath::Max(AxisDistance - SlotRadii[Slot], 0.0f) });
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// USplashDamageSubsystem
+
+USplashDamageSubsystem::USplashDamageSubsystem()
+{
+}
+
+bool USplashDamageSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void USplashDamageSubsystem::Deinitialize()
+{
+	SlotCharacters.Reset();
+	PendingExplosions.Reset();
+	Grid.Init(SplashDamageCellSize);
+
+	Super::Deinitialize();
+}
+
+ETickableTickType USplashDamageSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool USplashDamageSubsystem::IsTickable() const
+{
+	return PendingExplosions.Num() > 0;
+}
+
+TStatId USplashDamageSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USplashDamageSubsystem, STATGROUP_Tickables);
+}
+
+void USplashDamageSubsystem::RegisterCharacter(AMultiplayerGame_DemoCharacter* Character)
+{
+	if (!Character || SlotCharacters.Contains(Character))
+	{
+		return;
+	}
+
+	const int32 Slot = Grid.AllocateSlot();
+	if (SlotCharacters.Num() <= Slot)
+	{
+		SlotCharacters.SetNum(Slot + 1);
+	}
+	SlotCharacters[Slot] = Character;
+}
+
+void USplashDamageSubsystem::UnregisterCharacter(AMultiplayerGame_DemoCharacter* Character)
+{
+	const int32 Slot = SlotCharacters.IndexOfByKey(Character);
+	if (Slot != INDEX_NONE)
+	{
+		SlotCharacters[Slot] = nullptr;
+		Grid.FreeSlot(Slot);
+	}
+}
+
+void USplashDamageSubsystem::QueueProjectileExplosion(const AThirdPersonMPProjectile* Archetype, const FVector& Origin, AActor* DirectHitActor, AController* InstigatorController, AActor* DamageCauser)
+{
+	if (Archetype && Archetype->SplashDamage.OuterRadius > 0.0f)
+	{
+		QueueExplosion(Origin, Archetype->SplashDamage, Archetype->DamageType, DirectHitActor, InstigatorController, DamageCauser);
+	}
+}
+
+void USplashDamageSubsystem::QueueExplosion(const FVector& Origin, const FRadialDamageParams& Params, TSubclassOf<UDamageType> DamageType, AActor* IgnoredActor, AController* InstigatorController, AActor* DamageCauser)
+{
+	FPendingExplosion& Explosion = PendingExplosions.AddDefaulted_GetRef();
+	Explosion.Origin = Origin;
+	Explosion.Params = Params;
+	Explosion.DamageType = DamageType;
+	Explosion.IgnoredActor = IgnoredActor;
+	Explosion.InstigatorController = InstigatorController;
+	Explosion.DamageCauser = DamageCauser;
+}
+
+void USplashDamageSubsystem::Tick(float DeltaTime)
+{
+	// 可Tick对象在所有Actor移动与投射物撞击之后更新，本帧内的爆炸在这里一起结算。
+	Swap(ExplosionsToResolve, PendingExplosions);
+	PendingExplosions.Reset();
+
+	Targets.Reset();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SplashDamageQuery);
+		if (CVarSplashBatched.GetValueOnGameThread() != 0)
+		{
+			UpdateGrid();
+			CollectTargetsBatched(ExplosionsToResolve, Targets);
+		}
+		else
+		{
+			CollectTargetsWithOverlaps(ExplosionsToResolve, Targets);
+		}
+	}
+
+	ApplyDamage(ExplosionsToResolve, Targets);
+
+	INC_DWORD_STAT_BY(STAT_SplashExplosions, ExplosionsToResolve.Num());
+	INC_DWORD_STAT_BY(STAT_SplashTargets, Targets.Num());
+	Stats.NumExplosions += ExplosionsToResolve.Num();
+	Stats.NumBatches++;
+	ExplosionsToResolve.Reset();
+}
+
+void USplashDamageSubsystem::UpdateGrid()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SplashDamageGridUpdate);
+
+	// 没有爆炸的帧不需要网格，只在结算前更新；角色没有跨越格子时只写入坐标。
+	for (int32 Slot = 0; Slot < SlotCharacters.Num(); ++Slot)
+	{
+		const AMultiplayerGame_DemoCharacter* Character = SlotCharacters[Slot].Get();
+		if (Character && !Character->IsActorBeingDestroyed() && !Character->IsDead())
+		{
+			const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+			float Radius, HalfHeight;
+			Capsule->GetScaledCapsuleSize(Radius, HalfHeight);
+			Grid.UpdateSlot(Slot, Capsule->GetComponentLocation(), Radius, HalfHeight);
+		}
+		else if (Character)
+		{
+			Grid.ClearSlot(Slot);
+		}
+	}
+}
+
+void USplashDamageSubsystem::CollectTargetsBatched(TArrayView<const FPendingExplosion> Explosions, TArray<FSplashDamageTarget>& OutTargets)
+{
+	Queries.Reset(Explosions.Num());
+	for (const FPendingExplosion& Explosion : Explosions)
+	{
+		const AMultiplayerGame_DemoCharacter* IgnoredCharacter = Cast<AMultiplayerGame_DemoCharacter>(Explosion.IgnoredActor.Get());
+		Queries.Add({ Explosion.Origin, Explosion.Params.OuterRadius, IgnoredCharacter ? SlotCharacters.IndexOfByKey(IgnoredCharacter) : INDEX_NONE });
+	}
+
+	Overlaps.Reset();
+	Grid.QueryBatch(Queries, Overlaps);
+
+	for (const FSplashDamageOverlap& Overlap : Overlaps)
+	{
+		if (AMultiplayerGame_DemoCharacter* Character = SlotCharacters[Overlap.Slot].Get())
+		{
+			OutTargets.Add({ Overlap.Query, Character, Overlap.Distance });
+		}
+	}
+}
+
+void USplashDamageSubsystem::CollectTargetsWithOverlaps(TArrayView<const FPendingExplosion> Explosions, TArray<FSplashDamageTarget>& OutTargets) const
+{
+	const UWorld* World = GetWorld();
+	const FCollisionObjectQueryParams ObjectQueryParams(ECC_Pawn);
+	TArray<FOverlapResult> Results;
+
+	for (int32 ExplosionIndex = 0; ExplosionIndex < Explosions.Num(); ++ExplosionIndex)
+	{
+		const FPendingExplosion& Explosion = Explosions[ExplosionIndex];
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(SplashDamageOverlap), false, Explosion.IgnoredActor.Get());
+
+		Results.Reset();
+		World->OverlapMultiByObjectType(Results, Explosion.Origin, FQuat::Identity, ObjectQueryParams, FCollisionShape::MakeSphere(Explosion.Params.OuterRadius), QueryParams);
+
+		for (const FOverlapResult& Result : Results)
+		{
+			// 角色只以胶囊体计算，网格体等其他组件的重叠忽略。
+			AMultiplayerGame_DemoCharacter* Character = Cast<AMultiplayerGame_DemoCharacter>(Result.GetActor());
+			if (!Character || Character->IsDead() || Result.GetComponent() != Character->GetCapsuleComponent())
+			{
+				continue;
+			}
+
+			const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+			float Radius, HalfHeight;
+			Capsule->GetScaledCapsuleSize(Radius, HalfHeight);
+			const FVector Center = Capsule->GetComponentLocation();
+			const FVector AxisOffset(0.0f, 0.0f, FMath::Max(HalfHeight - Radius, 0.0f));
+			const float AxisDistance = FMath::PointDistToSegment(Explosion.Origin, Center - AxisOffset, Center + AxisOffset);
+			OutTargets.Add({ ExplosionIndex, Character, FMath::Max(AxisDistance - Radius, 0.0f) });
+		}
+	}
+}
+
+void USplashDamageSubsystem::ApplyDamage(TArrayView<const FPendingExplosion> Explosions, TArrayView<const FSplashDamageTarget> InTargets)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SplashDamageApply);
+
+	for (const FSplashDamageTarget& Target : InTargets)
+	{
+		// 同一帧中的前一次爆炸可能已经击杀了该角色。
+		if (Target.Character->IsDead())
+		{
+			continue;
+		}
+
+		const FPendingExplosion& Explosion = Explosions[Target.Explosion];
+		const float DamageScale = Explosion.Params.GetDamageScale(Target.Distance);
+		if (DamageScale <= 0.0f)
+		{
+			continue;
+		}
+
+		// 与 AActor::InternalTakeRadialDamage 相同的衰减：在 MinimumDamage 与 BaseDamage 之间插值。
+		const float Damage = FMath::Lerp(Explosion.Params.MinimumDamage, Explosion.Params.BaseDamage, DamageScale);
+
+		FRadialDamageEvent DamageEvent;
+		DamageEvent.DamageTypeClass = Explosion.DamageType;
+		DamageEvent.Params = Explosion.Params;
+		DamageEvent.Origin = Explosion.Origin;
+		Target.Character->TakeDamage(Damage, DamageEvent, Explosion.InstigatorController.Get(), Explosion.DamageCauser.Get());
+
+		Stats.NumTargetsDamaged++;
+		Stats.TotalDamage += Damage;
+	}
+}
+
+void USplashDamageSubsystem::LogStats() const
+{
+	UE_LOG(LogSplashDamage, Log, TEXT("Splash damage: Explosions=%d Batches=%d TargetsDamaged=%d TotalDamage=%.1f Characters=%d Cells=%d CellMoves=%d Mode=%s"),
+		Stats.NumExplosions, Stats.NumBatches, Stats.NumTargetsDamaged, Stats.TotalDamage,
+		SlotCharacters.Num(), Grid.GetNumCells(), Grid.GetNumCellMoves(),
+		CVarSplashBatched.GetValueOnGameThread() != 0 ? TEXT("Batched") : TEXT("Overlaps"));
+}
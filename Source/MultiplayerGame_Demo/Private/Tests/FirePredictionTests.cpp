@@ -0,0 +1,281 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileSimulationSubsystem.h"
+#include "ThirdPersonMPProjectile.h"
+#include "GameplayTestWorld.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace FirePredictionTests
+{
+	// 客户端 60 帧/秒，每 6 帧开火一次。
+	const float DeltaTime = 1.0f / 60.0f;
+	const int32 NumShots = 40;
+	const int32 FramesBetweenShots = 6;
+
+	// 模拟的往返延迟（毫秒），每个取值是一个单独的测试。
+	const int32 LatenciesMs[] = { 50, 150, 300 };
+
+	/** 服务器对一发预测开火的回复。*/
+	enum class EServerReply : uint8
+	{
+		Confirm,
+		// 确认到达后，同一个确认在下一帧再次到达
+		DuplicateConfirm,
+		// 服务器丢弃了这一发（ClientRejectPredictedFire）
+		Reject,
+		// 确认在预测超时之后才到达
+		LateConfirm,
+	};
+
+	struct FShot
+	{
+		EServerReply Reply = EServerReply::Confirm;
+		// 回复到达客户端的时刻（世界时间）
+		float ReplyTime = 0.0f;
+		bool bReplied = false;
+
+		// 服务器的权威弹道
+		FVector ServerOrigin = FVector::ZeroVector;
+		FVector ServerDirection = FVector::ForwardVector;
+		float ServerLaunchTime = 0.0f;
+
+		bool bConfirmed = false;
+		float ConfirmTime = 0.0f;
+		bool bDuplicateSent = false;
+		bool bConvergenceChecked = false;
+	};
+
+	static float GetConsoleFloat(const TCHAR* Name)
+	{
+		const IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(Name);
+		return Variable ? Variable->GetFloat() : 0.0f;
+	}
+}
+
+/**
+ * 不建立网络连接，在空的游戏世界中按模拟的往返延迟调用开火者客户端的真实入口：
+ * FirePredictedProjectile、ConfirmPredictedProjectile、RejectPredictedProjectile 和世界Tick（其中包括本子系统的 Tick）。
+ * 服务器的发射位置、方向和发射时刻带有误差；部分开火被拒绝，部分确认重复到达，部分确认在预测超时之后才到达。
+ */
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FFirePredictionSimulatedLatencyTest, "MultiplayerGame.FirePrediction.SimulatedLatency",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+void FFirePredictionSimulatedLatencyTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (const int32 LatencyMs : FirePredictionTests::LatenciesMs)
+	{
+		OutBeautifiedNames.Add(FString::Printf(TEXT("%dms"), LatencyMs));
+		OutTestCommands.Add(FString::FromInt(LatencyMs));
+	}
+}
+
+bool FFirePredictionSimulatedLatencyTest::RunTest(const FString& Parameters)
+{
+	using namespace FirePredictionTests;
+
+	const float Latency = FCString::Atoi(*Parameters) * 0.001f;
+	const float Timeout = GetConsoleFloat(TEXT("mp.Fire.PredictionTimeout"));
+	const float CorrectionTime = FMath::Max(GetConsoleFloat(TEXT("mp.Fire.PredictionCorrectionTime")), DeltaTime);
+	if (!TestTrue(TEXT("mp.Fire.PredictionTimeout is longer than the simulated round trip"), Timeout > Latency + 0.02f))
+	{
+		return false;
+	}
+
+	// 预测投射物的网格体是软引用，先加载，开火的那一帧才能画出来。
+	const AThirdPersonMPProjectile* Archetype = GetDefault<AThirdPersonMPProjectile>();
+	if (!TestNotNull(TEXT("Projectile mesh"), Archetype->MeshAsset.LoadSynchronous()))
+	{
+		return false;
+	}
+
+	UWorld* World = GameplayTestWorld::Create(TEXT("FirePredictionTest"));
+	UProjectileSimulationSubsystem* ProjectileSimulation = World->GetSubsystem<UProjectileSimulationSubsystem>();
+	AActor* Shooter = World->SpawnActor<AActor>();
+	if (!TestNotNull(TEXT("Projectile simulation subsystem"), ProjectileSimulation) || !TestNotNull(TEXT("Shooter"), Shooter))
+	{
+		GameplayTestWorld::Destroy(World);
+		return false;
+	}
+
+	const FProjectileSimBuffer& Buffer = ProjectileSimulation->GetProjectileBuffer();
+	const float Speed = Archetype->ProjectileMovementComponent->InitialSpeed;
+	const FVector Gravity(0.0f, 0.0f, World->GetGravityZ() * Archetype->ProjectileMovementComponent->ProjectileGravityScale);
+
+	const auto FindShot = [&Buffer, Shooter](int32 PredictionId)
+	{
+		return Buffer.PredictionKeys.IndexOfByKey(FProjectileSimBuffer::MakePredictionKey(Shooter, PredictionId));
+	};
+	const auto GetRendered = [&Buffer](int32 Index)
+	{
+		return Buffer.Positions[Index] + Buffer.VisualOffsets[Index];
+	};
+
+	FRandomStream Random(0x5EED);
+	TArray<FShot> Shots;
+	TMap<int32, FVector> LastRendered;
+	int32 NumReplies[4] = { 0, 0, 0, 0 };
+
+	int32 NumHiddenOnFireFrame = 0;
+	int32 NumConfirmsMissed = 0;
+	int32 NumRejectsMissed = 0;
+	int32 NumDuplicatesAccepted = 0;
+	int32 NumDuplicatesMoved = 0;
+	int32 NumLateConfirmsAccepted = 0;
+	int32 NumLateExpiries = 0;
+	int32 NumSnaps = 0;
+	int32 NumUnconverged = 0;
+	float MaxSnap = 0.0f;
+	float MaxError = 0.0f;
+
+	const int32 NumFrames = NumShots * FramesBetweenShots + FMath::CeilToInt((Timeout + Latency + CorrectionTime * 10.0f) / DeltaTime) + 2;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		const float Now = World->GetTimeSeconds();
+
+		// 客户端开火，同时决定服务器对这一发的结果。
+		if (Frame % FramesBetweenShots == 0 && Shots.Num() < NumShots)
+		{
+			const int32 PredictionId = Shots.Num();
+			FShot& Shot = Shots.AddDefaulted_GetRef();
+
+			const FVector Origin(0.0f, Random.FRandRange(-200.0f, 200.0f), 100.0f);
+			const FVector Direction = FRotator(Random.FRandRange(-5.0f, 15.0f), Random.FRandRange(-30.0f, 30.0f), 0.0f).Vector();
+
+			// 服务器上角色位置与控制朝向略有差异，发射时刻按延迟补偿估算，带有抖动。
+			Shot.ServerOrigin = Origin + Random.GetUnitVector() * Random.FRandRange(0.0f, 10.0f);
+			Shot.ServerDirection = (Direction + Random.GetUnitVector() * 0.01f).GetSafeNormal();
+			Shot.ServerLaunchTime = Now + Random.FRandRange(-0.01f, 0.03f);
+
+			const float Roll = Random.FRand();
+			Shot.Reply = Roll < 0.1f ? EServerReply::Reject : Roll < 0.2f ? EServerReply::LateConfirm : Roll < 0.3f ? EServerReply::DuplicateConfirm : EServerReply::Confirm;
+			Shot.ReplyTime = Shot.Reply == EServerReply::LateConfirm ? Now + Timeout + 0.1f : Now + Latency + Random.FRandRange(0.0f, 0.02f);
+			++NumReplies[(int32)Shot.Reply];
+
+			ProjectileSimulation->FirePredictedProjectile(Archetype, Origin, Direction, Shooter, PredictionId);
+
+			// 开火的这一帧就要画出来，不等下一次Tick。
+			const bool bVisible = FindShot(PredictionId) != INDEX_NONE && ProjectileSimulation->GetNumVisualInstances() == Buffer.Num();
+			NumHiddenOnFireFrame += bVisible ? 0 : 1;
+		}
+
+		// 到达的回复
+		for (int32 PredictionId = 0; PredictionId < Shots.Num(); ++PredictionId)
+		{
+			FShot& Shot = Shots[PredictionId];
+			if (!Shot.bReplied && Shot.ReplyTime <= Now)
+			{
+				Shot.bReplied = true;
+				if (Shot.Reply == EServerReply::Reject)
+				{
+					const int32 NumBefore = Buffer.Num();
+					const bool bRemoved = ProjectileSimulation->RejectPredictedProjectile(Shooter, PredictionId);
+					NumRejectsMissed += bRemoved && Buffer.Num() == NumBefore - 1 && FindShot(PredictionId) == INDEX_NONE ? 0 : 1;
+				}
+				else
+				{
+					const bool bMatched = ProjectileSimulation->ConfirmPredictedProjectile(Shooter, PredictionId, Shot.ServerOrigin, Shot.ServerDirection, Shot.ServerLaunchTime);
+					if (Shot.Reply == EServerReply::LateConfirm)
+					{
+						NumLateConfirmsAccepted += bMatched ? 1 : 0;
+					}
+					else
+					{
+						NumConfirmsMissed += bMatched ? 0 : 1;
+						Shot.bConfirmed = bMatched;
+						Shot.ConfirmTime = Now;
+					}
+				}
+			}
+			else if (Shot.Reply == EServerReply::DuplicateConfirm && Shot.bConfirmed && !Shot.bDuplicateSent && Shot.ConfirmTime < Now)
+			{
+				// 重复的确认带着不同的发射位置到达，必须被忽略，绘制位置不变。
+				Shot.bDuplicateSent = true;
+				const int32 Index = FindShot(PredictionId);
+				const FVector RenderedBefore = Index != INDEX_NONE ? GetRendered(Index) : FVector::ZeroVector;
+				NumDuplicatesAccepted += ProjectileSimulation->ConfirmPredictedProjectile(Shooter, PredictionId, Shot.ServerOrigin + FVector(0.0f, 0.0f, 50.0f), Shot.ServerDirection, Shot.ServerLaunchTime) ? 1 : 0;
+				NumDuplicatesMoved += Index != INDEX_NONE && GetRendered(Index).Equals(RenderedBefore) ? 0 : 1;
+			}
+		}
+
+		World->Tick(LEVELTICK_All, DeltaTime);
+		const float TickTime = World->GetTimeSeconds();
+
+		// 检查绘制位置
+		const float AllowedStep = ProjectileSimulation->GetPredictionStats().MaxCorrection * (1.0f - FMath::Exp(-DeltaTime / CorrectionTime)) + 1.0f;
+		for (int32 Index = 0; Index < Buffer.Num(); ++Index)
+		{
+			const int32 PredictionId = (int32)(uint32)Buffer.PredictionKeys[Index];
+			FShot& Shot = Shots[PredictionId];
+			const FVector Rendered = GetRendered(Index);
+
+			// 相邻两帧绘制位置之差减去弹道本身的位移即为修正带来的跳变：修正量应逐帧平滑释放，不能一次跳到位。
+			if (const FVector* Previous = LastRendered.Find(PredictionId))
+			{
+				const float Snap = ((Rendered - *Previous) - Buffer.Velocities[Index] * DeltaTime).Size();
+				MaxSnap = FMath::Max(MaxSnap, Snap);
+				NumSnaps += Snap > AllowedStep ? 1 : 0;
+			}
+			LastRendered.Add(PredictionId, Rendered);
+
+			if (Buffer.PredictionStates[Index] == EProjectilePrediction::Pending && Buffer.Ages[Index] > Timeout + DeltaTime)
+			{
+				++NumLateExpiries;
+			}
+
+			// 确认后经过足够长的时间，绘制位置应与服务器弹道一致（误差小于1厘米）。
+			// SimulateProjectiles 是半隐式欧拉积分，有重力时每秒偏离解析弹道 0.5*g*dt，这里一并计入。
+			if (Shot.bConfirmed && TickTime >= Shot.ConfirmTime + CorrectionTime * 8.0f)
+			{
+				const float FlightTime = TickTime - Shot.ServerLaunchTime;
+				const FVector Authoritative = Shot.ServerOrigin + Shot.ServerDirection * Speed * FlightTime + 0.5f * Gravity * FlightTime * FlightTime
+					+ 0.5f * Gravity * DeltaTime * (TickTime - Shot.ConfirmTime);
+				const float Error = FVector::Dist(Rendered, Authoritative);
+				MaxError = FMath::Max(MaxError, Error);
+				NumUnconverged += Error < 1.0f ? 0 : 1;
+				Shot.bConvergenceChecked = true;
+			}
+		}
+	}
+
+	const int32 NumConfirms = NumReplies[(int32)EServerReply::Confirm] + NumReplies[(int32)EServerReply::DuplicateConfirm];
+	const int32 NumRejects = NumReplies[(int32)EServerReply::Reject];
+	const int32 NumDuplicates = NumReplies[(int32)EServerReply::DuplicateConfirm];
+	const int32 NumLateConfirms = NumReplies[(int32)EServerReply::LateConfirm];
+	const int32 NumConvergenceChecked = Shots.FilterByPredicate([](const FShot& Shot) { return Shot.bConvergenceChecked; }).Num();
+	const UProjectileSimulationSubsystem::FPredictionStats& Stats = ProjectileSimulation->GetPredictionStats();
+
+	AddInfo(FString::Printf(TEXT("%.0fms RTT, %d shots: Confirmed=%d Rejected=%d Expired=%d UnmatchedConfirms=%d"),
+		Latency * 1000.0f, NumShots, Stats.NumConfirmed, Stats.NumRejected, Stats.NumExpired, Stats.NumUnmatchedConfirms));
+	AddInfo(FString::Printf(TEXT("Max correction %.1fcm, max per-frame correction step %.2fcm, max error after blending %.3fcm"),
+		Stats.MaxCorrection, MaxSnap, MaxError));
+
+	TestTrue(TEXT("The scenario covers rejects, duplicate confirms and late confirms"), NumRejects > 0 && NumDuplicates > 0 && NumLateConfirms > 0);
+	TestEqual(TEXT("Every predicted shot is drawn on the frame it is fired"), NumHiddenOnFireFrame, 0);
+	TestEqual(TEXT("Predicted shots"), Stats.NumPredicted, NumShots);
+	TestEqual(TEXT("Confirms that arrive in time merge with their prediction"), NumConfirmsMissed, 0);
+	TestEqual(TEXT("Confirmed shots"), Stats.NumConfirmed, NumConfirms);
+	TestEqual(TEXT("Rejected predictions are removed when the reject arrives"), NumRejectsMissed, 0);
+	TestEqual(TEXT("Rejected shots"), Stats.NumRejected, NumRejects);
+	TestEqual(TEXT("Duplicate confirms are ignored"), NumDuplicatesAccepted, 0);
+	TestEqual(TEXT("Duplicate confirms do not move the projectile"), NumDuplicatesMoved, 0);
+	TestEqual(TEXT("Confirms arriving after the timeout are ignored"), NumLateConfirmsAccepted, 0);
+	TestEqual(TEXT("Unmatched confirms"), Stats.NumUnmatchedConfirms, NumDuplicates + NumLateConfirms);
+	TestEqual(TEXT("Unconfirmed predictions expire"), Stats.NumExpired, NumLateConfirms);
+	TestEqual(TEXT("No prediction outlives the timeout"), NumLateExpiries, 0);
+	TestEqual(TEXT("Corrections blend in without snapping"), NumSnaps, 0);
+	TestEqual(TEXT("Confirmed shots were checked after blending"), NumConvergenceChecked, NumConfirms);
+	TestEqual(TEXT("Confirmed shots converge onto the server trajectory"), NumUnconverged, 0);
+
+	GameplayTestWorld::Destroy(World);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayTestWorld.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "UObject/UObjectGlobals.h"
+
+UWorld* GameplayTestWorld::Create(const TCHAR* Name)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, Name);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+	return World;
+}
+
+void GameplayTestWorld::Destroy(UWorld* World)
+{
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+/**
+ * 自动化测试与无头基准测试共用的临时游戏世界：不加载地图，已调用 BeginPlay，世界子系统照常创建与Tick。
+ * 不受 WITH_DEV_AUTOMATION_TESTS 限制，GameplayBenchmark 命令行工具同样使用。
+ */
+namespace GameplayTestWorld
+{
+	/** 创建一个空的游戏世界及其世界上下文。*/
+	UWorld* Create(const TCHAR* Name);
+
+	/** 销毁 Create 创建的世界并回收垃圾，使下一个世界从干净的状态开始。*/
+	void Destroy(UWorld* World);
+}
@@ -0,0 +1,172 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationSubsystem.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace LagCompensationTests
+{
+	const int32 NumCharacters = 100;
+	const int32 NumQueries = 10000;
+	const float FrameInterval = 1.0f / 30.0f;
+	const float OrbitRadius = 400.0f;
+	const float AngularSpeed = 1.5f;  // 弧度/秒，约 600cm/s 的线速度
+	const float CapsuleRadius = 42.0f;
+	const float CapsuleHalfHeight = 96.0f;
+
+	// 第 i 个角色绕各自的圆心做匀速圆周运动。
+	static FVector GetTruePosition(int32 Character, float Time)
+	{
+		const FVector Center(Character * 1000.0f, 0.0f, 0.0f);
+		const float Angle = AngularSpeed * Time + Character;
+		return Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f) * OrbitRadius;
+	}
+
+	// 以30Hz记录已知轨迹，填满整个历史。
+	static void RecordHistory(FLagCompensationHistory& History)
+	{
+		History.Init(FLagCompensationHistory::DefaultNumFrames, NumCharacters);
+		for (int32 Character = 0; Character < NumCharacters; ++Character)
+		{
+			History.AllocateSlot();
+		}
+
+		for (int32 Frame = 0; Frame < FLagCompensationHistory::DefaultNumFrames; ++Frame)
+		{
+			const float Time = Frame * FrameInterval;
+			FLagCompensationSample* Row = History.BeginFrame(Time);
+			for (int32 Character = 0; Character < NumCharacters; ++Character)
+			{
+				Row[Character].Location = GetTruePosition(Character, Time);
+				Row[Character].Radius = CapsuleRadius;
+				Row[Character].HalfHeight = CapsuleHalfHeight;
+			}
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLagCompensationRewindAccuracyTest, "MultiplayerGame.LagCompensation.RewindAccuracy",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FLagCompensationRewindAccuracyTest::RunTest(const FString& Parameters)
+{
+	using namespace LagCompensationTests;
+
+	FLagCompensationHistory History;
+	RecordHistory(History);
+
+	const float NewestTime = History.GetNewestTime();
+	const float OldestTime = History.GetOldestTime();
+	FRandomStream Random(12345);
+
+	// 插值位置与真实位置的误差不超过线性插值的理论上限：弦与弧之间的最大距离。
+	const float StepAngle = AngularSpeed * FrameInterval;
+	const float ErrorTolerance = OrbitRadius * (1.0f - FMath::Cos(0.5f * StepAngle)) + KINDA_SMALL_NUMBER;
+
+	float MaxError = 0.0f;
+	int32 NumSamples = 0;
+	for (int32 Query = 0; Query < NumQueries; ++Query)
+	{
+		const int32 Character = Random.RandHelper(NumCharacters);
+		const float Time = Random.FRandRange(OldestTime, NewestTime);
+		FLagCompensationSample Sample;
+		if (History.GetSampleAtTime(Character, Time, Sample))
+		{
+			MaxError = FMath::Max(MaxError, FVector::Dist(Sample.Location, GetTruePosition(Character, Time)));
+			++NumSamples;
+		}
+	}
+
+	AddInfo(FString::Printf(TEXT("Rewind position error: max %.3f cm (tolerance %.3f cm)"), MaxError, ErrorTolerance));
+	TestEqual(TEXT("Every rewind inside the recorded range returns a sample"), NumSamples, NumQueries);
+	TestTrue(TEXT("Rewind position error is within the chord bound"), MaxError <= ErrorTolerance);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLagCompensationRewindSweepTest, "MultiplayerGame.LagCompensation.RewindSweep",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FLagCompensationRewindSweepTest::RunTest(const FString& Parameters)
+{
+	using namespace LagCompensationTests;
+
+	FLagCompensationHistory History;
+	RecordHistory(History);
+
+	const float NewestTime = History.GetNewestTime();
+	const float OldestTime = History.GetOldestTime();
+	FRandomStream Random(54321);
+
+	// 从角色真实位置的正侧方射向其中心，回溯后必须命中同一个角色；忽略该角色时必须落空。
+	int32 CorrectHits = 0;
+	int32 IgnoredMisses = 0;
+	const double StartSeconds = FPlatformTime::Seconds();
+	for (int32 Query = 0; Query < NumQueries; ++Query)
+	{
+		const int32 Character = Random.RandHelper(NumCharacters);
+		const float Time = Random.FRandRange(OldestTime, NewestTime);
+		const FVector Target = GetTruePosition(Character, Time);
+		const FVector Start = Target - FVector(0.0f, 300.0f, 0.0f);
+		const FVector End = Target + FVector(0.0f, 300.0f, 0.0f);
+
+		float HitTime;
+		if (History.SweepAtTime(Time, Start, End, 5.0f, INDEX_NONE, HitTime) == Character)
+		{
+			++CorrectHits;
+		}
+		if (History.SweepAtTime(Time, Start, End, 5.0f, Character, HitTime) == INDEX_NONE)
+		{
+			++IgnoredMisses;
+		}
+	}
+	const double MicrosecondsPerSweep = (FPlatformTime::Seconds() - StartSeconds) * 1000000.0 / (NumQueries * 2);
+
+	AddInfo(FString::Printf(TEXT("%d characters, %d sweeps: %.3f us per rewind sweep"), NumCharacters, NumQueries * 2, MicrosecondsPerSweep));
+	TestEqual(TEXT("Rewound sweeps hit the intended character"), CorrectHits, NumQueries);
+	TestEqual(TEXT("Rewound sweeps skip the ignored slot"), IgnoredMisses, NumQueries);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLagCompensationSlotReuseTest, "MultiplayerGame.LagCompensation.SlotReuse",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FLagCompensationSlotReuseTest::RunTest(const FString& Parameters)
+{
+	using namespace LagCompensationTests;
+
+	FLagCompensationHistory History;
+	RecordHistory(History);
+
+	// 角色离开后立刻有新角色占用同一槽位，并在远处记录一帧。
+	const int32 DepartedSlot = 3;
+	const float RewindTime = 0.5f * (History.GetOldestTime() + History.GetNewestTime());
+	const FVector DepartedLocation = GetTruePosition(DepartedSlot, RewindTime);
+
+	History.FreeSlot(DepartedSlot);
+	TestEqual(TEXT("The freed slot is reused by the next registration"), History.AllocateSlot(), DepartedSlot);
+
+	const float NewTime = History.GetNewestTime() + FrameInterval;
+	FLagCompensationSample* Row = History.BeginFrame(NewTime);
+	for (int32 Character = 0; Character < NumCharacters; ++Character)
+	{
+		Row[Character].Location = Character == DepartedSlot ? FVector(0.0f, 100000.0f, 0.0f) : GetTruePosition(Character, NewTime);
+		Row[Character].Radius = CapsuleRadius;
+		Row[Character].HalfHeight = CapsuleHalfHeight;
+	}
+
+	// 回溯到新角色加入之前，离开者原来的位置上不应再有任何胶囊体。
+	FLagCompensationSample Sample;
+	TestFalse(TEXT("The new occupant has no samples from before it registered"), History.GetSampleAtTime(DepartedSlot, RewindTime, Sample));
+
+	float HitTime;
+	const FVector Start = DepartedLocation - FVector(0.0f, 300.0f, 0.0f);
+	const FVector End = DepartedLocation + FVector(0.0f, 300.0f, 0.0f);
+	TestEqual(TEXT("A rewound sweep through the departed character's position hits nothing"),
+		History.SweepAtTime(RewindTime, Start, End, 5.0f, INDEX_NONE, HitTime), static_cast<int32>(INDEX_NONE));
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerGame_DemoCharacter.h"
+#include "GameplayTestWorld.h"
+#include "Camera/CameraComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/SpringArmComponent.h"
+#include "Misc/AutomationTest.h"
+#include "Serialization/ArchiveCountMem.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace PawnFootprintTests
+{
+	// 游戏模式实际生成的蓝图角色，其烘焙数据中带有 CameraBoom 与 FollowCamera。
+	const TCHAR* CharacterBlueprintPath = TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter.ThirdPersonCharacter_C");
+
+	struct FFootprint
+	{
+		int32 NumComponents = 0;
+		int32 NumCameraComponents = 0;
+		// 与 mp.Server.PawnFootprint 相同，按 FArchiveCountMem 统计Actor与各组件本身的内存。
+		SIZE_T Bytes = 0;
+	};
+
+	static FFootprint Measure(AActor* Actor)
+	{
+		FFootprint Footprint;
+		Footprint.Bytes = FArchiveCountMem(Actor).GetMax();
+
+		TInlineComponentArray<UActorComponent*> Components(Actor);
+		for (UActorComponent* Component : Components)
+		{
+			++Footprint.NumComponents;
+			Footprint.NumCameraComponents += Component->IsA<USpringArmComponent>() || Component->IsA<UCameraComponent>() ? 1 : 0;
+			Footprint.Bytes += FArchiveCountMem(Component).GetMax();
+		}
+		return Footprint;
+	}
+}
+
+/**
+ * 生成两个蓝图角色，其中一个按专用服务器的方式剥离摄像机组件，输出两者的组件数量与内存。
+ * 在专用服务器上（服务器构建，或以 -server 运行）两个角色都已在 PostInitializeComponents 中剥离。
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPawnFootprintTest, "MultiplayerGame.Server.PawnFootprint",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPawnFootprintTest::RunTest(const FString& Parameters)
+{
+	using namespace PawnFootprintTests;
+
+	UClass* CharacterClass = LoadClass<AMultiplayerGame_DemoCharacter>(nullptr, CharacterBlueprintPath);
+	if (!TestNotNull(TEXT("Character blueprint class"), CharacterClass))
+	{
+		return false;
+	}
+
+	UWorld* World = GameplayTestWorld::Create(TEXT("PawnFootprintTest"));
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AMultiplayerGame_DemoCharacter* GameCharacter = World->SpawnActor<AMultiplayerGame_DemoCharacter>(CharacterClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParameters);
+	AMultiplayerGame_DemoCharacter* ServerCharacter = World->SpawnActor<AMultiplayerGame_DemoCharacter>(CharacterClass, FVector(500.0f, 0.0f, 0.0f), FRotator::ZeroRotator, SpawnParameters);
+	if (!TestNotNull(TEXT("Spawned character"), GameCharacter) || !TestNotNull(TEXT("Spawned character"), ServerCharacter))
+	{
+		GameplayTestWorld::Destroy(World);
+		return false;
+	}
+
+	const bool bDedicatedServer = IsRunningDedicatedServer();
+	if (!bDedicatedServer)
+	{
+		ServerCharacter->StripClientOnlyComponents();
+	}
+
+	const FFootprint GameFootprint = Measure(GameCharacter);
+	const FFootprint ServerFootprint = Measure(ServerCharacter);
+	AddInfo(FString::Printf(TEXT("%s (%s build): %d components (%d camera), %.1f KB as spawned; %d components (%d camera), %.1f KB stripped"),
+		*CharacterClass->GetName(), UE_SERVER ? TEXT("server") : TEXT("game"),
+		GameFootprint.NumComponents, GameFootprint.NumCameraComponents, GameFootprint.Bytes / 1024.0,
+		ServerFootprint.NumComponents, ServerFootprint.NumCameraComponents, ServerFootprint.Bytes / 1024.0));
+
+	TestEqual(TEXT("No spring arm or camera remains on a server character"), ServerFootprint.NumCameraComponents, 0);
+	TestNull(TEXT("CameraBoom is cleared on a server character"), ServerCharacter->GetCameraBoom());
+	TestNull(TEXT("FollowCamera is cleared on a server character"), ServerCharacter->GetFollowCamera());
+
+	if (bDedicatedServer)
+	{
+		TestEqual(TEXT("A dedicated server strips every character it spawns"), GameFootprint.NumCameraComponents, 0);
+	}
+	else
+	{
+		TestTrue(TEXT("The blueprint character has camera components outside a dedicated server"), GameFootprint.NumCameraComponents > 0);
+		TestEqual(TEXT("Stripping removes only the camera components"), ServerFootprint.NumComponents, GameFootprint.NumComponents - GameFootprint.NumCameraComponents);
+		TestTrue(TEXT("The stripped character uses less memory"), ServerFootprint.Bytes < GameFootprint.Bytes);
+	}
+
+	GameplayTestWorld::Destroy(World);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
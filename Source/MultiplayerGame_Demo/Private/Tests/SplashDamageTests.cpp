@@ -0,0 +1,252 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SplashDamageSubsystem.h"
+#include "MultiplayerGame_DemoCharacter.h"
+#include "ThirdPersonMPProjectile.h"
+#include "GameplayTestWorld.h"
+#include "Engine/World.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace SplashDamageTests
+{
+	// 网格测试：槽位分布在原点四周（包括坐标为负的格子），部分槽位移动、清除或释放后再查询。
+	const int32 NumSlots = 500;
+	const int32 NumQueries = 1000;
+	const float HalfExtent = 5000.0f;
+
+	// 与物理重叠查询的对照：角色按网格排列，原点位于正中。
+	const int32 NumCharacters = 200;
+	const float CharacterSpacing = 300.0f;
+	const int32 NumExplosions = 64;
+	const int32 NumIterations = 50;
+
+	// 两种方式的距离误差上限（厘米）
+	const float DistanceTolerance = 1.0f;
+
+	/** 球心到竖直胶囊体表面的距离，胶囊体外为正。*/
+	static float GetCapsuleDistance(const FVector& Origin, const FVector& Center, float Radius, float HalfHeight)
+	{
+		const FVector AxisOffset(0.0f, 0.0f, FMath::Max(HalfHeight - Radius, 0.0f));
+		return FMath::PointDistToSegment(Origin, Center - AxisOffset, Center + AxisOffset) - Radius;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSplashDamageGridTest, "MultiplayerGame.SplashDamage.Grid",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSplashDamageGridTest::RunTest(const FString& Parameters)
+{
+	using namespace SplashDamageTests;
+
+	struct FSlot
+	{
+		FVector Center;
+		float Radius;
+		float HalfHeight;
+		bool bInGrid;
+	};
+
+	FRandomStream Random(12345);
+	FSplashDamageGrid Grid;
+	TArray<FSlot> Slots;
+	for (int32 Index = 0; Index < NumSlots; ++Index)
+	{
+		const int32 Slot = Grid.AllocateSlot();
+		if (!TestEqual(TEXT("Slots are allocated in order"), Slot, Index))
+		{
+			return false;
+		}
+
+		const FSlot& SlotData = Slots.Add_GetRef({ FVector(Random.FRandRange(-HalfExtent, HalfExtent), Random.FRandRange(-HalfExtent, HalfExtent), Random.FRandRange(-200.0f, 200.0f)),
+			Random.FRandRange(20.0f, 60.0f), Random.FRandRange(60.0f, 120.0f), true });
+		Grid.UpdateSlot(Slot, SlotData.Center, SlotData.Radius, SlotData.HalfHeight);
+	}
+
+	// 增量更新：一部分槽位小幅移动（大多仍在原来的格子中），一部分跨越较远，另有槽位被清除或释放。
+	for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+	{
+		FSlot& SlotData = Slots[Slot];
+		const float Roll = Random.FRand();
+		if (Roll < 0.05f)
+		{
+			Grid.ClearSlot(Slot);
+			SlotData.bInGrid = false;
+		}
+		else if (Roll < 0.1f)
+		{
+			Grid.FreeSlot(Slot);
+			SlotData.bInGrid = false;
+		}
+		else
+		{
+			SlotData.Center += Roll < 0.3f ? FVector(Random.FRandRange(-2000.0f, 2000.0f), Random.FRandRange(-2000.0f, 2000.0f), 0.0f) : Random.GetUnitVector() * 30.0f;
+			Grid.UpdateSlot(Slot, SlotData.Center, SlotData.Radius, SlotData.HalfHeight);
+		}
+	}
+
+	TArray<FSplashDamageQuery> Queries;
+	for (int32 Index = 0; Index < NumQueries; ++Index)
+	{
+		const FVector Origin(Random.FRandRange(-HalfExtent, HalfExtent), Random.FRandRange(-HalfExtent, HalfExtent), Random.FRandRange(-300.0f, 300.0f));
+		Queries.Add({ Origin, Random.FRandRange(50.0f, 800.0f), Random.FRand() < 0.2f ? Random.RandHelper(NumSlots) : INDEX_NONE });
+	}
+
+	TArray<FSplashDamageOverlap> Overlaps;
+	Grid.QueryBatch(Queries, Overlaps);
+
+	// 与逐个槽位的暴力检测比较：同样的 (查询, 槽位) 组合，距离一致。
+	int32 NumExpected = 0;
+	int32 NumMissing = 0;
+	int32 NumDistanceErrors = 0;
+	int32 NumNegative = 0;
+	TSet<TPair<int32, int32>> Found;
+	for (const FSplashDamageOverlap& Overlap : Overlaps)
+	{
+		Found.Add(TPair<int32, int32>(Overlap.Query, Overlap.Slot));
+	}
+	for (int32 QueryIndex = 0; QueryIndex < Queries.Num(); ++QueryIndex)
+	{
+		const FSplashDamageQuery& Query = Queries[QueryIndex];
+		NumNegative += Query.Origin.X < 0.0f || Query.Origin.Y < 0.0f ? 1 : 0;
+		for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+		{
+			const FSlot& SlotData = Slots[Slot];
+			if (SlotData.bInGrid && Slot != Query.IgnoredSlot && GetCapsuleDistance(Query.Origin, SlotData.Center, SlotData.Radius, SlotData.HalfHeight) < Query.Radius - DistanceTolerance)
+			{
+				++NumExpected;
+				NumMissing += Found.Contains(TPair<int32, int32>(QueryIndex, Slot)) ? 0 : 1;
+			}
+		}
+	}
+	for (const FSplashDamageOverlap& Overlap : Overlaps)
+	{
+		const FSplashDamageQuery& Query = Queries[Overlap.Query];
+		const FSlot& SlotData = Slots[Overlap.Slot];
+		const float Distance = FMath::Max(GetCapsuleDistance(Query.Origin, SlotData.Center, SlotData.Radius, SlotData.HalfHeight), 0.0f);
+		const bool bValid = SlotData.bInGrid && Overlap.Slot != Query.IgnoredSlot && Distance <= Query.Radius + DistanceTolerance;
+		NumDistanceErrors += bValid && FMath::Abs(Distance - Overlap.Distance) <= DistanceTolerance ? 0 : 1;
+	}
+
+	AddInfo(FString::Printf(TEXT("%d slots, %d queries (%d west or south of the origin): %d overlaps, %d cells, %d cell moves"),
+		NumSlots, NumQueries, NumNegative, Overlaps.Num(), Grid.GetNumCells(), Grid.GetNumCellMoves()));
+	TestTrue(TEXT("Queries find overlaps"), NumExpected > 0);
+	TestEqual(TEXT("Every capsule inside a query radius is found"), NumMissing, 0);
+	TestEqual(TEXT("Every overlap is a live, non-ignored capsule at the right distance"), NumDistanceErrors, 0);
+	TestEqual(TEXT("Each (query, slot) pair is reported once"), Found.Num(), Overlaps.Num());
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSplashDamageBatchedMatchesOverlapsTest, "MultiplayerGame.SplashDamage.BatchedMatchesOverlaps",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FSplashDamageBatchedMatchesOverlapsTest::RunTest(const FString& Parameters)
+{
+	using namespace SplashDamageTests;
+
+	UWorld* World = GameplayTestWorld::Create(TEXT("SplashDamageTest"));
+	USplashDamageSubsystem* SplashDamage = World->GetSubsystem<USplashDamageSubsystem>();
+	if (!TestNotNull(TEXT("Splash damage subsystem"), SplashDamage))
+	{
+		GameplayTestWorld::Destroy(World);
+		return false;
+	}
+
+	// 角色在 BeginPlay 中登记到网格。
+	const int32 NumColumns = FMath::CeilToInt(FMath::Sqrt((float)NumCharacters));
+	const FVector GridOffset(NumColumns * CharacterSpacing * 0.5f, NumColumns * CharacterSpacing * 0.5f, 0.0f);
+	TArray<const AMultiplayerGame_DemoCharacter*> Characters;
+	for (int32 Index = 0; Index < NumCharacters; ++Index)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		const FVector Location((Index % NumColumns) * CharacterSpacing, (Index / NumColumns) * CharacterSpacing, 0.0f);
+		if (const AMultiplayerGame_DemoCharacter* Character = World->SpawnActor<AMultiplayerGame_DemoCharacter>(Location - GridOffset, FRotator::ZeroRotator, SpawnParameters))
+		{
+			Characters.Add(Character);
+		}
+	}
+	if (!TestEqual(TEXT("Spawned characters"), Characters.Num(), NumCharacters))
+	{
+		GameplayTestWorld::Destroy(World);
+		return false;
+	}
+
+	FRadialDamageParams Params = GetDefault<AThirdPersonMPProjectile>()->SplashDamage;
+	if (Params.OuterRadius <= 0.0f)
+	{
+		Params = FRadialDamageParams(10.0f, 0.0f, 50.0f, 300.0f, 1.0f);
+	}
+
+	// 爆炸落在随机角色附近，约一半的爆炸能覆盖到至少一名角色；部分爆炸忽略直接命中的角色。
+	FRandomStream Random(12345);
+	TArray<USplashDamageSubsystem::FPendingExplosion> Explosions;
+	for (int32 Index = 0; Index < NumExplosions; ++Index)
+	{
+		const AMultiplayerGame_DemoCharacter* Character = Characters[Random.RandHelper(Characters.Num())];
+		USplashDamageSubsystem::FPendingExplosion& Explosion = Explosions.AddDefaulted_GetRef();
+		Explosion.Origin = Character->GetActorLocation() + Random.GetUnitVector() * Random.FRandRange(0.0f, Params.OuterRadius * 1.5f);
+		Explosion.Params = Params;
+		Explosion.IgnoredActor = Random.FRand() < 0.25f ? const_cast<AMultiplayerGame_DemoCharacter*>(Character) : nullptr;
+	}
+
+	TArray<USplashDamageSubsystem::FSplashDamageTarget> BatchedTargets;
+	TArray<USplashDamageSubsystem::FSplashDamageTarget> OverlapTargets;
+
+	const double BatchedStart = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		BatchedTargets.Reset();
+		SplashDamage->UpdateGrid();
+		SplashDamage->CollectTargetsBatched(Explosions, BatchedTargets);
+	}
+	const double BatchedSeconds = FPlatformTime::Seconds() - BatchedStart;
+
+	const double OverlapStart = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		OverlapTargets.Reset();
+		SplashDamage->CollectTargetsWithOverlaps(Explosions, OverlapTargets);
+	}
+	const double OverlapSeconds = FPlatformTime::Seconds() - OverlapStart;
+
+	// 两种方式应找到同样的 (爆炸, 角色) 组合，距离误差在1厘米以内。
+	const auto SortTargets = [](TArray<USplashDamageSubsystem::FSplashDamageTarget>& InOutTargets)
+	{
+		InOutTargets.Sort([](const USplashDamageSubsystem::FSplashDamageTarget& A, const USplashDamageSubsystem::FSplashDamageTarget& B)
+		{
+			return A.Explosion != B.Explosion ? A.Explosion < B.Explosion : A.Character->GetUniqueID() < B.Character->GetUniqueID();
+		});
+	};
+	SortTargets(BatchedTargets);
+	SortTargets(OverlapTargets);
+
+	int32 NumMismatches = 0;
+	for (int32 Index = 0; Index < FMath::Min(BatchedTargets.Num(), OverlapTargets.Num()); ++Index)
+	{
+		const USplashDamageSubsystem::FSplashDamageTarget& A = BatchedTargets[Index];
+		const USplashDamageSubsystem::FSplashDamageTarget& B = OverlapTargets[Index];
+		if (A.Explosion != B.Explosion || A.Character != B.Character || FMath::Abs(A.Distance - B.Distance) > DistanceTolerance)
+		{
+			++NumMismatches;
+		}
+	}
+
+	const double NumQueries = (double)NumExplosions * NumIterations;
+	AddInfo(FString::Printf(TEXT("%d characters, %d explosions x %d iterations, outer radius %.0f: %d targets per batch"),
+		NumCharacters, NumExplosions, NumIterations, Params.OuterRadius, BatchedTargets.Num()));
+	AddInfo(FString::Printf(TEXT("Grid batch (incl. grid update) %.3f us, physics overlap %.3f us per explosion, speedup %.1fx"),
+		BatchedSeconds * 1000000.0 / NumQueries, OverlapSeconds * 1000000.0 / NumQueries, BatchedSeconds > 0.0 ? OverlapSeconds / BatchedSeconds : 0.0));
+
+	TestTrue(TEXT("Explosions reach characters"), OverlapTargets.Num() > 0);
+	TestEqual(TEXT("The grid finds as many targets as the physics overlaps"), BatchedTargets.Num(), OverlapTargets.Num());
+	TestEqual(TEXT("The grid finds the same targets at the same distances"), NumMismatches, 0);
+
+	GameplayTestWorld::Destroy(World);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -4,21 +4,39 @@
 #include "ThirdPersonMPProjectile.h"
 #include "Components/SphereComponent.h"
 #include "Components/StaticMeshComponent.h"
+#include "GameFramework/Pawn.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "GameFramework/DamageType.h"
 #include "Particles/ParticleSystem.h"
 #include "Kismet/GameplayStatics.h"       // 用于访问基本游戏进程函数
-#include "UObject/ConstructorHelpers.h"   // 用于访问一些有用的构造函数以便设置组件。
+#include "Engine/AssetManager.h"
+#include "Engine/StaticMesh.h"
+#include "Net/UnrealNetwork.h"
+#include "ImpactEffectSubsystem.h"
+#include "GameplayCountersSubsystem.h"
+#include "MultiplayerGame_Demo.h"
+#include "GameplayEventChannel.h"
+#include "MultiplayerGame_DemoGameState.h"
+#include "ProjectilePoolSubsystem.h"
+#include "ProjectileSimulationSubsystem.h"
+#include "ProjectileSweepBatch.h"
+#include "SplashDamageSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Impact"), STAT_ProjectileImpact, STATGROUP_MultiplayerGame);
 
 // Sets default values
 AThirdPersonMPProjectile::AThirdPersonMPProjectile()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// 投射物本身没有每帧逻辑，移动由移动组件（或批量扫掠）完成，不需要进入Tick列表。
+	PrimaryActorTick.bCanEverTick = false;
 
 	// 启用该Actor的网络同步
 	bReplicates = true;
 
+	// 投射物的轨迹由客户端本地模拟，不需要高频复制。
+	NetUpdateFrequency = 20.0f;
+	MinNetUpdateFrequency = 2.0f;
+
 	// 定义将作为投射物及其碰撞的根组件的SphereComponent。
 	SphereComponent = CreateDefaultSubobject<USphereComponent>(TEXT("RootComponent"));
 	SphereComponent->InitSphereRadius(40.0f);
@@ -32,26 +50,20 @@ AThirdPersonMPProjectile::AThirdPersonMPProjectile()
 	}
 
 	
-	// 定义将作为视觉呈现的网格体。
-	static ConstructorHelpers::FObjectFinder<UStaticMesh> DefaultMesh(TEXT("/Game/StarterContent/Shapes/Shape_Sphere.Shape_Sphere"));
+	// 定义将作为视觉呈现的网格体。网格体资产通过软引用在 BeginPlay 时设置，构造时不加载。
+	// 专用服务器上本来就不设置网格体资产（因此没有碰撞体），网格体只用于表现；专用服务器构建中不创建，StaticMesh 为空。
+#if !UE_SERVER
 	StaticMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Mesh"));
 	StaticMesh->SetupAttachment(RootComponent);
+	StaticMesh->SetRelativeLocation(FVector(0.0f, 0.0f, -40.0f));
+	StaticMesh->SetRelativeScale3D(FVector(0.8f, 0.8f, 0.8f));
+#else
+	StaticMesh = nullptr;
+#endif
+	MeshAsset = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(TEXT("/Game/StarterContent/Shapes/Shape_Sphere.Shape_Sphere")));
 
-	// 若成功找到要使用的静态网格体资产，则设置该静态网格体及其位置/比例。
-	if(DefaultMesh.Succeeded())
-	{
-		StaticMesh->SetStaticMesh(DefaultMesh.Object);
-		StaticMesh->SetRelativeLocation(FVector(0.0f, 0.0f, -40.0f));
-		StaticMesh->SetRelativeScale3D(FVector(0.8f, 0.8f, 0.8f));
-	}
-
-	// 定义将作为视觉呈现的粒子特效。
-	static ConstructorHelpers::FObjectFinder<UParticleSystem> DefaultExplosionEffect(TEXT("/Game/StarterContent/Particles/P_Explosion.P_Explosion"));
-	// 如果根据路径找到对应的资产，这将把ExplosionEffect的资产引用设置为StarterContent中的P_Explosion资产。
-	if(DefaultExplosionEffect.Succeeded())
-	{
-		ExplosionEffect = DefaultExplosionEffect.Object;
-	}
+	// 定义将作为视觉呈现的粒子特效（StarterContent中的P_Explosion）。
+	ExplosionEffect = TSoftObjectPtr<UParticleSystem>(FSoftObjectPath(TEXT("/Game/StarterContent/Particles/P_Explosion.P_Explosion")));
 	
 	//定义投射物移动组件。
 	ProjectileMovementComponent = CreateDefaultSubobject<UProjectileMovementComponent>(TEXT("ProjectileMovement"));
@@ -64,26 +76,271 @@ AThirdPersonMPProjectile::AThirdPersonMPProjectile()
 	// 定义伤害类型及伤害数值
 	DamageType = UDamageType::StaticClass();
 	Damage = 10.0f;
+	SplashDamage = FRadialDamageParams(8.0f, 2.0f, 50.0f, 250.0f, 1.0f);
 
-	
+	bPooled = false;
+	bPoolActive = true;
+	PoolLaunchTime = 0.0f;
+	PredictionId = INDEX_NONE;
 }
 
 void AThirdPersonMPProjectile::Destroyed()
 {
 	// Super::Destroyed();  // 此处不继承父类的逻辑，只使用以下简单逻辑进行演示【重写】
-	FVector spawnLocation = GetActorLocation();
-	UGameplayStatics::SpawnEmitterAtLocation(this, ExplosionEffect, spawnLocation, FRotator::ZeroRotator, true, EPSCPoolMethod::AutoRelease);
+	// 处于池中（已隐藏）的投射物在关卡卸载时被销毁，不应再播放爆炸。
+	if (!IsHidden())
+	{
+		PlayImpactEffect();
+	}
+}
+
+void AThirdPersonMPProjectile::FellOutOfWorld(const UDamageType& DmgType)
+{
+	if (!ReleaseOutOfWorld())
+	{
+		Super::FellOutOfWorld(DmgType);
+	}
+}
+
+void AThirdPersonMPProjectile::OutsideWorldBounds()
+{
+	if (!ReleaseOutOfWorld())
+	{
+		Super::OutsideWorldBounds();
+	}
+}
+
+bool AThirdPersonMPProjectile::ReleaseOutOfWorld()
+{
+	UProjectilePoolSubsystem* ProjectilePool = bPooled && HasAuthority() ? GetWorld()->GetSubsystem<UProjectilePoolSubsystem>() : nullptr;
+	if (!ProjectilePool)
+	{
+		return false;
+	}
+
+	// 没有撞到任何东西，不播放爆炸。
+	ProjectilePool->ReleaseProjectile(this, false);
+	return true;
+}
+
+bool AThirdPersonMPProjectile::IsPredictedLocally() const
+{
+	if (PredictionId == INDEX_NONE || GetLocalRole() == ROLE_Authority)
+	{
+		return false;
+	}
+
+	const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+	return OwnerPawn && OwnerPawn->IsLocallyControlled();
+}
+
+void AThirdPersonMPProjectile::PlayImpactEffect()
+{
+	// 预测的投射物可能已经在本地撞击并播放过特效；仍在飞行时结束它，在这里统一播放一次。
+	if (IsPredictedLocally())
+	{
+		UProjectileSimulationSubsystem* ProjectileSimulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>();
+		if (!ProjectileSimulation || !ProjectileSimulation->EndPredictedProjectile(GetOwner(), PredictionId))
+		{
+			return;
+		}
+	}
+
+	// 纯表现：专用服务器上没有 UImpactEffectSubsystem，不播放任何特效。
+	if (UImpactEffectSubsystem* ImpactEffects = GetWorld()->GetSubsystem<UImpactEffectSubsystem>())
+	{
+		ImpactEffects->QueueImpact(ExplosionEffect.Get(), GetActorLocation());
+	}
+}
+
+void AThirdPersonMPProjectile::ApplyMeshAsset()
+{
+	// 蓝图子类直接在组件上指定了网格体时以组件为准。
+	if (IsRunningDedicatedServer() || !StaticMesh || MeshAsset.IsNull() || StaticMesh->GetStaticMesh())
+	{
+		return;
+	}
+
+	if (UStaticMesh* Mesh = MeshAsset.Get())
+	{
+		StaticMesh->SetStaticMesh(Mesh);
+	}
+	else
+	{
+		UAssetManager::GetStreamableManager().RequestAsyncLoad(MeshAsset.ToSoftObjectPath(), FStreamableDelegate::CreateUObject(this, &AThirdPersonMPProjectile::ApplyMeshAsset));
+	}
 }
 
 // 若撞击对象是有效Actor，将调用 ApplyPointDamage 函数，在碰撞处对该对象造成伤害。同时，无论撞击表面是什么，任何碰撞都将摧毁该Actor，导致爆炸效果显示。
 void AThirdPersonMPProjectile::OnProjectileImpact(UPrimitiveComponent* HitComponent, AActor* OtherActor,
 	UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
+	MP_SCOPE_CYCLE_COUNTER(STAT_ProjectileImpact);
+
 	if(OtherActor)
 	{
 		UGameplayStatics::ApplyPointDamage(OtherActor, Damage, NormalImpulse, Hit, GetInstigator()->Controller, this, DamageType);
 	}
-	Destroy();  // 销毁 Actor 的内置函数
+
+	if (HasAuthority())
+	{
+		FGameplayEventChannel::Get().Push(EGameplayEventType::Impact, OtherActor, GetInstigator(), Damage, 0.0f, Hit.ImpactPoint);
+
+		if (AMultiplayerGame_DemoGameState* MatchGameState = GetWorld()->GetGameState<AMultiplayerGame_DemoGameState>())
+		{
+			MatchGameState->RecordHit(GetInstigator(), OtherActor);
+		}
+
+		if (USplashDamageSubsystem* SplashDamageSubsystem = GetWorld()->GetSubsystem<USplashDamageSubsystem>())
+		{
+			SplashDamageSubsystem->QueueProjectileExplosion(this, Hit.ImpactPoint, OtherActor, GetInstigatorController(), this);
+		}
+	}
+
+	// 对象池中的投射物回收复用，其余情况下销毁。
+	UProjectilePoolSubsystem* ProjectilePool = bPooled ? GetWorld()->GetSubsystem<UProjectilePoolSubsystem>() : nullptr;
+	if (ProjectilePool)
+	{
+		ProjectilePool->ReleaseProjectile(this);
+	}
+	else
+	{
+		Destroy();  // 销毁 Actor 的内置函数
+	}
+}
+
+void AThirdPersonMPProjectile::ActivateFromPool(const FVector& Location, const FRotator& Rotation)
+{
+	check(GetLocalRole() == ROLE_Authority);
+
+	PooledState.bActive = true;
+	PooledState.ActivationId++;
+	PooledState.LaunchLocation = Location;
+	PooledState.LaunchRotation = Rotation;
+	PoolLaunchTime = GetWorld()->GetTimeSeconds();
+	ApplyPoolActivation(Location, Rotation);
+
+	// 唤醒网络通道，让客户端收到新的发射状态。
+	SetNetDormancy(DORM_Awake);
+	ForceNetUpdate();
+}
+
+void AThirdPersonMPProjectile::DeactivateToPool(bool bPlayEffect)
+{
+	check(GetLocalRole() == ROLE_Authority);
+
+	if (bPlayEffect && bPoolActive)
+	{
+		PlayImpactEffect();
+	}
+
+	PooledState.bActive = false;
+	PooledState.bPlayImpactEffect = bPlayEffect;
+	ApplyPoolDeactivation();
+
+	// 先把回收状态同步出去，再进入休眠，关闭网络通道直到下一次激活。
+	FlushNetDormancy();
+	SetNetDormancy(DORM_DormantAll);
+}
+
+void AThirdPersonMPProjectile::OnRep_PooledState()
+{
+	if (PooledState.bActive)
+	{
+		ApplyPoolActivation(PooledState.LaunchLocation, PooledState.LaunchRotation);
+	}
+	else if (bPoolActive)
+	{
+		if (PooledState.bPlayImpactEffect)
+		{
+			PlayImpactEffect();
+		}
+		ApplyPoolDeactivation();
+	}
+}
+
+void AThirdPersonMPProjectile::ApplyPoolActivation(const FVector& Location, const FRotator& Rotation)
+{
+	if (!bPoolActive && HasActorBegunPlay())
+	{
+		UpdateActiveCounter(1);
+	}
+	bPoolActive = true;
+
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	if (StaticMesh)
+	{
+		StaticMesh->SetVisibility(!IsPredictedLocally());
+	}
+
+	// 撞击时移动组件会调用 StopSimulating 并清空 UpdatedComponent，这里按 InitializeComponent 的方式重新初始化。
+	ProjectileMovementComponent->SetUpdatedComponent(SphereComponent);
+	ProjectileMovementComponent->Velocity = Rotation.Vector() * ProjectileMovementComponent->InitialSpeed;
+	ProjectileMovementComponent->UpdateComponentVelocity();
+	ProjectileMovementComponent->SetComponentTickEnabled(true);
+	ProjectileMovementComponent->Activate(true);
+
+	UpdateSweepBatchRegistration();
+}
+
+void AThirdPersonMPProjectile::ApplyPoolDeactivation()
+{
+	if (bPoolActive && HasActorBegunPlay())
+	{
+		UpdateActiveCounter(-1);
+	}
+	bPoolActive = false;
+
+	ProjectileMovementComponent->StopMovementImmediately();
+	ProjectileMovementComponent->Deactivate();
+	ProjectileMovementComponent->SetComponentTickEnabled(false);
+
+	SetActorEnableCollision(false);
+	SetActorHiddenInGame(true);
+
+	UpdateSweepBatchRegistration();
+}
+
+void AThirdPersonMPProjectile::UpdateSweepBatchRegistration()
+{
+	if (GetLocalRole() != ROLE_Authority)
+	{
+		return;
+	}
+
+	UProjectileSimulationSubsystem* ProjectileSimulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>();
+	if (!ProjectileSimulation)
+	{
+		return;
+	}
+
+	// 飞行中且开启了批量扫掠时，由子系统统一移动；否则交还给移动组件自己Tick。
+	if (bPoolActive && FProjectileSweepBatch::IsParallelEnabled())
+	{
+		ProjectileSimulation->RegisterBatchedProjectile(this);
+	}
+	else
+	{
+		ProjectileSimulation->UnregisterBatchedProjectile(this);
+	}
+}
+
+void AThirdPersonMPProjectile::UpdateActiveCounter(int32 Delta)
+{
+	if (UGameplayCountersSubsystem* Counters = GetWorld()->GetSubsystem<UGameplayCountersSubsystem>())
+	{
+		Counters->AddActiveProjectileActors(Delta);
+	}
+}
+
+void AThirdPersonMPProjectile::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AThirdPersonMPProjectile, PooledState);
+	DOREPLIFETIME_CONDITION(AThirdPersonMPProjectile, PredictionId, COND_OwnerOnly);
 }
 
 
@@ -93,13 +350,45 @@ void AThirdPersonMPProjectile::OnProjectileImpact(UPrimitiveComponent* HitCompon
 void AThirdPersonMPProjectile::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	ApplyMeshAsset();
+	if (StaticMesh)
+	{
+		StaticMesh->SetVisibility(!IsPredictedLocally());
+	}
+
+	if (bPoolActive)
+	{
+		UpdateActiveCounter(1);
+	}
+
+	// 对象池中的投射物在激活/回收时更新，这里处理直接生成的投射物。
+	if (!bPooled)
+	{
+		UpdateSweepBatchRegistration();
+	}
 }
 
-// Called every frame
-void AThirdPersonMPProjectile::Tick(float DeltaTime)
+void AThirdPersonMPProjectile::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	if (bPoolActive)
+	{
+		UpdateActiveCounter(-1);
+	}
 
-}
+	if (UProjectileSimulationSubsystem* ProjectileSimulation = GetWorld()->GetSubsystem<UProjectileSimulationSubsystem>())
+	{
+		ProjectileSimulation->UnregisterBatchedProjectile(this);
+	}
 
+	// 对象池中的投射物被池以外的原因销毁（例如关卡流送卸载）时，从池中移除，避免池内计数偏高。
+	if (bPooled && HasAuthority())
+	{
+		if (UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>())
+		{
+			ProjectilePool->RemoveProjectile(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TickAggregationSubsystem.h"
+#include "MultiplayerGame_Demo.h"
+#include "Engine/World.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogTickAggregation, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Aggregated Ticks"), STAT_AggregatedTicks, STATGROUP_MultiplayerGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Aggregated Tick Objects"), STAT_AggregatedTickObjects, STATGROUP_MultiplayerGame);
+
+bool UTickAggregationSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UTickAggregationSubsystem::Deinitialize()
+{
+	Groups.Reset();
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UTickAggregationSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UTickAggregationSubsystem::IsTickable() const
+{
+	return Groups.Num() > 0;
+}
+
+TStatId UTickAggregationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTickAggregationSubsystem, STATGROUP_Tickables);
+}
+
+void UTickAggregationSubsystem::RegisterGroup(FName GroupName, FAggregatedTickFunction Function, float Interval)
+{
+	check(Function);
+
+	if (!Groups.Contains(GroupName))
+	{
+		FTickAggregationGroup& Group = Groups.Add(GroupName);
+		Group.Function = Function;
+		Group.Interval = FMath::Max(Interval, 0.0f);
+	}
+}
+
+void UTickAggregationSubsystem::AddObject(FName GroupName, UObject* Object)
+{
+	FTickAggregationGroup* Group = Groups.Find(GroupName);
+	if (ensureMsgf(Group, TEXT("Tick aggregation group %s is not registered"), *GroupName.ToString()) && Object)
+	{
+		Group->Objects.AddUnique(Object);
+	}
+}
+
+void UTickAggregationSubsystem::RemoveObject(FName GroupName, UObject* Object)
+{
+	if (FTickAggregationGroup* Group = Groups.Find(GroupName))
+	{
+		Group->Objects.RemoveSingleSwap(Object);
+	}
+}
+
+int32 UTickAggregationSubsystem::GetNumObjects(FName GroupName) const
+{
+	const FTickAggregationGroup* Group = Groups.Find(GroupName);
+	return Group ? Group->Objects.Num() : 0;
+}
+
+void UTickAggregationSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AggregatedTicks);
+
+	for (TPair<FName, FTickAggregationGroup>& Pair : Groups)
+	{
+		FTickAggregationGroup& Group = Pair.Value;
+		if (Group.Objects.Num() == 0)
+		{
+			Group.TimeSinceLastTick = 0.0f;
+			continue;
+		}
+
+		Group.TimeSinceLastTick += DeltaTime;
+		if (Group.TimeSinceLastTick < Group.Interval)
+		{
+			continue;
+		}
+
+		const float GroupDeltaTime = Group.TimeSinceLastTick;
+		Group.TimeSinceLastTick = 0.0f;
+
+		// 同时清理已销毁的对象。
+		ScratchObjects.Reset();
+		for (int32 Index = Group.Objects.Num() - 1; Index >= 0; --Index)
+		{
+			if (UObject* Object = Group.Objects[Index].Get())
+			{
+				ScratchObjects.Add(Object);
+			}
+			else
+			{
+				Group.Objects.RemoveAtSwap(Index);
+			}
+		}
+
+		INC_DWORD_STAT_BY(STAT_AggregatedTickObjects, ScratchObjects.Num());
+		Group.Function(ScratchObjects, GroupDeltaTime);
+	}
+}
+
+void UTickAggregationSubsystem::LogGroups() const
+{
+	UE_LOG(LogTickAggregation, Display, TEXT("Aggregated tick groups in %s: %d"), *GetNameSafe(GetWorld()), Groups.Num());
+	for (const TPair<FName, FTickAggregationGroup>& Pair : Groups)
+	{
+		UE_LOG(LogTickAggregation, Display, TEXT("  %-32s objects %4d, interval %.3fs"), *Pair.Key.ToString(), Pair.Value.Objects.Num(), Pair.Value.Interval);
+	}
+}
@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TickAuditSubsystem.h"
+#include "TickAggregationSubsystem.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogTickAudit, Log, All);
+
+static TAutoConsoleVariable<float> CVarTickAuditEmptyTickMicroseconds(
+	TEXT("mp.TickAudit.EmptyTickMicroseconds"),
+	1.0f,
+	TEXT("Ticks whose average cost per call is below this many microseconds are reported as (nearly) empty by mp.TickAudit."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorldAndArgs GTickAuditCommand(
+	TEXT("mp.TickAudit"),
+	TEXT("Measures every enabled actor and component tick in the current world and logs count, tick group, interval and cost per frame per class. Usage: mp.TickAudit [NumFrames=60]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UTickAuditSubsystem* TickAudit = World ? World->GetSubsystem<UTickAuditSubsystem>() : nullptr)
+		{
+			TickAudit->StartAudit(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 60);
+		}
+	}));
+
+void FTickAuditProbe::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	// 对象已销毁，或游戏逻辑在审计期间重新启用了原Tick函数：交还给引擎，不再代为执行。
+	if (!TargetObject.IsValid() || !Target->IsTickFunctionRegistered() || Target->IsTickFunctionEnabled())
+	{
+		return;
+	}
+
+	const uint32 StartCycles = FPlatformTime::Cycles();
+	Target->ExecuteTick(DeltaTime, TickType, CurrentThread, MyCompletionGraphEvent);
+	Cycles += FPlatformTime::Cycles() - StartCycles;
+	++NumCalls;
+}
+
+FString FTickAuditProbe::DiagnosticMessage()
+{
+	return FString::Printf(TEXT("TickAuditProbe[%s]"), Target ? *Target->DiagnosticMessage() : TEXT("None"));
+}
+
+bool UTickAuditSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UTickAuditSubsystem::Deinitialize()
+{
+	FinishAudit(false);
+
+	Super::Deinitialize();
+}
+
+ETickableTickType UTickAuditSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UTickAuditSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTickAuditSubsystem, STATGROUP_Tickables);
+}
+
+void UTickAuditSubsystem::StartAudit(int32 NumFrames)
+{
+	if (IsAuditing())
+	{
+		UE_LOG(LogTickAudit, Warning, TEXT("Tick audit already running (%d/%d frames)"), FramesSampled, FramesToSample);
+		return;
+	}
+
+	FramesToSample = FMath::Max(NumFrames, 1);
+	FramesSampled = 0;
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		AActor* Actor = *It;
+		ULevel* Level = Actor->GetLevel();
+		AddProbe(Actor, Actor->PrimaryActorTick, Level);
+
+		for (UActorComponent* Component : Actor->GetComponents())
+		{
+			if (Component)
+			{
+				AddProbe(Component, Component->PrimaryComponentTick, Level);
+			}
+		}
+	}
+
+	UE_LOG(LogTickAudit, Display, TEXT("Tick audit: measuring %d tick functions for %d frames"), Probes.Num(), FramesToSample);
+}
+
+void UTickAuditSubsystem::AddProbe(UObject* Owner, FTickFunction& TickFunction, ULevel* Level)
+{
+	if (!TickFunction.IsTickFunctionRegistered() || !TickFunction.IsTickFunctionEnabled())
+	{
+		return;
+	}
+
+	TUniquePtr<FTickAuditProbe>& Probe = Probes.Add_GetRef(MakeUnique<FTickAuditProbe>());
+	Probe->Target = &TickFunction;
+	Probe->TargetObject = Owner;
+	Probe->TargetClass = Owner->GetClass();
+	Probe->TickGroup = TickFunction.TickGroup;
+	Probe->EndTickGroup = TickFunction.EndTickGroup;
+	Probe->TickInterval = TickFunction.TickInterval;
+
+	// 可在任意线程执行的Tick函数不改动，只统计数量。
+	if (TickFunction.bRunOnAnyThread)
+	{
+		return;
+	}
+
+	Probe->bMeasured = true;
+	Probe->bCanEverTick = true;
+	Probe->bTickEvenWhenPaused = TickFunction.bTickEvenWhenPaused;
+	Probe->bHighPriority = TickFunction.bHighPriority;
+	for (const FTickPrerequisite& Prerequisite : TickFunction.GetPrerequisites())
+	{
+		if (UObject* PrerequisiteObject = Prerequisite.PrerequisiteObject.Get())
+		{
+			Probe->AddPrerequisite(PrerequisiteObject, *Prerequisite.PrerequisiteTickFunction);
+		}
+	}
+
+	Probe->RegisterTickFunction(Level);
+	TickFunction.SetTickFunctionEnable(false);
+}
+
+void UTickAuditSubsystem::Tick(float DeltaTime)
+{
+	if (++FramesSampled >= FramesToSample)
+	{
+		FinishAudit(true);
+	}
+}
+
+void UTickAuditSubsystem::FinishAudit(bool bReport)
+{
+	struct FClassTickEntry
+	{
+		UClass* Class;
+		ETickingGroup TickGroup;
+		float TickInterval;
+		int32 Count = 0;
+		int32 NumMeasured = 0;
+		int32 NumCalls = 0;
+		uint64 Cycles = 0;
+	};
+
+	TArray<FClassTickEntry> Entries;
+	for (const TUniquePtr<FTickAuditProbe>& Probe : Probes)
+	{
+		// 先注销探针再恢复原Tick函数，避免同一帧执行两次。
+		if (Probe->bMeasured)
+		{
+			Probe->UnRegisterTickFunction();
+			if (Probe->TargetObject.IsValid() && Probe->Target->IsTickFunctionRegistered())
+			{
+				Probe->Target->SetTickFunctionEnable(true);
+			}
+		}
+
+		FClassTickEntry* Entry = Entries.FindByPredicate([&Probe](const FClassTickEntry& Existing)
+		{
+			return Existing.Class == Probe->TargetClass && Existing.TickGroup == Probe->TickGroup && Existing.TickInterval == Probe->TickInterval;
+		});
+		if (!Entry)
+		{
+			Entry = &Entries.Add_GetRef({ Probe->TargetClass, Probe->TickGroup, Probe->TickInterval });
+		}
+		Entry->Count++;
+		Entry->NumMeasured += Probe->bMeasured ? 1 : 0;
+		Entry->NumCalls += Probe->NumCalls;
+		Entry->Cycles += Probe->Cycles;
+	}
+	Probes.Reset();
+
+	if (!bReport)
+	{
+		return;
+	}
+
+	Entries.Sort([](const FClassTickEntry& A, const FClassTickEntry& B) { return A.Cycles > B.Cycles; });
+
+	const double EmptyTickSeconds = CVarTickAuditEmptyTickMicroseconds.GetValueOnGameThread() * 1e-6;
+	const UEnum* TickGroupEnum = StaticEnum<ETickingGroup>();
+	double TotalMilliseconds = 0.0;
+
+	UE_LOG(LogTickAudit, Display, TEXT("Tick audit over %d frames (cost = measured game thread time per frame):"), FramesSampled);
+	for (const FClassTickEntry& Entry : Entries)
+	{
+		const double Seconds = FPlatformTime::ToSeconds64(Entry.Cycles);
+		const double MillisecondsPerFrame = Seconds * 1000.0 / FMath::Max(FramesSampled, 1);
+		TotalMilliseconds += MillisecondsPerFrame;
+
+		FString CostText = TEXT("not measured (runs on any thread)");
+		if (Entry.NumMeasured > 0)
+		{
+			const double MicrosecondsPerCall = Entry.NumCalls > 0 ? Seconds * 1e6 / Entry.NumCalls : 0.0;
+			CostText = FString::Printf(TEXT("%.3f ms/frame, %.2f us/call"), MillisecondsPerFrame, MicrosecondsPerCall);
+		}
+
+		UE_LOG(LogTickAudit, Display, TEXT("  %-48s %-20s interval %.3fs  count %4d  %s"),
+			*GetNameSafe(Entry.Class), *TickGroupEnum->GetNameStringByValue(Entry.TickGroup), Entry.TickInterval, Entry.Count, *CostText);
+
+		if (Entry.NumCalls > 0 && Seconds < EmptyTickSeconds * Entry.NumCalls)
+		{
+			UE_LOG(LogTickAudit, Warning, TEXT("  %s: tick does almost nothing (< %.2f us/call) - consider disabling it or using batched updates"),
+				*GetNameSafe(Entry.Class), EmptyTickSeconds * 1e6);
+		}
+	}
+	UE_LOG(LogTickAudit, Display, TEXT("  Total measured: %.3f ms/frame"), TotalMilliseconds);
+
+	if (const UTickAggregationSubsystem* TickAggregation = GetWorld()->GetSubsystem<UTickAggregationSubsystem>())
+	{
+		TickAggregation->LogGroups();
+	}
+}
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/StreamableManager.h"
+#include "AssetPreloadSubsystem.generated.h"
+
+/**
+ * 地图加载时的资产预加载器。
+ * 世界创建时（地图加载期间）异步加载配置中列出的软引用资产，并在本世界存续期间保持它们常驻，
+ * 游戏中第一次用到这些资产时不再同步加载。只用于渲染的资产（网格体、粒子）在专用服务器上跳过，不占用服务器内存。
+ * 加载完成时输出耗时和常驻内存变化；控制台命令 mp.Assets.Report（或命令行 -AssetReport，在预加载完成时）输出启动耗时与内存报告。
+ */
+UCLASS(config=Game)
+class MULTIPLAYERGAME_DEMO_API UAssetPreloadSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	/** 预加载是否已经完成。*/
+	bool IsPreloadComplete() const { return bPreloadComplete; }
+
+	/** 输出启动耗时、预加载耗时、常驻内存以及已加载的渲染资产数量。*/
+	void LogReport() const;
+
+protected:
+	/** 客户端和服务器都需要的资产（例如玩家角色蓝图类）。*/
+	UPROPERTY(config)
+	TArray<FSoftObjectPath> SharedAssets;
+
+	/** 只用于渲染的资产，专用服务器上不加载。*/
+	UPROPERTY(config)
+	TArray<FSoftObjectPath> RenderAssets;
+
+private:
+	void OnPreloadComplete();
+
+	TSharedPtr<FStreamableHandle> PreloadHandle;
+
+	bool bPreloadComplete = false;
+	int32 NumRequested = 0;
+	int32 NumSkipped = 0;
+
+	// 预加载开始时的时间和常驻内存
+	double PreloadStartTime = 0.0;
+	uint64 PreloadStartUsedPhysical = 0;
+
+	// 预加载完成时的耗时和常驻内存
+	double PreloadSeconds = 0.0;
+	uint64 PreloadEndUsedPhysical = 0;
+};
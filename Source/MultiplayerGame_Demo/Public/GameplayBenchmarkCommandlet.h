@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "GameplayBenchmarkCommandlet.generated.h"
+
+class AMultiplayerGame_DemoCharacter;
+class FJsonObject;
+
+/**
+ * 玩法热点的无头基准测试，不需要地图和渲染：
+ *   -run=GameplayBenchmark -nullrhi [-Iterations=<n>] [-Scales=10,100,1000] [-Frames=<n>]
+ *       [-Output=<结果>] [-Baseline=<基线>] [-Threshold=<百分比>] [-UpdateBaseline] [-AllowNoBaseline]
+ * 在临时的游戏世界中测量 TakeDamage / SetCurrentHealth 的吞吐、服务器处理一次开火输入的开销与开火到命中的耗时、
+ * 按 GetLifetimeReplicatedProps 序列化一个角色的开销，同一组移动分别以 mp.Move.Compact 0 和 1 序列化时的位数、耗时与位置误差，
+ * 以及10、100、1000个角色持续互相开火时的帧耗时。
+ * 结果以JSON写入 -Output（默认 Saved/Benchmarks/GameplayBenchmark.json），格式与基线文件相同。
+ * 与基线文件（默认 Benchmarks/GameplayBaseline.json）逐项比较，任何一项比基线慢超过阈值即返回1；
+ * 阈值默认为 -Threshold，基线文件的 "thresholds" 中可以按项覆盖。-UpdateBaseline 用本次结果覆盖基线。
+ * 基线文件不存在时同样返回1，除非指定了 -UpdateBaseline 或 -AllowNoBaseline。
+ */
+UCLASS()
+class UGameplayBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UGameplayBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	/** TakeDamage 与 SetCurrentHealth 每次调用的耗时。*/
+	void RunDamageBenchmark(UWorld* World, int32 NumIterations);
+
+	/** 服务器处理一次开火输入（ServerProcessFireInput）的耗时，以及投射物从开火到命中目标（包括其间的世界Tick）的耗时。*/
+	void RunFireBenchmark(UWorld* World, int32 NumIterations);
+
+	/** 按 GetLifetimeReplicatedProps 序列化一个角色全部可复制属性的耗时与位数。*/
+	void RunReplicationBenchmark(UWorld* World, int32 NumIterations);
+
+	/**
+	 * 同一组脚本生成的移动（停止、各方向行走、跳跃、转向）分别以默认格式与紧凑格式序列化再解码，
+	 * 两种格式各自输出每个移动的位数、序列化耗时，以及服务器解码出的位置与客户端位置的最大误差。
+	 * 纠正率与实际的包频率需要真实连接，见 Scripts/LoadTestCompare.sh client mp.Move.Compact。
+	 */
+	void RunMoveFormatBenchmark(UWorld* World, int32 NumIterations);
+
+	/** NumCharacters 个角色按 FireRate 持续向前一列开火，测量 NumFrames 帧的帧耗时。*/
+	void RunScenario(UWorld* World, int32 NumCharacters, int32 NumFrames);
+
+	/** 推进世界一帧，返回耗时（毫秒）。*/
+	double TickWorld(UWorld* World);
+
+	AMultiplayerGame_DemoCharacter* SpawnCharacter(UWorld* World, const FVector& Location);
+
+	void AddResult(const FString& Name, double Value);
+
+	/** 把结果与基线比较，返回超过阈值的项数。*/
+	int32 CompareWithBaseline(const FString& BaselineFilename, float DefaultThresholdPercent) const;
+
+	/** 写出结果。Thresholds 有效时一并写入，用于更新基线时保留按项设置的阈值。*/
+	bool WriteResults(const FString& Filename, const TSharedPtr<FJsonObject>& Thresholds = nullptr) const;
+
+	// 结果按加入顺序保存，数值越小越好。
+	TArray<TPair<FString, double>> Results;
+};
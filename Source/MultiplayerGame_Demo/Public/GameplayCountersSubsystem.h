@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "GameplayCountersSubsystem.generated.h"
+
+/**
+ * 玩法热点的实时计数器：飞行中的投射物数量、每秒开火次数、每秒伤害事件数以及网络发送的字节数。
+ * 每帧写入 "stat MultiplayerGame" 与CSV分析器的 MultiplayerGame 分类，
+ * 无头服务器上用 -csvCaptureFrames=N（或控制台命令 csvprofile start / stop）即可把它们与每个类复制的字节数一起导出为CSV。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API UGameplayCountersSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	// End of USubsystem interface
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	/** 投射物Actor进入（+1）或离开（-1）飞行状态。由 AThirdPersonMPProjectile 调用。*/
+	void AddActiveProjectileActors(int32 Delta) { NumActiveProjectileActors += Delta; }
+
+	/** 服务器处理了一次开火。*/
+	void RecordShot() { ++ShotsThisFrame; }
+
+	/** 服务器结算了一次伤害。*/
+	void RecordDamageEvent() { ++DamageEventsThisFrame; }
+
+	/** 输出当前计数（mp.Stats.Counters）。*/
+	void LogCounters() const;
+
+private:
+	// 飞行中的投射物Actor（不含轻量级模拟中的投射物，后者从 UProjectileSimulationSubsystem 读取）
+	int32 NumActiveProjectileActors = 0;
+
+	int32 ShotsThisFrame = 0;
+	int32 DamageEventsThisFrame = 0;
+
+	// 按1秒窗口统计的速率
+	float WindowSeconds = 0.0f;
+	int32 ShotsInWindow = 0;
+	int32 DamageEventsInWindow = 0;
+	float ShotsPerSecond = 0.0f;
+	float DamageEventsPerSecond = 0.0f;
+
+	// 最近一帧的采样
+	int32 NumActiveProjectiles = 0;
+	int32 NetOutBytesPerSecond = 0;
+};
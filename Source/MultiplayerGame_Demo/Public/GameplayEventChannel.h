@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include <atomic>
+#include <type_traits>
+
+/** 玩法事件类型。数值写入日志文件，只能在末尾追加。*/
+enum class EGameplayEventType : uint8
+{
+	// 生命值变化：Value 为新的生命值，Delta 为变化量
+	HealthChanged,
+	// 角色被击杀：Instigator 为击杀者
+	Killed,
+	// 服务器处理了一次开火：Location 为投射物生成位置
+	Fired,
+	// 角色重生：Value 为死亡到重生的时间，Location 为出生点
+	Respawned,
+	// 投射物撞击：Subject 为被撞击的Actor（撞到场景时为场景Actor或0），Instigator 为射击者，Value 为投射物伤害
+	Impact,
+	// 伤害结算结果：Value 为实际扣除的生命值，Delta 为请求的伤害，Instigator 为攻击者
+	Damaged,
+	// 角色位置采样（UMatchRecorderSubsystem 定期记录）：Value 为朝向Yaw
+	Transform,
+	// 角色与玩家的对应关系（每次录制中每个角色一次）：Value 为 PlayerState 的 PlayerId
+	Identity,
+};
+
+/**
+ * 一条玩法事件记录。只包含数值，不含字符串或指针，可以直接按字节复制。写入文件时逐个字段写出，不含对齐填充。
+ * Actor 使用 UObject::GetUniqueID() 标识，同一进程内唯一。
+ */
+struct FGameplayEventRecord
+{
+	// 世界时间（秒）
+	float WorldTime = 0.0f;
+
+	uint32 SubjectId = 0;
+	uint32 InstigatorId = 0;
+
+	float Value = 0.0f;
+	float Delta = 0.0f;
+
+	FVector Location = FVector::ZeroVector;
+
+	EGameplayEventType Type = EGameplayEventType::HealthChanged;
+};
+
+static_assert(std::is_trivially_copyable<FGameplayEventRecord>::value, "FGameplayEventRecord must stay trivially copyable");
+
+/**
+ * 固定容量的单生产者单消费者无锁环形缓冲区。
+ * 生产者（游戏线程）写入时只做一次拷贝和一次原子存储，从不加锁、不分配内存；满了就丢弃并返回 false。
+ */
+template<typename ItemType, uint32 Capacity>
+class TGameplayEventRing
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	/** 生产者线程调用。*/
+	bool TryPush(const ItemType& Item)
+	{
+		const uint32 CurrentHead = Head.load(std::memory_order_relaxed);
+		if (CurrentHead - Tail.load(std::memory_order_acquire) >= Capacity)
+		{
+			return false;
+		}
+
+		Items[CurrentHead & (Capacity - 1)] = Item;
+		Head.store(CurrentHead + 1, std::memory_order_release);
+		return true;
+	}
+
+	/** 消费者线程调用，最多取出 MaxItems 条，返回取出的数量。*/
+	int32 PopBatch(ItemType* OutItems, int32 MaxItems)
+	{
+		const uint32 CurrentTail = Tail.load(std::memory_order_relaxed);
+		const uint32 Available = Head.load(std::memory_order_acquire) - CurrentTail;
+		const int32 NumItems = FMath::Min<int32>(Available, MaxItems);
+
+		for (int32 Index = 0; Index < NumItems; ++Index)
+		{
+			OutItems[Index] = Items[(CurrentTail + Index) & (Capacity - 1)];
+		}
+
+		Tail.store(CurrentTail + NumItems, std::memory_order_release);
+		return NumItems;
+	}
+
+private:
+	ItemType Items[Capacity];
+
+	// 生产者和消费者的索引放在不同的缓存行，避免伪共享
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> Head{ 0 };
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> Tail{ 0 };
+};
+
+/** 事件的消费者，在后台线程上按批次接收事件。*/
+class IGameplayEventSink
+{
+public:
+	virtual ~IGameplayEventSink() {}
+
+	virtual void Consume(TArrayView<const FGameplayEventRecord> Records) = 0;
+
+	/** 后台线程停止前调用。*/
+	virtual void Flush() {}
+};
+
+/**
+ * 玩法事件通道（生命值变化、击杀、开火）。
+ * 游戏线程通过 Push 把记录写入无锁环形缓冲区，后台线程定期取出并交给各个消费者，
+ * 默认消费者按 mp.Events.Log 写入 Saved/Logs 下的二进制或 CSV 文件。
+ * 伤害处理路径上的开销与是否有人读取这些事件无关：没有格式化字符串，也没有内存分配。
+ */
+class MULTIPLAYERGAME_DEMO_API FGameplayEventChannel : public FRunnable
+{
+public:
+	static FGameplayEventChannel& Get();
+
+	/** 记录一条事件。只能在游戏线程调用；通道未启用或没有消费者时直接返回。*/
+	void Push(EGameplayEventType Type, const UObject* Subject, const UObject* Instigator, float Value, float Delta = 0.0f, const FVector& Location = FVector::ZeroVector);
+
+	/** 添加一个消费者（游戏线程）。添加后通道即被启用。*/
+	void AddSink(TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe> Sink);
+
+	/** 移除消费者（游戏线程）。返回时后台线程已不再使用它。*/
+	void RemoveSink(TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe> Sink);
+
+	/** 停用消费者（游戏线程），不等待。后台线程把调用前推入的事件交给它之后，在后台线程上调用 Flush 并移除，文件的收尾写入不会阻塞游戏线程。*/
+	void RetireSink(TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe> Sink);
+
+	/** 停止后台线程，写完剩余事件并关闭文件。模块卸载时调用。*/
+	void Shutdown();
+
+	/** 把计数器输出到日志（控制台命令 mp.Events.Stats）。*/
+	void LogStats() const;
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	// End of FRunnable interface
+
+private:
+	FGameplayEventChannel() = default;
+
+	/** 通道是否需要接收事件：有日志文件或其他消费者（启动前按 mp.Events.Log 判断）。*/
+	bool IsEnabled() const;
+
+	/** 启动后台线程；按 mp.Events.Log 创建日志文件消费者。*/
+	void Start();
+
+	/** 后台线程：取出所有待处理的事件并交给消费者。*/
+	void Drain();
+
+	/** 后台线程：先取出待停用的消费者，再处理完此前的事件，最后对它们调用 Flush 并移除。*/
+	void DrainAndRetireSinks();
+
+	static constexpr uint32 RingCapacity = 16384;
+	static constexpr int32 DrainBatchSize = 1024;
+
+	TGameplayEventRing<FGameplayEventRecord, RingCapacity> Ring;
+
+	FRunnableThread* Thread = nullptr;
+	std::atomic<bool> bStopping{ false };
+	bool bRunning = false;
+
+	mutable FCriticalSection SinksCriticalSection;
+	TArray<TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe>> Sinks;
+	TArray<TSharedRef<IGameplayEventSink, ESPMode::ThreadSafe>> RetiringSinks;
+	int32 NumExternalSinks = 0;
+	// 是否按 mp.Events.Log 创建了日志文件消费者，它在 Shutdown 前一直存在
+	bool bHasFileSink = false;
+
+	// 后台线程使用的批次缓冲
+	FGameplayEventRecord DrainBuffer[DrainBatchSize];
+
+	uint64 NumPushed = 0;
+	uint64 NumDropped = 0;
+	std::atomic<uint64> NumConsumed{ 0 };
+};
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ImpactEffectSubsystem.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+
+/**
+ * 客户端撞击特效管理器（专用服务器上不创建）。
+ * 一帧内排队的撞击在帧末统一处理：
+ * 同一位置附近（mp.Impact.MergeDistance）的同一种特效合并为一次；超出 mp.Impact.CullDistance 的直接丢弃，
+ * 超出 mp.Impact.LowDetailDistance 的使用低细节LOD；按距离由近到远最多生成 mp.Impact.MaxPerFrame 个。
+ * 特效组件来自固定大小的组件池，不再为每次撞击创建和销毁组件。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API UImpactEffectSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override { return PendingImpacts.Num() > 0; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	/** 在指定位置排队一次撞击特效，帧末统一处理。Effect 为空时忽略。*/
+	void QueueImpact(UParticleSystem* Effect, const FVector& Location);
+
+private:
+	struct FPendingImpact
+	{
+		UParticleSystem* Effect;
+		FVector Location;
+		float DistanceSquared;
+	};
+
+	/** 本地玩家的摄像机位置。*/
+	bool GetViewLocation(FVector& OutViewLocation) const;
+
+	/** 从组件池取一个空闲组件；没有空闲组件时复用最早播放的那个。*/
+	UParticleSystemComponent* AcquireComponent();
+
+	void SpawnImpact(const FPendingImpact& Impact, bool bLowDetail);
+
+	// 本帧排队的撞击
+	TArray<FPendingImpact> PendingImpacts;
+
+	// 合并时使用的格子集合，保留容量避免每帧分配
+	TSet<TTuple<FIntVector, UParticleSystem*>> MergeCells;
+
+	// 组件池及其所属的临时Actor
+	UPROPERTY(Transient)
+	AActor* PoolActor;
+
+	UPROPERTY(Transient)
+	TArray<UParticleSystemComponent*> ComponentPool;
+
+	// 下一个检查或复用的池索引
+	int32 NextPoolIndex = 0;
+};
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class AMultiplayerGame_DemoCharacter;
+
+// 某一帧中一个角色胶囊体的记录。胶囊体始终保持竖直，所以只需记录中心与尺寸。
+struct FLagCompensationSample
+{
+	FVector Location;
+	float Radius;
+	float HalfHeight;
+
+	// 半径为0表示该槽位在这一帧中没有角色。
+	bool IsValid() const { return Radius > 0.0f; }
+};
+
+/**
+ * 固定容量的胶囊体历史环形缓冲区。
+ * 按 [帧][槽位] 连续存放，回溯某一时刻时只需访问相邻两帧的两段连续内存。
+ * 不依赖任何Actor，便于在无头环境中单独测试与测量。
+ */
+struct MULTIPLAYERGAME_DEMO_API FLagCompensationHistory
+{
+	// 服务器使用的历史帧数。按60Hz计算约可保存1秒，超过 mp.LagComp.MaxRewind 的上限。
+	static constexpr int32 DefaultNumFrames = 64;
+
+	FLagCompensationHistory();
+
+	/** 设置保存的帧数与初始槽位数量，并清空历史。*/
+	void Init(int32 InNumFrames, int32 InSlotCapacity);
+
+	/** 分配一个槽位，容量不足时扩容。*/
+	int32 AllocateSlot();
+
+	/** 释放槽位并清空它在所有历史帧中的样本，之后分配到此槽位的角色不会继承离开者的位置。*/
+	void FreeSlot(int32 Slot);
+
+	/** 开始记录新的一帧（覆盖最旧的一帧），返回该帧全部槽位的样本数组，长度为 GetSlotCapacity()。*/
+	FLagCompensationSample* BeginFrame(float Time);
+
+	/** 取得槽位在指定时刻的胶囊体（相邻两帧线性插值）。时间会被限制在已记录的范围内。*/
+	bool GetSampleAtTime(int32 Slot, float Time, FLagCompensationSample& OutSample) const;
+
+	/**
+	 * 用指定时刻的胶囊体检测球体扫掠。
+	 * @return 最先接触的槽位，未命中返回 INDEX_NONE。OutHitTime 为沿扫掠方向的接触比例（0~1）。
+	 */
+	int32 SweepAtTime(float Time, const FVector& Start, const FVector& End, float SweepRadius, int32 IgnoredSlot, float& OutHitTime) const;
+
+	int32 GetSlotCapacity() const { return SlotCapacity; }
+	int32 GetNumRecordedFrames() const { return NumRecorded; }
+	float GetNewestTime() const;
+	float GetOldestTime() const;
+
+	/** 球体沿线段扫掠与竖直胶囊体的首次接触。*/
+	static bool SweepSphereCapsule(const FVector& Start, const FVector& End, float SweepRadius, const FLagCompensationSample& Capsule, float& OutHitTime);
+
+private:
+	/** 逻辑帧下标（0为最旧）对应的物理帧下标。*/
+	int32 GetPhysicalFrame(int32 LogicalFrame) const;
+
+	/** 找到包含 Time 的相邻两帧与插值系数。*/
+	bool FindFrames(float Time, int32& OutFrameA, int32& OutFrameB, float& OutAlpha) const;
+
+	/** 调整槽位容量，保留已记录的历史。*/
+	void GrowSlots(int32 NewSlotCapacity);
+
+	TArray<float> FrameTimes;
+	TArray<FLagCompensationSample> Samples;
+	TBitArray<> SlotsInUse;
+	int32 NumFrames;
+	int32 SlotCapacity;
+	int32 NewestFrame;
+	int32 NumRecorded;
+};
+
+// 回溯命中结果。
+struct FLagCompensationHit
+{
+	AMultiplayerGame_DemoCharacter* Character = nullptr;
+	FVector Location = FVector::ZeroVector;
+	float Time = 1.0f;
+};
+
+/**
+ * 服务器端延迟补偿。
+ * 每帧记录所有 AMultiplayerGame_DemoCharacter 的胶囊体，开火时将目标回溯到客户端开火的时刻再做命中检测，
+ * 玩家不再需要按自己的延迟提前量瞄准。最大回溯时间由 mp.LagComp.MaxRewind 限制。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API ULagCompensationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	ULagCompensationSubsystem();
+
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	/** 开始记录角色的胶囊体历史。仅在服务器上调用。*/
+	void RegisterCharacter(AMultiplayerGame_DemoCharacter* Character);
+
+	/** 停止记录角色的胶囊体历史。*/
+	void UnregisterCharacter(AMultiplayerGame_DemoCharacter* Character);
+
+	/** 根据客户端时间戳计算应回溯的秒数，已限制在 [0, MaxRewind] 内。*/
+	float GetRewindSeconds(float ClientTimeStamp) const;
+
+	/** 将所有角色回溯 RewindSeconds 秒后检测球体扫掠，Shooter 不参与检测。*/
+	bool RewindSweep(float RewindSeconds, const FVector& Start, const FVector& End, float SweepRadius, const AMultiplayerGame_DemoCharacter* Shooter, FLagCompensationHit& OutHit) const;
+
+private:
+	FLagCompensationHistory History;
+
+	// 槽位 -> 角色
+	TArray<TWeakObjectPtr<AMultiplayerGame_DemoCharacter>> SlotCharacters;
+};
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "LoadTestBotController.generated.h"
+
+/** 负载测试机器人的输入脚本。*/
+UENUM()
+enum class ELoadTestBotScript : uint8
+{
+	// 随机选择方向、转向和停顿
+	Random,
+	// 一直前进并匀速转向，绕圈移动
+	Circle,
+	// 前进的同时左右来回平移
+	Strafe,
+};
+
+/** 机器人一帧的输入，与玩家的 MoveForward / MoveRight / StartFire 绑定一一对应。*/
+struct FLoadTestBotInput
+{
+	float Forward = 0.0f;
+	float Right = 0.0f;
+
+	// 本帧控制器的偏航变化（度）
+	float YawDelta = 0.0f;
+
+	bool bFire = false;
+};
+
+/**
+ * 机器人的输入生成器。服务器上的 ALoadTestBotController 和客户端机器人模式（-LoadTestBot）共用。
+ * 相同的脚本和随机种子会产生相同的输入序列，便于对比多次测试的结果。
+ */
+struct MULTIPLAYERGAME_DEMO_API FLoadTestBotBrain
+{
+	void Init(ELoadTestBotScript InScript, int32 Seed, float InFiresPerSecond);
+
+	/** 生成下一帧的输入。*/
+	FLoadTestBotInput Update(float DeltaTime);
+
+	/** 解析命令行中的脚本名（random / circle / strafe），无法识别时返回 Random。*/
+	static ELoadTestBotScript ParseScript(const FString& ScriptName);
+
+private:
+	ELoadTestBotScript Script = ELoadTestBotScript::Random;
+	FRandomStream Random;
+	float FiresPerSecond = 2.0f;
+	float Time = 0.0f;
+	float TimeUntilNextDecision = 0.0f;
+	FLoadTestBotInput Current;
+};
+
+/**
+ * 负载测试用的服务器端机器人。由 ULoadTestSubsystem 生成并占有一个默认Pawn，
+ * 每帧用 FLoadTestBotBrain 生成输入，通过 AMultiplayerGame_DemoCharacter::ApplyBotInput 驱动角色的移动和开火。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API ALoadTestBotController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	ALoadTestBotController();
+
+	/** 设置输入脚本和随机种子。*/
+	void InitBrain(ELoadTestBotScript Script, int32 Seed, float FiresPerSecond);
+
+	// AActor interface
+	virtual void Tick(float DeltaTime) override;
+	// End of AActor interface
+
+private:
+	FLoadTestBotBrain Brain;
+};
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "LoadTestBotController.h"
+#include "LoadTestSubsystem.generated.h"
+
+/** 一个连接在一个阶段内的平均带宽。*/
+struct FLoadTestConnectionResult
+{
+	FString Name;
+	double OutBytesPerSecond = 0.0;
+	double InBytesPerSecond = 0.0;
+
+	// 本阶段内的采样次数
+	int32 NumSamples = 0;
+};
+
+/** 负载测试一个阶段（固定机器人数量）的结果。*/
+struct FLoadTestStepResult
+{
+	int32 NumBots = 0;
+	int32 NumConnections = 0;
+	float Seconds = 0.0f;
+
+	// 服务器帧时间（毫秒）
+	float FrameMsP50 = 0.0f;
+	float FrameMsP90 = 0.0f;
+	float FrameMsP99 = 0.0f;
+	float FrameMsMax = 0.0f;
+
+	// 超出目标Tick间隔（含10%余量）的帧所占比例
+	float OverBudgetFraction = 0.0f;
+
+	int32 PeakProjectiles = 0;
+	double PeakUsedPhysicalMB = 0.0;
+
+	TArray<FLoadTestConnectionResult> Connections;
+};
+
+/**
+ * 无头负载测试。
+ * 服务器（-LoadTest）：按阶段逐步增加服务器端机器人（ALoadTestBotController），每个阶段统计服务器帧时间分位数、
+ * 每个连接的收发字节数、飞行中的投射物数量和内存占用，全部阶段结束后把 CSV 和 JSON 报告写入 Saved/LoadTest 并退出。
+ * 报告中记录第一个无法保持目标Tick频率的阶段，即服务器能承载的玩家数量上限。
+ * 客户端（-LoadTestBot）：用同样的输入脚本驱动本地玩家的角色，配合 -nullrhi 启动多个进程，通过回环地址产生真实的网络负载。
+ *
+ * 服务器命令行参数：
+ *   -LoadTestBots=N          服务器端机器人总数（默认0，只统计真实客户端）
+ *   -LoadTestBotStep=K       每个阶段增加的机器人数量（默认一次全部加入）
+ *   -LoadTestStepSeconds=S   每个阶段的时长（默认30）
+ *   -LoadTestWarmupSeconds=W 每个阶段开始后不计入统计的时间（默认3）
+ *   -LoadTestReport=Name     报告文件名前缀（默认 LoadTest）
+ *   -LoadTestNoExit          结束后不退出
+ * 共用参数：-LoadTestScript=random|circle|strafe、-LoadTestSeed=N、-LoadTestFiresPerSecond=F
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API ULoadTestSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	// End of USubsystem interface
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+private:
+	/** 客户端机器人模式：驱动本地玩家的角色。*/
+	void TickClientBot(float DeltaTime);
+
+	/** 服务器：采样当前阶段，阶段结束时汇总并进入下一阶段。*/
+	void TickServer(float DeltaTime);
+
+	/** 服务器：开始新阶段，把机器人补足到 NumBots。*/
+	void BeginStep(int32 NumBots);
+
+	/** 服务器：汇总当前阶段的采样。*/
+	void FinishStep();
+
+	/** 生成一个机器人并占有一个默认Pawn；Pawn死亡后也用它重新生成。*/
+	void SpawnBotPawn(class ALoadTestBotController* Bot);
+
+	/** 每秒一次：采样连接带宽、投射物数量和内存。*/
+	void SampleSlowCounters();
+
+	/** 把所有阶段写入 CSV 和 JSON。*/
+	void WriteReport() const;
+
+	// 服务器负载测试 / 客户端机器人模式
+	bool bServerLoadTest = false;
+	bool bClientBot = false;
+
+	// 命令行参数
+	int32 TotalBots = 0;
+	int32 BotStep = 0;
+	float StepSeconds = 30.0f;
+	float WarmupSeconds = 3.0f;
+	ELoadTestBotScript Script = ELoadTestBotScript::Random;
+	int32 Seed = 0;
+	float FiresPerSecond = 2.0f;
+	FString ReportName;
+	bool bExitWhenDone = true;
+
+	// 客户端机器人的输入生成器
+	FLoadTestBotBrain ClientBrain;
+
+	// 服务器状态
+	bool bStarted = false;
+	bool bFinished = false;
+	float StepTime = 0.0f;
+	float TimeUntilSlowSample = 0.0f;
+	float TargetFrameMs = 0.0f;
+
+	UPROPERTY(Transient)
+	TArray<class ALoadTestBotController*> Bots;
+
+	// 当前阶段的采样
+	TArray<float> FrameMsSamples;
+	TMap<FString, FLoadTestConnectionResult> ConnectionSums;
+	int32 NumSlowSamples = 0;
+	FLoadTestStepResult CurrentStep;
+
+	TArray<FLoadTestStepResult> Steps;
+};
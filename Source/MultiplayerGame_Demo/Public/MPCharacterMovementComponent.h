@@ -0,0 +1,213 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "RpcRateLimitSubsystem.h"
+#include "MPCharacterMovementComponent.generated.h"
+
+class UMPCharacterMovementComponent;
+
+// 一次开火输入。
+struct FFireInputEntry
+{
+	// 客户端递增的开火序号，服务器据此去重并限制射速。
+	uint16 Sequence = 0;
+
+	// 开火时客户端估算的服务器时间，用于延迟补偿。
+	float TimeStamp = 0.0f;
+
+	// 客户端是否已在本地预测了这次开火（见 UProjectileSimulationSubsystem::FirePredictedProjectile），服务器据此回传确认。
+	bool bPredicted = false;
+
+	// 客户端：还需要随移动包重复发送的次数。
+	uint8 SendsRemaining = 0;
+};
+
+/**
+ * 随移动包发送的开火输入窗口：最近几次尚未发送够次数的开火，按序号从旧到新排列。
+ * 每次开火会在接下来的若干个移动包中重复发送，丢包时无需可靠重传。
+ */
+struct MULTIPLAYERGAME_DEMO_API FFireInputPacket
+{
+	// 单个包中最多携带的开火次数。
+	static const int32 MaxEntries = 4;
+
+	TArray<FFireInputEntry, TInlineAllocator<MaxEntries>> Entries;
+
+	int32 Num() const { return Entries.Num(); }
+
+	/** 最新一次发送完整序号，其余发送与后一次的序号间隔（连续时 1 位）；时间戳以相对最新一次的毫秒数发送。*/
+	void Serialize(FArchive& Ar);
+};
+
+/**
+ * 携带开火输入的移动数据。开火输入只随 NewMove 发送。
+ * 每个移动以一位格式标志开头：紧凑格式（mp.Move.Compact）或引擎默认格式，服务器按标志解码，两端的设置不必一致。
+ */
+struct MULTIPLAYERGAME_DEMO_API FMPCharacterNetworkMoveData : public FCharacterNetworkMoveData
+{
+	typedef FCharacterNetworkMoveData Super;
+
+	FFireInputPacket FireInput;
+
+	// 这个移动是否以紧凑格式发送。
+	bool bCompact = false;
+
+	virtual void ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType) override;
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
+
+private:
+	/**
+	 * 紧凑格式：加速度按最大加速度量化为每轴 8 位，没有输入时只占 1 位；
+	 * 控制器朝向只发送偏航与俯仰（各 16 位），翻滚为零时只占 1 位；
+	 * 跳跃与下蹲标志各 1 位；位置以 1 毫米精度发送且只随 NewMove 发送（服务器只在 NewMove 上检查误差）。
+	 */
+	void SerializeCompact(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, ENetworkMoveType MoveType);
+};
+
+// 服务器：一种移动包格式的接收统计，用于对比紧凑格式与引擎默认格式的带宽与纠正率。
+struct MULTIPLAYERGAME_DEMO_API FMPMoveNetStats
+{
+	uint32 Packets = 0;
+	uint64 Bits = 0;
+	// 服务器检查客户端位置的次数与其中需要纠正的次数
+	uint32 Checks = 0;
+	uint32 Corrections = 0;
+	// 超出接收令牌桶、未处理就丢弃的包数（计入这个连接最近一个包的格式）
+	uint32 Dropped = 0;
+	// 以这种格式收包的时长（秒），两个包之间的间隔计入后一个包的格式
+	float Seconds = 0.0f;
+
+	void Accumulate(const FMPMoveNetStats& Other);
+};
+
+struct MULTIPLAYERGAME_DEMO_API FMPCharacterNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
+{
+	typedef FCharacterNetworkMoveDataContainer Super;
+
+	FMPCharacterNetworkMoveDataContainer();
+
+	virtual void ClientFillNetworkMoveData(const FSavedMove_Character* ClientNewMove, const FSavedMove_Character* ClientPendingMove, const FSavedMove_Character* ClientOldMove) override;
+
+	// 提供待发送开火输入的移动组件。
+	UMPCharacterMovementComponent* OwnerMovement = nullptr;
+
+	FMPCharacterNetworkMoveData MoveData[3];
+};
+
+/**
+ * 项目的角色移动组件。
+ * 开火请求打包进已有的不可靠移动RPC（ServerMovePacked），并在之后的几个包中冗余发送，
+ * 取代每次开火一个可靠的 HandleFire RPC，丢包时不会占满可靠缓冲区导致连接卡住。
+ *
+ * 移动本身以紧凑格式发送（见 FMPCharacterNetworkMoveData::SerializeCompact）。客户端的加速度在保存移动时就按同样的精度量化，
+ * 两端模拟的是同一个输入，量化不会引起纠正；量化后相同的连续移动也更容易被引擎合并。
+ * 客户端按连接用令牌桶限制每秒的移动包数（mp.Move.MaxSendRate）：预算用完时新移动暂存，并放宽合并条件，
+ * 加速度不同的移动也合并进暂存的移动；开火、跳跃等无法合并的输入仍立即发送，透支之后的预算。
+ * 服务器把收到的移动包排队，在同一帧稍后由 UTickAggregationSubsystem 对所有角色批量处理（mp.Move.BatchServerMoves），
+ * 处理仍早于向客户端发送纠正。服务器也按同样的频率用令牌桶检查收到的包，超出 mp.Move.ReceiveBurst 的包直接丢弃。
+ * 实际的包频率与丢弃数见服务器上的 mp.Move.Stats。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API UMPCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UMPCharacterMovementComponent();
+
+	// INetworkPredictionInterface
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	// End of INetworkPredictionInterface
+
+	/** 按当前移动格式的精度取整加速度。客户端保存移动时调用，基准测试也用它生成与客户端相同的输入。*/
+	virtual FVector RoundAcceleration(FVector InAccel) const override;
+
+	/** 客户端：这个连接的移动包发送预算是否已用完。用完时暂存的移动放宽合并条件。*/
+	bool IsMoveSendBudgetExhausted() const;
+
+	/** 是否可以通过移动包发送开火输入（需要开启 p.NetUsePackedMovementRPCs）。*/
+	static bool CanSendFireInputWithMoves();
+
+	/** 客户端：分配下一个开火序号。随移动包发送和通过 HandleFire 发送的开火共用同一个序号。*/
+	uint16 AllocateFireSequence() { return NextFireSequence++; }
+
+	/** 客户端：记录一次开火，随后的移动包会携带它。返回这次开火的序号。*/
+	uint16 QueueFireInput(float TimeStamp, bool bPredicted);
+
+	/** 客户端：是否还有需要发送的开火输入。*/
+	bool HasPendingFireInput() const { return PendingFireInput.Num() > 0; }
+
+	/** 客户端：填充即将发送的开火输入窗口。*/
+	void BuildFireInputPacket(FFireInputPacket& OutPacket) const;
+
+	/** 服务器：这个连接按格式（0 默认，1 紧凑）的移动包统计。*/
+	FMPMoveNetStats GetMoveNetStats(bool bCompact) const;
+
+	/** 服务器：清零移动包统计。*/
+	void ResetMoveNetStats();
+
+	/** 输出世界中所有角色按格式汇总的移动带宽与纠正率（mp.Move.Stats）。*/
+	static void LogMoveNetStats(UWorld* World);
+
+	/** 清零世界中所有角色的移动包统计（mp.Move.ResetStats）。*/
+	static void ResetMoveNetStats(UWorld* World);
+
+protected:
+	// UCharacterMovementComponent interface
+	virtual void ReplicateMoveToServer(float DeltaTime, const FVector& NewAcceleration) override;
+	virtual bool CanDelaySendingMove(const FSavedMovePtr& NewMove) override;
+	virtual float GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const override;
+	virtual void CallServerMovePacked(const FSavedMove_Character* NewMove, const FSavedMove_Character* PendingMove, const FSavedMove_Character* OldMove) override;
+	virtual void ServerMovePacked_ServerReceive(const FCharacterServerMovePackedBits& PackedBits) override;
+	virtual void ServerMove_PerformMovement(const FCharacterNetworkMoveData& MoveData) override;
+	virtual bool ServerCheckClientError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation, const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
+	// End of UCharacterMovementComponent interface
+
+private:
+	/** 服务器：从接收令牌桶中取一个令牌。返回 false 时这个包超出了频率上限，应当丢弃。*/
+	bool ConsumeMoveReceiveToken();
+
+	/** 服务器：解码并执行一个移动包，记录接收统计。*/
+	void ProcessServerMovePacked(const FCharacterServerMovePackedBits& PackedBits);
+
+	/** 服务器：按到达顺序处理排队的移动包。*/
+	void FlushQueuedServerMoves();
+
+	/** 移动包的批量处理：对本帧收到移动包的所有角色依次处理排队的包。*/
+	static void TickQueuedServerMoves(TArrayView<UObject* const> Components, float DeltaTime);
+
+	FMPCharacterNetworkMoveDataContainer MoveDataContainer;
+
+	// 客户端：尚未发送够次数的开火输入，按序号从旧到新排列。
+	TArray<FFireInputEntry, TInlineAllocator<FFireInputPacket::MaxEntries>> PendingFireInput;
+
+	// 客户端：下一次开火的序号。
+	uint16 NextFireSequence;
+
+	// 客户端：移动包的发送令牌桶。每发送一个包消耗一个令牌，立即发送的输入可以透支到 -mp.Move.SendBurst。
+	FRpcTokenBucket MoveSendBucket;
+
+	// 客户端：令牌桶所属的连接，仅作为键使用。连接变化（例如重新连接）时令牌桶重新装满。
+	const UNetConnection* MoveSendConnection;
+
+	// 服务器：移动包的接收令牌桶。不遵守发送频率上限的客户端超出的包被丢弃，不进入队列。
+	FRpcTokenBucket MoveReceiveBucket;
+
+	// 服务器：接收令牌桶所属的连接，仅作为键使用。
+	const UNetConnection* MoveReceiveConnection;
+
+	// 服务器：本帧收到、等待批量处理的移动包，按到达顺序排列。
+	TArray<FCharacterServerMovePackedBits> QueuedServerMoves;
+
+	// 服务器：按格式（0 默认，1 紧凑）的移动包统计。
+	FMPMoveNetStats MoveNetStats[2];
+
+	// 服务器：上一个移动包到达的时间，-1 表示统计清零后还没有收到。
+	float LastMovePacketTime;
+
+	// 服务器：最近一个移动包的格式，位置检查计入这种格式。
+	bool bLastMoveCompact;
+};
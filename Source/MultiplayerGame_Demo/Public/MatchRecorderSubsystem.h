@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "MatchRecorderSubsystem.generated.h"
+
+class IGameplayEventSink;
+
+/**
+ * 服务器对局录像。开启 mp.Recorder.Enable 或使用 -RecordMatch 启动时创建。
+ * 作为 FGameplayEventChannel 的消费者记录开火、撞击、伤害、击杀与重生事件，并每隔 mp.Recorder.TransformInterval 秒记录一次所有角色的位置。
+ * 编码和写文件都在事件通道的后台线程上完成（见 FMatchRecordingWriter），游戏线程只负责推送事件。
+ * 录像写入 Saved/Recordings，可用 MatchReplay 命令行工具（-run=MatchReplay）查询。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API UMatchRecorderSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override { return !bClientWorld; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	/** 当前录像文件，未在录制时为空。*/
+	const FString& GetFilename() const { return Filename; }
+
+private:
+	/** 创建录像文件并注册为事件通道的消费者。*/
+	void StartRecording();
+
+	/** 停用消费者，剩余事件和文件收尾由后台线程完成。*/
+	void StopRecording();
+
+	/** 记录所有存活角色的位置；第一次见到某个角色时记录它的 PlayerId。*/
+	void SampleTransforms();
+
+	TSharedPtr<IGameplayEventSink, ESPMode::ThreadSafe> Sink;
+	FString Filename;
+
+	float TimeUntilSample = 0.0f;
+
+	// 本次录制中已经记录过 PlayerId 的角色
+	TSet<uint32> IdentifiedCharacters;
+
+	// 客户端世界不录制
+	bool bClientWorld = false;
+};
@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayEventChannel.h"
+
+class FArchive;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * 对局录像文件（.mprec）格式：
+ *   文件头 | 块 | 块 | ... | 块索引 | 文件尾
+ * 每个块由块头和压缩后的记录组成，块内从零状态开始编码，可以单独解码：
+ *   类型(u8) 标志(u8) 时间差毫秒(varint) SubjectId(varint) [InstigatorId(varint)] [Value(zigzag)] [Delta(zigzag)] [位置差 x/y/z(zigzag)]
+ * Value / Delta 以 0.01 为单位量化，位置以厘米为单位量化，并相对同一块内同一 Subject 的上一个位置做差分；为0的字段由标志省略。
+ * 文件尾记录块索引的偏移；录制意外中断没有写出文件尾时，读取端按块头顺序扫描。
+ * 所有结构按本机字节序（小端）直接写入。
+ */
+namespace MatchRecording
+{
+	static constexpr uint32 FileMagic = 0x4352504D;		// "MPRC"
+	static constexpr uint32 ChunkMagic = 0x4B4E4843;	// "CHNK"
+	static constexpr uint32 TrailerMagic = 0x4952504D;	// "MPRI"
+	static constexpr uint32 Version = 1;
+
+	// 记录标志
+	static constexpr uint8 HasInstigator = 1 << 0;
+	static constexpr uint8 HasValue = 1 << 1;
+	static constexpr uint8 HasDelta = 1 << 2;
+	static constexpr uint8 HasLocation = 1 << 3;
+
+	FORCEINLINE uint32 TypeBit(EGameplayEventType Type) { return 1u << (uint32)Type; }
+}
+
+struct FMatchRecordingFileHeader
+{
+	uint32 Magic = MatchRecording::FileMagic;
+	uint32 Version = MatchRecording::Version;
+};
+
+struct FMatchRecordingChunkHeader
+{
+	uint32 Magic = MatchRecording::ChunkMagic;
+	uint32 PayloadBytes = 0;
+	uint32 NumRecords = 0;
+	// 块内出现过的事件类型（MatchRecording::TypeBit），查询时据此跳过无关的块
+	uint32 TypeMask = 0;
+	float StartTime = 0.0f;
+	float EndTime = 0.0f;
+};
+
+struct FMatchRecordingIndexEntry
+{
+	// 块头在文件中的偏移
+	uint64 Offset = 0;
+	uint32 TypeMask = 0;
+	uint32 NumRecords = 0;
+	float StartTime = 0.0f;
+	float EndTime = 0.0f;
+};
+
+struct FMatchRecordingTrailer
+{
+	uint64 IndexOffset = 0;
+	uint32 NumChunks = 0;
+	uint32 Magic = MatchRecording::TrailerMagic;
+};
+
+/**
+ * 录像写入端，在事件通道的后台线程上使用。内存占用固定：当前块的缓冲区（达到 ChunkBytes 或跨越 ChunkSeconds 即写出）、
+ * 块内各 Subject 的上一个位置，以及每块 24 字节的索引。
+ */
+class MULTIPLAYERGAME_DEMO_API FMatchRecordingWriter
+{
+public:
+	/** Writer 的所有权转移给本对象。*/
+	FMatchRecordingWriter(FArchive* InWriter, int32 InChunkBytes, float InChunkSeconds);
+	~FMatchRecordingWriter();
+
+	void Append(const FGameplayEventRecord& Record);
+
+	/** 写出最后一个块、块索引和文件尾，并关闭文件。*/
+	void Finish();
+
+	int64 GetTotalBytes() const { return TotalBytes; }
+
+private:
+	void FlushChunk();
+
+	void WriteVarUInt(uint32 Value);
+	void WriteVarInt(int32 Value);
+
+	TUniquePtr<FArchive> Writer;
+	int32 ChunkBytes;
+	float ChunkSeconds;
+
+	// 当前块
+	FMatchRecordingChunkHeader Chunk;
+	TArray<uint8> Payload;
+	int32 LastRecordMs = 0;
+	TMap<uint32, FIntVector> LastLocations;
+
+	TArray<FMatchRecordingIndexEntry> Index;
+	int64 TotalBytes = 0;
+};
+
+/** 一名角色的伤害汇总。*/
+struct FMatchDamageSummary
+{
+	float DamageDealt = 0.0f;
+	float DamageTaken = 0.0f;
+	int32 Kills = 0;
+	int32 Deaths = 0;
+	int32 ShotsFired = 0;
+};
+
+/**
+ * 录像读取端。以内存映射方式打开文件，只有被查询到的块才会真正读入内存。
+ */
+class MULTIPLAYERGAME_DEMO_API FMatchRecordingReader
+{
+public:
+	FMatchRecordingReader();
+	~FMatchRecordingReader();
+
+	bool Open(const FString& Filename);
+
+	const TArray<FMatchRecordingIndexEntry>& GetChunks() const { return Chunks; }
+
+	/** 文件是否完整（有块索引和文件尾）。*/
+	bool HasTrailer() const { return bHasTrailer; }
+
+	/** 解码一个块，按顺序对每条记录调用 Visitor。块数据损坏时返回 false。*/
+	bool DecodeChunk(int32 ChunkIndex, TFunctionRef<void(const FGameplayEventRecord&)> Visitor) const;
+
+	/** 按 SubjectId 汇总伤害、击杀与开火次数。只解码包含相关事件的块。*/
+	void SumDamage(TMap<uint32, FMatchDamageSummary>& OutSummaries) const;
+
+	/** 读取每个角色对应的 PlayerId。*/
+	void GetIdentities(TMap<uint32, int32>& OutPlayerIds) const;
+
+	/** 角色在 Time 时刻的位置：在前后两个位置采样之间插值，只解码覆盖该时刻的块及其相邻块。*/
+	bool FindLocationAtTime(uint32 SubjectId, float Time, FVector& OutLocation) const;
+
+private:
+	bool ReadIndexFromTrailer();
+	void ScanChunks();
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+
+	TArray<FMatchRecordingIndexEntry> Chunks;
+	bool bHasTrailer = false;
+};
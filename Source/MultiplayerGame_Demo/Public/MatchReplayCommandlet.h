@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MatchReplayCommandlet.generated.h"
+
+/**
+ * 查询对局录像（UMatchRecorderSubsystem 生成的 .mprec 文件），不需要加载地图：
+ *   -run=MatchReplay -File=<录像> [-Query=Summary|Damage|Location] [-Subject=<角色Id> | -Player=<PlayerId>] [-Time=<秒>]
+ * Summary 输出块数量与时间范围；Damage 输出每个角色的伤害、击杀与开火次数；Location 输出角色在 -Time 时刻的位置。
+ */
+UCLASS()
+class UMatchReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMatchReplayCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
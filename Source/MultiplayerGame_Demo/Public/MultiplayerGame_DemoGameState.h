@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameStateBase.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "MultiplayerGame_DemoGameState.generated.h"
+
+class APlayerState;
+
+// 一名玩家在本局中的战斗统计。
+USTRUCT()
+struct FMatchStatsRow : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	// APlayerState::GetPlayerId()
+	UPROPERTY()
+	int32 PlayerId = INDEX_NONE;
+
+	UPROPERTY()
+	int32 Kills = 0;
+
+	UPROPERTY()
+	int32 Deaths = 0;
+
+	UPROPERTY()
+	int32 ShotsFired = 0;
+
+	// 直接命中其他角色的投射物数，每发至多计一次，范围伤害不另外计数，因此不会超过 ShotsFired。
+	UPROPERTY()
+	int32 Hits = 0;
+
+	UPROPERTY()
+	float DamageDealt = 0.0f;
+
+	UPROPERTY()
+	float DamageTaken = 0.0f;
+};
+
+/**
+ * 本局所有玩家的统计表，所有行连续存放在一个数组中。
+ * 使用快速数组序列化：服务器只发送标记为脏的行，客户端收到的流量与玩家人数无关，只与本帧发生变化的玩家数有关。
+ */
+USTRUCT()
+struct FMatchStatsArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FMatchStatsRow> Rows;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FMatchStatsRow, FMatchStatsArray>(Rows, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FMatchStatsArray> : public TStructOpsTypeTraitsBase2<FMatchStatsArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ * 对局状态：复制每名玩家的击杀、死亡、造成与承受的伤害、开火与命中次数。
+ * 统计在服务器上由角色的开火、投射物的撞击与受伤处理直接写入；行在玩家加入时添加，容量在对局开始时一次性预留，对局期间不再分配。
+ */
+UCLASS(config=Game)
+class MULTIPLAYERGAME_DEMO_API AMultiplayerGame_DemoGameState : public AGameStateBase
+{
+	GENERATED_BODY()
+
+public:
+	AMultiplayerGame_DemoGameState();
+
+	// AActor interface
+	virtual void PostInitializeComponents() override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	// End of AActor interface
+
+	// AGameStateBase interface
+	virtual void AddPlayerState(APlayerState* PlayerState) override;
+	// End of AGameStateBase interface
+
+	/** 服务器：Shooter 开了一枪。*/
+	void RecordShot(const APlayerState* Shooter);
+
+	/** 服务器：Shooter 发射的一发投射物撞击到了 HitActor。HitActor 是 Shooter 以外的Pawn时计一次命中。每次撞击调用一次，与造成伤害的次数无关。*/
+	void RecordHit(const APawn* Shooter, const AActor* HitActor);
+
+	/** 服务器：Attacker 对 Victim 造成了 Damage 点伤害，bKilled 表示这次伤害致死。Attacker 可以为空（环境伤害）或与 Victim 相同（自伤）。*/
+	void RecordDamage(const APlayerState* Attacker, const APlayerState* Victim, float Damage, bool bKilled);
+
+	/** 服务器：清零所有统计，并移除已离开的玩家的行（对局重置时使用）。*/
+	void ResetMatchStats();
+
+	/** 查找玩家的统计，没有时返回 nullptr。服务器与客户端都可调用。*/
+	const FMatchStatsRow* FindMatchStats(int32 PlayerId) const;
+
+	TArrayView<const FMatchStatsRow> GetMatchStatsRows() const { return MatchStats.Rows; }
+
+	/** 输出统计表（mp.Match.Stats）。*/
+	void LogMatchStats() const;
+
+protected:
+	/** 对局开始时为统计表预留的行数。超过后仍可添加，但会重新分配并输出警告。*/
+	UPROPERTY(config, EditDefaultsOnly, Category="Match Stats")
+	int32 MatchStatsCapacity;
+
+private:
+	/** 服务器：查找或添加玩家的行，返回下标。*/
+	int32 FindOrAddRow(const APlayerState* PlayerState);
+
+	/** 服务器：行的内容已修改，下一次复制时发送。*/
+	void MarkRowDirty(int32 RowIndex);
+
+	UPROPERTY(Replicated)
+	FMatchStatsArray MatchStats;
+
+	// 服务器：PlayerId -> 行下标
+	TMap<int32, int32> RowIndices;
+};
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BasicReplicationGraph.h"
+#include "MultiplayerGame_DemoReplicationGraph.generated.h"
+
+/**
+ * 本项目的复制图（Replication Graph）。
+ * 角色和投射物放入二维空间网格节点，每个连接只收集视点附近网格中的Actor，
+ * 不再对所有Actor逐个调用 IsNetRelevantFor；GameState 等 bAlwaysRelevant 的Actor放入全局常驻节点。
+ * 服务器网络Tick的开销因此只与局部密度有关，而不是Actor总数。
+ */
+UCLASS(transient, config=Engine)
+class MULTIPLAYERGAME_DEMO_API UMultiplayerGame_DemoReplicationGraph : public UBasicReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UMultiplayerGame_DemoReplicationGraph();
+
+	// UReplicationGraph interface
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	// End of UReplicationGraph interface
+
+	/** 设置Actor在某个连接上的复制频率（换算为复制周期帧数）。由 UNetUpdateRateSubsystem 按连接调整。*/
+	void SetConnectionUpdateFrequency(UNetConnection* Connection, AActor* Actor, float Frequency);
+
+protected:
+	/** 空间网格每个格子的边长（厘米）。*/
+	UPROPERTY(config)
+	float GridCellSize;
+
+	/** 角色的复制裁剪距离（厘米）。*/
+	UPROPERTY(config)
+	float CharacterCullDistance;
+
+	/** 投射物的复制裁剪距离（厘米）。投射物寿命短、速度快，远处的连接不需要它们。*/
+	UPROPERTY(config)
+	float ProjectileCullDistance;
+};
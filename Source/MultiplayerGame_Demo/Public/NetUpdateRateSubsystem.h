@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "NetUpdateRateSubsystem.generated.h"
+
+class UNetConnection;
+
+// 某一类Actor的复制频率范围与每个连接的带宽预算。
+USTRUCT()
+struct FNetUpdateRateClassBudget
+{
+	GENERATED_BODY()
+
+	// 适用的Actor类（包括子类）。
+	UPROPERTY(config, EditAnywhere, Category="Net Update Rate")
+	TSoftClassPtr<AActor> ActorClass;
+
+	// 远处、视野外或静止时的复制频率（Hz）。
+	UPROPERTY(config, EditAnywhere, Category="Net Update Rate")
+	float MinRate = 2.0f;
+
+	// 近处、视野内或刚受到伤害时的复制频率（Hz）。
+	UPROPERTY(config, EditAnywhere, Category="Net Update Rate")
+	float MaxRate = 60.0f;
+
+	// 每次复制的估算字节数，用于按预算缩放频率。
+	UPROPERTY(config, EditAnywhere, Category="Net Update Rate")
+	float EstimatedBytesPerUpdate = 32.0f;
+
+	// 此类Actor在每个连接上的带宽预算（字节/秒），0表示不限制。
+	UPROPERTY(config, EditAnywhere, Category="Net Update Rate")
+	float BytesPerSecondBudget = 0.0f;
+};
+
+/**
+ * 服务器端自适应复制频率。
+ * 按每个连接的视点为角色和投射物计算复制频率：距离近、在视野内或刚受到伤害的Actor使用较高频率，
+ * 远处或静止的Actor降低频率；无人控制且长时间静止的Actor进入休眠。
+ * 使用复制图时按连接设置复制周期，否则设置Actor自身的 NetUpdateFrequency（取所有连接中的最大值）。
+ */
+UCLASS(config=Game)
+class MULTIPLAYERGAME_DEMO_API UNetUpdateRateSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UNetUpdateRateSubsystem();
+
+	/** 是否启用自适应复制频率（控制台变量 mp.Net.AdaptiveUpdateRate）。*/
+	static bool IsEnabled();
+
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	/** Actor的复制状态发生了变化（例如受到伤害）：短时间内提高其复制频率，并唤醒休眠。*/
+	void NotifyActorChanged(AActor* Actor);
+
+protected:
+	/** 重新计算所有受管理Actor在每个连接上的复制频率。*/
+	void UpdateRates();
+
+	/** 按到视点的距离、是否在视野内及最近是否变化计算复制频率。*/
+	float ComputeRate(const FNetUpdateRateClassBudget& Budget, const AActor* Actor, const FVector& ViewLocation, const FVector& ViewDirection, bool bRecentlyChanged, bool bIdle) const;
+
+	/** 开始带宽对比采样（控制台命令 mp.Net.BandwidthReport）。*/
+	void StartBandwidthReport(float SecondsPerPhase);
+
+	/** 重新计算的间隔（秒）。*/
+	UPROPERTY(config)
+	float UpdateInterval;
+
+	/** 在此距离内使用最高频率（厘米）。*/
+	UPROPERTY(config)
+	float NearDistance;
+
+	/** 超过此距离使用最低频率（厘米）。*/
+	UPROPERTY(config)
+	float FarDistance;
+
+	/** 视野半角（度），视野外的Actor频率减半。*/
+	UPROPERTY(config)
+	float ViewHalfAngleDegrees;
+
+	/** 受到伤害后保持最高频率的时间（秒）。*/
+	UPROPERTY(config)
+	float RecentChangeSeconds;
+
+	/** 无人控制的Actor静止多久后进入休眠（秒）。*/
+	UPROPERTY(config)
+	float IdleSecondsBeforeDormant;
+
+	/** 各类Actor的频率范围与带宽预算。*/
+	UPROPERTY(config)
+	TArray<FNetUpdateRateClassBudget> ClassBudgets;
+
+private:
+	struct FActorRateState
+	{
+		float LastChangeTime = 0.0f;
+		float LastActiveTime = 0.0f;
+
+		// 是否由本子系统置为休眠
+		bool bMadeDormant = false;
+	};
+
+	struct FViewPoint
+	{
+		UNetConnection* Connection;
+		FVector Location;
+		FVector Direction;
+	};
+
+	struct FBandwidthSample
+	{
+		double BytesPerSecondSum = 0.0;
+		int32 NumSamples = 0;
+
+		double GetAverage() const { return NumSamples > 0 ? BytesPerSecondSum / NumSamples : 0.0; }
+	};
+
+	/** 无人控制且静止的Pawn进入休眠，重新活动时唤醒。*/
+	void UpdateDormancy(AActor* Actor, FActorRateState& State, bool bShouldBeDormant);
+
+	/** 关闭自适应后的第一次更新中恢复类默认对象的复制频率。*/
+	void RestoreDefaultRates(class UMultiplayerGame_DemoReplicationGraph* ReplicationGraph);
+
+	void TickBandwidthReport(float DeltaTime);
+
+	TMap<TWeakObjectPtr<AActor>, FActorRateState> ActorStates;
+
+	float TimeUntilUpdate;
+
+	// 上一次更新是否设置了自适应频率；关闭后只在第一次更新中恢复默认频率
+	bool bAdaptiveRatesApplied = false;
+
+	// UpdateRates 使用的临时数组，保留容量避免每次分配
+	TArray<FViewPoint> ViewPoints;
+	TArray<AActor*> ClassActors;
+	TArray<bool> ActorRecentlyChanged;
+	TArray<bool> ActorIdle;
+	TArray<float> ActorMaxRates;
+	TArray<float> ConnectionRates;
+
+	// 带宽基准：先以类默认频率采样（基线），再以自适应频率采样。每个世界各自采样，互不影响
+	float BandwidthReportSeconds = 0.0f;
+	bool bBandwidthReportBaseline = false;
+	float BandwidthReportTimeLeft = 0.0f;
+	TMap<UNetConnection*, FBandwidthSample> BaselineSamples;
+	TMap<UNetConnection*, FBandwidthSample> AdaptiveSamples;
+};
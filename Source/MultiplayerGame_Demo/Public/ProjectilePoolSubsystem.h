@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectilePoolSubsystem.generated.h"
+
+class AThirdPersonMPProjectile;
+
+// 投射物对象池的计数器，用于按地图调整预热数量。
+USTRUCT(BlueprintType)
+struct FProjectilePoolStats
+{
+	GENERATED_BODY()
+
+	// 直接从池中取到空闲投射物的次数。
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 Hits = 0;
+
+	// 池中没有空闲投射物、只能新生成的次数。
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 Misses = 0;
+
+	// 同时处于飞行状态的投射物数量峰值。
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 HighWaterMark = 0;
+
+	// 当前处于飞行状态的投射物数量。
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 ActiveCount = 0;
+
+	// 池中投射物总数（飞行中 + 空闲）。
+	UPROPERTY(BlueprintReadOnly, Category="Projectile Pool")
+	int32 TotalCount = 0;
+};
+
+// 同一投射物类的空闲列表。
+USTRUCT()
+struct FProjectilePoolBucket
+{
+	GENERATED_BODY()
+
+	// 等待复用的投射物。
+	UPROPERTY()
+	TArray<AThirdPersonMPProjectile*> FreeProjectiles;
+
+	// 此类在池中的全部投射物。
+	UPROPERTY()
+	TArray<AThirdPersonMPProjectile*> AllProjectiles;
+};
+
+/**
+ * 服务器端投射物对象池。
+ * 预先生成一批投射物，开火时取出、撞击后回收，对局期间不再销毁，
+ * 以避免每发子弹都要生成Actor、注册组件、打开复制通道并产生GC对象。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API UProjectilePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	/** 为指定投射物类预先生成投射物，直到池中数量达到 Count。仅在服务器上调用。*/
+	void Prewarm(TSubclassOf<AThirdPersonMPProjectile> ProjectileClass, int32 Count);
+
+	/** 从池中取出投射物并在指定位置发射。池中没有空闲投射物时会生成新的投射物并加入池中。*/
+	AThirdPersonMPProjectile* AcquireProjectile(TSubclassOf<AThirdPersonMPProjectile> ProjectileClass, const FVector& Location, const FRotator& Rotation, AActor* Owner, APawn* Instigator);
+
+	/** 将投射物回收到池中。bPlayEffect 为 true 时在当前位置播放爆炸特效（撞击），超时或飞出世界时不播放。*/
+	void ReleaseProjectile(AThirdPersonMPProjectile* Projectile, bool bPlayEffect = true);
+
+	/** 把所有飞行中的投射物回收到池中，不播放爆炸特效（对局重置时使用）。返回回收的数量。*/
+	int32 ReleaseAllProjectiles();
+
+	/** 投射物在池外被销毁（EndPlay）时调用：从池中移除并修正计数器。*/
+	void RemoveProjectile(AThirdPersonMPProjectile* Projectile);
+
+	/** 对象池计数器的取值函数。*/
+	UFUNCTION(BlueprintPure, Category="Projectile Pool")
+	FProjectilePoolStats GetStats() const { return Stats; }
+
+	/** 清零命中/未命中计数与峰值，便于按回合统计。*/
+	UFUNCTION(BlueprintCallable, Category="Projectile Pool")
+	void ResetStats();
+
+	/** 将计数器输出到日志。*/
+	void LogStats() const;
+
+private:
+	/** 生成一个处于回收状态的投射物并登记到池中。*/
+	AThirdPersonMPProjectile* SpawnPooledProjectile(UClass* ProjectileClass, FProjectilePoolBucket& Bucket);
+
+	/** 飞行时间分组的批量函数（UTickAggregationSubsystem）：把飞行超过 mp.ProjectilePool.MaxFlightTime 仍未撞击的投射物回收到池中。*/
+	static void TickFlightTimes(TArrayView<UObject* const> Projectiles, float DeltaTime);
+
+	/** 把投射物移出飞行时间分组。*/
+	void StopFlightTimer(AThirdPersonMPProjectile* Projectile);
+
+	// 按投射物类分组的对象池。
+	UPROPERTY(Transient)
+	TMap<UClass*, FProjectilePoolBucket> Buckets;
+
+	FProjectilePoolStats Stats;
+};
@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ProjectileSweepBatch.h"
+#include "ProjectileSimulationSubsystem.generated.h"
+
+class AThirdPersonMPProjectile;
+class UInstancedStaticMeshComponent;
+
+/** 开火者客户端上预测投射物的状态。*/
+enum class EProjectilePrediction : uint8
+{
+	// 不是预测的投射物
+	None,
+	// 已在本地发射，等待服务器确认
+	Pending,
+	// 已与服务器的权威弹道合并
+	Confirmed,
+};
+
+/**
+ * 飞行中投射物的结构数组（SoA）缓冲区。
+ * 每个数组按同一下标对应同一发投射物，删除时各数组同步 RemoveAtSwap。
+ */
+struct FProjectileSimBuffer
+{
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<TWeakObjectPtr<APawn>> Instigators;
+	TArray<float> Damages;
+	TArray<float> Lifetimes;
+	// 提供伤害类型、碰撞半径、重力系数与特效的投射物类默认对象。
+	TArray<const AThirdPersonMPProjectile*> Archetypes;
+	// 发射后经过的时间
+	TArray<float> Ages;
+	// 预测投射物：开火者与预测ID组成的键（见 MakePredictionKey）及其状态
+	TArray<uint64> PredictionKeys;
+	TArray<EProjectilePrediction> PredictionStates;
+	// 绘制位置相对模拟位置的偏移。合并到权威弹道时产生，随后逐渐衰减为0，使修正看起来是平滑的。
+	TArray<FVector> VisualOffsets;
+
+	int32 Num() const { return Positions.Num(); }
+
+	int32 Add(const FVector& Position, const FVector& Velocity, APawn* Instigator, float Damage, float Lifetime, const AThirdPersonMPProjectile* Archetype, uint64 PredictionKey = 0);
+	void RemoveAtSwap(int32 Index);
+	void Reset();
+
+	static uint64 MakePredictionKey(const AActor* Shooter, int32 PredictionId) { return ((uint64)Shooter->GetUniqueID() << 32) | (uint32)PredictionId; }
+
+	/** 查找等待确认的预测投射物，没有时返回 INDEX_NONE。*/
+	int32 FindPendingPrediction(uint64 PredictionKey) const;
+
+	/**
+	 * 把第 Index 发投射物移到权威弹道上：从 Origin 以 LaunchVelocity 发射、已飞行 Elapsed 秒的位置。
+	 * 原位置与新位置之差计入 VisualOffsets，返回修正的距离。
+	 */
+	float Reconcile(int32 Index, const FVector& Origin, const FVector& LaunchVelocity, float Elapsed, float GravityZ);
+
+	/** 视觉偏移按时间常数 CorrectionTime 指数衰减。*/
+	void DecayVisualOffsets(float DeltaTime, float CorrectionTime);
+
+	/** 移除等待确认超过 Timeout 秒的预测投射物（服务器拒绝了开火或确认丢失），返回移除的数量。*/
+	int32 RemoveExpiredPredictions(float Timeout);
+};
+
+/**
+ * 轻量级投射物模拟。
+ * 服务器将所有飞行中的投射物保存在一个SoA缓冲区中，每帧统一推进并做扫掠检测，
+ * 不再为每发子弹生成一个复制的Actor；客户端通过角色的多播开火事件得到发射参数，
+ * 在本地做纯表现的模拟。由控制台变量 mp.Projectile.Lightweight 开启。
+ *
+ * 开启 mp.Projectile.BatchedSweeps 时，服务器上的 AThirdPersonMPProjectile 也交由本子系统统一移动：
+ * 所有投射物的扫掠合并为一批在工作线程上并行执行，再按固定顺序调用 OnProjectileImpact 处理撞击。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API UProjectileSimulationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/** 是否启用轻量级投射物模拟。*/
+	static bool IsEnabled();
+
+	/** 开火者客户端是否在本地预测开火（mp.Fire.Predict）。*/
+	static bool IsFirePredictionEnabled();
+
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	/** 服务器发射一发造成伤害的投射物。伤害、伤害类型、初速度与重力系数取自 Archetype。*/
+	void FireProjectile(const AThirdPersonMPProjectile* Archetype, const FVector& Location, const FRotator& Rotation, APawn* Instigator);
+
+	/** 客户端根据开火事件发射一发只用于表现的投射物。*/
+	void FireCosmeticProjectile(const AThirdPersonMPProjectile* Archetype, const FVector& Location, const FVector& Direction);
+
+	/** 开火者客户端：按下开火的同一帧发射一发预测的表现用投射物，等待服务器以 PredictionId 确认。*/
+	void FirePredictedProjectile(const AThirdPersonMPProjectile* Archetype, const FVector& Location, const FVector& Direction, const AActor* Shooter, int32 PredictionId);
+
+	/**
+	 * 开火者客户端：服务器确认了开火。Origin / Direction 为权威的发射参数，ServerLaunchTime 为投射物位于 Origin 时的服务器时间。
+	 * 把对应的预测投射物合并到权威弹道上；没有找到（已撞击、已超时或重复的确认）时返回 false。
+	 */
+	bool ConfirmPredictedProjectile(const AActor* Shooter, int32 PredictionId, const FVector& Origin, const FVector& Direction, float ServerLaunchTime);
+
+	/** 开火者客户端：服务器丢弃了这一发。立即移除仍在等待确认的预测投射物，不播放特效；没有找到时返回 false。*/
+	bool RejectPredictedProjectile(const AActor* Shooter, int32 PredictionId);
+
+	/** 开火者客户端：权威投射物已经撞击。移除仍在飞行的对应预测投射物并返回 true；预测投射物已自行撞击时返回 false。*/
+	bool EndPredictedProjectile(const AActor* Shooter, int32 PredictionId);
+
+	/** 输出开火预测统计（mp.Fire.PredictionStats）。*/
+	void LogPredictionStats() const;
+
+	/** 当前飞行中的投射物数量。*/
+	int32 GetNumProjectiles() const { return Projectiles.Num(); }
+
+	/** 飞行中投射物的缓冲区（只读），供统计与测试检查。*/
+	const FProjectileSimBuffer& GetProjectileBuffer() const { return Projectiles; }
+
+	/** 当前绘制的投射物实例数量，尚未创建绘制组件时为0。*/
+	int32 GetNumVisualInstances() const;
+
+	struct FPredictionStats
+	{
+		int32 NumPredicted = 0;
+		int32 NumConfirmed = 0;
+		int32 NumExpired = 0;
+		int32 NumRejected = 0;
+		int32 NumUnmatchedConfirms = 0;
+		// 合并时的位置修正
+		float TotalCorrection = 0.0f;
+		float MaxCorrection = 0.0f;
+		// 开火到收到确认的时间（约等于往返延迟）
+		float TotalConfirmSeconds = 0.0f;
+		float MaxConfirmSeconds = 0.0f;
+	};
+
+	/** 开火预测统计（mp.Fire.PredictionStats 输出的数据）。*/
+	const FPredictionStats& GetPredictionStats() const { return PredictionStats; }
+
+	/** 移除所有飞行中的投射物，不造成伤害也不播放特效（对局重置时使用）。返回移除的数量。*/
+	int32 ClearProjectiles();
+
+	/** 由本子系统接管投射物Actor的移动扫掠，并关闭其移动组件的Tick。仅在服务器上调用。*/
+	void RegisterBatchedProjectile(AThirdPersonMPProjectile* Projectile);
+
+	/** 归还投射物Actor的移动控制权。*/
+	void UnregisterBatchedProjectile(AThirdPersonMPProjectile* Projectile);
+
+protected:
+	/** 推进所有投射物并做扫掠检测，返回撞击的投射物下标（按下标升序）。*/
+	void SimulateProjectiles(float DeltaTime, TArray<int32>& OutImpactIndices, TArray<FHitResult>& OutImpactHits);
+
+	/** 批量推进由本子系统接管的投射物Actor，并调用它们的 OnProjectileImpact。*/
+	void SimulateBatchedActors(float DeltaTime);
+
+	/** 处理撞击：服务器上造成伤害，所有机器上播放爆炸特效。*/
+	void HandleImpact(int32 Index, const FHitResult& Hit);
+
+	/** 用实例化静态网格体绘制所有投射物（专用服务器上跳过）。*/
+	void UpdateVisuals();
+
+private:
+	FProjectileSimBuffer Projectiles;
+
+	// 绘制投射物的实例化网格体，按需在本地创建。
+	UPROPERTY(Transient)
+	UInstancedStaticMeshComponent* VisualComponent;
+
+	// 由本子系统接管移动的投射物Actor。
+	TArray<TWeakObjectPtr<AThirdPersonMPProjectile>> BatchedActors;
+
+	FPredictionStats PredictionStats;
+
+	// 复用的临时数组，避免每帧分配。
+	FProjectileSweepBatch SweepBatch;
+	TArray<AThirdPersonMPProjectile*> BatchedActorSnapshot;
+	TArray<int32> ImpactIndices;
+	TArray<FHitResult> ImpactHits;
+	TArray<FTransform> InstanceTransforms;
+};
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+
+class UWorld;
+
+/**
+ * 一帧内所有投射物的移动扫掠请求。
+ * 先收集全部请求，再在工作线程上并行执行场景查询，最后由调用者在游戏线程上按下标顺序处理撞击，
+ * 结果与串行执行一致。
+ */
+struct MULTIPLAYERGAME_DEMO_API FProjectileSweepBatch
+{
+	TArray<FVector> Starts;
+	TArray<FVector> Ends;
+	TArray<float> Radii;
+	TArray<FName> CollisionProfiles;
+	TArray<const AActor*> IgnoredActors;
+
+	// 执行结果，与请求按下标一一对应。
+	TArray<FHitResult> Hits;
+	TArray<bool> bBlockingHits;
+
+	/** 起点处重叠的物体最多忽略几个，超过后视为没有撞击。*/
+	static constexpr int32 MaxStartPenetratingRetries = 2;
+
+	/** 是否启用并行扫掠（控制台变量 mp.Projectile.BatchedSweeps）。*/
+	static bool IsParallelEnabled();
+
+	int32 Num() const { return Starts.Num(); }
+
+	/** 添加一条扫掠请求，返回其下标。*/
+	int32 Add(const FVector& Start, const FVector& End, float Radius, FName CollisionProfile, const AActor* IgnoredActor);
+
+	/** 清空请求，保留已分配的内存。*/
+	void Reset();
+
+	/** 执行所有扫掠。bParallel 为 true 时分散到工作线程上执行。起点就已重叠且正在离开的物体不会作为撞击返回。*/
+	void Execute(const UWorld* World, bool bParallel);
+};
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RpcRateLimitSubsystem.generated.h"
+
+class UNetConnection;
+
+// 受限流的客户端调用类型，每个连接的每种类型各有一个令牌桶。
+enum class ERpcRateLimit : uint8
+{
+	// 开火（HandleFire RPC 与随移动包到达的开火输入）
+	Fire,
+
+	Count
+};
+
+// 一个令牌桶。令牌按速率恢复，上限为突发容量；每次调用消耗一个令牌。
+struct FRpcTokenBucket
+{
+	float Tokens = 0.0f;
+	float LastRefillTime = 0.0f;
+	// 当前是否处于限流状态（上一次调用被拒绝）
+	bool bThrottled = false;
+
+	/** 按距上次恢复经过的时间恢复令牌，不超过突发容量。*/
+	void Refill(float Now, float TokensPerSecond, float BurstSize)
+	{
+		Tokens = FMath::Min(BurstSize, Tokens + FMath::Max(0.0f, Now - LastRefillTime) * TokensPerSecond);
+		LastRefillTime = Now;
+	}
+};
+
+// 一个连接的所有令牌桶与计数。
+struct FRpcRateLimitEntry
+{
+	// 仅作为键使用，不会解引用。nullptr 表示空槽位。
+	const UNetConnection* Connection = nullptr;
+	// 槽位曾被占用又被释放，查找时不能在这里停止
+	bool bRemoved = false;
+
+	FRpcTokenBucket Buckets[(int32)ERpcRateLimit::Count];
+
+	// 被拒绝的调用数
+	uint32 Drops[(int32)ERpcRateLimit::Count];
+	// 从允许转为拒绝的次数
+	uint32 Throttles[(int32)ERpcRateLimit::Count];
+};
+
+/**
+ * 固定容量的连接令牌桶表。以连接指针为键做开放寻址，查找与更新都不分配内存。
+ * 连接数超过容量时，多出的连接共用一个溢出槽位（更严格，但不会放过任何调用）。
+ * 不依赖任何Actor，便于在无头环境中单独测试与测量。
+ */
+struct MULTIPLAYERGAME_DEMO_API FRpcRateLimitTable
+{
+	static constexpr int32 Capacity = 256;
+
+	FRpcRateLimitTable();
+
+	/**
+	 * 尝试为连接的一次调用消耗一个令牌。
+	 * @param TokensPerSecond	令牌恢复速率，即允许的持续调用频率
+	 * @param BurstSize			突发容量，允许网络抖动造成的短时间集中到达
+	 * @return 允许调用时返回 true。
+	 */
+	bool TryConsume(const UNetConnection* Connection, ERpcRateLimit Type, float Now, float TokensPerSecond, float BurstSize);
+
+	/** 连接断开时释放其槽位。*/
+	void RemoveConnection(const UNetConnection* Connection);
+
+	/** 清空所有槽位与计数。*/
+	void Reset();
+
+	/** 查找连接的槽位，没有时返回 nullptr。*/
+	const FRpcRateLimitEntry* Find(const UNetConnection* Connection) const;
+
+	/** 遍历所有占用中的槽位（包括溢出槽位）。*/
+	void ForEachEntry(TFunctionRef<void(const FRpcRateLimitEntry&)> Visitor) const;
+
+	int32 GetNumConnections() const { return NumConnections; }
+
+private:
+	int32 FindSlot(const UNetConnection* Connection) const;
+	FRpcRateLimitEntry& FindOrAddEntry(const UNetConnection* Connection, float Now, float BurstSize);
+
+	static uint32 HashConnection(const UNetConnection* Connection);
+
+	FRpcRateLimitEntry Entries[Capacity];
+	FRpcRateLimitEntry OverflowEntry;
+	int32 NumConnections;
+};
+
+/**
+ * 服务器端按连接、按调用类型的令牌桶限流。
+ * 客户端的调用在产生任何开销（例如生成投射物）之前先在这里检查，超出频率的直接丢弃，
+ * 单个恶意客户端因此无法拖慢服务器。频率取自玩法设置（例如角色的 FireRate），允许的余量与突发容量由 mp.RpcLimit.* 控制。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API URpcRateLimitSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	/**
+	 * 检查连接的一次调用是否在允许的频率内。Connection 为空（服务器本机或机器人）时总是允许。
+	 * @param IntervalSeconds 玩法上两次调用的最小间隔，例如 FireRate
+	 */
+	bool AllowCall(const UNetConnection* Connection, ERpcRateLimit Type, float IntervalSeconds);
+
+	/** 连接断开时调用。*/
+	void RemoveConnection(const UNetConnection* Connection);
+
+	/** 输出允许、丢弃与限流计数，以及丢弃最多的连接（mp.RpcLimit.Stats）。*/
+	void LogStats() const;
+
+private:
+	FRpcRateLimitTable Table;
+
+	uint64 NumAllowed[(int32)ERpcRateLimit::Count] = {};
+	uint64 NumDropped[(int32)ERpcRateLimit::Count] = {};
+};
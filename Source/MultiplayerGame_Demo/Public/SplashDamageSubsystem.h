@@ -0,0 +1,207 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "SplashDamageSubsystem.generated.h"
+
+class AController;
+class AMultiplayerGame_DemoCharacter;
+class AThirdPersonMPProjectile;
+class UDamageType;
+
+// 一次范围查询：以 Origin 为球心、Radius 为半径。
+struct FSplashDamageQuery
+{
+	FVector Origin;
+	float Radius;
+	// 不参与这次查询的槽位（例如已经受到直接命中的角色），没有时为 INDEX_NONE。
+	int32 IgnoredSlot;
+};
+
+// 范围查询的结果：第 Query 次查询覆盖了槽位 Slot，Distance 为球心到胶囊体表面的距离。
+struct FSplashDamageOverlap
+{
+	int32 Query;
+	int32 Slot;
+	float Distance;
+};
+
+/**
+ * 可受伤角色的均匀网格（水平方向分格，竖直方向不分格）。
+ * 位置按槽位以结构数组存放；更新位置时只有跨越格子才修改格子的成员列表。
+ * 查询先按格子收集候选槽位，再用SIMD一次检测4个候选到球心的距离。不依赖任何Actor，便于在无头环境中单独测试与测量。
+ */
+struct MULTIPLAYERGAME_DEMO_API FSplashDamageGrid
+{
+	FSplashDamageGrid();
+
+	/** 设置格子边长并清空所有槽位。*/
+	void Init(float InCellSize);
+
+	/** 分配一个槽位。新槽位不在任何格子中，直到第一次 UpdateSlot。*/
+	int32 AllocateSlot();
+
+	/** 释放槽位，并从所在格子中移除。*/
+	void FreeSlot(int32 Slot);
+
+	/** 更新槽位的竖直胶囊体，必要时移动到新的格子。*/
+	void UpdateSlot(int32 Slot, const FVector& Location, float Radius, float HalfHeight);
+
+	/** 把槽位从格子中移除（例如角色死亡），槽位本身保留。*/
+	void ClearSlot(int32 Slot);
+
+	/** 批量执行范围查询，结果按查询顺序追加到 OutOverlaps。*/
+	void QueryBatch(TArrayView<const FSplashDamageQuery> Queries, TArray<FSplashDamageOverlap>& OutOverlaps);
+
+	int32 GetNumSlots() const { return SlotCells.Num(); }
+	int32 GetNumCells() const { return Cells.Num(); }
+
+	// 自 Init 以来跨越格子的次数，用于观察增量更新的开销。
+	int32 GetNumCellMoves() const { return NumCellMoves; }
+
+private:
+	uint64 GetCellKey(float X, float Y) const;
+
+	/** 格子坐标可以为负，先按无符号数拼接成键，避免对负数左移。*/
+	static uint64 MakeCellKey(int32 CellX, int32 CellY) { return ((uint64)(uint32)CellX << 32) | (uint32)CellY; }
+	void RemoveFromCell(int32 Slot);
+
+	float CellSize;
+	float InvCellSize;
+
+	// 槽位数据
+	TArray<float> SlotX;
+	TArray<float> SlotY;
+	TArray<float> SlotZ;
+	TArray<float> SlotRadii;
+	// 胶囊体轴线的半长（HalfHeight - Radius）
+	TArray<float> SlotHalfAxes;
+	TArray<uint64> SlotCells;
+	TArray<int32> SlotIndicesInCell;
+	TBitArray<> SlotsInCell;
+	TBitArray<> SlotsInUse;
+
+	// 格子 -> 其中的槽位
+	TMap<uint64, TArray<int32>> Cells;
+
+	// 网格中最大的槽位半径，扩大查询范围时使用
+	float MaxSlotRadius;
+
+	int32 NumCellMoves;
+
+	// 复用的候选数组，按4个一组对齐
+	TArray<int32> CandidateSlots;
+	TArray<float> CandidateX;
+	TArray<float> CandidateY;
+	TArray<float> CandidateZ;
+	TArray<float> CandidateHalfAxes;
+	TArray<float> CandidateReach;
+};
+
+/**
+ * 服务器端的爆炸范围伤害。
+ * 所有 AMultiplayerGame_DemoCharacter 登记在 FSplashDamageGrid 中。本帧内的所有爆炸先排队，
+ * 在 Tick 中先按角色的移动增量更新网格，再作为一批统一查询，再按 FRadialDamageParams 的衰减计算伤害，通过 TakeDamage 结算。
+ * mp.Splash.Batched 为0时改用每次爆炸一次物理重叠查询（对照用）。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API USplashDamageSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	USplashDamageSubsystem();
+
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	/** 把角色加入网格。仅在服务器上调用。*/
+	void RegisterCharacter(AMultiplayerGame_DemoCharacter* Character);
+
+	/** 把角色移出网格。*/
+	void UnregisterCharacter(AMultiplayerGame_DemoCharacter* Character);
+
+	/**
+	 * 投射物在 Origin 处爆炸，按 Archetype 的 SplashDamage 造成范围伤害。外半径为0时不做任何事。
+	 * DirectHitActor 已经受到了点伤害，不再受范围伤害。
+	 */
+	void QueueProjectileExplosion(const AThirdPersonMPProjectile* Archetype, const FVector& Origin, AActor* DirectHitActor, AController* InstigatorController, AActor* DamageCauser);
+
+	/** 排队一次范围伤害，在本帧 Tick 中与其他爆炸一起结算。*/
+	void QueueExplosion(const FVector& Origin, const FRadialDamageParams& Params, TSubclassOf<UDamageType> DamageType, AActor* IgnoredActor, AController* InstigatorController, AActor* DamageCauser);
+
+	/** 丢弃本帧尚未结算的爆炸（对局重置时使用）。*/
+	void ClearPendingExplosions() { PendingExplosions.Reset(); }
+
+	/** 输出统计（mp.Splash.Stats）。*/
+	void LogStats() const;
+
+	struct FPendingExplosion
+	{
+		FVector Origin;
+		FRadialDamageParams Params;
+		TSubclassOf<UDamageType> DamageType;
+		TWeakObjectPtr<AActor> IgnoredActor;
+		TWeakObjectPtr<AController> InstigatorController;
+		TWeakObjectPtr<AActor> DamageCauser;
+	};
+
+	// 一次爆炸覆盖到的一名角色
+	struct FSplashDamageTarget
+	{
+		int32 Explosion;
+		AMultiplayerGame_DemoCharacter* Character;
+		float Distance;
+	};
+
+	// 目标收集的两种方式，只查询不造成伤害。Tick 按 mp.Splash.Batched 选择其一，自动化测试比较两者的结果与耗时。
+
+	/** 按角色当前位置增量更新网格。*/
+	void UpdateGrid();
+
+	/** 用网格批量查询收集爆炸覆盖的角色。调用前先 UpdateGrid。*/
+	void CollectTargetsBatched(TArrayView<const FPendingExplosion> Explosions, TArray<FSplashDamageTarget>& OutTargets);
+
+	/** 对每次爆炸做一次物理重叠查询收集覆盖的角色。*/
+	void CollectTargetsWithOverlaps(TArrayView<const FPendingExplosion> Explosions, TArray<FSplashDamageTarget>& OutTargets) const;
+
+private:
+	/** 按衰减计算伤害并通过 TakeDamage 结算。*/
+	void ApplyDamage(TArrayView<const FPendingExplosion> Explosions, TArrayView<const FSplashDamageTarget> Targets);
+
+	FSplashDamageGrid Grid;
+
+	// 槽位 -> 角色
+	TArray<TWeakObjectPtr<AMultiplayerGame_DemoCharacter>> SlotCharacters;
+
+	TArray<FPendingExplosion> PendingExplosions;
+
+	// 复用的临时数组，避免每帧分配。
+	TArray<FPendingExplosion> ExplosionsToResolve;
+	TArray<FSplashDamageQuery> Queries;
+	TArray<FSplashDamageOverlap> Overlaps;
+	TArray<FSplashDamageTarget> Targets;
+
+	struct FSplashStats
+	{
+		int32 NumExplosions = 0;
+		int32 NumBatches = 0;
+		int32 NumTargetsDamaged = 0;
+		float TotalDamage = 0.0f;
+	};
+	FSplashStats Stats;
+};
@@ -4,32 +4,64 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Engine/NetSerialization.h"
 #include "ThirdPersonMPProjectile.generated.h"
 
+// 对象池投射物的复制状态。客户端依靠它在同一个Actor被重复使用时重置位置与移动。
+USTRUCT()
+struct FPooledProjectileState
+{
+	GENERATED_BODY()
+
+	// 是否处于飞行（激活）状态。
+	UPROPERTY()
+	bool bActive = false;
+
+	// 每次激活时递增，保证客户端能区分连续两次激活。
+	UPROPERTY()
+	uint8 ActivationId = 0;
+
+	// 本次激活的发射位置。
+	UPROPERTY()
+	FVector_NetQuantize10 LaunchLocation;
+
+	// 本次激活的发射朝向。
+	UPROPERTY()
+	FRotator LaunchRotation = FRotator::ZeroRotator;
+
+	// 回收时是否播放爆炸特效。对局重置、飞行超时等静默回收为 false，客户端据此跳过特效。
+	UPROPERTY()
+	bool bPlayImpactEffect = false;
+};
+
 UCLASS()
 class MULTIPLAYERGAME_DEMO_API AThirdPersonMPProjectile : public AActor
 {
 	GENERATED_BODY()
-	
-public:	
+
+public:
 	// Sets default values for this actor's properties
 	AThirdPersonMPProjectile();
 
 	// 球形碰撞组件
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components")
 	class USphereComponent* SphereComponent;
-	
-	// 用于提供对象视觉呈现效果的静态网格体。
+
+	// 用于提供对象视觉呈现效果的静态网格体。专用服务器构建中为空。
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components")
 	class UStaticMeshComponent* StaticMesh;
 
+	// StaticMesh 使用的网格体资产。软引用：不在类默认对象构造时加载，由 UAssetPreloadSubsystem 在地图加载时异步加载，专用服务器上不加载。
+	UPROPERTY(EditDefaultsOnly, Category="Components")
+	TSoftObjectPtr<class UStaticMesh> MeshAsset;
+
 	// 用于处理投射物移动的移动组件。
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components")
 	class UProjectileMovementComponent* ProjectileMovementComponent;
 
-	// 在投射物撞击其他对象并爆炸时使用的粒子。
+	// 在投射物撞击其他对象并爆炸时使用的粒子。软引用，只在客户端预加载；尚未加载完成时不播放。
 	UPROPERTY(EditAnywhere, Category="Effects")
-	class UParticleSystem* ExplosionEffect;
+	TSoftObjectPtr<class UParticleSystem> ExplosionEffect;
 
 	// 此投射物将造成的伤害类型和伤害。
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Damage")
@@ -39,20 +71,96 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Damage")
 	float Damage;
 
+	// 爆炸的范围伤害，对直接撞击的Actor以外的角色按距离衰减。OuterRadius 为0时没有范围伤害。由 USplashDamageSubsystem 结算。
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Damage")
+	FRadialDamageParams SplashDamage;
+
 	// 投射物Actor被摧毁时调用此函数
 	virtual void Destroyed() override;
 
+	// 掉出世界（KillZ）或飞出世界边界时，对象池中的投射物回收到池中而不是被销毁。
+	virtual void FellOutOfWorld(const class UDamageType& DmgType) override;
+	virtual void OutsideWorldBounds() override;
+
 	// 投射物撞击对象检测，这是在投射物撞击对象时要调用的函数。
 	UFUNCTION(Category="Projectile")
 	void OnProjectileImpact(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
-	
+
+	//////////////////////////////////////////////////////////////////////////
+	// 对象池支持（由 UProjectilePoolSubsystem 调用，仅在服务器上执行）
+
+	/** 标记此投射物归对象池管理。撞击后将回收到池中，而不是被销毁。*/
+	void MarkAsPooled() { bPooled = true; }
+
+	/** 此投射物是否归对象池管理。*/
+	FORCEINLINE bool IsPooled() const { return bPooled; }
+
+	/** 此投射物当前是否处于飞行状态。*/
+	FORCEINLINE bool IsPoolActive() const { return bPoolActive; }
+
+	/** 最近一次从池中发射的世界时间，用于飞行超时回收。*/
+	FORCEINLINE float GetPoolLaunchTime() const { return PoolLaunchTime; }
+
+	/** 在指定位置和朝向重新发射投射物，并重置移动、碰撞与复制状态。*/
+	void ActivateFromPool(const FVector& Location, const FRotator& Rotation);
+
+	/** 停止移动、关闭碰撞并进入休眠，等待下一次激活。bPlayEffect 为 true 时播放爆炸特效。*/
+	void DeactivateToPool(bool bPlayEffect);
+
+	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** 服务器：记录这一发对应的客户端预测ID（INDEX_NONE 表示未预测）。对象池复用时每次激活都要重新设置。*/
+	void SetPredictionId(int32 InPredictionId) { PredictionId = InPredictionId; }
+
+	/** 本机是否是预测了这一发的开火者客户端。是则本投射物不显示，由 UProjectileSimulationSubsystem 中的预测投射物负责表现。*/
+	bool IsPredictedLocally() const;
 
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** RepNotify，客户端据此同步对象池的激活与回收。*/
+	UFUNCTION()
+	void OnRep_PooledState();
+
+	/** 在本机上应用激活状态：移动到发射点，恢复碰撞、显示与移动组件。*/
+	void ApplyPoolActivation(const FVector& Location, const FRotator& Rotation);
+
+	/** 在本机上应用回收状态：隐藏、关闭碰撞并停止移动组件。*/
+	void ApplyPoolDeactivation();
+
+	/** 根据飞行状态和 mp.Projectile.BatchedSweeps 决定是否由 UProjectileSimulationSubsystem 批量移动（仅服务器）。*/
+	void UpdateSweepBatchRegistration();
+
+	/** 在当前位置播放爆炸特效（交给 UImpactEffectSubsystem 合并、裁剪后从组件池播放）。*/
+	void PlayImpactEffect();
+
+	/** 飞行中的投射物计数（UGameplayCountersSubsystem）。在 BeginPlay 之后每次进入或离开飞行状态时调用。*/
+	void UpdateActiveCounter(int32 Delta);
+
+	/** 服务器上把飞出世界的对象池投射物静默回收到池中。返回 false 时按普通Actor处理（销毁）。*/
+	bool ReleaseOutOfWorld();
+
+	/** 把 MeshAsset 设置到网格体组件上；资产尚未加载完成时异步请求，完成后再次调用。专用服务器上不做任何事。*/
+	void ApplyMeshAsset();
+
+	// 对象池复制状态
+	UPROPERTY(ReplicatedUsing=OnRep_PooledState)
+	FPooledProjectileState PooledState;
+
+	// 开火者客户端预测这一发时使用的ID，只复制给拥有者。
+	UPROPERTY(Replicated)
+	int32 PredictionId;
+
+private:
+	// 是否归对象池管理
+	bool bPooled;
+
+	// 本机上是否处于飞行状态
+	bool bPoolActive;
 
+	// 最近一次从池中发射的世界时间（仅服务器）
+	float PoolLaunchTime;
 };
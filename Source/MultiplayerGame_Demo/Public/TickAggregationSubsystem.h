@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "TickAggregationSubsystem.generated.h"
+
+/** 批量更新函数：每次对组内所有对象调用一次，而不是每个对象各自Tick。*/
+typedef void (*FAggregatedTickFunction)(TArrayView<UObject* const> Objects, float DeltaTime);
+
+/**
+ * Tick聚合管理器。
+ * 玩法类把需要周期性更新的对象注册到命名分组中，由本子系统每帧（或按分组的间隔）对整个分组调用一次批量函数，
+ * 代替每个Actor各自的Tick或定时器：减少Tick列表和定时器堆中的条目，同类数据在一次循环里连续处理。
+ * 对象只在需要更新时加入分组（例如开火冷却期间），空闲时不产生任何开销。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API UTickAggregationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	/** 注册一个分组。Interval 为0时每帧调用，否则按间隔调用并传入累计的时间。已存在的分组保持不变。*/
+	void RegisterGroup(FName GroupName, FAggregatedTickFunction Function, float Interval = 0.0f);
+
+	/** 把对象加入分组（重复加入会被忽略）。分组必须已注册。*/
+	void AddObject(FName GroupName, UObject* Object);
+
+	/** 把对象移出分组。可以在批量函数执行期间调用。*/
+	void RemoveObject(FName GroupName, UObject* Object);
+
+	/** 分组中的对象数量。*/
+	int32 GetNumObjects(FName GroupName) const;
+
+	/** 把各分组的对象数量和间隔输出到日志（mp.TickAudit 会一并调用）。*/
+	void LogGroups() const;
+
+private:
+	struct FTickAggregationGroup
+	{
+		FAggregatedTickFunction Function = nullptr;
+		float Interval = 0.0f;
+		float TimeSinceLastTick = 0.0f;
+		TArray<TWeakObjectPtr<UObject>> Objects;
+	};
+
+	TMap<FName, FTickAggregationGroup> Groups;
+
+	// 每个分组调用前收集的有效对象，批量函数执行期间对分组的增删不会影响它
+	TArray<UObject*> ScratchObjects;
+};
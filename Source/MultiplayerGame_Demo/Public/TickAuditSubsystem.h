@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "TickAuditSubsystem.generated.h"
+
+/**
+ * 审计期间代替原Tick函数执行的探针：使用相同的Tick组、间隔和前置条件注册，
+ * 由它调用原Tick函数并累计耗时。原Tick函数在审计期间被禁用，结束后恢复。
+ */
+struct FTickAuditProbe : public FTickFunction
+{
+	// 被测量的Tick函数及其所属对象
+	FTickFunction* Target = nullptr;
+	TWeakObjectPtr<UObject> TargetObject;
+	UClass* TargetClass = nullptr;
+
+	// 是否由探针代为执行（可在任意线程执行的Tick函数只统计数量）
+	bool bMeasured = false;
+
+	uint64 Cycles = 0;
+	int32 NumCalls = 0;
+
+	// FTickFunction interface
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	// End of FTickFunction interface
+};
+
+/**
+ * Tick开销审计（控制台命令 mp.TickAudit [帧数]）。
+ * 在指定帧数内测量当前世界中所有已启用的Actor与组件Tick函数，按类、Tick组和间隔汇总数量与每帧耗时，
+ * 并对几乎不做事情的Tick给出警告，帮助找出应当关闭Tick或改用 UTickAggregationSubsystem 批量更新的类。
+ * 审计期间同一Tick组内的执行顺序可能改变，只用于开发诊断。
+ */
+UCLASS()
+class MULTIPLAYERGAME_DEMO_API UTickAuditSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	// End of USubsystem interface
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override { return Probes.Num() > 0; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject interface
+
+	/** 开始审计，NumFrames 帧后输出报告。*/
+	void StartAudit(int32 NumFrames);
+
+	/** 审计是否正在进行。*/
+	bool IsAuditing() const { return Probes.Num() > 0; }
+
+private:
+	/** 为一个已注册并启用的Tick函数创建探针。*/
+	void AddProbe(UObject* Owner, FTickFunction& TickFunction, ULevel* Level);
+
+	/** 输出报告并恢复所有原Tick函数。*/
+	void FinishAudit(bool bReport);
+
+	TArray<TUniquePtr<FTickAuditProbe>> Probes;
+
+	int32 FramesToSample = 0;
+	int32 FramesSampled = 0;
+};
@@ -9,6 +9,7 @@ public class MultiplayerGame_DemoEditorTarget : TargetRules
 	{
 		Type = TargetType.Editor;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
+		bWithPushModel = true;
 		ExtraModuleNames.Add("MultiplayerGame_Demo");
 	}
 }
@@ -0,0 +1,15 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+public class MultiplayerGame_DemoServerTarget : TargetRules
+{
+	public MultiplayerGame_DemoServerTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Server;
+		DefaultBuildSettings = BuildSettingsVersion.V2;
+		bWithPushModel = true;
+		ExtraModuleNames.Add("MultiplayerGame_Demo");
+	}
+}